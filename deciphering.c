@@ -2,7 +2,6 @@
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
-#include <mach/mach_time.h>
 #include <arpa/inet.h> // for ntohl
 
 typedef struct {
@@ -18,11 +17,17 @@ typedef struct {
 	uint32_t matchNumber;       // 4 bytes
 } Message;
 
-/* read big-endian integer up to 8 bytes */
-static uint64_t read_be(const uint8_t *b, size_t nbytes) {
-	uint64_t v = 0;
-	for (size_t i = 0; i < nbytes; ++i) v = (v << 8) | b[i];
-	return v;
+/* fixed-width big-endian reads: one unaligned load and a byte swap each */
+static uint16_t read_be16(const uint8_t *b) {
+	uint16_t v;
+	memcpy(&v, b, sizeof(v));
+	return __builtin_bswap16(v);
+}
+
+static uint64_t read_be64(const uint8_t *b) {
+	uint64_t v;
+	memcpy(&v, b, sizeof(v));
+	return __builtin_bswap64(v);
 }
 
 /* Parse 6-byte big-endian timestamp into a 64-bit integer efficiently on little-endian machines like x86/arm64 */
@@ -40,14 +45,14 @@ Message parseMessage(const unsigned char *msg, size_t len) {
 	if (len < 11) return ee; // too short
 
 	ee.messageType = (char)msg[0];
-	ee.stockLocate = (uint16_t)read_be(msg + 1, 2);
-	ee.trackingNumber = (uint16_t)read_be(msg + 3, 2);
+	ee.stockLocate = read_be16(msg + 1);
+	ee.trackingNumber = read_be16(msg + 3);
 	ee.timestamp = parse_6byte_be_as_u64(msg + 5);
 
 	/* Following fields depend on message type and layout; example offsets below are for the C message you provided (Single Side Executed With Price)
 	   Check and adjust offsets per ITTO/ITCH spec for other message types. */
 	if (len >= 17) {
-		ee.referenceNumber = read_be(msg + 11, 8);
+		ee.referenceNumber = read_be64(msg + 11);
 	}
 	if (len >= 21) {
 		uint32_t t;
@@ -107,30 +112,9 @@ int main() {
 		0x4A,0x00,0x00,0x1E,0xD5,0x01,0x12,0x20,0xA2,0x00,0x00,0x00,0x00,0xB3,0x28,0xA3,0xE4,0x00,0x00,0x00,0x00,0xB3,0x28,0xA3,0xE8,0x00,0x00,0xE4,0x10,0x00,0x66,0x14,0xD0,0x00,0x00,0x00,0x05,0x00,0x68,0x62,0xA8,0x00,0x00,0x00,0x05
 	};
 
-	mach_timebase_info_data_t timebase;
-	mach_timebase_info(&timebase);
-
-	const int iterations = 1000000;
-	volatile uint64_t dummy = 0;
-
-	uint64_t start = mach_absolute_time();
-	Message ee;
-	size_t lenC = sizeof messageC;
-	size_t lenJ = sizeof messageJ;
-	for (int i = 0; i < iterations; i++) {
-		ee = parseMessage(messageC, lenC);
-		ee = parseMessage(messageJ, lenJ);
-		dummy += ee.trackingNumber;
-	}
-	uint64_t end = mach_absolute_time();
-
-	double elapsed_ns = (double)(end - start) * (double)timebase.numer / (double)timebase.denom;
-	double elapsed_per_iter = elapsed_ns / iterations;
-
-	printf("Total elapsed time: %.4f ns\n", elapsed_ns);
-	printf("Average per iteration: %.4f ns\n", elapsed_per_iter);
-
-	if (dummy == 0) printf("");
+	/* Timing lives in itch_bench (make bench), over real message mixes */
+	Message ee = parseMessage(messageC, message_length_by_type(messageC[0]));
+	ee = parseMessage(messageJ, message_length_by_type(messageJ[0]));
 
 	printf("\n--- Last Parsed Message (C then J) ---\n");
 	printf("Message Type: %c\n", ee.messageType);
@@ -2,7 +2,6 @@
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
-#include <mach/mach_time.h>
 
 typedef struct {
     char messageType;
@@ -15,12 +14,10 @@ typedef struct {
     uint32_t matchNumber;
 } Message;
 
-static inline uint64_t read_be(const uint8_t *b, size_t nbytes) {
-    uint64_t v = 0;
-#pragma clang loop unroll(full)
-    for (size_t i = 0; i < nbytes; ++i)
-        v = (v << 8) | b[i];
-    return v;
+static inline uint64_t read_be64(const uint8_t *b) {
+    uint64_t v;
+    memcpy(&v, b, sizeof(v));
+    return __builtin_bswap64(v);
 }
 
 static inline uint64_t parse_6byte_be_as_u64(const uint8_t *b) {
@@ -43,7 +40,7 @@ static inline Message parseMessage(const uint8_t *msg, size_t len) {
     ee.trackingNumber = (uint16_t)((msg[3] << 8) | msg[4]);
     ee.timestamp      = parse_6byte_be_as_u64(msg + 5);
 
-    if (len >= 19) ee.referenceNumber   = read_be(msg + 11, 8);
+    if (len >= 19) ee.referenceNumber   = read_be64(msg + 11);
     if (len >= 23) ee.executedContracts = __builtin_bswap32(*(const uint32_t*)(msg + 19));
     if (len >= 27) ee.crossNumber       = __builtin_bswap32(*(const uint32_t*)(msg + 23));
     if (len >= 31) ee.matchNumber       = __builtin_bswap32(*(const uint32_t*)(msg + 27));
@@ -65,35 +62,15 @@ int main(void) {
         0x62,0xA8,0x00,0x00,0x00,0x05
     };
 
-    mach_timebase_info_data_t tb;
-    mach_timebase_info(&tb);
+    /* Timing lives in itch_bench (make bench), over real message mixes */
+    Message ee = parseMessage(messageC, sizeof messageC);
+    ee = parseMessage(messageJ, sizeof messageJ);
 
-    const int iterations = 1000000;
-    volatile uint64_t dummy = 0;
-
-    uint64_t start = mach_absolute_time();
-    Message ee;
-    size_t lenC = sizeof messageC;
-    size_t lenJ = sizeof messageJ;
-
-    for (int i = 0; i < iterations; i++) {
-        ee = parseMessage(messageC, lenC);
-        ee = parseMessage(messageJ, lenJ);
-        dummy += ee.trackingNumber;
-    }
-
-    uint64_t end = mach_absolute_time();
-
-    double elapsed_ns = (double)(end - start) * tb.numer / tb.denom;
-    double per_iter = elapsed_ns / iterations;
-
-    printf("Total: %.3f ns\nAvg/iter: %.3f ns\n", elapsed_ns, per_iter);
     printf("\n--- Last Message ---\n");
     printf("Type: %c\nLocate: %u\nTrack: %u\nTimestamp: %" PRIu64 "\n",
            ee.messageType, ee.stockLocate, ee.trackingNumber, ee.timestamp);
     printf("Ref#: %" PRIu64 "\nExec: %u\nCross: %u\nMatch: %u\n",
            ee.referenceNumber, ee.executedContracts, ee.crossNumber, ee.matchNumber);
 
-    if (dummy == 0) printf("");
     return 0;
 }
@@ -0,0 +1,741 @@
+/*
+ * Fanout - see fanout.h
+ *
+ * Threads and ownership:
+ * - The publisher owns head (bytes) and rec_head (message records). It
+ *   writes ahead of them from pub_head/pub_rec and moves them on flush.
+ * - The IO thread owns every client, every cursor, tail and rec_tail.
+ * They meet only through those four atomics plus the wake eventfd, which
+ * the publisher writes only when the IO thread is about to sleep.
+ *
+ * Besides the byte ring, the publisher records the end position of every
+ * message in a record ring. The IO thread only looks at it when it drops a
+ * client: if the client is partway through a message, the rest of that
+ * message is copied to the client's stash and sent before the live stream,
+ * so the stream is never cut mid-message and the dropped client stops
+ * holding back the tail at once.
+ *
+ * A subscribed client reads the record ring too: its cursor only ever moves
+ * a whole message at a time, so it always sits on a boundary (a drop needs
+ * no stash), and rec is the record that starts there. Messages its filter
+ * passes are copied into its send buffer; the rest are skipped in place.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "fanout.h"
+
+#define DEFAULT_MAX_CLIENTS 1024
+#define DEFAULT_RING_SIZE (64u << 20)
+#define DEFAULT_FLUSH_BYTES (64u << 10)
+#define MIN_RECORD_BYTES 16     // smallest framed message the record ring is sized for
+#define STASH_SIZE 512          // longest partial message a drop preserves
+#define EPOLL_BATCH 256
+#define IDLE_TIMEOUT_MS 100
+#define HANDSHAKE_POLL_MS 5     // epoll timeout while a client is in its handshake
+#define REQUEST_MAX 16384       // longest request line
+#define SEND_BUFFER (128u << 10) // subscribed clients: gathered messages per write (> any framed message)
+
+#define TAG_LISTEN UINT32_MAX
+#define TAG_WAKE (UINT32_MAX - 1)
+
+#define STAT_ADD(f, field, n) atomic_fetch_add_explicit(&(f)->stats.field, (n), memory_order_relaxed)
+
+typedef struct {
+    int fd;                     // -1 = free slot
+    int blocked;                // EAGAIN: waiting for EPOLLOUT
+    uint64_t cursor;            // next ring byte to send (after the stash)
+    uint16_t stash_len;         // rest of the message in flight when dropped
+    uint16_t stash_sent;
+    uint8_t stash[STASH_SIZE];
+    struct sockaddr_in addr;
+    // Subscriptions
+    int handshake;              // held at its join position until its request line
+    uint64_t handshake_until;   // CLOCK_MONOTONIC ns
+    char *request;              // request line so far
+    size_t request_len;
+    fanout_filter_t *filter;    // NULL = whole feed
+    uint64_t rec;               // filtered: record starting at cursor
+    uint8_t *out;               // filtered: gathered messages, [out_sent, out_len) unsent
+    size_t out_len;
+    size_t out_sent;
+} fanout_client_t;
+
+typedef struct {
+    _Atomic uint64_t clients_accepted;
+    _Atomic uint64_t clients_rejected;
+    _Atomic uint64_t clients_active;
+    _Atomic uint64_t disconnects;
+    _Atomic uint64_t slow_disconnects;
+    _Atomic uint64_t drops;
+    _Atomic uint64_t dropped_bytes;
+    _Atomic uint64_t writev_calls;
+    _Atomic uint64_t bytes_out;
+    _Atomic uint64_t publisher_waits;
+    _Atomic uint64_t flushes;
+    _Atomic uint64_t wakeups;
+    _Atomic uint64_t subscriptions;
+    _Atomic uint64_t filtered_bytes;
+} fanout_counters_t;
+
+struct fanout {
+    fanout_config_t cfg;
+    uint8_t *ring;
+    size_t ring_mask;
+    uint64_t *records;          // end position of each message
+    uint32_t *tags;             // and its FANOUT_TAG
+    size_t record_mask;
+
+    uint64_t pub_head;          // publisher only: bytes written, flushed or not
+    uint64_t pub_rec;
+    _Atomic uint64_t head;      // publisher: bytes flushed
+    _Atomic uint64_t rec_head;  // publisher: messages flushed
+    _Atomic uint64_t tail;      // IO thread: slowest client cursor (head if none)
+    _Atomic uint64_t rec_tail;  // IO thread: oldest record still needed
+    _Atomic int io_sleeping;
+    _Atomic int running;
+
+    int epfd;
+    int wakefd;
+    fanout_client_t *clients;
+    int client_count;
+    int handshakes;             // clients still in their handshake
+    pthread_t thread;
+    fanout_counters_t stats;
+};
+
+static size_t round_pow2(size_t x) {
+    size_t p = 1;
+    while (p < x) p <<= 1;
+    return p;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void wake_io(fanout_t *f) {
+    uint64_t one = 1;
+    ssize_t r = write(f->wakefd, &one, sizeof(one));
+    (void)r;
+    STAT_ADD(f, wakeups, 1);
+}
+
+/* ========== IO thread ========== */
+
+/* Free a client's subscription state, telling the owner first */
+static void release_client(fanout_t *f, fanout_client_t *c) {
+    if (c->filter && f->cfg.on_close) f->cfg.on_close(f->cfg.ctx, (int)(c - f->clients));
+    if (c->handshake) f->handshakes--;
+    free(c->filter);
+    free(c->out);
+    free(c->request);
+    c->filter = NULL;
+    c->out = NULL;
+    c->request = NULL;
+    c->handshake = 0;
+}
+
+static void close_client(fanout_t *f, fanout_client_t *c, const char *why) {
+    printf("Client %d disconnected (%s)\n", (int)(c - f->clients), why);
+    epoll_ctl(f->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    close(c->fd);
+    release_client(f, c);
+    c->fd = -1;
+    f->client_count--;
+    atomic_store_explicit(&f->stats.clients_active, (uint64_t)f->client_count, memory_order_relaxed);
+}
+
+/* The first record ending after pos: the message starting at boundary pos */
+static uint64_t record_after(fanout_t *f, uint64_t pos) {
+    uint64_t lo = atomic_load_explicit(&f->rec_tail, memory_order_relaxed);
+    uint64_t hi = atomic_load_explicit(&f->rec_head, memory_order_acquire);
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (f->records[mid & f->record_mask] <= pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void accept_clients(fanout_t *f) {
+    for (;;) {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        int fd = accept4(f->cfg.listen_fd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) perror("accept");
+            return;
+        }
+
+        int slot = -1;
+        for (int i = 0; i < f->cfg.max_clients; i++) {
+            if (f->clients[i].fd < 0) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot < 0) {
+            printf("Max clients reached, rejecting connection\n");
+            STAT_ADD(f, clients_rejected, 1);
+            close(fd);
+            continue;
+        }
+
+        if (f->cfg.mode == FANOUT_LATENCY) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+
+        fanout_client_t *c = &f->clients[slot];
+        memset(c, 0, sizeof(*c));
+        c->fd = fd;
+        c->addr = addr;
+        c->cursor = atomic_load_explicit(&f->head, memory_order_acquire);   // join live
+        c->rec = record_after(f, c->cursor);
+        if (f->cfg.handshake_ms > 0 && f->cfg.on_request) {
+            // Held here, pinning the tail, until its request line or the deadline
+            c->handshake = 1;
+            c->handshake_until = now_ns() + (uint64_t)f->cfg.handshake_ms * 1000000;
+            f->handshakes++;
+        }
+
+        struct epoll_event ev = { .events = EPOLLIN, .data.u32 = (uint32_t)slot };
+        if (epoll_ctl(f->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            perror("epoll_ctl");
+            close(fd);
+            c->fd = -1;
+            continue;
+        }
+        f->client_count++;
+        atomic_store_explicit(&f->stats.clients_active, (uint64_t)f->client_count, memory_order_relaxed);
+        STAT_ADD(f, clients_accepted, 1);
+        printf("Client %d connected from %s:%d\n", slot, inet_ntoa(addr.sin_addr), ntohs(addr.sin_port));
+    }
+}
+
+static void set_blocked(fanout_t *f, fanout_client_t *c, int blocked) {
+    c->blocked = blocked;
+    struct epoll_event ev = {
+        .events = EPOLLIN | (blocked ? EPOLLOUT : 0),
+        .data.u32 = (uint32_t)(c - f->clients),
+    };
+    epoll_ctl(f->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+/* End of the message containing byte position pos: the first record end >= pos */
+static uint64_t message_end_at(fanout_t *f, uint64_t pos) {
+    uint64_t lo = atomic_load_explicit(&f->rec_tail, memory_order_relaxed);
+    uint64_t hi = atomic_load_explicit(&f->rec_head, memory_order_acquire);
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (f->records[mid & f->record_mask] < pos) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < atomic_load_explicit(&f->rec_head, memory_order_relaxed)
+         ? f->records[lo & f->record_mask] : pos;
+}
+
+/* Apply the slow-consumer policy. Returns 0 if the client was closed. */
+static int apply_policy(fanout_t *f, fanout_client_t *c, uint64_t head) {
+    if (f->cfg.policy == FANOUT_BACKPRESSURE) return 1;
+    if (head - c->cursor <= f->cfg.high_water) return 1;
+
+    // A drop keeps the rest of a partly sent message; one too long to stash
+    // closes the client instead. While a stash is unsent nothing past it has
+    // gone out, so the cursor is on a boundary and needs no new stash.
+    uint64_t end = message_end_at(f, c->cursor);
+    if (f->cfg.policy == FANOUT_DISCONNECT || end - c->cursor > STASH_SIZE) {
+        STAT_ADD(f, slow_disconnects, 1);
+        close_client(f, c, "slow consumer");
+        return 0;
+    }
+
+    if (end != c->cursor) {
+        size_t n = (size_t)(end - c->cursor);
+        size_t start = (size_t)(c->cursor & f->ring_mask);
+        size_t first = n < f->ring_mask + 1 - start ? n : f->ring_mask + 1 - start;
+        memcpy(c->stash, f->ring + start, first);
+        memcpy(c->stash + first, f->ring, n - first);
+        c->stash_len = (uint16_t)n;
+        c->stash_sent = 0;
+    }
+
+    STAT_ADD(f, drops, 1);
+    STAT_ADD(f, dropped_bytes, head - end);
+    c->cursor = head;
+    if (c->filter) c->rec = record_after(f, head);
+    return 1;
+}
+
+/* Send the stash, then as much of [cursor, head) as the socket takes.
+ * Returns 0 if the client was closed. */
+static int flush_client(fanout_t *f, fanout_client_t *c, uint64_t head) {
+    size_t ring_size = f->ring_mask + 1;
+    for (;;) {
+        size_t stash = (size_t)(c->stash_len - c->stash_sent);
+        size_t n = (size_t)(head - c->cursor);
+        if (stash == 0 && n == 0) return 1;
+
+        size_t start = (size_t)(c->cursor & f->ring_mask);
+        size_t first = n < ring_size - start ? n : ring_size - start;
+        struct iovec iov[3];
+        int iovcnt = 0;
+        if (stash) iov[iovcnt++] = (struct iovec){ c->stash + c->stash_sent, stash };
+        if (first) iov[iovcnt++] = (struct iovec){ f->ring + start, first };
+        if (n > first) iov[iovcnt++] = (struct iovec){ f->ring, n - first };
+        struct msghdr mh = { .msg_iov = iov, .msg_iovlen = (size_t)iovcnt };
+
+        // Throughput mode: let the kernel fill segments while a newer flush waits
+        int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+        if (f->cfg.mode == FANOUT_THROUGHPUT &&
+            atomic_load_explicit(&f->head, memory_order_relaxed) != head) {
+            flags |= MSG_MORE;
+        }
+        ssize_t sent = sendmsg(c->fd, &mh, flags);
+        STAT_ADD(f, writev_calls, 1);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_blocked(f, c, 1);
+                return 1;
+            }
+            if (errno == EINTR) continue;
+            STAT_ADD(f, disconnects, 1);
+            close_client(f, c, strerror(errno));
+            return 0;
+        }
+        STAT_ADD(f, bytes_out, (uint64_t)sent);
+        size_t from_stash = (size_t)sent < stash ? (size_t)sent : stash;
+        c->stash_sent += (uint16_t)from_stash;
+        c->cursor += (uint64_t)sent - from_stash;
+        if ((size_t)sent < stash + n) {
+            // Short write: the socket buffer is full
+            set_blocked(f, c, 1);
+            return 1;
+        }
+    }
+}
+
+/* Subscribed client: copy the messages its filter passes from [cursor, head)
+ * into its send buffer, skipping the rest */
+static void gather_client(fanout_t *f, fanout_client_t *c, uint64_t head) {
+    if (c->out_sent == c->out_len) c->out_len = c->out_sent = 0;
+    uint64_t rec_head = atomic_load_explicit(&f->rec_head, memory_order_acquire);
+    uint64_t filtered = 0;
+    while (c->rec < rec_head && c->cursor < head) {
+        uint64_t end = f->records[c->rec & f->record_mask];
+        size_t n = (size_t)(end - c->cursor);
+        if (fanout_filter_pass(c->filter, f->tags[c->rec & f->record_mask])) {
+            if (c->out_len + n > SEND_BUFFER) break;
+            size_t start = (size_t)(c->cursor & f->ring_mask);
+            size_t first = n < f->ring_mask + 1 - start ? n : f->ring_mask + 1 - start;
+            memcpy(c->out + c->out_len, f->ring + start, first);
+            memcpy(c->out + c->out_len + first, f->ring, n - first);
+            c->out_len += n;
+        } else {
+            filtered += n;
+        }
+        c->cursor = end;
+        c->rec++;
+    }
+    if (filtered) STAT_ADD(f, filtered_bytes, filtered);
+}
+
+/* Subscribed client: gather and send until caught up or the socket is full.
+ * Returns 0 if the client was closed. */
+static int flush_filtered(fanout_t *f, fanout_client_t *c, uint64_t head) {
+    for (;;) {
+        if (c->out_sent == c->out_len) gather_client(f, c, head);
+        size_t n = c->out_len - c->out_sent;
+        if (n == 0) return 1;
+
+        int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+        if (f->cfg.mode == FANOUT_THROUGHPUT && c->cursor < head) flags |= MSG_MORE;
+        ssize_t sent = send(c->fd, c->out + c->out_sent, n, flags);
+        STAT_ADD(f, writev_calls, 1);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_blocked(f, c, 1);
+                return 1;
+            }
+            if (errno == EINTR) continue;
+            STAT_ADD(f, disconnects, 1);
+            close_client(f, c, strerror(errno));
+            return 0;
+        }
+        STAT_ADD(f, bytes_out, (uint64_t)sent);
+        c->out_sent += (size_t)sent;
+        if ((size_t)sent < n) {
+            set_blocked(f, c, 1);
+            return 1;
+        }
+    }
+}
+
+/* End a client's handshake. line is its request, or NULL when the deadline
+ * passed first (whole feed). Returns 0 if the client was closed. */
+static int finish_handshake(fanout_t *f, fanout_client_t *c, const char *line) {
+    int id = (int)(c - f->clients);
+    c->handshake = 0;
+    f->handshakes--;
+    if (!line) {
+        free(c->request);
+        c->request = NULL;
+        return 1;
+    }
+
+    c->filter = calloc(1, sizeof(fanout_filter_t));
+    c->out = malloc(SEND_BUFFER);
+    if (!c->filter || !c->out) {
+        free(c->filter);
+        c->filter = NULL;
+        close_client(f, c, "out of memory");
+        return 0;
+    }
+    if (f->cfg.on_request(f->cfg.ctx, id, line, c->filter) < 0) {
+        // Rejected: on_close is only owed for accepted requests
+        free(c->filter);
+        c->filter = NULL;
+        STAT_ADD(f, disconnects, 1);
+        close_client(f, c, "bad request");
+        return 0;
+    }
+    free(c->request);
+    c->request = NULL;
+    STAT_ADD(f, subscriptions, 1);
+    return 1;
+}
+
+/* Read a handshaking client's request line. Returns 0 if the client was closed. */
+static int read_request(fanout_t *f, fanout_client_t *c) {
+    if (!c->request) {
+        c->request = malloc(REQUEST_MAX);
+        if (!c->request) {
+            close_client(f, c, "out of memory");
+            return 0;
+        }
+    }
+    ssize_t r = recv(c->fd, c->request + c->request_len, REQUEST_MAX - c->request_len, MSG_DONTWAIT);
+    if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+        STAT_ADD(f, disconnects, 1);
+        close_client(f, c, r == 0 ? "closed" : strerror(errno));
+        return 0;
+    }
+    if (r < 0) return 1;
+    c->request_len += (size_t)r;
+
+    char *nl = memchr(c->request, '\n', c->request_len);
+    if (!nl) {
+        if (c->request_len < REQUEST_MAX) return 1;
+        close_client(f, c, "request too long");
+        return 0;
+    }
+    *nl = '\0';
+    if (nl > c->request && nl[-1] == '\r') nl[-1] = '\0';
+    return finish_handshake(f, c, c->request);
+}
+
+/* Publish the slowest cursor and release records every client is past */
+static void update_tail(fanout_t *f, uint64_t head) {
+    uint64_t tail = head;
+    for (int i = 0; i < f->cfg.max_clients; i++) {
+        if (f->clients[i].fd >= 0 && f->clients[i].cursor < tail) tail = f->clients[i].cursor;
+    }
+    atomic_store_explicit(&f->tail, tail, memory_order_release);
+
+    // Keep the record ending at tail: it tells apply_policy the cursor is on a boundary
+    uint64_t rt = atomic_load_explicit(&f->rec_tail, memory_order_relaxed);
+    uint64_t rh = atomic_load_explicit(&f->rec_head, memory_order_acquire);
+    while (rt < rh && f->records[rt & f->record_mask] < tail) rt++;
+    atomic_store_explicit(&f->rec_tail, rt, memory_order_release);
+}
+
+static void handle_client_event(fanout_t *f, fanout_client_t *c, uint32_t events) {
+    if (c->fd < 0) return;
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        STAT_ADD(f, disconnects, 1);
+        close_client(f, c, "hangup");
+        return;
+    }
+    if ((events & EPOLLIN) && c->handshake) {
+        read_request(f, c);
+        return;
+    }
+    if (events & EPOLLIN) {
+        // Nothing more is read after the handshake; read to notice EOF
+        uint8_t buf[512];
+        ssize_t r = recv(c->fd, buf, sizeof(buf), MSG_DONTWAIT);
+        if (r == 0 || (r < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            STAT_ADD(f, disconnects, 1);
+            close_client(f, c, r == 0 ? "closed" : strerror(errno));
+            return;
+        }
+    }
+    if ((events & EPOLLOUT) && c->blocked) set_blocked(f, c, 0);
+}
+
+static void *io_thread(void *arg) {
+    fanout_t *f = arg;
+    struct epoll_event events[EPOLL_BATCH];
+
+    while (atomic_load_explicit(&f->running, memory_order_relaxed)) {
+        uint64_t head = atomic_load_explicit(&f->head, memory_order_acquire);
+        uint64_t now = f->handshakes ? now_ns() : 0;
+        int pending = 0;
+
+        for (int i = 0; i < f->cfg.max_clients; i++) {
+            fanout_client_t *c = &f->clients[i];
+            if (c->fd < 0) continue;
+            if (c->handshake && (now < c->handshake_until || !finish_handshake(f, c, NULL))) continue;
+            if (!apply_policy(f, c, head)) continue;
+            if (c->filter) {
+                if (c->blocked || (c->cursor >= head && c->out_sent == c->out_len)) continue;
+                if (flush_filtered(f, c, head) && !c->blocked && c->cursor < head) pending = 1;
+                continue;
+            }
+            if (c->blocked || (c->cursor >= head && c->stash_sent == c->stash_len)) continue;
+            if (flush_client(f, c, head) && !c->blocked && c->cursor < head) pending = 1;
+        }
+        update_tail(f, head);
+
+        // Sleep only when every client is caught up or parked on EPOLLOUT
+        int timeout = 0;
+        if (!pending) {
+            atomic_store(&f->io_sleeping, 1);
+            if (atomic_load(&f->head) == head) timeout = f->handshakes ? HANDSHAKE_POLL_MS : IDLE_TIMEOUT_MS;
+        }
+        int n = epoll_wait(f->epfd, events, EPOLL_BATCH, timeout);
+        atomic_store(&f->io_sleeping, 0);
+
+        for (int i = 0; i < n; i++) {
+            uint32_t tag = events[i].data.u32;
+            if (tag == TAG_LISTEN) {
+                accept_clients(f);
+            } else if (tag == TAG_WAKE) {
+                uint64_t v;
+                ssize_t r = read(f->wakefd, &v, sizeof(v));
+                (void)r;
+            } else {
+                handle_client_event(f, &f->clients[tag], events[i].events);
+            }
+        }
+    }
+    return NULL;
+}
+
+/* ========== Public API ========== */
+
+fanout_t *fanout_create(const fanout_config_t *cfg) {
+    fanout_t *f = calloc(1, sizeof(fanout_t));
+    if (!f) return NULL;
+    f->cfg = *cfg;
+    if (f->cfg.max_clients <= 0) f->cfg.max_clients = DEFAULT_MAX_CLIENTS;
+    size_t ring_size = round_pow2(f->cfg.ring_size ? f->cfg.ring_size : DEFAULT_RING_SIZE);
+    f->cfg.ring_size = ring_size;
+    if (f->cfg.high_water == 0 || f->cfg.high_water >= ring_size) f->cfg.high_water = ring_size / 2;
+    if (f->cfg.flush_bytes == 0) f->cfg.flush_bytes = DEFAULT_FLUSH_BYTES;
+    if (f->cfg.flush_bytes > f->cfg.high_water) f->cfg.flush_bytes = f->cfg.high_water;
+    f->ring_mask = ring_size - 1;
+    size_t records = round_pow2(ring_size / MIN_RECORD_BYTES);
+    f->record_mask = records - 1;
+    f->epfd = -1;
+    f->wakefd = -1;
+
+    f->ring = malloc(ring_size);
+    f->records = malloc(records * sizeof(uint64_t));
+    f->tags = malloc(records * sizeof(uint32_t));
+    f->clients = malloc((size_t)f->cfg.max_clients * sizeof(fanout_client_t));
+    f->epfd = epoll_create1(EPOLL_CLOEXEC);
+    f->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (!f->ring || !f->records || !f->tags || !f->clients || f->epfd < 0 || f->wakefd < 0) {
+        fanout_destroy(f);
+        return NULL;
+    }
+    for (int i = 0; i < f->cfg.max_clients; i++) f->clients[i].fd = -1;
+
+    int flags = fcntl(cfg->listen_fd, F_GETFL, 0);
+    fcntl(cfg->listen_fd, F_SETFL, flags | O_NONBLOCK);
+    struct epoll_event lev = { .events = EPOLLIN, .data.u32 = TAG_LISTEN };
+    struct epoll_event wev = { .events = EPOLLIN, .data.u32 = TAG_WAKE };
+    if (epoll_ctl(f->epfd, EPOLL_CTL_ADD, cfg->listen_fd, &lev) < 0 ||
+        epoll_ctl(f->epfd, EPOLL_CTL_ADD, f->wakefd, &wev) < 0) {
+        fanout_destroy(f);
+        return NULL;
+    }
+
+    atomic_store(&f->running, 1);
+    if (pthread_create(&f->thread, NULL, io_thread, f) != 0) {
+        atomic_store(&f->running, 0);
+        fanout_destroy(f);
+        return NULL;
+    }
+    return f;
+}
+
+void fanout_destroy(fanout_t *f) {
+    if (!f) return;
+    if (atomic_exchange(&f->running, 0)) {
+        wake_io(f);
+        pthread_join(f->thread, NULL);
+    }
+    if (f->clients) {
+        for (int i = 0; i < f->cfg.max_clients; i++) {
+            if (f->clients[i].fd < 0) continue;
+            close(f->clients[i].fd);
+            release_client(f, &f->clients[i]);
+        }
+    }
+    if (f->epfd >= 0) close(f->epfd);
+    if (f->wakefd >= 0) close(f->wakefd);
+    free(f->ring);
+    free(f->records);
+    free(f->tags);
+    free(f->clients);
+    free(f);
+}
+
+static inline void ring_copy(fanout_t *f, uint64_t pos, const uint8_t *src, size_t len) {
+    size_t start = (size_t)(pos & f->ring_mask);
+    size_t first = len < f->ring_mask + 1 - start ? len : f->ring_mask + 1 - start;
+    memcpy(f->ring + start, src, first);
+    memcpy(f->ring, src + first, len - first);
+}
+
+int fanout_publish(fanout_t *f, const uint8_t *prefix, size_t prefix_len,
+                   const uint8_t *msg, size_t len, uint32_t tag) {
+    size_t total = prefix_len + len;
+    size_t ring_size = f->ring_mask + 1;
+    if (total > ring_size) return -1;
+
+    uint64_t head = f->pub_head;
+    uint64_t rec = f->pub_rec;
+
+    // Full: flush, then wait for the IO thread to drain or apply the policy
+    if (head + total - atomic_load_explicit(&f->tail, memory_order_acquire) > ring_size ||
+        rec - atomic_load_explicit(&f->rec_tail, memory_order_acquire) > f->record_mask) {
+        STAT_ADD(f, publisher_waits, 1);
+        fanout_flush(f);
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = 20000 };
+        while (head + total - atomic_load_explicit(&f->tail, memory_order_acquire) > ring_size ||
+               rec - atomic_load_explicit(&f->rec_tail, memory_order_acquire) > f->record_mask) {
+            if (!atomic_load_explicit(&f->running, memory_order_relaxed)) return -1;
+            wake_io(f);
+            nanosleep(&pause, NULL);
+        }
+    }
+
+    if (prefix_len) ring_copy(f, head, prefix, prefix_len);
+    ring_copy(f, head + prefix_len, msg, len);
+    f->records[rec & f->record_mask] = head + total;
+    f->tags[rec & f->record_mask] = tag;
+    f->pub_head = head + total;
+    f->pub_rec = rec + 1;
+
+    if (fanout_pending(f) >= f->cfg.flush_bytes) fanout_flush(f);
+    return 0;
+}
+
+void fanout_flush(fanout_t *f) {
+    if (f->pub_head == atomic_load_explicit(&f->head, memory_order_relaxed)) return;
+    atomic_store_explicit(&f->rec_head, f->pub_rec, memory_order_release);
+    atomic_store(&f->head, f->pub_head);
+    STAT_ADD(f, flushes, 1);
+
+    // Nobody to send to: tail catches up on the IO thread's next timeout
+    if (atomic_load(&f->io_sleeping) &&
+        atomic_load_explicit(&f->stats.clients_active, memory_order_relaxed)) {
+        wake_io(f);
+    }
+}
+
+size_t fanout_pending(const fanout_t *f) {
+    return (size_t)(f->pub_head - atomic_load_explicit(&f->head, memory_order_relaxed));
+}
+
+void fanout_drain(fanout_t *f, int timeout_ms) {
+    fanout_flush(f);
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 1000000 };
+    for (int waited = 0; waited < timeout_ms; waited++) {
+        wake_io(f);
+        nanosleep(&pause, NULL);
+        if (atomic_load_explicit(&f->tail, memory_order_acquire) ==
+            atomic_load_explicit(&f->head, memory_order_acquire)) {
+            return;
+        }
+    }
+}
+
+void fanout_get_stats(fanout_t *f, fanout_stats_t *out) {
+    out->clients_accepted = atomic_load_explicit(&f->stats.clients_accepted, memory_order_relaxed);
+    out->clients_rejected = atomic_load_explicit(&f->stats.clients_rejected, memory_order_relaxed);
+    out->clients_active = atomic_load_explicit(&f->stats.clients_active, memory_order_relaxed);
+    out->disconnects = atomic_load_explicit(&f->stats.disconnects, memory_order_relaxed);
+    out->slow_disconnects = atomic_load_explicit(&f->stats.slow_disconnects, memory_order_relaxed);
+    out->drops = atomic_load_explicit(&f->stats.drops, memory_order_relaxed);
+    out->dropped_bytes = atomic_load_explicit(&f->stats.dropped_bytes, memory_order_relaxed);
+    out->writev_calls = atomic_load_explicit(&f->stats.writev_calls, memory_order_relaxed);
+    out->bytes_out = atomic_load_explicit(&f->stats.bytes_out, memory_order_relaxed);
+    out->publisher_waits = atomic_load_explicit(&f->stats.publisher_waits, memory_order_relaxed);
+    out->flushes = atomic_load_explicit(&f->stats.flushes, memory_order_relaxed);
+    out->wakeups = atomic_load_explicit(&f->stats.wakeups, memory_order_relaxed);
+    out->subscriptions = atomic_load_explicit(&f->stats.subscriptions, memory_order_relaxed);
+    out->filtered_bytes = atomic_load_explicit(&f->stats.filtered_bytes, memory_order_relaxed);
+}
+
+static const char *POLICY_NAMES[] = {
+    [FANOUT_DROP] = "drop",
+    [FANOUT_DISCONNECT] = "disconnect",
+    [FANOUT_BACKPRESSURE] = "backpressure",
+};
+
+int fanout_policy_parse(const char *name, fanout_policy_t *out) {
+    for (size_t i = 0; i < sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0]); i++) {
+        if (strcmp(name, POLICY_NAMES[i]) == 0) {
+            *out = (fanout_policy_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *fanout_policy_name(fanout_policy_t policy) {
+    if ((size_t)policy < sizeof(POLICY_NAMES) / sizeof(POLICY_NAMES[0])) return POLICY_NAMES[policy];
+    return "unknown";
+}
+
+static const char *MODE_NAMES[] = {
+    [FANOUT_LATENCY] = "latency",
+    [FANOUT_THROUGHPUT] = "throughput",
+};
+
+int fanout_mode_parse(const char *name, fanout_mode_t *out) {
+    for (size_t i = 0; i < sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0]); i++) {
+        if (strcmp(name, MODE_NAMES[i]) == 0) {
+            *out = (fanout_mode_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *fanout_mode_name(fanout_mode_t mode) {
+    if ((size_t)mode < sizeof(MODE_NAMES) / sizeof(MODE_NAMES[0])) return MODE_NAMES[mode];
+    return "unknown";
+}
@@ -0,0 +1,162 @@
+/*
+ * Fanout - event-driven TCP broadcast of one message stream to many clients
+ *
+ * The publisher appends framed messages to a single shared byte ring; every
+ * client is a read cursor into it, so a message is copied once no matter how
+ * many clients there are. One IO thread owns all sockets: it accepts on the
+ * listening socket, and for each client writes everything between its cursor
+ * and the ring head with one non-blocking writev (two iovecs across the wrap).
+ * A client that returns EAGAIN is parked on EPOLLOUT; it never holds up the
+ * others or the publisher.
+ *
+ * Slow consumers are handled by policy once their backlog passes the high
+ * water mark (half the ring by default):
+ * - FANOUT_DROP:         skip the client ahead to the live head (it loses the
+ *                        backlog, always resuming on a message boundary)
+ * - FANOUT_DISCONNECT:   close the client
+ * - FANOUT_BACKPRESSURE: never act; the publisher waits for the slowest client
+ *
+ * The publisher never overwrites unsent bytes: when the ring is full it waits
+ * for the IO thread to drain or apply the policy.
+ *
+ * Published messages become visible to the IO thread in batches: on
+ * fanout_flush, or automatically once flush_bytes are pending, so one
+ * writev carries a whole batch instead of one message. The mode picks the
+ * socket side of the trade-off:
+ * - FANOUT_LATENCY:    TCP_NODELAY on every client; the caller flushes
+ *                      each timestamp group
+ * - FANOUT_THROUGHPUT: Nagle stays on and writes carry MSG_MORE while more
+ *                      data is already waiting; the caller flushes rarely
+ *
+ * Subscriptions: every message is published with a tag, its type byte and a
+ * 16-bit key (ITCH: the stockLocate). With handshake_ms set, a new client is
+ * held at its join position until it sends one request line (or the time
+ * runs out, which means the whole feed). on_request turns the line into the
+ * client's filter: a bitmap over type bytes and one over keys. The IO thread
+ * then walks the client's messages through the record ring, tests each tag
+ * with two bit lookups, and copies only the messages that pass into the
+ * client's send buffer, so a narrow subscriber costs one socket write per
+ * buffer of its own messages instead of the whole feed. Key bits may be set
+ * by another thread while the client is live (symbols bound late); one set
+ * before a message is published applies to that message.
+ *
+ * Usage:
+ *   fanout_config_t cfg = { .listen_fd = fd, .max_clients = 1024, .policy = FANOUT_DROP };
+ *   fanout_t *f = fanout_create(&cfg);
+ *   fanout_publish(f, prefix, prefix_len, msg, msg_len, FANOUT_TAG(msg[0], locate));   // per message
+ *   fanout_flush(f);                                       // per batch
+ *   fanout_drain(f, 2000);
+ *   fanout_destroy(f);
+ */
+
+#ifndef FANOUT_H
+#define FANOUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define FANOUT_KEYS 65536
+#define FANOUT_TAG(type, key) (((uint32_t)(uint8_t)(type) << 16) | (uint16_t)(key))
+
+typedef enum {
+    FANOUT_DROP = 0,
+    FANOUT_DISCONNECT,
+    FANOUT_BACKPRESSURE,
+} fanout_policy_t;
+
+typedef enum {
+    FANOUT_LATENCY = 0,
+    FANOUT_THROUGHPUT,
+} fanout_mode_t;
+
+/* What a subscribed client is sent: messages whose type and key bits are both set */
+typedef struct {
+    uint64_t types[256 / 64];
+    _Atomic uint64_t keys[FANOUT_KEYS / 64];
+} fanout_filter_t;
+
+static inline void fanout_filter_set_key(fanout_filter_t *flt, uint16_t key) {
+    atomic_fetch_or_explicit(&flt->keys[key >> 6], 1ULL << (key & 63), memory_order_relaxed);
+}
+
+static inline int fanout_filter_pass(const fanout_filter_t *flt, uint32_t tag) {
+    uint32_t type = tag >> 16, key = tag & 0xffff;
+    return ((flt->types[type >> 6] >> (type & 63)) & 1) &&
+           ((atomic_load_explicit(&flt->keys[key >> 6], memory_order_relaxed) >> (key & 63)) & 1);
+}
+
+/* A client's request line (without the newline), on the IO thread. Fill
+ * filter (zeroed) and return 0, or return -1 to close the client. filter
+ * stays valid, and may be updated from any thread, until on_close. */
+typedef int (*fanout_request_fn)(void *ctx, int client, const char *line, fanout_filter_t *filter);
+
+/* A subscribed client is gone (IO thread), before its filter is freed */
+typedef void (*fanout_close_fn)(void *ctx, int client);
+
+typedef struct {
+    int listen_fd;              // bound, listening TCP socket (made non-blocking)
+    int max_clients;            // default 1024
+    size_t ring_size;           // bytes, rounded up to a power of two; default 64 MB
+    size_t high_water;          // per-client backlog that triggers the policy; default ring/2
+    fanout_policy_t policy;
+    fanout_mode_t mode;
+    size_t flush_bytes;         // pending bytes that force a flush; default 64 KB
+    int handshake_ms;           // wait this long for a new client's request line; 0 = no requests
+    fanout_request_fn on_request;
+    fanout_close_fn on_close;
+    void *ctx;
+} fanout_config_t;
+
+typedef struct {
+    uint64_t clients_accepted;
+    uint64_t clients_rejected;  // over max_clients
+    uint64_t clients_active;
+    uint64_t disconnects;       // peer closed or errored
+    uint64_t slow_disconnects;  // closed by FANOUT_DISCONNECT
+    uint64_t drops;             // FANOUT_DROP skips
+    uint64_t dropped_bytes;
+    uint64_t writev_calls;
+    uint64_t bytes_out;
+    uint64_t publisher_waits;   // publishes that found the ring full
+    uint64_t flushes;
+    uint64_t wakeups;           // eventfd writes to wake the IO thread
+    uint64_t subscriptions;     // clients that sent an accepted request
+    uint64_t filtered_bytes;    // bytes subscriptions kept from their clients
+} fanout_stats_t;
+
+typedef struct fanout fanout_t;
+
+/* Start the IO thread. Returns NULL on failure. */
+fanout_t *fanout_create(const fanout_config_t *cfg);
+
+/* Stop the IO thread and close every client (not the listening socket) */
+void fanout_destroy(fanout_t *f);
+
+/* Append one message, with an optional framing prefix, for every client
+ * whose filter passes tag (every unsubscribed client). It is sent after the
+ * next flush. Blocks only while the ring is full. Returns 0, or -1 if the
+ * message is larger than the ring. */
+int fanout_publish(fanout_t *f, const uint8_t *prefix, size_t prefix_len,
+                   const uint8_t *msg, size_t len, uint32_t tag);
+
+/* Hand everything published so far to the IO thread */
+void fanout_flush(fanout_t *f);
+
+/* Bytes published but not yet flushed */
+size_t fanout_pending(const fanout_t *f);
+
+/* Flush, then wait up to timeout_ms for every client to receive everything */
+void fanout_drain(fanout_t *f, int timeout_ms);
+
+void fanout_get_stats(fanout_t *f, fanout_stats_t *out);
+
+/* Parse "drop", "disconnect" or "backpressure". Returns 0, or -1 if unknown. */
+int fanout_policy_parse(const char *name, fanout_policy_t *out);
+const char *fanout_policy_name(fanout_policy_t policy);
+
+/* Parse "latency" or "throughput". Returns 0, or -1 if unknown. */
+int fanout_mode_parse(const char *name, fanout_mode_t *out);
+const char *fanout_mode_name(fanout_mode_t mode);
+
+#endif /* FANOUT_H */
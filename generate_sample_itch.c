@@ -1,172 +1,998 @@
 /*
- * Generate sample ITCH data for testing
- * Creates a small binary file with various ITCH message types
+ * Generate sample ITCH data for testing and benchmarks
+ *
+ * Writes a synthetic ITCH 5.0 trading day of any size, from a few thousand
+ * messages to multi-GB corpora: the stock directory and trading actions for
+ * every symbol, the opening cross, continuous trading from 09:30 to 16:00,
+ * the closing cross and the end-of-day system events.
+ *
+ * Continuous trading is modelled on a NASDAQ day:
+ * - Every symbol is a Poisson stream of order events. Activity is Zipfian
+ *   (-z): the busiest symbol is rank 1, with a rate proportional to
+ *   1 / rank^z; ranks are dealt to stock locates at random.
+ * - The message rate over the day is U-shaped, four times as busy at the
+ *   open and the close as at midday. Timestamps never go backwards.
+ * - Each symbol keeps its live orders. Message shares are those of a NASDAQ
+ *   day: adds ~42% (a few with MPID attribution), deletes ~39%, replaces
+ *   ~10%, executions ~5%, partial cancels ~3%, non-displayed trades ~2%.
+ * - Most orders are deleted, replaced or executed within a few events of
+ *   being added; the rest rest for much longer, some all day.
+ * - Each book keeps its best bid and ask. Buys rest a geometric number of
+ *   ticks below the best bid, sells above the best ask, a few improve
+ *   inside the spread, and neither side ever reaches the other: books are
+ *   never crossed or locked. Executions take the oldest order at the best
+ *   level of one side, so prices move once a level is used up. An empty
+ *   book restarts around the last such price (first $5 to $500,
+ *   log-uniform). Sizes are mostly round lots.
+ *
+ * Symbols are split across worker threads (-j), each owning its symbols'
+ * books for the whole day. The day is cut into windows of about 256K
+ * messages. A thread writes each window's events for its symbols as one
+ * sorted run, and whichever thread completes a window merges the runs,
+ * frames the messages and compresses them for .gz. The main thread writes
+ * finished windows in order with one write() each. Every symbol draws from
+ * its own seeded generator and runs merge in (time, locate) order, so the
+ * output depends on -S and the shape options, not on the thread count.
+ *
+ * An output name ending in .gz is written as BGZF: independent gzip
+ * blocks of at most 64 KB, like bgzip. zcat reads it as plain gzip, and
+ * itch_replay_server inflates it in parallel.
+ *
+ * Usage:
+ *   ./generate_sample_itch [-n messages] [-s symbols] [-z exponent] [-f framing]
+ *                          [-j threads] [-S seed] [-l level] [output]
+ *
+ *   -n  approximate number of messages (default 1M; k, M and G suffixes)
+ *   -s  number of symbols (default 8000, at most 65535)
+ *   -z  Zipf exponent of symbol activity (default 1.0; 0 = uniform)
+ *   -f  framing: raw (default), binaryfile, soupbintcp
+ *   -j  worker threads (default one per CPU)
+ *   -S  random seed (default 1)
+ *   -l  gzip level for .gz output (default 1)
+ *   output defaults to data/sample.itch
+ *
+ * Example:
+ *   ./generate_sample_itch
+ *   ./generate_sample_itch -n 500M data/synthetic.itch
+ *   ./generate_sample_itch -n 100M -f binaryfile data/synthetic.bin.gz
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "itch_parser.h"
+#include "itch_framing.h"
 
-static inline void write_u16(uint8_t *b, uint16_t v) {
-    b[0] = (v >> 8) & 0xFF;
-    b[1] = v & 0xFF;
+#define DEFAULT_OUTPUT "data/sample.itch"
+#define DEFAULT_MESSAGES 1000000
+#define DEFAULT_SYMBOLS 8000
+#define MAX_SYMBOLS 65535
+#define MAX_THREADS 64
+#define WINDOW_MESSAGES (1 << 18)   // expected messages per window
+#define WINDOW_DEPTH 2              // windows in flight per thread
+#define TIME_STEPS 4096             // intraday profile table
+#define LIVE_ORDERS (1 << 19)       // live orders shared out by activity (order_book holds 4M)
+#define MIN_LIVE 8                  // live-order cap of the quietest symbol
+#define TICK 100                    // $0.01, prices carry 4 implied decimals
+#define MAX_RECORD (8 + 64)         // run record: [u:8][message]
+#define BGZF_BLOCK_INPUT 0xff00     // bgzip's block size: compressed blocks fit in 64 KB
+#define BGZF_HEADER 18
+#define BGZF_FOOTER 8
+#define BGZF_MAX_BLOCK 65536
+
+#define NS_PER_SEC 1000000000ULL
+#define T_DIRECTORY (3 * 3600 * NS_PER_SEC)            // 03:00 start of messages
+#define T_SYSTEM (4 * 3600 * NS_PER_SEC)               // 04:00 start of system hours
+#define T_OPEN (34200 * NS_PER_SEC)                    // 09:30 opening cross
+#define T_CLOSE (57600 * NS_PER_SEC)                   // 16:00 closing cross
+#define T_END (20 * 3600 * NS_PER_SEC)                 // 20:00 end of system hours
+
+/* Order event shares, per 10000 continuous-trading messages */
+typedef struct {
+    uint8_t type;
+    uint16_t weight;
+} gen_weight_t;
+
+static const gen_weight_t event_weights[] = {
+    { 'A', 4000 }, { 'F', 160 }, { 'D', 3850 }, { 'U', 1030 },
+    { 'E', 455 }, { 'C', 35 }, { 'X', 280 }, { 'P', 190 },
+};
+
+static const char *mpids[] = { "GSCO", "MSCO", "UBSS", "NITE", "VIRT", "CDRG", "JPMS", "SBSH" };
+
+typedef struct {
+    uint64_t ref;
+    uint32_t shares;
+    uint32_t price;
+    char side;
+} gen_order_t;
+
+/* One symbol's event stream and book, owned by one worker thread */
+typedef struct {
+    uint64_t rng;
+    double next_u;              // intensity time of its next event, in [0, 1)
+    double rate;                // events per unit of intensity time
+    gen_order_t *orders;        // live orders, roughly oldest first
+    uint32_t count;
+    uint32_t cap;
+    uint32_t max_live;
+    uint32_t mid;               // last price a level was used up at; P and crosses print here
+    uint32_t best_bid;          // best prices while the side has orders
+    uint32_t best_ask;
+    uint32_t at_best_bid;       // live orders at the best price
+    uint32_t at_best_ask;
+    uint32_t bids;              // live orders per side
+    uint32_t asks;
+    uint64_t refs;
+    uint64_t matches;
+    uint16_t locate;
+    char stock[8];
+} gen_symbol_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} gen_buf_t;
+
+/* A window in flight: one run per thread, then the merged output */
+typedef struct {
+    gen_buf_t *runs;
+    gen_buf_t out;              // framed messages
+    gen_buf_t z;                // BGZF blocks (.gz output)
+    int runs_ready;
+    int done;
+} gen_window_t;
+
+typedef struct gen gen_t;
+
+typedef struct {
+    gen_t *g;
+    int id;
+    gen_symbol_t **heap;        // this thread's symbols, by next_u
+    size_t nheap;
+    z_stream z;
+    uint64_t by_type[256];
+} gen_worker_t;
+
+struct gen {
+    // Configuration
+    uint64_t messages;
+    int symbols;
+    double zipf;
+    itch_framing_t framing;
+    int threads;
+    uint64_t seed;
+    int level;
+    int gzip;
+    const char *output;
+
+    gen_symbol_t *sym;          // by locate - 1
+    double time_table[TIME_STEPS + 1];
+    int windows;
+
+    // Window pipeline
+    gen_window_t slots[WINDOW_DEPTH * MAX_THREADS];
+    int nslots;
+    int written;                // next window to write
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    gen_worker_t workers[MAX_THREADS];
+};
+
+/* ---------------------------------------------------------------------------
+ * Random numbers
+ * ------------------------------------------------------------------------- */
+
+static inline uint64_t splitmix64(uint64_t *s) {
+    uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint64_t xorshift64(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* Uniform in (0, 1] */
+static inline double uniform(uint64_t *s) {
+    return (double)((xorshift64(s) >> 11) + 1) * 0x1p-53;
+}
+
+/* 0 with probability 1/2, 1 with 1/4, ... capped at max */
+static inline uint32_t geometric(uint64_t *s, uint32_t max) {
+    uint32_t n = (uint32_t)__builtin_ctzll(xorshift64(s) | (1ULL << 63));
+    return n < max ? n : max;
+}
+
+/* ---------------------------------------------------------------------------
+ * Symbols and the day
+ * ------------------------------------------------------------------------- */
+
+/* Rank r in the lexicographic order of all 1-4 letter tickers */
+static void symbol_name(uint32_t r, char out[8]) {
+    static const uint32_t subtree[4] = { 1 + 26 + 676 + 17576, 1 + 26 + 676, 1 + 26, 1 };
+    memset(out, ' ', 8);
+    for (int d = 0; d < 4; d++) {
+        out[d] = (char)('A' + r / subtree[d]);
+        r %= subtree[d];
+        if (r == 0) break;
+        r--;
+    }
+}
+
+/* Share of the day's messages sent before x (x in [0, 1] of market hours):
+ * intensity (1 + 3(2x-1)^2) / 2, four times higher at the edges than midday */
+static double day_profile(double x) {
+    double c = 2 * x - 1;
+    return (x + 0.5 * (c * c * c + 1)) / 2;
+}
+
+static void build_time_table(gen_t *g) {
+    for (int i = 0; i <= TIME_STEPS; i++) {
+        double target = (double)i / TIME_STEPS, lo = 0, hi = 1;
+        for (int k = 0; k < 60; k++) {
+            double mid = (lo + hi) / 2;
+            if (day_profile(mid) < target) lo = mid;
+            else hi = mid;
+        }
+        g->time_table[i] = lo;
+    }
+}
+
+/* Intensity time u in [0, 1) to a feed timestamp in market hours */
+static inline uint64_t feed_time(const gen_t *g, double u) {
+    double pos = u * TIME_STEPS;
+    int i = (int)pos;
+    if (i >= TIME_STEPS) i = TIME_STEPS - 1;
+    double x = g->time_table[i] + (pos - i) * (g->time_table[i + 1] - g->time_table[i]);
+    uint64_t ts = T_OPEN + (uint64_t)(x * (double)(T_CLOSE - T_OPEN));
+    return ts < T_CLOSE ? ts : T_CLOSE - 1;
 }
 
-static inline void write_u32(uint8_t *b, uint32_t v) {
-    b[0] = (v >> 24) & 0xFF;
-    b[1] = (v >> 16) & 0xFF;
-    b[2] = (v >> 8) & 0xFF;
-    b[3] = v & 0xFF;
+static int init_symbols(gen_t *g, uint64_t continuous) {
+    int n = g->symbols;
+    g->sym = calloc((size_t)n, sizeof(gen_symbol_t));
+    uint32_t *rank_locate = malloc((size_t)n * sizeof(uint32_t));
+    double *weight = malloc((size_t)n * sizeof(double));
+    if (!g->sym || !rank_locate || !weight) {
+        free(rank_locate);
+        free(weight);
+        return -1;
+    }
+
+    // Zipf weights by rank, and a seeded shuffle of ranks onto locates
+    uint64_t s = g->seed;
+    double total = 0;
+    for (int r = 0; r < n; r++) {
+        weight[r] = 1.0 / pow(r + 1, g->zipf);
+        total += weight[r];
+        rank_locate[r] = (uint32_t)r;
+    }
+    for (int r = n - 1; r > 0; r--) {
+        uint32_t k = (uint32_t)(splitmix64(&s) % (uint64_t)(r + 1));
+        uint32_t t = rank_locate[r];
+        rank_locate[r] = rank_locate[k];
+        rank_locate[k] = t;
+    }
+
+    for (int r = 0; r < n; r++) {
+        gen_symbol_t *sym = &g->sym[rank_locate[r]];
+        double w = weight[r] / total;
+        sym->locate = (uint16_t)(rank_locate[r] + 1);
+        symbol_name((uint32_t)((uint64_t)rank_locate[r] * 475254 / (uint64_t)n), sym->stock);
+        uint64_t seed = g->seed ^ ((uint64_t)sym->locate * 0xd1b54a32d192ed03ULL);
+        sym->rng = splitmix64(&seed) | 1;
+        sym->rate = (double)continuous * w;
+        sym->next_u = sym->rate > 0 ? -log(uniform(&sym->rng)) / sym->rate : INFINITY;
+        sym->max_live = MIN_LIVE + (uint32_t)(w * LIVE_ORDERS);
+        // Log-uniform $5 - $500, on a tick
+        double price = 5.0 * exp(uniform(&sym->rng) * log(100.0));
+        sym->mid = (uint32_t)(price * 100) * TICK;
+    }
+    free(rank_locate);
+    free(weight);
+    return 0;
 }
 
-static inline void write_u64(uint8_t *b, uint64_t v) {
-    for (int i = 0; i < 8; i++) {
-        b[i] = (v >> (56 - i * 8)) & 0xFF;
+/* ---------------------------------------------------------------------------
+ * Order events
+ * ------------------------------------------------------------------------- */
+
+static void oom(void) {
+    fprintf(stderr, "Out of memory\n");
+    exit(1);
+}
+
+static inline uint8_t *buf_reserve(gen_buf_t *b, size_t n) {
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 1 << 20;
+        while (cap < b->len + n) cap *= 2;
+        uint8_t *p = realloc(b->data, cap);
+        if (!p) oom();
+        b->data = p;
+        b->cap = cap;
     }
+    return b->data + b->len;
 }
 
-static inline void write_timestamp(uint8_t *b, uint64_t ts) {
-    uint64_t tmp = ts << 16;
-    tmp = __builtin_bswap64(tmp);
-    memcpy(b, &tmp, 6);
+static inline ITCHHeader header_for(const gen_symbol_t *s, uint64_t ts) {
+    return (ITCHHeader){ .stockLocate = s->locate, .timestamp = ts };
 }
 
-static void write_stock(uint8_t *b, const char *stock) {
-    memset(b, ' ', 8);
-    size_t len = strlen(stock);
-    if (len > 8) len = 8;
-    memcpy(b, stock, len);
+static inline uint32_t order_size(uint64_t *rng) {
+    if (xorshift64(rng) % 10 == 0) return 1 + (uint32_t)(xorshift64(rng) % 99);   // odd lot
+    return 100 * (1 + geometric(rng, 20));
 }
 
-int main() {
-    FILE *fp = fopen("data/sample.itch", "wb");
-    if (!fp) {
-        perror("fopen");
-        return 1;
+/* A new order's price: a geometric number of ticks behind its side's best
+ * (behind the other side, or the last price, when its side is empty),
+ * sometimes a tick inside the spread, never at or through the other side */
+static inline uint32_t resting_price(gen_symbol_t *s, char side) {
+    uint32_t away = TICK * geometric(&s->rng, 30);
+    int improve = xorshift64(&s->rng) % 8 == 0;
+    if (side == 'S') {
+        uint32_t price;
+        if (s->asks) price = improve ? s->best_ask - TICK : s->best_ask + away;
+        else price = (s->bids ? s->best_bid : s->mid) + TICK + away;
+        uint32_t floor = s->bids ? s->best_bid + TICK : TICK;
+        return price > floor ? price : floor;
+    }
+    uint32_t price;
+    if (s->bids) {
+        price = improve ? s->best_bid + TICK : s->best_bid - (away < s->best_bid ? away : 0);
+    } else {
+        uint32_t ref = s->asks ? s->best_ask : s->mid;
+        price = ref > away + TICK ? ref - TICK - away : TICK;
+    }
+    uint32_t ceiling = s->asks ? s->best_ask - TICK : UINT32_MAX;
+    if (price < TICK) price = TICK;
+    return price < ceiling ? price : ceiling;
+}
+
+/* The order an event acts on: usually one of the last few added */
+static inline uint32_t pick_order(gen_symbol_t *s) {
+    uint64_t r = xorshift64(&s->rng);
+    if (r % 10 < 8) {
+        uint32_t recent = s->count < 8 ? s->count : 8;
+        return s->count - 1 - (uint32_t)((r >> 8) % recent);
+    }
+    return (uint32_t)((r >> 8) % s->count);
+}
+
+/* The oldest live order at the best price of a side */
+static inline uint32_t best_order(const gen_symbol_t *s, char side) {
+    uint32_t best = side == 'B' ? s->best_bid : s->best_ask;
+    uint32_t i = 0;
+    while (s->orders[i].side != side || s->orders[i].price != best) i++;
+    return i;
+}
+
+/* Rescan a side for its best price after its best level emptied */
+static void find_best(gen_symbol_t *s, char side) {
+    uint32_t best = side == 'B' ? 0 : UINT32_MAX, at = 0;
+    for (uint32_t i = 0; i < s->count; i++) {
+        const gen_order_t *o = &s->orders[i];
+        if (o->side != side) continue;
+        if (o->price == best) at++;
+        else if (side == 'B' ? o->price > best : o->price < best) {
+            best = o->price;
+            at = 1;
+        }
+    }
+    if (side == 'B') {
+        s->best_bid = best;
+        s->at_best_bid = at;
+    } else {
+        s->best_ask = best;
+        s->at_best_ask = at;
+    }
+}
+
+static inline void book_add(gen_symbol_t *s, const gen_order_t *o) {
+    if (o->side == 'B') {
+        if (s->bids++ == 0 || o->price > s->best_bid) {
+            s->best_bid = o->price;
+            s->at_best_bid = 1;
+        } else if (o->price == s->best_bid) {
+            s->at_best_bid++;
+        }
+    } else {
+        if (s->asks++ == 0 || o->price < s->best_ask) {
+            s->best_ask = o->price;
+            s->at_best_ask = 1;
+        } else if (o->price == s->best_ask) {
+            s->at_best_ask++;
+        }
+    }
+}
+
+/* Take order i off the book. Returns 1 if that emptied its side's best level. */
+static inline int remove_order(gen_symbol_t *s, uint32_t i) {
+    gen_order_t o = s->orders[i];
+    s->orders[i] = s->orders[--s->count];
+    if (o.side == 'B') {
+        s->bids--;
+        if (o.price != s->best_bid || --s->at_best_bid) return 0;
+    } else {
+        s->asks--;
+        if (o.price != s->best_ask || --s->at_best_ask) return 0;
+    }
+    find_best(s, o.side);
+    return 1;
+}
+
+static inline gen_order_t *push_order(gen_symbol_t *s) {
+    if (s->count == s->cap) {
+        uint32_t cap = s->cap ? s->cap * 2 : 16;
+        gen_order_t *p = realloc(s->orders, cap * sizeof(gen_order_t));
+        if (!p) oom();
+        s->orders = p;
+        s->cap = cap;
+    }
+    return &s->orders[s->count++];
+}
+
+static inline uint64_t next_ref(gen_symbol_t *s) {
+    return ((uint64_t)s->locate << 40) | ++s->refs;
+}
+
+static inline uint64_t next_match(gen_symbol_t *s) {
+    return ((uint64_t)s->locate << 40) | ++s->matches;
+}
+
+/* Write one order event for s at ts into msg. Returns its length. */
+static size_t order_event(gen_symbol_t *s, uint64_t ts, uint8_t *msg) {
+    uint32_t r = (uint32_t)(xorshift64(&s->rng) % 10000);
+    size_t k = 0;
+    while (r >= event_weights[k].weight) r -= event_weights[k++].weight;
+    uint8_t type = event_weights[k].type;
+
+    // Keep every book between empty and its live-order cap
+    int removes = type == 'D' || type == 'U' || type == 'E' || type == 'C' || type == 'X';
+    if (removes && s->count == 0) type = 'A';
+    else if ((type == 'A' || type == 'F') && s->count >= s->max_live) type = 'D';
+
+    switch (type) {
+        case 'A':
+        case 'F': {
+            gen_order_t *o = push_order(s);
+            o->ref = next_ref(s);
+            o->side = (xorshift64(&s->rng) & 1) ? 'B' : 'S';
+            o->shares = order_size(&s->rng);
+            o->price = resting_price(s, o->side);
+            book_add(s, o);
+            if (type == 'A') {
+                ITCHAddOrder m = { .header = header_for(s, ts), .orderRefNum = o->ref,
+                                   .buySellIndicator = o->side, .shares = o->shares, .price = o->price };
+                memcpy(m.stock, s->stock, 8);
+                return itch_encode_A(msg, &m);
+            }
+            ITCHAddOrderMPID m = { .header = header_for(s, ts), .orderRefNum = o->ref,
+                                   .buySellIndicator = o->side, .shares = o->shares, .price = o->price };
+            memcpy(m.stock, s->stock, 8);
+            memcpy(m.attribution, mpids[xorshift64(&s->rng) % (sizeof(mpids) / sizeof(mpids[0]))], 4);
+            return itch_encode_F(msg, &m);
+        }
+        case 'D': {
+            uint32_t i = pick_order(s);
+            ITCHOrderDelete m = { .header = header_for(s, ts), .orderRefNum = s->orders[i].ref };
+            remove_order(s, i);
+            return itch_encode_D(msg, &m);
+        }
+        case 'X': {
+            uint32_t i = pick_order(s);
+            gen_order_t *o = &s->orders[i];
+            if (o->shares < 2) {
+                ITCHOrderDelete m = { .header = header_for(s, ts), .orderRefNum = o->ref };
+                remove_order(s, i);
+                return itch_encode_D(msg, &m);
+            }
+            uint32_t cancelled = 1 + (uint32_t)(xorshift64(&s->rng) % (o->shares - 1));
+            o->shares -= cancelled;
+            ITCHOrderCancel m = { .header = header_for(s, ts), .orderRefNum = o->ref,
+                                  .cancelledShares = cancelled };
+            return itch_encode_X(msg, &m);
+        }
+        case 'E':
+        case 'C': {
+            // An incoming order takes the oldest order at the best level of one side
+            char side = (xorshift64(&s->rng) & 1) ? 'B' : 'S';
+            if ((side == 'B' ? s->bids : s->asks) == 0) side = side == 'B' ? 'S' : 'B';
+            uint32_t i = best_order(s, side);
+            gen_order_t *o = &s->orders[i];
+            uint32_t executed = o->shares;
+            if (o->shares > 1 && xorshift64(&s->rng) % 10 < 4) {
+                executed = 1 + (uint32_t)(xorshift64(&s->rng) % (o->shares - 1));
+            }
+            uint64_t ref = o->ref;
+            uint32_t price = o->price;
+            o->shares -= executed;
+            if (o->shares == 0 && remove_order(s, i)) s->mid = price;
+            if (type == 'E') {
+                ITCHOrderExecuted m = { .header = header_for(s, ts), .orderRefNum = ref,
+                                        .executedShares = executed, .matchNumber = next_match(s) };
+                return itch_encode_E(msg, &m);
+            }
+            ITCHOrderExecutedWithPrice m = { .header = header_for(s, ts), .orderRefNum = ref,
+                                             .executedShares = executed, .matchNumber = next_match(s),
+                                             .printable = 'Y', .executionPrice = price };
+            return itch_encode_C(msg, &m);
+        }
+        case 'U': {
+            uint32_t i = pick_order(s);
+            gen_order_t o = s->orders[i];
+            remove_order(s, i);
+            gen_order_t *n = push_order(s);
+            n->ref = next_ref(s);
+            n->side = o.side;
+            n->shares = order_size(&s->rng);
+            n->price = resting_price(s, o.side);
+            book_add(s, n);
+            ITCHOrderReplace m = { .header = header_for(s, ts), .origOrderRefNum = o.ref,
+                                   .newOrderRefNum = n->ref, .shares = n->shares, .price = n->price };
+            return itch_encode_U(msg, &m);
+        }
+        default: {
+            // Non-displayed execution at the current level
+            ITCHTrade m = { .header = header_for(s, ts), .orderRefNum = 0,
+                            .buySellIndicator = (xorshift64(&s->rng) & 1) ? 'B' : 'S',
+                            .shares = order_size(&s->rng), .price = s->mid, .matchNumber = next_match(s) };
+            memcpy(m.stock, s->stock, 8);
+            return itch_encode_P(msg, &m);
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * Windows: per-thread runs, merged in (time, locate) order
+ * ------------------------------------------------------------------------- */
+
+static void heap_sift_down(gen_symbol_t **h, size_t n, size_t i) {
+    gen_symbol_t *x = h[i];
+    for (;;) {
+        size_t c = 2 * i + 1;
+        if (c >= n) break;
+        if (c + 1 < n && h[c + 1]->next_u < h[c]->next_u) c++;
+        if (h[c]->next_u >= x->next_u) break;
+        h[i] = h[c];
+        i = c;
+    }
+    h[i] = x;
+}
+
+/* Every event of this thread's symbols before u_end, as [u:8][message] */
+static void generate_run(gen_worker_t *w, double u_end, gen_buf_t *run) {
+    gen_t *g = w->g;
+    gen_symbol_t **h = w->heap;
+    while (w->nheap && h[0]->next_u < u_end) {
+        gen_symbol_t *s = h[0];
+        double u = s->next_u;
+        uint8_t *rec = buf_reserve(run, MAX_RECORD);
+        memcpy(rec, &u, sizeof(u));
+        size_t len = order_event(s, feed_time(g, u), rec + sizeof(u));
+        w->by_type[rec[sizeof(u)]]++;
+        run->len += sizeof(u) + len;
+        s->next_u = u - log(uniform(&s->rng)) / s->rate;
+        heap_sift_down(h, w->nheap, 0);
+    }
+}
+
+static inline size_t record_len(const uint8_t *rec) {
+    return sizeof(double) + itch_message_lengths[rec[sizeof(double)]];
+}
+
+static inline int record_before(const uint8_t *a, const uint8_t *b) {
+    double ua, ub;
+    memcpy(&ua, a, sizeof(ua));
+    memcpy(&ub, b, sizeof(ub));
+    if (ua != ub) return ua < ub;
+    return itch_read_u16(a + sizeof(double) + 1) < itch_read_u16(b + sizeof(double) + 1);
+}
+
+static inline void append_message(gen_t *g, gen_buf_t *out, const uint8_t *msg, size_t len) {
+    uint8_t *p = buf_reserve(out, len + 3);
+    size_t prefix = itch_framing_write_prefix(g->framing, p, len);
+    memcpy(p + prefix, msg, len);
+    out->len += prefix + len;
+}
+
+/* Compress in into BGZF blocks appended to out. Returns 0, or -1. */
+static int bgzf_compress(z_stream *z, const uint8_t *in, size_t len, gen_buf_t *out) {
+    static const uint8_t header[BGZF_HEADER] = {
+        0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0, 0
+    };
+    for (size_t off = 0; off < len; ) {
+        size_t n = len - off < BGZF_BLOCK_INPUT ? len - off : BGZF_BLOCK_INPUT;
+        uint8_t *block = buf_reserve(out, BGZF_MAX_BLOCK);
+        memcpy(block, header, BGZF_HEADER);
+        deflateReset(z);
+        z->next_in = (Bytef *)(in + off);
+        z->avail_in = (uInt)n;
+        z->next_out = block + BGZF_HEADER;
+        z->avail_out = BGZF_MAX_BLOCK - BGZF_HEADER - BGZF_FOOTER;
+        if (deflate(z, Z_FINISH) != Z_STREAM_END) return -1;
+
+        size_t size = BGZF_HEADER + z->total_out + BGZF_FOOTER;
+        block[16] = (uint8_t)(size - 1);
+        block[17] = (uint8_t)((size - 1) >> 8);
+        uint32_t crc = (uint32_t)crc32(0, in + off, (uInt)n);
+        uint8_t *footer = block + size - BGZF_FOOTER;
+        for (int i = 0; i < 4; i++) {
+            footer[i] = (uint8_t)(crc >> (8 * i));
+            footer[4 + i] = (uint8_t)(n >> (8 * i));
+        }
+        out->len += size;
+        off += n;
+    }
+    return 0;
+}
+
+/* Merge a window's runs into framed (and compressed) output */
+static void finish_window(gen_worker_t *w, gen_window_t *win) {
+    gen_t *g = w->g;
+    size_t pos[MAX_THREADS] = { 0 };
+    for (;;) {
+        int best = -1;
+        for (int t = 0; t < g->threads; t++) {
+            if (pos[t] >= win->runs[t].len) continue;
+            if (best < 0 || record_before(win->runs[t].data + pos[t], win->runs[best].data + pos[best])) best = t;
+        }
+        if (best < 0) break;
+        const uint8_t *rec = win->runs[best].data + pos[best];
+        size_t len = record_len(rec);
+        append_message(g, &win->out, rec + sizeof(double), len - sizeof(double));
+        pos[best] += len;
+    }
+    if (g->gzip && bgzf_compress(&w->z, win->out.data, win->out.len, &win->z) < 0) {
+        fprintf(stderr, "deflate failed\n");
+        exit(1);
+    }
+}
+
+static void *worker_thread(void *arg) {
+    gen_worker_t *w = arg;
+    gen_t *g = w->g;
+    for (int k = 0; k < g->windows; k++) {
+        gen_window_t *win = &g->slots[k % g->nslots];
+        pthread_mutex_lock(&g->lock);
+        while (k >= g->written + g->nslots) pthread_cond_wait(&g->cond, &g->lock);
+        pthread_mutex_unlock(&g->lock);
+
+        double u_end = k + 1 == g->windows ? 1.0 : (double)(k + 1) / g->windows;
+        generate_run(w, u_end, &win->runs[w->id]);
+
+        // The last run of a window in merges it
+        pthread_mutex_lock(&g->lock);
+        int last = ++win->runs_ready == g->threads;
+        pthread_mutex_unlock(&g->lock);
+        if (!last) continue;
+        finish_window(w, win);
+        pthread_mutex_lock(&g->lock);
+        win->done = 1;
+        pthread_cond_broadcast(&g->cond);
+        pthread_mutex_unlock(&g->lock);
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+ * Start and end of day
+ * ------------------------------------------------------------------------- */
+
+static void system_event(gen_t *g, gen_buf_t *out, uint64_t ts, char code) {
+    uint8_t msg[64];
+    ITCHSystemEvent m = { .header = { .timestamp = ts }, .eventCode = code };
+    append_message(g, out, msg, itch_encode_S(msg, &m));
+}
+
+static void cross(gen_t *g, gen_buf_t *out, gen_symbol_t *s, uint64_t ts, char type) {
+    uint8_t msg[64];
+    ITCHCrossTrade m = { .header = header_for(s, ts), .shares = 100 * (1 + xorshift64(&s->rng) % 500),
+                         .crossPrice = s->mid, .matchNumber = next_match(s), .crossType = type };
+    memcpy(m.stock, s->stock, 8);
+    append_message(g, out, msg, itch_encode_Q(msg, &m));
+}
+
+/* System events, directory, trading actions and the opening cross */
+static uint64_t start_of_day(gen_t *g, gen_buf_t *out) {
+    static const char categories[] = "QQQGGSNNAPZ";
+    uint8_t msg[64];
+    system_event(g, out, T_DIRECTORY, 'O');
+    for (int i = 0; i < g->symbols; i++) {
+        gen_symbol_t *s = &g->sym[i];
+        ITCHStockDirectory m = {
+            .header = header_for(s, T_DIRECTORY + (uint64_t)(i + 1) * 1000),
+            .marketCategory = categories[s->locate % (sizeof(categories) - 1)],
+            .financialStatusIndicator = 'N', .roundLotSize = 100, .roundLotsOnly = 'N',
+            .issueClassification = 'C', .issueSubType = { 'Z', ' ' }, .authenticity = 'P',
+            .shortSaleThresholdIndicator = 'N', .ipoFlag = 'N', .luldReferencePriceTier = s->mid >= 30000 ? '1' : '2',
+            .etpFlag = 'N', .etpLeverageFactor = 0, .inverseIndicator = 'N',
+        };
+        memcpy(m.stock, s->stock, 8);
+        append_message(g, out, msg, itch_encode_R(msg, &m));
+    }
+    system_event(g, out, T_SYSTEM, 'S');
+    for (int i = 0; i < g->symbols; i++) {
+        gen_symbol_t *s = &g->sym[i];
+        ITCHTradingAction m = { .header = header_for(s, T_SYSTEM + (uint64_t)(i + 1) * 1000),
+                                .tradingState = 'T', .reserved = ' ', .reason = { ' ', ' ', ' ', ' ' } };
+        memcpy(m.stock, s->stock, 8);
+        append_message(g, out, msg, itch_encode_H(msg, &m));
+    }
+    system_event(g, out, T_OPEN, 'Q');
+    for (int i = 0; i < g->symbols; i++) cross(g, out, &g->sym[i], T_OPEN, 'O');
+    return 3 + 3 * (uint64_t)g->symbols;
+}
+
+/* Closing cross and end-of-day system events */
+static uint64_t end_of_day(gen_t *g, gen_buf_t *out) {
+    for (int i = 0; i < g->symbols; i++) cross(g, out, &g->sym[i], T_CLOSE, 'C');
+    system_event(g, out, T_CLOSE, 'M');
+    system_event(g, out, T_END, 'E');
+    system_event(g, out, T_END, 'C');
+    return 3 + (uint64_t)g->symbols;
+}
+
+/* ---------------------------------------------------------------------------
+ * Output
+ * ------------------------------------------------------------------------- */
+
+static int write_all(int fd, const uint8_t *p, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("write");
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
     }
-    
-    uint8_t msg[50];
-    uint64_t ts = 34200000000000ULL;  // 9:30 AM in nanoseconds
-    uint16_t stock_locate = 1;
-    uint16_t tracking = 0;
-    
+    return 0;
+}
+
+/* Frame (and compress) a main-thread buffer straight to the file */
+static int write_plain(gen_t *g, z_stream *z, int fd, gen_buf_t *b) {
+    if (!g->gzip) return write_all(fd, b->data, b->len);
+    gen_buf_t c = { 0 };
+    int rc = bgzf_compress(z, b->data, b->len, &c) < 0 ? -1 : write_all(fd, c.data, c.len);
+    free(c.data);
+    return rc;
+}
+
+static int by_rate_desc(const void *a, const void *b) {
+    const gen_symbol_t *x = *(gen_symbol_t *const *)a, *y = *(gen_symbol_t *const *)b;
+    if (x->rate != y->rate) return x->rate < y->rate ? 1 : -1;
+    return x->locate - y->locate;
+}
+
+/* "1000", "10k", "5M", "2G" */
+static int parse_count(const char *s, uint64_t *out) {
+    char *end;
+    double v = strtod(s, &end);
+    if (end == s || v < 0) return -1;
+    if (*end == 'k' || *end == 'K') v *= 1e3, end++;
+    else if (*end == 'm' || *end == 'M') v *= 1e6, end++;
+    else if (*end == 'g' || *end == 'G') v *= 1e9, end++;
+    if (*end != '\0') return -1;
+    *out = (uint64_t)v;
+    return 0;
+}
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    static gen_t gen;
+    gen_t *g = &gen;
+    g->messages = DEFAULT_MESSAGES;
+    g->symbols = DEFAULT_SYMBOLS;
+    g->zipf = 1.0;
+    g->framing = FRAMING_RAW;
+    g->seed = 1;
+    g->level = 1;
+    g->output = DEFAULT_OUTPUT;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:z:f:j:S:l:")) != -1) {
+        switch (opt) {
+            case 'n':
+                if (parse_count(optarg, &g->messages) < 0) {
+                    fprintf(stderr, "Invalid message count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 's':
+                g->symbols = atoi(optarg);
+                if (g->symbols < 1 || g->symbols > MAX_SYMBOLS) {
+                    fprintf(stderr, "Symbols must be 1..%d\n", MAX_SYMBOLS);
+                    return 1;
+                }
+                break;
+            case 'z': g->zipf = atof(optarg); break;
+            case 'f':
+                if (itch_framing_parse(optarg, &g->framing) < 0 || g->framing == FRAMING_MOLDUDP64) {
+                    fprintf(stderr, "Unsupported framing: %s (raw, binaryfile, soupbintcp)\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'j':
+                g->threads = atoi(optarg);
+                if (g->threads < 1 || g->threads > MAX_THREADS) {
+                    fprintf(stderr, "Threads must be 1..%d\n", MAX_THREADS);
+                    return 1;
+                }
+                break;
+            case 'S': g->seed = strtoull(optarg, NULL, 10); break;
+            case 'l': g->level = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-n messages] [-s symbols] [-z exponent] [-f framing]\n"
+                                "          [-j threads] [-S seed] [-l level] [output]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc) g->output = argv[optind];
+    size_t name_len = strlen(g->output);
+    g->gzip = name_len > 3 && strcmp(g->output + name_len - 3, ".gz") == 0;
+    if (g->threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        g->threads = cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (int)cpus;
+    }
+    if (g->threads > g->symbols) g->threads = g->symbols;
+
+    uint64_t fixed = 6 + 4 * (uint64_t)g->symbols;
+    uint64_t continuous = g->messages > fixed ? g->messages - fixed : 0;
+    g->windows = (int)((continuous + WINDOW_MESSAGES - 1) / WINDOW_MESSAGES);
+    if (g->windows < 1) g->windows = 1;
+
     printf("Generating sample ITCH data...\n");
-    
-    // System Event - Start of Messages
-    memset(msg, 0, sizeof(msg));
-    msg[0] = 'S';
-    write_u16(msg + 1, stock_locate);
-    write_u16(msg + 3, tracking++);
-    write_timestamp(msg + 5, ts);
-    msg[11] = 'O';  // Start of Messages
-    fwrite(msg, 12, 1, fp);
-    ts += 1000000;
-    
-    // Stock Directory - AAPL
-    memset(msg, 0, sizeof(msg));
-    msg[0] = 'R';
-    write_u16(msg + 1, stock_locate);
-    write_u16(msg + 3, tracking++);
-    write_timestamp(msg + 5, ts);
-    write_stock(msg + 11, "AAPL");
-    msg[19] = 'Q';  // NASDAQ
-    msg[20] = 'N';  // Normal
-    write_u32(msg + 21, 100);  // Round lot size
-    msg[25] = 'Y';
-    msg[26] = 'P';
-    write_u16(msg + 27, 0);
-    msg[29] = 'P';
-    msg[30] = 'N';
-    msg[31] = ' ';
-    msg[32] = '1';
-    msg[33] = 'N';
-    write_u32(msg + 34, 1);
-    msg[38] = 'N';
-    fwrite(msg, 39, 1, fp);
-    ts += 1000000;
-    
-    // Stock Directory - TSLA
-    memset(msg, 0, sizeof(msg));
-    msg[0] = 'R';
-    write_u16(msg + 1, stock_locate + 1);
-    write_u16(msg + 3, tracking++);
-    write_timestamp(msg + 5, ts);
-    write_stock(msg + 11, "TSLA");
-    msg[19] = 'Q';
-    msg[20] = 'N';
-    write_u32(msg + 21, 100);
-    msg[25] = 'Y';
-    msg[26] = 'P';
-    write_u16(msg + 27, 0);
-    msg[29] = 'P';
-    msg[30] = 'N';
-    msg[31] = ' ';
-    msg[32] = '1';
-    msg[33] = 'N';
-    write_u32(msg + 34, 1);
-    msg[38] = 'N';
-    fwrite(msg, 39, 1, fp);
-    ts += 1000000;
-    
-    // Generate some trades
-    for (int i = 0; i < 100; i++) {
-        // Add Order - Buy AAPL
-        memset(msg, 0, sizeof(msg));
-        msg[0] = 'A';
-        write_u16(msg + 1, stock_locate);
-        write_u16(msg + 3, tracking++);
-        write_timestamp(msg + 5, ts);
-        write_u64(msg + 11, 1000000 + i);  // Order ref
-        msg[19] = 'B';  // Buy
-        write_u32(msg + 20, 100 + i * 10);  // Shares
-        write_stock(msg + 24, "AAPL");
-        write_u32(msg + 32, 1500000 + i * 100);  // Price ($150.00 + i * $0.01)
-        fwrite(msg, 36, 1, fp);
-        ts += 50000000;  // 50ms between orders
-        
-        // Add Order - Sell AAPL
-        memset(msg, 0, sizeof(msg));
-        msg[0] = 'A';
-        write_u16(msg + 1, stock_locate);
-        write_u16(msg + 3, tracking++);
-        write_timestamp(msg + 5, ts);
-        write_u64(msg + 11, 2000000 + i);  // Order ref
-        msg[19] = 'S';  // Sell
-        write_u32(msg + 20, 100 + i * 10);  // Shares
-        write_stock(msg + 24, "AAPL");
-        write_u32(msg + 32, 1500100 + i * 100);  // Price ($150.01 + i * $0.01)
-        fwrite(msg, 36, 1, fp);
-        ts += 50000000;
-        
-        // Execute some orders
-        if (i % 5 == 0) {
-            memset(msg, 0, sizeof(msg));
-            msg[0] = 'E';
-            write_u16(msg + 1, stock_locate);
-            write_u16(msg + 3, tracking++);
-            write_timestamp(msg + 5, ts);
-            write_u64(msg + 11, 1000000 + i);
-            write_u32(msg + 19, 50);  // Executed shares
-            write_u64(msg + 23, 3000000 + i);  // Match number
-            fwrite(msg, 31, 1, fp);
-            ts += 10000000;
-        }
-    }
-    
-    // System Event - End of Messages
-    memset(msg, 0, sizeof(msg));
-    msg[0] = 'S';
-    write_u16(msg + 1, stock_locate);
-    write_u16(msg + 3, tracking++);
-    write_timestamp(msg + 5, ts);
-    msg[11] = 'C';  // End of Messages
-    fwrite(msg, 12, 1, fp);
-    
-    fclose(fp);
-    
-    printf("Sample ITCH data written to data/sample.itch\n");
-    printf("Messages generated: ~200\n");
-    
+    printf("  Output: %s (%s%s)\n", g->output, itch_framing_name(g->framing), g->gzip ? ", BGZF" : "");
+    printf("  Messages: ~%lu, %d symbols (Zipf %.2f), %d threads, seed %lu\n",
+           g->messages, g->symbols, g->zipf, g->threads, g->seed);
+
+    build_time_table(g);
+    if (init_symbols(g, continuous) < 0) oom();
+
+    for (int t = 0; t < g->threads; t++) {
+        gen_worker_t *w = &g->workers[t];
+        w->g = g;
+        w->id = t;
+        w->heap = malloc(((size_t)g->symbols / g->threads + 1) * sizeof(gen_symbol_t *));
+        if (!w->heap) oom();
+        if (g->gzip && deflateInit2(&w->z, g->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            fprintf(stderr, "deflateInit failed\n");
+            return 1;
+        }
+    }
+
+    // Deal symbols out by activity rank, so every thread gets its share of the busy ones
+    gen_symbol_t **by_rate = malloc((size_t)g->symbols * sizeof(gen_symbol_t *));
+    if (!by_rate) oom();
+    for (int i = 0; i < g->symbols; i++) by_rate[i] = &g->sym[i];
+    qsort(by_rate, (size_t)g->symbols, sizeof(gen_symbol_t *), by_rate_desc);
+    for (int i = 0; i < g->symbols; i++) {
+        gen_worker_t *w = &g->workers[i % g->threads];
+        w->heap[w->nheap++] = by_rate[i];
+    }
+    free(by_rate);
+    for (int t = 0; t < g->threads; t++) {
+        gen_worker_t *w = &g->workers[t];
+        for (size_t i = w->nheap / 2; i-- > 0; ) heap_sift_down(w->heap, w->nheap, i);
+    }
+
+    g->nslots = WINDOW_DEPTH * g->threads;
+    for (int i = 0; i < g->nslots; i++) {
+        g->slots[i].runs = calloc((size_t)g->threads, sizeof(gen_buf_t));
+        if (!g->slots[i].runs) oom();
+    }
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+
+    int fd = open(g->output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror(g->output);
+        return 1;
+    }
+    z_stream z = { 0 };
+    if (g->gzip && deflateInit2(&z, g->level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "deflateInit failed\n");
+        return 1;
+    }
+
+    double start = now_sec();
+    gen_buf_t edge = { 0 };
+    uint64_t messages = start_of_day(g, &edge);
+    if (write_plain(g, &z, fd, &edge) < 0) return 1;
+    uint64_t bytes = edge.len;
+    edge.len = 0;
+
+    pthread_t tids[MAX_THREADS];
+    for (int t = 0; t < g->threads; t++) {
+        if (pthread_create(&tids[t], NULL, worker_thread, &g->workers[t]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    // Write windows in order as they complete, then hand their slots back
+    int rc = 0;
+    for (int k = 0; k < g->windows; k++) {
+        gen_window_t *win = &g->slots[k % g->nslots];
+        pthread_mutex_lock(&g->lock);
+        while (!win->done) pthread_cond_wait(&g->cond, &g->lock);
+        pthread_mutex_unlock(&g->lock);
+
+        const gen_buf_t *b = g->gzip ? &win->z : &win->out;
+        if (rc == 0 && write_all(fd, b->data, b->len) < 0) rc = -1;
+        bytes += win->out.len;
+
+        pthread_mutex_lock(&g->lock);
+        for (int t = 0; t < g->threads; t++) win->runs[t].len = 0;
+        win->out.len = 0;
+        win->z.len = 0;
+        win->runs_ready = 0;
+        win->done = 0;
+        g->written = k + 1;
+        pthread_cond_broadcast(&g->cond);
+        pthread_mutex_unlock(&g->lock);
+    }
+    for (int t = 0; t < g->threads; t++) pthread_join(tids[t], NULL);
+
+    messages += end_of_day(g, &edge);
+    if (write_plain(g, &z, fd, &edge) < 0) rc = -1;
+    bytes += edge.len;
+    free(edge.data);
+    if (g->gzip) {
+        // bgzip's empty end-of-file block
+        static const uint8_t eof[28] = {
+            0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+        };
+        if (write_all(fd, eof, sizeof(eof)) < 0) rc = -1;
+        deflateEnd(&z);
+    }
+    if (close(fd) < 0) {
+        perror("close");
+        rc = -1;
+    }
+    double elapsed = now_sec() - start;
+    if (rc < 0) return 1;
+
+    uint64_t by_type[256] = { 0 };
+    uint64_t events = 0;
+    for (int t = 0; t < g->threads; t++) {
+        for (int c = 0; c < 256; c++) {
+            by_type[c] += g->workers[t].by_type[c];
+            events += g->workers[t].by_type[c];
+        }
+    }
+    messages += events;
+
+    printf("Sample ITCH data written to %s\n", g->output);
+    printf("Messages generated: %lu (%.2f MB framed) in %.2f s, %.1f M msg/s\n", messages,
+           bytes / 1048576.0, elapsed, elapsed > 0 ? messages / elapsed / 1e6 : 0.0);
+    printf("Order events:");
+    for (size_t k = 0; k < sizeof(event_weights) / sizeof(event_weights[0]); k++) {
+        uint8_t c = event_weights[k].type;
+        printf(" %c %.1f%%", c, events ? 100.0 * by_type[c] / events : 0.0);
+    }
+    printf("\n");
     return 0;
 }
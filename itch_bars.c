@@ -0,0 +1,53 @@
+/*
+ * ITCH Bars - see itch_bars.h
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "itch_bars.h"
+
+#define DEFAULT_INTERVAL_NS 60000000000ULL
+
+itch_bars_t *itch_bars_create(const itch_bars_config_t *cfg) {
+    itch_bars_t *b = calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->interval_ns = cfg && cfg->interval_ns ? cfg->interval_ns : DEFAULT_INTERVAL_NS;
+    if (cfg) {
+        b->on_bar = cfg->on_bar;
+        b->ctx = cfg->ctx;
+    }
+    return b;
+}
+
+void itch_bars_destroy(itch_bars_t *b) {
+    free(b);
+}
+
+static int locate_cmp(const void *a, const void *b) {
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+void itch_bars_close(itch_bars_t *b) {
+    if (b->nopen == 0) return;
+    qsort(b->open, b->nopen, sizeof(uint16_t), locate_cmp);
+    for (uint32_t i = 0; i < b->nopen; i++) {
+        itch_bar_t *bar = &b->bars[b->open[i]];
+        if (b->on_bar) b->on_bar(b->open[i], bar, b->ctx);
+        memset(bar, 0, sizeof(*bar));
+    }
+    b->stats.bars += b->nopen;
+    b->stats.intervals++;
+    b->nopen = 0;
+}
+
+void itch_bars_roll(itch_bars_t *b, uint64_t timestamp) {
+    itch_bars_close(b);
+    b->start = timestamp - timestamp % b->interval_ns;
+    b->end = b->start + b->interval_ns;
+}
+
+void itch_bars_print_stats(const itch_bars_t *b, FILE *out) {
+    fprintf(out, "Bars: %lu closed over %lu intervals, %lu trades, %lu unpriced E, %lu non-printable C\n",
+            b->stats.bars, b->stats.intervals, b->stats.trades, b->stats.unpriced, b->stats.non_printable);
+}
@@ -0,0 +1,120 @@
+/*
+ * ITCH Bars - incremental OHLCV / VWAP bars per stockLocate
+ *
+ * Executions go in as they are decoded: P (non-cross trade), Q (cross), C
+ * (printable executions at their own price) and E (priced from the resting
+ * order, which the caller looks up in its order book before applying the
+ * execution). Each locate's open bar lives in a flat array indexed by
+ * locate; a trade is one array index and a handful of compares and adds.
+ *
+ * Bars share one clock: feed time is cut into fixed intervals, and when a
+ * message's timestamp crosses into a later interval every bar still open is
+ * closed and handed to the callback, in locate order. Only locates that
+ * traded in the interval have a bar, and only those are visited: a list of
+ * open locates is kept alongside the array, so closing never scans all 64K.
+ * Nothing is rescanned and no trade is kept after its bar closes.
+ *
+ * Prices are ITCH fixed point (4 decimals). VWAP is notional / volume.
+ *
+ * Usage:
+ *   itch_bars_config_t cfg = { .interval_ns = 60000000000ULL, .on_bar = my_cb };
+ *   itch_bars_t *b = itch_bars_create(&cfg);
+ *   itch_bars_advance(b, timestamp);                      // every message
+ *   itch_bars_trade(b, locate, timestamp, price, shares); // every execution
+ *   itch_bars_close(b);                                   // end of feed
+ *   itch_bars_destroy(b);
+ */
+
+#ifndef ITCH_BARS_H
+#define ITCH_BARS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define ITCH_BARS_LOCATES 65536
+
+typedef struct {
+    uint64_t start;             // ns since midnight: the interval the bar covers
+    uint32_t open;
+    uint32_t high;
+    uint32_t low;
+    uint32_t close;
+    uint64_t volume;            // shares
+    uint64_t notional;          // sum of price * shares
+    uint32_t trades;
+} itch_bar_t;
+
+/* A bar closed: called in locate order for each locate that traded */
+typedef void (*itch_bar_cb)(uint16_t locate, const itch_bar_t *bar, void *ctx);
+
+typedef struct {
+    uint64_t interval_ns;       // bar length (default 1 minute)
+    itch_bar_cb on_bar;
+    void *ctx;
+} itch_bars_config_t;
+
+typedef struct {
+    uint64_t trades;
+    uint64_t bars;              // closed and emitted
+    uint64_t intervals;         // intervals that closed at least one bar
+    uint64_t unpriced;          // E executions whose order was unknown
+    uint64_t non_printable;     // C executions left out of bars
+} itch_bars_stats_t;
+
+typedef struct {
+    itch_bar_t bars[ITCH_BARS_LOCATES];
+    uint16_t open[ITCH_BARS_LOCATES];  // locates with a bar in the current interval
+    uint32_t nopen;
+    uint64_t interval_ns;
+    uint64_t start;             // current interval
+    uint64_t end;               // 0 until the first trade
+    itch_bar_cb on_bar;
+    void *ctx;
+    itch_bars_stats_t stats;
+} itch_bars_t;
+
+/* NULL on allocation failure */
+itch_bars_t *itch_bars_create(const itch_bars_config_t *cfg);
+void itch_bars_destroy(itch_bars_t *b);
+
+/* Out of line part of itch_bars_advance: close every open bar, then start
+ * the interval holding timestamp */
+void itch_bars_roll(itch_bars_t *b, uint64_t timestamp);
+
+/* Close the bars still open (end of feed) */
+void itch_bars_close(itch_bars_t *b);
+
+/* "Bars: n closed over k intervals, t trades, u unpriced E, c non-printable C" */
+void itch_bars_print_stats(const itch_bars_t *b, FILE *out);
+
+/* Feed time moved on: close the current bars once it leaves their interval */
+static inline void itch_bars_advance(itch_bars_t *b, uint64_t timestamp) {
+    if (timestamp >= b->end && b->nopen) itch_bars_roll(b, timestamp);
+}
+
+static inline void itch_bars_trade(itch_bars_t *b, uint16_t locate, uint64_t timestamp,
+                                   uint32_t price, uint64_t shares) {
+    if (timestamp >= b->end) itch_bars_roll(b, timestamp);
+    itch_bar_t *bar = &b->bars[locate];
+    if (bar->trades == 0) {
+        bar->start = b->start;
+        bar->open = bar->high = bar->low = price;
+        b->open[b->nopen++] = locate;
+    } else {
+        if (price > bar->high) bar->high = price;
+        if (price < bar->low) bar->low = price;
+    }
+    bar->close = price;
+    bar->volume += shares;
+    bar->notional += (uint64_t)price * shares;
+    bar->trades++;
+    b->stats.trades++;
+}
+
+/* Volume-weighted average price of a bar, ITCH fixed point */
+static inline double itch_bar_vwap(const itch_bar_t *bar) {
+    return bar->volume ? (double)bar->notional / (double)bar->volume : 0.0;
+}
+
+#endif /* ITCH_BARS_H */
@@ -0,0 +1,790 @@
+/*
+ * ITCH Bench - decoder and framer microbenchmarks
+ *
+ * Replaces the single-message timing loops (deciphering.c, slack.cpp):
+ * parsing one constant message ten million times measures a perfectly
+ * predicted branch and an L1-resident buffer, not a decoder. Here every
+ * case runs over a working set of real message mixes:
+ * - Each input file is framed once and its messages are copied into a
+ *   working set of -n messages. A file with at least that many messages is
+ *   taken in order; a smaller one (like the generate_sample_itch output) is
+ *   resampled at random, which keeps its type mix but not a pattern short
+ *   enough for the branch predictor to learn. The default 1M messages is
+ *   well past L2.
+ * - A protocol with no input file gets a synthetic mix: message types drawn
+ *   with the rough shares of a NASDAQ day (adds and deletes for ITCH, quote
+ *   replaces for ITTO) and random field bytes.
+ * - The working set is laid out in each framing (raw, BinaryFILE,
+ *   SoupBinTCP, MoldUDP64 packets) for the framer cases.
+ *
+ * Cases, per mix:
+ *   <proto>.frame.<framing>  itch_frame_next over the framed working set
+ *   itch.scan.<isa>          itch_scan_batch boundary scan (ITCH)
+ *   itch.gather.<isa>        scan plus hot-field gather of A F E C X D U P
+ *   <proto>.decode.dispatch  itch_decode / itto_decode with no handlers set
+ *   <proto>.decode.all       the same with every handler set
+ *   <proto>.decode.inline    switch on the type byte and the inline
+ *                            per-type decoders, no handler table
+ *
+ * Each case runs -w warm-up passes over the working set (reported as the
+ * cold ns/msg of the first pass) and then -r measured passes, timed with
+ * CLOCK_MONOTONIC per batch of -B messages. The percentiles are over the
+ * per-batch ns/msg; ns/msg, Mmsg/s and GB/s are totals over the measured
+ * passes. GB/s counts the bytes the case walked, framing included.
+ *
+ * Results can be saved (-s) and later runs compared against them (-c); a
+ * case whose p50 is more than -t percent slower than the saved one fails
+ * the run with exit status 1.
+ *
+ * Usage:
+ *   ./itch_bench [-n messages] [-r passes] [-w passes] [-B batch] [-f framing]
+ *                [-k filter] [-s save_file] [-c compare_file] [-t percent] [file ...]
+ *
+ *   -n  working set size in messages (default 1M)
+ *   -r  measured passes per case (default 5)
+ *   -w  warm-up passes per case (default 1)
+ *   -B  messages per timed batch (default 4096)
+ *   -f  framing of the input files: raw (default), binaryfile, soupbintcp, moldudp64
+ *   -k  run only the cases whose name contains this string
+ *   -s  save the results to this file
+ *   -c  compare against results saved with -s
+ *   -t  regression threshold for -c, in percent of p50 (default 10)
+ *
+ * Example:
+ *   make bench                      # generated sample mix + synthetic ITTO
+ *   ./itch_bench -s base.txt data/01302019.NASDAQ_ITCH50
+ *   ./itch_bench -c base.txt -k decode data/01302019.NASDAQ_ITCH50
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <time.h>
+#include "itch_parser.h"
+#include "itto_parser.h"
+#include "itch_framing.h"
+#include "itch_file.h"
+#include "itch_scan.h"
+
+#define DEFAULT_MESSAGES (1u << 20)
+#define DEFAULT_PASSES 5
+#define DEFAULT_WARMUP 1
+#define DEFAULT_BATCH 4096
+#define DEFAULT_THRESHOLD 10.0
+#define MAX_MIXES 8
+#define MAX_RESULTS 256
+#define MOLD_PAYLOAD 1400       // MoldUDP64 datagram payload budget
+#define TAIL_PAD 8              // timestamp loads read up to 2 bytes past a message
+#define FRAMINGS 4
+
+/* A working set of messages, back to back, plus the same messages in every framing */
+typedef struct {
+    itch_protocol_t protocol;
+    char label[64];             // file basename, or "synthetic-<proto>"
+    const char *origin;         // "in order", "resampled" or "synthetic"
+    uint8_t *data;              // raw framing
+    size_t size;
+    uint32_t *offsets;
+    uint16_t *lengths;
+    size_t count;
+    size_t types;               // distinct message types
+    uint8_t *framed[FRAMINGS];  // [FRAMING_RAW] aliases data
+    size_t framed_size[FRAMINGS];
+} bench_mix_t;
+
+typedef struct bench_case bench_case_t;
+
+struct bench_case {
+    const char *name;
+    const bench_mix_t *mix;
+    void (*reset)(bench_case_t *c);
+    // Process up to batch messages; returns the count, 0 at the end of a pass
+    size_t (*run)(bench_case_t *c, size_t batch, uint64_t *bytes);
+
+    itch_framing_t framing;
+    const itch_handlers_t *itch_handlers;
+    const itto_handlers_t *itto_handlers;
+    itch_scan_t *scan;
+    itch_columns_t *cols;
+    size_t next;                // message index or byte offset of the next batch
+    itch_framer_t framer;
+    uint64_t sink;
+};
+
+typedef struct {
+    char key[128];
+    double cold, min, p50, p90, p99, max;
+    double ns_per_msg, mmsg_per_sec, gb_per_sec;
+} bench_result_t;
+
+static volatile uint64_t bench_sink;
+
+/* Make the compiler materialize a decoded struct it would otherwise drop */
+#define BENCH_KEEP(x) __asm__ volatile("" : : "r"(&(x)) : "memory")
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t xorshift64(uint64_t *s) {
+    uint64_t x = *s;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *s = x;
+}
+
+/* ---------------------------------------------------------------------------
+ * Working sets
+ * ------------------------------------------------------------------------- */
+
+/* Rough message shares of a full NASDAQ day, per 10000 messages */
+typedef struct {
+    uint8_t type;
+    uint16_t weight;
+} bench_weight_t;
+
+static const bench_weight_t itch_weights[] = {
+    { 'A', 3700 }, { 'F', 150 }, { 'D', 3550 }, { 'U', 950 }, { 'E', 420 },
+    { 'C', 30 }, { 'X', 260 }, { 'P', 160 }, { 'I', 400 }, { 'L', 200 },
+    { 'R', 40 }, { 'H', 40 }, { 'Y', 40 }, { 'Q', 10 }, { 'S', 10 },
+    { 'N', 20 }, { 'V', 5 }, { 'W', 5 }, { 'K', 5 }, { 'J', 5 },
+};
+
+static const bench_weight_t itto_weights[] = {
+    { 'k', 3400 }, { 'K', 900 }, { 'j', 900 }, { 'J', 300 }, { 'Y', 1100 },
+    { 'a', 700 }, { 'A', 150 }, { 'D', 700 }, { 'u', 450 }, { 'U', 100 },
+    { 'X', 350 }, { 'G', 350 }, { 'E', 350 }, { 'C', 60 }, { 'Q', 20 },
+    { 'I', 60 }, { 'R', 70 }, { 'H', 20 }, { 'O', 10 }, { 'S', 10 },
+};
+
+static const uint8_t *protocol_lengths(itch_protocol_t protocol) {
+    return protocol == PROTOCOL_ITTO ? itto_message_lengths : itch_message_lengths;
+}
+
+static int mix_alloc(bench_mix_t *m, size_t count, size_t bytes) {
+    m->data = malloc(bytes + TAIL_PAD);
+    m->offsets = malloc(count * sizeof(uint32_t));
+    m->lengths = malloc(count * sizeof(uint16_t));
+    if (!m->data || !m->offsets || !m->lengths) return -1;
+    m->count = count;
+    return 0;
+}
+
+static void mix_append(bench_mix_t *m, size_t i, const uint8_t *msg, size_t len) {
+    m->offsets[i] = (uint32_t)m->size;
+    m->lengths[i] = (uint16_t)len;
+    memcpy(m->data + m->size, msg, len);
+    m->size += len;
+}
+
+/* Lay the working set out in the length-prefixed framings */
+static int mix_frame(bench_mix_t *m) {
+    m->framed[FRAMING_RAW] = m->data;
+    m->framed_size[FRAMING_RAW] = m->size;
+
+    for (int f = FRAMING_BINARYFILE; f <= FRAMING_SOUPBINTCP; f++) {
+        size_t prefix = itch_framing_prefix_size((itch_framing_t)f);
+        uint8_t *out = malloc(m->size + m->count * prefix + TAIL_PAD);
+        if (!out) return -1;
+        size_t pos = 0;
+        for (size_t i = 0; i < m->count; i++) {
+            pos += itch_framing_write_prefix((itch_framing_t)f, out + pos, m->lengths[i]);
+            memcpy(out + pos, m->data + m->offsets[i], m->lengths[i]);
+            pos += m->lengths[i];
+        }
+        memset(out + pos, 0, TAIL_PAD);
+        m->framed[f] = out;
+        m->framed_size[f] = pos;
+    }
+
+    // MoldUDP64: packets of as many message blocks as fit the payload budget
+    size_t packets = (m->size + m->count * 2) / (MOLD_PAYLOAD - 64) + 1;  // < 64 bytes left per packet
+    uint8_t *out = malloc(m->size + m->count * 2 + packets * MOLDUDP64_HEADER_SIZE + TAIL_PAD);
+    if (!out) return -1;
+    size_t pos = 0;
+    uint64_t seq = 1;
+    for (size_t i = 0; i < m->count;) {
+        uint8_t *hdr = out + pos;
+        memcpy(hdr, "BENCH00001", 10);
+        itch_write_u64(hdr + 10, seq);
+        pos += MOLDUDP64_HEADER_SIZE;
+        size_t payload = 0;
+        uint16_t blocks = 0;
+        while (i < m->count && payload + 2 + m->lengths[i] <= MOLD_PAYLOAD) {
+            itch_write_u16(out + pos, m->lengths[i]);
+            memcpy(out + pos + 2, m->data + m->offsets[i], m->lengths[i]);
+            pos += 2 + m->lengths[i];
+            payload += 2 + m->lengths[i];
+            blocks++;
+            i++;
+        }
+        itch_write_u16(hdr + 18, blocks);
+        seq += blocks;
+    }
+    memset(out + pos, 0, TAIL_PAD);
+    m->framed[FRAMING_MOLDUDP64] = out;
+    m->framed_size[FRAMING_MOLDUDP64] = pos;
+    return 0;
+}
+
+static void mix_count_types(bench_mix_t *m) {
+    uint8_t seen[256] = { 0 };
+    m->types = 0;
+    for (size_t i = 0; i < m->count; i++) {
+        uint8_t t = m->data[m->offsets[i]];
+        if (!seen[t]) {
+            seen[t] = 1;
+            m->types++;
+        }
+    }
+}
+
+static int mix_from_file(bench_mix_t *m, const char *path, itch_framing_t framing, size_t n) {
+    itch_file_t file;
+    if (itch_file_open(&file, path) < 0) {
+        fprintf(stderr, "Failed to map file: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    size_t probe = file.size < (1u << 20) ? file.size : (1u << 20);
+    m->protocol = itch_protocol_detect(file.data, probe, framing);
+    const char *base = strrchr(path, '/');
+    snprintf(m->label, sizeof(m->label), "%s", base ? base + 1 : path);
+
+    // Index the file's messages (up to n of them)
+    size_t cap = 1 << 16, have = 0;
+    const uint8_t **msgs = malloc(cap * sizeof(*msgs));
+    uint16_t *lens = malloc(cap * sizeof(*lens));
+    itch_cursor_t cur;
+    itch_cursor_init(&cur, file.data, file.size, framing);
+    itch_framer_set_protocol(&cur.framer, m->protocol);
+    const uint8_t *msg;
+    size_t len;
+    while (msgs && lens && have < n && itch_cursor_next(&cur, &msg, &len)) {
+        if (have == cap) {
+            cap *= 2;
+            msgs = realloc(msgs, cap * sizeof(*msgs));
+            lens = realloc(lens, cap * sizeof(*lens));
+            if (!msgs || !lens) break;
+        }
+        msgs[have] = msg;
+        lens[have] = (uint16_t)len;
+        have++;
+    }
+    if (!msgs || !lens) {
+        fprintf(stderr, "Out of memory indexing %s\n", path);
+        free(msgs);
+        free(lens);
+        itch_file_close(&file);
+        return -1;
+    }
+    if (have == 0) {
+        fprintf(stderr, "No %s messages in %s\n", itch_protocol_name(m->protocol), path);
+        free(msgs);
+        free(lens);
+        itch_file_close(&file);
+        return -1;
+    }
+
+    // In order if the file is big enough, otherwise resample to n
+    size_t count = have < n ? n : have;
+    size_t bytes = 0;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    uint32_t *pick = malloc(count * sizeof(uint32_t));
+    for (size_t i = 0; pick && i < count; i++) {
+        pick[i] = have == count ? (uint32_t)i : (uint32_t)(xorshift64(&rng) % have);
+        bytes += lens[pick[i]];
+    }
+    int rc = -1;
+    if (pick && mix_alloc(m, count, bytes) == 0) {
+        for (size_t i = 0; i < count; i++) mix_append(m, i, msgs[pick[i]], lens[pick[i]]);
+        memset(m->data + m->size, 0, TAIL_PAD);
+        m->origin = have == count ? "in order" : "resampled";
+        rc = 0;
+    } else {
+        fprintf(stderr, "Out of memory building the working set for %s\n", path);
+    }
+    free(pick);
+    free(msgs);
+    free(lens);
+    itch_file_close(&file);
+    return rc;
+}
+
+static int mix_synthetic(bench_mix_t *m, itch_protocol_t protocol, size_t n) {
+    const bench_weight_t *w = protocol == PROTOCOL_ITTO ? itto_weights : itch_weights;
+    size_t nw = protocol == PROTOCOL_ITTO ? sizeof(itto_weights) / sizeof(itto_weights[0])
+                                          : sizeof(itch_weights) / sizeof(itch_weights[0]);
+    const uint8_t *lengths = protocol_lengths(protocol);
+    uint32_t total = 0;
+    for (size_t i = 0; i < nw; i++) total += w[i].weight;
+
+    m->protocol = protocol;
+    snprintf(m->label, sizeof(m->label), "synthetic-%s", itch_protocol_name(protocol));
+    m->origin = "synthetic";
+
+    uint8_t *types = malloc(n);
+    if (!types) return -1;
+    uint64_t rng = 0xD1B54A32D192ED03ULL;
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t r = (uint32_t)(xorshift64(&rng) % total);
+        size_t k = 0;
+        while (r >= w[k].weight) r -= w[k++].weight;
+        types[i] = w[k].type;
+        bytes += lengths[types[i]];
+    }
+    if (mix_alloc(m, n, bytes) < 0) {
+        free(types);
+        return -1;
+    }
+    uint8_t msg[256];
+    for (size_t i = 0; i < n; i++) {
+        size_t len = lengths[types[i]];
+        for (size_t b = 0; b < len; b += 8) {
+            uint64_t r = xorshift64(&rng);
+            memcpy(msg + b, &r, 8);
+        }
+        msg[0] = types[i];
+        mix_append(m, i, msg, len);
+    }
+    memset(m->data + m->size, 0, TAIL_PAD);
+    free(types);
+    return 0;
+}
+
+static void mix_free(bench_mix_t *m) {
+    for (int f = FRAMING_BINARYFILE; f < FRAMINGS; f++) free(m->framed[f]);
+    free(m->data);
+    free(m->offsets);
+    free(m->lengths);
+}
+
+/* ---------------------------------------------------------------------------
+ * Cases
+ * ------------------------------------------------------------------------- */
+
+#define ITCH_GEN_SINK(c, T, Name, len, slot) \
+    static void sink_itch_##T(const Name *m, void *ctx) { *(uint64_t *)ctx += m->header.timestamp; }
+ITCH_MESSAGES(ITCH_GEN_SINK)
+#undef ITCH_GEN_SINK
+
+#define ITTO_GEN_SINK(Name, T, slot) \
+    static void sink_itto_##T(const Name *m, void *ctx) { *(uint64_t *)ctx += m->header.timestamp; }
+ITTO_STRUCTS(ITTO_GEN_SINK)
+#undef ITTO_GEN_SINK
+
+#define ITCH_GEN_SINK_SLOT(c, T, Name, len, slot) .slot = sink_itch_##T,
+static const itch_handlers_t itch_sink_handlers = { ITCH_MESSAGES(ITCH_GEN_SINK_SLOT) };
+#undef ITCH_GEN_SINK_SLOT
+
+#define ITTO_GEN_SINK_SLOT(Name, T, slot) .slot = sink_itto_##T,
+static const itto_handlers_t itto_sink_handlers = { ITTO_STRUCTS(ITTO_GEN_SINK_SLOT) };
+#undef ITTO_GEN_SINK_SLOT
+
+static const itch_handlers_t itch_no_handlers;
+static const itto_handlers_t itto_no_handlers;
+
+static void reset_frame(bench_case_t *c) {
+    c->next = 0;
+    itch_framer_init(&c->framer, c->framing);
+    itch_framer_set_protocol(&c->framer, c->mix->protocol);
+}
+
+static void reset_index(bench_case_t *c) {
+    c->next = 0;
+}
+
+static void reset_scan(bench_case_t *c) {
+    c->next = 0;
+    itch_framer_init(&c->scan->framer, FRAMING_RAW);
+}
+
+static size_t run_frame(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    const uint8_t *buf = c->mix->framed[c->framing];
+    size_t size = c->mix->framed_size[c->framing];
+    size_t pos = c->next, n = 0;
+    while (n < batch && pos < size) {
+        const uint8_t *msg;
+        size_t len;
+        size_t used = itch_frame_next(&c->framer, buf + pos, size - pos, &msg, &len);
+        if (used == 0) break;
+        pos += used;
+        if (len) {
+            c->sink += msg[0] + len;
+            n++;
+        }
+    }
+    *bytes = pos - c->next;
+    c->next = pos;
+    return n;
+}
+
+static size_t run_scan(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    (void)batch;    // the scan capacity is the batch size
+    const bench_mix_t *m = c->mix;
+    const uint8_t *base = m->data + c->next;
+    size_t used = itch_scan_batch(c->scan, base, m->size - c->next);
+    if (used == 0) return 0;
+    if (c->cols) {
+        static const uint8_t hot[] = { 'A', 'F', 'E', 'C', 'X', 'D', 'U', 'P' };
+        for (size_t t = 0; t < sizeof(hot); t++) {
+            size_t n;
+            const uint32_t *idx = itch_scan_select(c->scan, hot[t], &n);
+            if (n && itch_gather(c->cols, base, idx, n, hot[t]) == 0)
+                c->sink += c->cols->timestamp[n - 1];
+        }
+    } else {
+        c->sink += c->scan->offsets[c->scan->count - 1];
+    }
+    c->next += used;
+    *bytes = used;
+    return c->scan->count;
+}
+
+static size_t run_itch_decode(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    const bench_mix_t *m = c->mix;
+    size_t i = c->next, end = i + batch < m->count ? i + batch : m->count;
+    uint64_t b = 0;
+    for (; i < end; i++) {
+        itch_decode(m->data + m->offsets[i], m->lengths[i], c->itch_handlers, &c->sink);
+        b += m->lengths[i];
+    }
+    *bytes = b;
+    size_t n = end - c->next;
+    c->next = end;
+    return n;
+}
+
+static size_t run_itto_decode(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    const bench_mix_t *m = c->mix;
+    size_t i = c->next, end = i + batch < m->count ? i + batch : m->count;
+    uint64_t b = 0;
+    for (; i < end; i++) {
+        itto_decode(m->data + m->offsets[i], m->lengths[i], c->itto_handlers, &c->sink);
+        b += m->lengths[i];
+    }
+    *bytes = b;
+    size_t n = end - c->next;
+    c->next = end;
+    return n;
+}
+
+#define ITCH_GEN_INLINE(c, T, Name, len, slot) \
+    case c: { Name d; itch_decode_##T(msg, &d); BENCH_KEEP(d); sum += d.header.timestamp; break; }
+
+static size_t run_itch_inline(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    const bench_mix_t *m = c->mix;
+    size_t i = c->next, end = i + batch < m->count ? i + batch : m->count;
+    uint64_t b = 0, sum = 0;
+    for (; i < end; i++) {
+        const uint8_t *msg = m->data + m->offsets[i];
+        switch (msg[0]) {
+            ITCH_MESSAGES(ITCH_GEN_INLINE)
+            default: break;
+        }
+        b += m->lengths[i];
+    }
+    c->sink += sum;
+    *bytes = b;
+    size_t n = end - c->next;
+    c->next = end;
+    return n;
+}
+#undef ITCH_GEN_INLINE
+
+#define ITTO_GEN_INLINE(c, T, Name, len, slot) \
+    case c: { Name d; itto_decode_##T(msg, &d); BENCH_KEEP(d); sum += d.header.timestamp; break; }
+
+static size_t run_itto_inline(bench_case_t *c, size_t batch, uint64_t *bytes) {
+    const bench_mix_t *m = c->mix;
+    size_t i = c->next, end = i + batch < m->count ? i + batch : m->count;
+    uint64_t b = 0, sum = 0;
+    for (; i < end; i++) {
+        const uint8_t *msg = m->data + m->offsets[i];
+        switch (msg[0]) {
+            ITTO_MESSAGES(ITTO_GEN_INLINE)
+            default: break;
+        }
+        b += m->lengths[i];
+    }
+    c->sink += sum;
+    *bytes = b;
+    size_t n = end - c->next;
+    c->next = end;
+    return n;
+}
+#undef ITTO_GEN_INLINE
+
+/* ---------------------------------------------------------------------------
+ * Harness
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    size_t passes;
+    size_t warmup;
+    size_t batch;
+    const char *filter;
+} bench_opts_t;
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, size_t n, double p) {
+    size_t i = (size_t)(p * (double)(n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+/* Time one case; returns 0 with r filled, -1 if it processed nothing */
+static int bench_run(bench_case_t *c, const bench_opts_t *o, bench_result_t *r) {
+    size_t cap = (c->mix->count / o->batch + 2) * o->passes;
+    double *samples = malloc(cap * sizeof(double));
+    if (!samples) return -1;
+    size_t ns_count = 0;
+    uint64_t msgs = 0, bytes = 0, ns = 0;
+    uint64_t cold_msgs = 0, cold_ns = 0;
+
+    for (size_t pass = 0; pass < o->warmup + o->passes; pass++) {
+        c->reset(c);
+        for (;;) {
+            uint64_t b = 0;
+            uint64_t t0 = now_ns();
+            size_t n = c->run(c, o->batch, &b);
+            uint64_t dt = now_ns() - t0;
+            if (n == 0) break;
+            if (pass == 0) {
+                cold_msgs += n;
+                cold_ns += dt;
+            }
+            if (pass < o->warmup) continue;
+            msgs += n;
+            bytes += b;
+            ns += dt;
+            if (ns_count < cap) samples[ns_count++] = (double)dt / (double)n;
+        }
+    }
+    bench_sink += c->sink;
+    if (ns_count == 0 || msgs == 0) {
+        free(samples);
+        return -1;
+    }
+
+    qsort(samples, ns_count, sizeof(double), cmp_double);
+    r->cold = cold_msgs ? (double)cold_ns / (double)cold_msgs : 0;
+    r->min = samples[0];
+    r->p50 = percentile(samples, ns_count, 0.50);
+    r->p90 = percentile(samples, ns_count, 0.90);
+    r->p99 = percentile(samples, ns_count, 0.99);
+    r->max = samples[ns_count - 1];
+    r->ns_per_msg = (double)ns / (double)msgs;
+    r->mmsg_per_sec = (double)msgs * 1e3 / (double)ns;
+    r->gb_per_sec = (double)bytes / (double)ns;
+    free(samples);
+    return 0;
+}
+
+/* Saved results: "<key> <p50> <ns/msg>" per line */
+static size_t load_baseline(const char *path, bench_result_t *base, size_t max) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Cannot open baseline %s: %s\n", path, strerror(errno));
+        return 0;
+    }
+    char line[256];
+    size_t n = 0;
+    while (n < max && fgets(line, sizeof(line), fp)) {
+        if (line[0] == '#') continue;
+        if (sscanf(line, "%127s %lf %lf", base[n].key, &base[n].p50, &base[n].ns_per_msg) == 3) n++;
+    }
+    fclose(fp);
+    return n;
+}
+
+static const bench_result_t *find_result(const bench_result_t *rs, size_t n, const char *key) {
+    for (size_t i = 0; i < n; i++)
+        if (strcmp(rs[i].key, key) == 0) return &rs[i];
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n messages] [-r passes] [-w passes] [-B batch] [-f framing]\n"
+                    "       %*s [-k filter] [-s save_file] [-c compare_file] [-t percent] [file ...]\n",
+            prog, (int)strlen(prog), "");
+}
+
+int main(int argc, char *argv[]) {
+    size_t messages = DEFAULT_MESSAGES;
+    bench_opts_t o = { .passes = DEFAULT_PASSES, .warmup = DEFAULT_WARMUP, .batch = DEFAULT_BATCH };
+    itch_framing_t framing = FRAMING_RAW;
+    const char *save_path = NULL;
+    const char *compare_path = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:r:w:B:f:k:s:c:t:")) != -1) {
+        switch (opt) {
+            case 'n': messages = strtoul(optarg, NULL, 10); break;
+            case 'r': o.passes = strtoul(optarg, NULL, 10); break;
+            case 'w': o.warmup = strtoul(optarg, NULL, 10); break;
+            case 'B': o.batch = strtoul(optarg, NULL, 10); break;
+            case 'f':
+                if (itch_framing_parse(optarg, &framing) < 0) {
+                    fprintf(stderr, "Unknown framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'k': o.filter = optarg; break;
+            case 's': save_path = optarg; break;
+            case 'c': compare_path = optarg; break;
+            case 't': threshold = atof(optarg); break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (messages == 0 || o.passes == 0 || o.batch == 0) {
+        fprintf(stderr, "Messages, passes and batch must be positive\n");
+        return 1;
+    }
+    if (messages > UINT32_MAX / 64) {
+        fprintf(stderr, "Working set too large: %zu messages\n", messages);
+        return 1;
+    }
+
+    // Inputs, then a synthetic mix for each protocol no file covered
+    bench_mix_t mixes[MAX_MIXES];
+    size_t nmix = 0;
+    int have[2] = { 0, 0 };
+    memset(mixes, 0, sizeof(mixes));
+    for (int i = optind; i < argc; i++) {
+        if (nmix == MAX_MIXES - 2) {
+            fprintf(stderr, "At most %d input files\n", MAX_MIXES - 2);
+            return 1;
+        }
+        if (mix_from_file(&mixes[nmix], argv[i], framing, messages) < 0) return 1;
+        have[mixes[nmix].protocol] = 1;
+        nmix++;
+    }
+    for (int p = PROTOCOL_ITCH; p <= PROTOCOL_ITTO; p++) {
+        if (have[p]) continue;
+        if (mix_synthetic(&mixes[nmix], (itch_protocol_t)p, messages) < 0) {
+            fprintf(stderr, "Out of memory building the synthetic %s mix\n",
+                    itch_protocol_name((itch_protocol_t)p));
+            return 1;
+        }
+        nmix++;
+    }
+    for (size_t i = 0; i < nmix; i++) {
+        if (mix_frame(&mixes[i]) < 0) {
+            fprintf(stderr, "Out of memory framing the %s working set\n", mixes[i].label);
+            return 1;
+        }
+        mix_count_types(&mixes[i]);
+    }
+
+    itch_scan_t scan;
+    itch_columns_t cols;
+    if (itch_scan_init(&scan, o.batch, FRAMING_RAW) < 0 || itch_columns_init(&cols, o.batch) < 0) {
+        fprintf(stderr, "Out of memory for the scan batch\n");
+        return 1;
+    }
+
+    bench_result_t base[MAX_RESULTS];
+    size_t nbase = compare_path ? load_baseline(compare_path, base, MAX_RESULTS) : 0;
+    if (compare_path && nbase == 0) return 1;
+    FILE *save = NULL;
+    if (save_path && !(save = fopen(save_path, "w"))) {
+        fprintf(stderr, "Cannot write %s: %s\n", save_path, strerror(errno));
+        return 1;
+    }
+    if (save) fprintf(save, "# itch_bench: key p50_ns_per_msg ns_per_msg\n");
+
+    struct timespec res;
+    clock_getres(CLOCK_MONOTONIC, &res);
+    printf("=== ITCH Bench ===\n");
+    printf("Passes: %zu measured + %zu warm-up, batch %zu messages, clock resolution %ld ns, scan ISA %s\n",
+           o.passes, o.warmup, o.batch, res.tv_nsec, itch_scan_isa());
+
+    static const char *framing_case[FRAMINGS] = {
+        "frame.raw", "frame.binaryfile", "frame.soupbintcp", "frame.moldudp64",
+    };
+    char scan_name[32], gather_name[32];
+    snprintf(scan_name, sizeof(scan_name), "scan.%s", itch_scan_isa());
+    snprintf(gather_name, sizeof(gather_name), "gather.%s", itch_scan_isa());
+
+    int regressions = 0;
+    for (size_t mi = 0; mi < nmix; mi++) {
+        const bench_mix_t *m = &mixes[mi];
+        int itto = m->protocol == PROTOCOL_ITTO;
+        printf("\n%s mix: %s (%s), %zu messages, %zu types, %.1f bytes/msg, %.1f MB\n",
+               itto ? "ITTO" : "ITCH", m->label, m->origin, m->count, m->types,
+               (double)m->size / (double)m->count, m->size / 1048576.0);
+        printf("%-26s %7s %7s %7s %7s %7s %8s %8s %7s %6s%s\n", "case", "cold", "min", "p50",
+               "p90", "p99", "max", "ns/msg", "Mmsg/s", "GB/s", nbase ? "  vs base" : "");
+
+        bench_case_t cases[FRAMINGS + 5];
+        size_t nc = 0;
+        for (int f = 0; f < FRAMINGS; f++)
+            cases[nc++] = (bench_case_t){ .name = framing_case[f], .framing = (itch_framing_t)f,
+                                          .reset = reset_frame, .run = run_frame };
+        if (!itto) {
+            cases[nc++] = (bench_case_t){ .name = scan_name, .scan = &scan,
+                                          .reset = reset_scan, .run = run_scan };
+            cases[nc++] = (bench_case_t){ .name = gather_name, .scan = &scan, .cols = &cols,
+                                          .reset = reset_scan, .run = run_scan };
+        }
+        cases[nc++] = (bench_case_t){ .name = "decode.dispatch", .reset = reset_index,
+                                      .run = itto ? run_itto_decode : run_itch_decode,
+                                      .itch_handlers = &itch_no_handlers,
+                                      .itto_handlers = &itto_no_handlers };
+        cases[nc++] = (bench_case_t){ .name = "decode.all", .reset = reset_index,
+                                      .run = itto ? run_itto_decode : run_itch_decode,
+                                      .itch_handlers = &itch_sink_handlers,
+                                      .itto_handlers = &itto_sink_handlers };
+        cases[nc++] = (bench_case_t){ .name = "decode.inline", .reset = reset_index,
+                                      .run = itto ? run_itto_inline : run_itch_inline };
+
+        for (size_t ci = 0; ci < nc; ci++) {
+            bench_case_t *c = &cases[ci];
+            c->mix = m;
+            char name[64];
+            snprintf(name, sizeof(name), "%s.%s", itto ? "itto" : "itch", c->name);
+            if (o.filter && !strstr(name, o.filter)) continue;
+
+            bench_result_t r;
+            snprintf(r.key, sizeof(r.key), "%s:%s", m->label, name);
+            if (bench_run(c, &o, &r) < 0) {
+                printf("%-26s (no messages)\n", name);
+                continue;
+            }
+            printf("%-26s %7.2f %7.2f %7.2f %7.2f %7.2f %8.2f %8.2f %7.1f %6.2f",
+                   name, r.cold, r.min, r.p50, r.p90, r.p99, r.max,
+                   r.ns_per_msg, r.mmsg_per_sec, r.gb_per_sec);
+            const bench_result_t *b = nbase ? find_result(base, nbase, r.key) : NULL;
+            if (b && b->p50 > 0) {
+                double delta = (r.p50 - b->p50) * 100.0 / b->p50;
+                int regressed = delta > threshold;
+                printf("  %+6.1f%%%s", delta, regressed ? " REGRESSION" : "");
+                regressions += regressed;
+            }
+            printf("\n");
+            if (save) fprintf(save, "%s %.3f %.3f\n", r.key, r.p50, r.ns_per_msg);
+        }
+    }
+    printf("\n(all times ns/msg; sink %" PRIu64 ")\n", (uint64_t)bench_sink);
+
+    if (save) fclose(save);
+    if (regressions) printf("%d case(s) regressed by more than %.0f%% at p50\n", regressions, threshold);
+    itch_scan_free(&scan);
+    itch_columns_free(&cols);
+    for (size_t i = 0; i < nmix; i++) mix_free(&mixes[i]);
+    return regressions ? 1 : 0;
+}
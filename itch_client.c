@@ -1,47 +1,418 @@
 /*
  * ITCH Client - Connects to ITCH replay server and parses messages
  * 
+ * Receiving and decoding run on separate threads joined by a lock-free
+ * SPSC ring of framed messages (spsc_ring.h), so a slow decode (order
+ * books, -v) does not stop the socket from being drained until the ring
+ * itself is full. The ring's high-water mark is reported on exit.
+ * 
+ * With -M the client reads the server's shared-memory ring (shm_ring.h)
+ * instead: there is no socket and no receive thread, and messages are
+ * decoded in place from the mapping. The server never waits for a slow
+ * reader; the reader detects being overrun and skips to the live head.
+ * 
+ * Latency is measured on the decode thread into HDR-style histograms
+ * (latency.h): wire-to-decode from the send time the server stamps into
+ * every message (server -T), and decode-to-book as the time to decode a
+ * message and apply it to the order book. A reporter thread snapshots them,
+ * with the message counters, into one JSON line per interval, so scraping
+ * never touches the decode path.
+ * 
+ * ITCH feeds go through a stockLocate directory (itch_directory.h) built
+ * from the R and H messages: the book summary names stocks by symbol, and
+ * -s drops every other stock with one bitmap test on the locate before
+ * anything is decoded. Over TCP, -s and -t are also sent to the server as a
+ * SUBSCRIBE line on connect, so a server that takes subscriptions does not
+ * send the rest at all; the local filter still covers one that does not.
+ * 
+ * -B aggregates executions into per-stock OHLCV / VWAP bars (itch_bars.h)
+ * on the decode thread and writes each closed bar as one CSV line, so bars
+ * come out while the feed runs instead of from a later pass over the file.
+ * E executions carry no price: it is read from the order book before the
+ * execution is applied (the book is kept even without -b).
+ * 
+ * Mid-day starts: against a server started with -k snapshots -K -t HH:MM,
+ * -k file@HH:MM loads the same snapshot (itch_snapshot) into the book and
+ * the symbol directory before the first message, and the feed carries on
+ * from the snapshot's offset.
+ * 
  * Usage:
- *   ./itch_client [host] [port]
+ *   ./itch_client [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-r ring_mb] [-a cpus] [-f framing] [host] [port]
+ *   ./itch_client [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-r ring_mb] [-a cpus] -g group:port [-I iface] [-R host:port]
+ *   ./itch_client [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-a cpu] -M name
+ * 
+ *   -v  print every decoded message
+ *   -b  reconstruct order books and print top of book on exit (ITTO: per-series
+ *       order and quote books with best bid/offer)
+ *   -s  ITCH: only decode these comma-separated symbols (plus system messages);
+ *       symbols bind to their locates from the feed's R messages
+ *   -t  only decode these message types, e.g. PQEC (system messages too only
+ *       if listed)
+ *   -B  ITCH: build OHLCV / VWAP bars of this many seconds (e.g. 1, 60, 0.5)
+ *       from P, Q, printable C and E executions
+ *   -O  write closed bars as CSV to this file (default bars.csv, "-" = stdout)
+ *   -k  ITCH: load the snapshot at or before a feed time before decoding:
+ *       snapshots@HH:MM[:SS[.fraction]] (the server sends from there with -K)
+ *   -T  the server stamps send times (itch_replay_server -T): record
+ *       wire-to-decode latency. Needs a clock shared with the server.
+ *   -L  record decode-to-book latency (decode plus book update with -b)
+ *   -J  append a JSON stats line every interval to this file ("-" = stdout)
+ *   -i  stats interval in milliseconds (default 1000)
+ *   -P  feed protocol: itch (default, ITCH 5.0) or itto (ITTO 4.0 options)
+ *   -r  receive ring size in MB (default 16)
+ *   -a  pin the receive thread, and optionally the decode thread: rx[,decode]
+ *   -f  stream framing: raw (default), binaryfile, soupbintcp
+ *   -g  receive the MoldUDP64 multicast feed instead of connecting over TCP
+ *   -I  local interface address to join the group on (default any)
+ *   -R  retransmission server (default host:group port + 1)
+ *   -M  read the shared-memory ring of a server started with -M name
+ * 
+ * In multicast mode messages are delivered in sequence order: gaps are
+ * requested from the retransmission server while later packets are
+ * buffered, and the client exits at end of session.
  * 
  * Example:
- *   ./itch_client localhost 9999
+ *   ./itch_client -b localhost 9999
+ *   ./itch_client -b -T -L -J stats.jsonl localhost 9999
+ *   ./itch_client -g 239.1.1.1:30001 -R 10.0.0.1:30002
+ *   ./itch_client -b -T -M itch
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <errno.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "itch_parser.h"
+#include "itto_parser.h"
+#include "order_book.h"
+#include "itto_book.h"
+#include "itch_framing.h"
+#include "itch_stream.h"
+#include "mold.h"
+#include "mold_recv.h"
+#include "spsc_ring.h"
+#include "shm_ring.h"
+#include "pacer.h"
+#include "latency.h"
+#include "itch_directory.h"
+#include "itch_bars.h"
+#include "itch_idx.h"
+#include "itch_snap.h"
 
-#define BUFFER_SIZE (64 * 1024)
 #define DEFAULT_HOST "127.0.0.1"
 #define DEFAULT_PORT 9999
-
-/* Import parser functions (declared in itch_parser.c) */
-extern void parse_itch_message(const uint8_t *msg, size_t len);
-extern size_t get_itch_message_length(uint8_t msg_type);
+#define MCAST_IDLE_SECONDS 10   // give up on a feed that has gone quiet
+#define DEFAULT_RING_MB 16
+#define DECODE_BATCH 256        // messages decoded per ring release
+#define DEFAULT_STATS_MS 1000
+#define SHM_OPEN_TIMEOUT_MS 10000   // wait this long for the server to create the ring
 
 /* Statistics */
 typedef struct {
     uint64_t total_messages;
     uint64_t total_bytes;
     uint64_t messages_by_type[256];
+    uint64_t shares_added;
+    uint64_t shares_executed;
+    uint64_t shares_traded;      // non-displayed (P) and cross (Q) prints
+    uint64_t last_timestamp;     // feed time of the last decoded message
+    uint64_t filtered;           // dropped by the -s symbol or -t type filter
     struct timespec start_time;
     struct timespec last_update;
 } stats_t;
 
+/* Decode context shared by the handler table */
+typedef struct {
+    stats_t *stats;
+    order_book_t *book;
+    itto_book_t *options;
+    itch_directory_t *dir;       // ITCH only
+    int filter;                  // -s: drop unselected locates
+    int type_filter;             // -t: drop types not in types
+    itch_bars_t *bars;           // -B, ITCH only
+    FILE *bars_out;
+    uint64_t types[256 / 64];
+    int verbose;
+    itch_protocol_t protocol;
+    size_t ts_offset;            // timestamp offset for the protocol
+    latency_hist_t *wire;        // send stamp -> decode, NULL = off
+    latency_hist_t *book_lat;    // decode -> book updated, NULL = off
+    // Published once per decode batch for the reporter thread
+    _Atomic uint64_t live_messages;
+    _Atomic uint64_t live_bytes;
+} client_ctx_t;
+
+static void on_add_order(const ITCHAddOrder *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_added += m->shares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->book) {
+        order_book_add(c->book, m->header.stockLocate, m->header.timestamp,
+                       m->orderRefNum, m->buySellIndicator, m->shares, m->price);
+    }
+}
+
+static void on_add_order_mpid(const ITCHAddOrderMPID *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_added += m->shares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->book) {
+        order_book_add(c->book, m->header.stockLocate, m->header.timestamp,
+                       m->orderRefNum, m->buySellIndicator, m->shares, m->price);
+    }
+}
+
+static void on_order_executed(const ITCHOrderExecuted *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_executed += m->executedShares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->bars) {
+        // Priced from the resting order, before the execution can remove it
+        uint16_t locate;
+        uint32_t price;
+        if (order_book_order(c->book, m->orderRefNum, &locate, &price) == 0) {
+            itch_bars_trade(c->bars, m->header.stockLocate, m->header.timestamp, price, m->executedShares);
+        } else {
+            c->bars->stats.unpriced++;
+        }
+    }
+    if (c->book) {
+        order_book_execute(c->book, m->header.timestamp, m->orderRefNum, m->executedShares);
+    }
+}
+
+static void on_order_executed_with_price(const ITCHOrderExecutedWithPrice *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_executed += m->executedShares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->bars) {
+        // Non-printable executions are reported again elsewhere (e.g. a cross)
+        if (m->printable == 'Y') {
+            itch_bars_trade(c->bars, m->header.stockLocate, m->header.timestamp,
+                            m->executionPrice, m->executedShares);
+        } else {
+            c->bars->stats.non_printable++;
+        }
+    }
+    if (c->book) {
+        order_book_execute(c->book, m->header.timestamp, m->orderRefNum, m->executedShares);
+    }
+}
+
+static void on_order_cancel(const ITCHOrderCancel *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->book) {
+        order_book_cancel(c->book, m->header.timestamp, m->orderRefNum, m->cancelledShares);
+    }
+}
+
+static void on_order_delete(const ITCHOrderDelete *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->book) {
+        order_book_delete(c->book, m->header.timestamp, m->orderRefNum);
+    }
+}
+
+static void on_order_replace(const ITCHOrderReplace *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->book) {
+        order_book_replace(c->book, m->header.timestamp, m->origOrderRefNum,
+                           m->newOrderRefNum, m->shares, m->price);
+    }
+}
+
+static void on_trade(const ITCHTrade *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_traded += m->shares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->bars) itch_bars_trade(c->bars, m->header.stockLocate, m->header.timestamp, m->price, m->shares);
+}
+
+static void on_cross_trade(const ITCHCrossTrade *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_traded += m->shares;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->bars && m->shares) {
+        itch_bars_trade(c->bars, m->header.stockLocate, m->header.timestamp, m->crossPrice, m->shares);
+    }
+}
+
+/* -B: one CSV line per closed bar */
+static void on_bar(uint16_t locate, const itch_bar_t *bar, void *ctx) {
+    client_ctx_t *c = ctx;
+    const char *symbol = c->dir ? itch_directory_symbol(c->dir, locate) : NULL;
+    uint64_t ts = bar->start;
+    fprintf(c->bars_out, "%02u:%02u:%02u.%09u,%s,%u,%.4f,%.4f,%.4f,%.4f,%lu,%.4f,%u\n",
+            (unsigned)(ts / 3600000000000ULL), (unsigned)(ts / 60000000000ULL % 60),
+            (unsigned)(ts / 1000000000ULL % 60), (unsigned)(ts % 1000000000ULL),
+            symbol ? symbol : "", locate, bar->open / 10000.0, bar->high / 10000.0, bar->low / 10000.0,
+            bar->close / 10000.0, bar->volume, itch_bar_vwap(bar) / 10000.0, bar->trades);
+}
+
+static void on_system_event(const ITCHSystemEvent *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+}
+
+static const itch_handlers_t client_handlers = {
+    .on_system_event = on_system_event,
+    .on_add_order = on_add_order,
+    .on_add_order_mpid = on_add_order_mpid,
+    .on_order_executed = on_order_executed,
+    .on_order_executed_with_price = on_order_executed_with_price,
+    .on_order_cancel = on_order_cancel,
+    .on_order_delete = on_order_delete,
+    .on_order_replace = on_order_replace,
+    .on_trade = on_trade,
+    .on_cross_trade = on_cross_trade,
+};
+
+/* ITTO: contracts go into the same counters (added, executed, crossed) */
+
+static void on_itto_system_event(const ITTOSystemEvent *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+}
+
+static void on_itto_options_directory(const ITTOOptionsDirectory *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_add_option(c->options, m->optionId);
+    }
+}
+
+static void on_itto_add_order(const ITTOAddOrder *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_added += m->volume;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_add_order(c->options, m->header.timestamp, m->optionId, m->orderRefNum,
+                            m->side, m->volume, m->price);
+    }
+}
+
+static void on_itto_add_quote(const ITTOAddQuote *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_added += (uint64_t)m->bidSize + m->askSize;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_add_quote(c->options, m->header.timestamp, m->optionId,
+                            m->bidRefNum, m->bidPrice, m->bidSize,
+                            m->askRefNum, m->askPrice, m->askSize);
+    }
+}
+
+static void on_itto_order_executed(const ITTOOrderExecuted *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_executed += m->volume;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_execute(c->options, m->header.timestamp, m->refNum, m->volume);
+    }
+}
+
+static void on_itto_order_executed_with_price(const ITTOOrderExecutedWithPrice *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_executed += m->volume;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_execute(c->options, m->header.timestamp, m->refNum, m->volume);
+    }
+}
+
+static void on_itto_order_cancel(const ITTOOrderCancel *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_cancel(c->options, m->header.timestamp, m->refNum, m->cancelledContracts);
+    }
+}
+
+static void on_itto_order_replace(const ITTOOrderReplace *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_replace(c->options, m->header.timestamp, m->origRefNum, m->newRefNum,
+                          m->volume, m->price);
+    }
+}
+
+static void on_itto_order_delete(const ITTOOrderDelete *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_delete(c->options, m->header.timestamp, m->refNum);
+    }
+}
+
+static void on_itto_order_update(const ITTOOrderUpdate *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_update(c->options, m->header.timestamp, m->refNum, m->volume, m->price);
+    }
+}
+
+static void on_itto_quote_replace(const ITTOQuoteReplace *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_quote_replace(c->options, m->header.timestamp,
+                                m->origBidRefNum, m->newBidRefNum, m->bidPrice, m->bidSize,
+                                m->origAskRefNum, m->newAskRefNum, m->askPrice, m->askSize);
+    }
+}
+
+static void on_itto_quote_delete(const ITTOQuoteDelete *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->last_timestamp = m->header.timestamp;
+    if (c->options) {
+        itto_book_quote_delete(c->options, m->header.timestamp, m->bidRefNum, m->askRefNum);
+    }
+}
+
+static void on_itto_cross_trade(const ITTOCrossTrade *m, void *ctx) {
+    client_ctx_t *c = ctx;
+    c->stats->shares_traded += m->volume;
+    c->stats->last_timestamp = m->header.timestamp;
+}
+
+static const itto_handlers_t client_itto_handlers = {
+    .on_system_event = on_itto_system_event,
+    .on_options_directory = on_itto_options_directory,
+    .on_add_order = on_itto_add_order,
+    .on_add_quote = on_itto_add_quote,
+    .on_order_executed = on_itto_order_executed,
+    .on_order_executed_with_price = on_itto_order_executed_with_price,
+    .on_order_cancel = on_itto_order_cancel,
+    .on_order_replace = on_itto_order_replace,
+    .on_order_delete = on_itto_order_delete,
+    .on_order_update = on_itto_order_update,
+    .on_quote_replace = on_itto_quote_replace,
+    .on_quote_delete = on_itto_quote_delete,
+    .on_cross_trade = on_itto_cross_trade,
+};
+
 static void init_stats(stats_t *stats) {
     memset(stats, 0, sizeof(stats_t));
     clock_gettime(CLOCK_MONOTONIC, &stats->start_time);
     stats->last_update = stats->start_time;
 }
 
-static void print_stats(stats_t *stats) {
+static void print_stats(stats_t *stats, itch_protocol_t protocol) {
     struct timespec now;
     clock_gettime(CLOCK_MONOTONIC, &now);
     
@@ -54,6 +425,19 @@ static void print_stats(stats_t *stats) {
     printf("Elapsed Time: %.2f seconds\n", elapsed);
     printf("Message Rate: %.0f msg/sec\n", stats->total_messages / elapsed);
     printf("Throughput: %.2f MB/sec\n", (stats->total_bytes / 1048576.0) / elapsed);
+    if (stats->filtered) printf("Filtered Out: %lu messages\n", stats->filtered);
+    
+    uint64_t ts = stats->last_timestamp;
+    printf("Last Feed Time: %02u:%02u:%02u.%09u\n",
+           (unsigned)(ts / 3600000000000ULL), (unsigned)(ts / 60000000000ULL % 60),
+           (unsigned)(ts / 1000000000ULL % 60), (unsigned)(ts % 1000000000ULL));
+    if (protocol == PROTOCOL_ITTO) {
+        printf("Contracts Added: %" PRIu64 "  Executed: %" PRIu64 "  Crossed (Q): %" PRIu64 "\n",
+               stats->shares_added, stats->shares_executed, stats->shares_traded);
+    } else {
+        printf("Shares Added: %" PRIu64 "  Executed: %" PRIu64 "  Traded (P/Q): %" PRIu64 "\n",
+               stats->shares_added, stats->shares_executed, stats->shares_traded);
+    }
     
     printf("\nMessage Type Breakdown:\n");
     const char *type_names[] = {
@@ -71,10 +455,35 @@ static void print_stats(stats_t *stats) {
         ['Q'] = "Cross Trade",
         ['B'] = "Broken Trade",
     };
+    const char *itto_type_names[] = {
+        ['S'] = "System Event",
+        ['R'] = "Options Directory",
+        ['H'] = "Trading Action",
+        ['O'] = "Option Open",
+        ['a'] = "Add Order (Short)",
+        ['A'] = "Add Order (Long)",
+        ['j'] = "Add Quote (Short)",
+        ['J'] = "Add Quote (Long)",
+        ['E'] = "Single Side Executed",
+        ['C'] = "Single Side Exec w/ Price",
+        ['X'] = "Order Cancel",
+        ['u'] = "Replace (Short)",
+        ['U'] = "Replace (Long)",
+        ['D'] = "Single Side Delete",
+        ['G'] = "Single Side Update",
+        ['k'] = "Quote Replace (Short)",
+        ['K'] = "Quote Replace (Long)",
+        ['Y'] = "Quote Delete",
+        ['Q'] = "Cross Trade",
+        ['I'] = "NOII",
+    };
+    const char **names = protocol == PROTOCOL_ITTO ? itto_type_names : type_names;
+    size_t nnames = protocol == PROTOCOL_ITTO ? sizeof(itto_type_names) / sizeof(itto_type_names[0])
+                                              : sizeof(type_names) / sizeof(type_names[0]);
     
     for (int i = 0; i < 256; i++) {
         if (stats->messages_by_type[i] > 0) {
-            const char *name = type_names[i] ? type_names[i] : "Unknown";
+            const char *name = (size_t)i < nnames && names[i] ? names[i] : "Unknown";
             printf("  [%c] %-25s : %10lu (%.1f%%)\n", 
                    (char)i, name, stats->messages_by_type[i],
                    100.0 * stats->messages_by_type[i] / stats->total_messages);
@@ -83,60 +492,226 @@ static void print_stats(stats_t *stats) {
     printf("\n");
 }
 
-int main(int argc, char *argv[]) {
-    const char *host = DEFAULT_HOST;
-    int port = DEFAULT_PORT;
+/* Decode, count and report one message (decode thread) */
+static void handle_message(client_ctx_t *ctx, const uint8_t *msg, size_t msg_len) {
+    stats_t *stats = ctx->stats;
     
-    if (argc >= 2) {
-        host = argv[1];
+    // Directory first: it binds -s symbols to locates as the R messages pass
+    if (ctx->dir) {
+        itch_directory_update(ctx->dir, msg, msg_len);
+        if (ctx->filter && msg_len >= 3 && !itch_directory_selected(ctx->dir, itch_read_u16(msg + 1))) {
+            stats->filtered++;
+            return;
+        }
     }
-    if (argc >= 3) {
-        port = atoi(argv[2]);
+    if (ctx->type_filter && !((ctx->types[msg[0] >> 6] >> (msg[0] & 63)) & 1)) {
+        stats->filtered++;
+        return;
     }
     
-    printf("ITCH Client\n");
-    printf("Connecting to %s:%d...\n", host, port);
-    
-    // Create socket
-    int sock_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock_fd < 0) {
-        perror("socket");
-        return 1;
+    // The ring keeps 8 readable bytes past every message for the stamp load
+    uint64_t decode_start = 0;
+    if (ctx->wire || ctx->book_lat) decode_start = latency_wall_ns();
+    if (ctx->wire && msg_len >= ctx->ts_offset + 6) {
+        latency_hist_record_since(ctx->wire, itch_read_timestamp(msg + ctx->ts_offset), decode_start);
     }
     
-    // Connect to server
-    struct sockaddr_in server_addr = {
-        .sin_family = AF_INET,
-        .sin_port = htons(port),
-    };
+    // Bars close on feed time, traded or not
+    if (ctx->bars && msg_len >= 11) itch_bars_advance(ctx->bars, itch_read_timestamp(msg + 5));
     
-    if (inet_pton(AF_INET, host, &server_addr.sin_addr) <= 0) {
-        fprintf(stderr, "Invalid address: %s\n", host);
-        close(sock_fd);
-        return 1;
+    // Decode message into typed structs and dispatch
+    if (ctx->protocol == PROTOCOL_ITTO) {
+        itto_decode(msg, msg_len, &client_itto_handlers, ctx);
+    } else {
+        itch_decode(msg, msg_len, &client_handlers, ctx);
     }
-    
-    if (connect(sock_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("connect");
-        close(sock_fd);
-        return 1;
+    if (ctx->book_lat) latency_hist_record_since(ctx->book_lat, decode_start, latency_wall_ns());
+    if (ctx->verbose) {
+        if (ctx->protocol == PROTOCOL_ITTO) parse_itto_message(msg, msg_len);
+        else parse_itch_message(msg, msg_len);
     }
     
-    printf("Connected!\n\n");
-    
-    // Initialize stats
-    stats_t stats;
-    init_stats(&stats);
+    // Update stats
+    stats->total_messages++;
+    stats->total_bytes += msg_len;
+    stats->messages_by_type[msg[0]]++;
     
-    // Receive buffer
-    uint8_t buffer[BUFFER_SIZE];
-    size_t buffer_used = 0;
+    // Print progress every 100k messages
+    if (stats->total_messages % 100000 == 0) {
+        printf("Received %lu messages (%.2f MB)\n", 
+               stats->total_messages, stats->total_bytes / 1048576.0);
+    }
+}
+
+/* Counters for the reporter thread, once per decode batch */
+static void publish_counters(client_ctx_t *ctx) {
+    atomic_store_explicit(&ctx->live_messages, ctx->stats->total_messages, memory_order_relaxed);
+    atomic_store_explicit(&ctx->live_bytes, ctx->stats->total_bytes, memory_order_relaxed);
+}
+
+/* Decode thread: consume the ring until the receiver closes it */
+typedef struct {
+    client_ctx_t *ctx;
+    spsc_ring_t *ring;
+    int cpu;
+} decoder_t;
+
+static void *decode_thread(void *arg) {
+    decoder_t *d = arg;
+    if (d->cpu >= 0 && pacer_pin_thread(d->cpu) < 0) {
+        fprintf(stderr, "Cannot pin decode thread to CPU %d\n", d->cpu);
+    }
     
-    int verbose = 0;  // Set to 1 to print all messages
+    unsigned spins = 0;
+    for (;;) {
+        const uint8_t *msg;
+        size_t len;
+        int n = 0;
+        while (n < DECODE_BATCH && (msg = spsc_ring_peek(d->ring, &len))) {
+            handle_message(d->ctx, msg, len);
+            spsc_ring_next(d->ring);
+            n++;
+        }
+        if (n > 0) {
+            spsc_ring_release(d->ring);
+            publish_counters(d->ctx);
+            spins = 0;
+        } else if (spsc_ring_drained(d->ring)) {
+            break;
+        } else {
+            spsc_ring_backoff(&spins);
+        }
+    }
+    return NULL;
+}
+
+/* Shared memory: decode in place from the server's ring on this thread
+ * until the server closes it. An overrun batch is counted by the ring. */
+static void decode_shm(client_ctx_t *ctx, shm_ring_reader_t *r) {
+    unsigned spins = 0;
+    for (;;) {
+        const uint8_t *msg;
+        size_t len;
+        int n = 0;
+        while (n < DECODE_BATCH && (msg = shm_ring_peek(r, &len))) {
+            handle_message(ctx, msg, len);
+            shm_ring_next(r);
+            n++;
+        }
+        if (n > 0) {
+            shm_ring_release(r);
+            publish_counters(ctx);
+            spins = 0;
+        } else if (shm_ring_drained(r)) {
+            break;
+        } else {
+            spsc_ring_backoff(&spins);
+        }
+    }
+}
+
+/* Reporter thread: one JSON line of counters and interval latency per tick */
+typedef struct {
+    client_ctx_t *ctx;
+    FILE *out;
+    uint64_t interval_ns;
+    _Atomic int stop;
+    latency_hist_t *snap[2];     // current and previous snapshot, per histogram
+    latency_hist_t *prev[2];
+} reporter_t;
+
+static void write_latency_json(FILE *out, const char *name, latency_hist_t *live,
+                               latency_hist_t *snap, latency_hist_t *prev) {
+    latency_summary_t s;
+    latency_hist_snapshot(live, snap);
+    latency_hist_summarize(snap, prev, &s);
+    fprintf(out, ",\"%s\":", name);
+    latency_summary_write_json(&s, out);
+    latency_hist_snapshot(snap, prev);
+}
+
+static void report_line(reporter_t *r, uint64_t start, uint64_t *last, uint64_t *last_messages) {
+    client_ctx_t *ctx = r->ctx;
+    struct timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    uint64_t now = pacer_now();
+    uint64_t messages = atomic_load_explicit(&ctx->live_messages, memory_order_relaxed);
+    uint64_t bytes = atomic_load_explicit(&ctx->live_bytes, memory_order_relaxed);
+    double rate = now > *last ? (messages - *last_messages) * 1e9 / (now - *last) : 0;
     
+    fprintf(r->out, "{\"time\":%ld.%03ld,\"uptime\":%.3f,\"messages\":%" PRIu64 ",\"bytes\":%" PRIu64
+            ",\"msg_rate\":%.0f", (long)wall.tv_sec, wall.tv_nsec / 1000000, (now - start) / 1e9,
+            messages, bytes, rate);
+    if (ctx->wire) write_latency_json(r->out, "wire_to_decode_ns", ctx->wire, r->snap[0], r->prev[0]);
+    if (ctx->book_lat) write_latency_json(r->out, "decode_to_book_ns", ctx->book_lat, r->snap[1], r->prev[1]);
+    fprintf(r->out, "}\n");
+    fflush(r->out);
+    *last = now;
+    *last_messages = messages;
+}
+
+static void *reporter_thread(void *arg) {
+    reporter_t *r = arg;
+    uint64_t start = pacer_now(), last = start, last_messages = 0;
+    uint64_t next = start + r->interval_ns;
+    while (!atomic_load_explicit(&r->stop, memory_order_relaxed)) {
+        uint64_t now = pacer_now();
+        if (now >= next) {
+            report_line(r, start, &last, &last_messages);
+            next += r->interval_ns;
+            if (next <= now) next = now + r->interval_ns;
+            continue;
+        }
+        uint64_t wait = next - now < 50000000 ? next - now : 50000000;
+        struct timespec ts = { 0, (long)wait };
+        nanosleep(&ts, NULL);
+    }
+    report_line(r, start, &last, &last_messages);    // the tail of the last interval
+    return NULL;
+}
+
+/* Hand one message to the decode thread (receive thread). A full ring
+ * holds up the receiver: the socket is not read until decode catches up. */
+static void push_message(spsc_ring_t *ring, const uint8_t *msg, size_t len) {
+    uint8_t *slot;
+    unsigned spins = 0;
+    while (!(slot = spsc_ring_reserve(ring, len))) {
+        spsc_ring_commit(ring);
+        spsc_ring_backoff(&spins);
+    }
+    memcpy(slot, msg, len);
+}
+
+static void on_mold_message(const uint8_t *msg, size_t len, uint64_t seq, void *ctx) {
+    (void)seq;
+    if (len > 0) push_message(ctx, msg, len);
+}
+
+/* Receive the multicast feed until end of session. Returns 0, or -1. */
+static int receive_multicast(mold_recv_t *r, spsc_ring_t *ring) {
+    time_t last_data = time(NULL);
+    while (!mold_recv_done(r)) {
+        int n = mold_recv_poll(r, 1000, on_mold_message, ring);
+        if (n < 0) return -1;
+        spsc_ring_commit(ring);
+        if (n > 0) {
+            last_data = time(NULL);
+        } else if (time(NULL) - last_data >= MCAST_IDLE_SECONDS) {
+            printf("No data for %d seconds\n", MCAST_IDLE_SECONDS);
+            return 0;
+        }
+    }
+    printf("End of session\n");
+    return 0;
+}
+
+/* Receive and frame the TCP stream until the server disconnects */
+static void receive_tcp(int sock_fd, itch_stream_t *stream, spsc_ring_t *ring) {
     while (1) {
-        // Read data from socket
-        ssize_t bytes_read = recv(sock_fd, buffer + buffer_used, BUFFER_SIZE - buffer_used, 0);
+        // Read data from socket straight into the stream ring
+        size_t space;
+        uint8_t *dst = itch_stream_fill_ptr(stream, &space);
+        ssize_t bytes_read = recv(sock_fd, dst, space, 0);
         
         if (bytes_read < 0) {
             perror("recv");
@@ -148,58 +723,486 @@ int main(int argc, char *argv[]) {
             break;
         }
         
-        buffer_used += bytes_read;
+        itch_stream_filled(stream, (size_t)bytes_read);
         
-        // Parse messages from buffer
-        while (buffer_used > 0) {
-            if (buffer_used < 1) break;
-            
-            uint8_t msg_type = buffer[0];
-            size_t msg_len = get_itch_message_length(msg_type);
-            
-            if (msg_len == 0) {
-                fprintf(stderr, "Unknown message type: %c (0x%02X)\n", msg_type, msg_type);
-                // Skip byte
-                memmove(buffer, buffer + 1, buffer_used - 1);
-                buffer_used--;
-                continue;
-            }
-            
-            // Wait for complete message
-            if (buffer_used < msg_len) {
+        // Frame every complete message; a partial tail stays where it is
+        const uint8_t *msg;
+        size_t msg_len;
+        while (itch_stream_next(stream, &msg, &msg_len)) {
+            push_message(ring, msg, msg_len);
+        }
+        spsc_ring_commit(ring);
+    }
+}
+
+/* Parse "cpu" or "rx_cpu,decode_cpu". Returns 0, or -1 if malformed. */
+static int parse_cpus(const char *s, int *rx_cpu, int *decode_cpu) {
+    char *end;
+    *rx_cpu = (int)strtol(s, &end, 10);
+    if (end == s || *rx_cpu < 0) return -1;
+    if (*end == '\0') return 0;
+    if (*end != ',') return -1;
+    s = end + 1;
+    *decode_cpu = (int)strtol(s, &end, 10);
+    return (end == s || *end != '\0' || *decode_cpu < 0) ? -1 : 0;
+}
+
+/* Ask the server for only these symbols and types. R always goes along with
+ * -t so the local directory can still bind -s. Returns 0, or -1 on error. */
+static int send_subscription(int fd, const char *symbols, const char *types) {
+    char line[16384];
+    int n = snprintf(line, sizeof(line), "SUBSCRIBE%s%s%s%s%s\n",
+                     symbols ? " symbols=" : "", symbols ? symbols : "",
+                     types ? " types=" : "", types ? types : "",
+                     types && symbols && !strchr(types, 'R') ? "R" : "");
+    if (n < 0 || (size_t)n >= sizeof(line)) {
+        fprintf(stderr, "Subscription too long\n");
+        return -1;
+    }
+    if (send(fd, line, (size_t)n, MSG_NOSIGNAL) != n) {
+        perror("send");
+        return -1;
+    }
+    printf("Sent %.*s", n, line);
+    return 0;
+}
+
+static void print_latency_summary(const client_ctx_t *ctx) {
+    if (!ctx->wire && !ctx->book_lat) return;
+    printf("=== Latency ===\n");
+    if (ctx->wire) latency_hist_print(ctx->wire, "Wire-to-decode", stdout);
+    if (ctx->book_lat) latency_hist_print(ctx->book_lat, ctx->book || ctx->options ? "Decode-to-book" : "Decode", stdout);
+    printf("\n");
+}
+
+static void print_book_summary(const order_book_t *book, const itch_directory_t *dir) {
+    order_book_stats_t bs;
+    order_book_get_stats(book, &bs);
+    
+    printf("=== Order Book ===\n");
+    printf("Adds: %" PRIu64 "  Executes: %" PRIu64 "  Cancels: %" PRIu64
+           "  Deletes: %" PRIu64 "  Replaces: %" PRIu64 "\n",
+           bs.adds, bs.executes, bs.cancels, bs.deletes, bs.replaces);
+    printf("Live Orders: %" PRIu64 "  Live Levels: %" PRIu64 "  Top Updates: %" PRIu64 "\n",
+           bs.live_orders, bs.live_levels, bs.top_updates);
+    if (bs.unknown_refs || bs.pool_exhausted || bs.duplicate_refs) {
+        printf("Unknown Refs: %" PRIu64 "  Pool Exhausted: %" PRIu64 "  Duplicate Refs: %" PRIu64 "\n",
+               bs.unknown_refs, bs.pool_exhausted, bs.duplicate_refs);
+    }
+    slab_pool_stats_t orders, levels;
+    order_book_get_pool_stats(book, &orders, &levels);
+    slab_pool_print_stats("Order pool", &orders, stdout);
+    slab_pool_print_stats("Level pool", &levels, stdout);
+    
+    int shown = 0;
+    for (int locate = 0; locate < ORDER_BOOK_MAX_LOCATES && shown < 20; locate++) {
+        order_book_top_t top;
+        if (order_book_top(book, (uint16_t)locate, &top) < 0) continue;
+        const char *symbol = dir ? itch_directory_symbol(dir, (uint16_t)locate) : NULL;
+        printf("  %-8s %5d: %" PRIu64 " @ %.4f  x  %" PRIu64 " @ %.4f\n", symbol ? symbol : "Locate", locate,
+               top.bidShares, top.bidPrice / 10000.0, top.askShares, top.askPrice / 10000.0);
+        shown++;
+    }
+    printf("\n");
+}
+
+static void print_options_summary(const itto_book_t *book) {
+    itto_book_stats_t bs;
+    itto_book_get_stats(book, &bs);
+    
+    printf("=== Options Book ===\n");
+    printf("Adds: %" PRIu64 "  Quotes: %" PRIu64 "  Executes: %" PRIu64 "  Cancels: %" PRIu64
+           "  Deletes: %" PRIu64 "\n", bs.adds, bs.quote_adds, bs.executes, bs.cancels, bs.deletes);
+    printf("Replaces: %" PRIu64 "  Updates: %" PRIu64 "  Quote Replaces: %" PRIu64
+           "  Quote Deletes: %" PRIu64 "\n", bs.replaces, bs.updates, bs.quote_replaces, bs.quote_deletes);
+    printf("Series: %" PRIu64 "  Live Orders: %" PRIu64 "  Live Quotes: %" PRIu64
+           "  Live Levels: %" PRIu64 "  BBO Updates: %" PRIu64 "\n",
+           bs.options, bs.live_orders, bs.live_quotes, bs.live_levels, bs.top_updates);
+    if (bs.unknown_refs || bs.pool_exhausted || bs.bad_options || bs.duplicate_refs) {
+        printf("Unknown Refs: %" PRIu64 "  Pool Exhausted: %" PRIu64 "  Bad Option Ids: %" PRIu64
+               "  Duplicate Refs: %" PRIu64 "\n",
+               bs.unknown_refs, bs.pool_exhausted, bs.bad_options, bs.duplicate_refs);
+    }
+    slab_pool_stats_t orders, levels;
+    itto_book_get_pool_stats(book, &orders, &levels);
+    slab_pool_print_stats("Order pool", &orders, stdout);
+    slab_pool_print_stats("Level pool", &levels, stdout);
+    
+    int shown = 0;
+    for (uint32_t i = 0; i < bs.options && shown < 20; i++) {
+        itto_book_top_t top;
+        if (itto_book_top_at(book, i, &top) < 0) continue;
+        printf("  Option %8u: %" PRIu64 " @ %.4f  x  %" PRIu64 " @ %.4f\n", top.optionId,
+               top.bidSize, top.bidPrice / 10000.0, top.askSize, top.askPrice / 10000.0);
+        shown++;
+    }
+    printf("\n");
+}
+
+/* -k file@time: load the last snapshot at or before time into the book
+ * (if any) and the directory */
+static int load_snapshot(const char *spec, order_book_t *book, itch_directory_t *dir) {
+    char path[4096];
+    const char *at = strrchr(spec, '@');
+    uint64_t ts;
+    if (!at || (size_t)(at - spec) >= sizeof(path) || itch_parse_time(at + 1, &ts) < 0) {
+        fprintf(stderr, "Invalid snapshot (want file@HH:MM[:SS[.fraction]]): %s\n", spec);
+        return -1;
+    }
+    memcpy(path, spec, (size_t)(at - spec));
+    path[at - spec] = '\0';
+
+    itch_snap_t snap;
+    if (itch_snap_open(&snap, path) < 0) {
+        fprintf(stderr, "Failed to open snapshots: %s (%s)\n", path, strerror(errno));
+        return -1;
+    }
+    const itch_snap_entry_t *e = itch_snap_find(&snap, ts);
+    if (!e) {
+        printf("No snapshot at or before %s: starting from an empty book\n", at + 1);
+        itch_snap_close(&snap);
+        return 0;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = itch_snap_load(&snap, e, book, dir);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (rc < 0) {
+        fprintf(stderr, "Snapshot does not fit in the order book\n");
+    } else {
+        uint64_t t = e->timestamp;
+        printf("Loaded snapshot %02u:%02u:%02u.%09u: %lu orders in %.1f ms\n",
+               (unsigned)(t / 3600000000000ULL), (unsigned)(t / 60000000000ULL % 60),
+               (unsigned)(t / 1000000000ULL % 60), (unsigned)(t % 1000000000ULL), book ? e->orders : 0,
+               (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+    }
+    itch_snap_close(&snap);
+    return rc;
+}
+
+int main(int argc, char *argv[]) {
+    const char *host = DEFAULT_HOST;
+    int port = DEFAULT_PORT;
+    int verbose = 0;
+    int build_book = 0;
+    itch_framing_t framing = FRAMING_RAW;
+    itch_protocol_t protocol = PROTOCOL_ITCH;
+    const char *mcast = NULL;
+    const char *mcast_iface = NULL;
+    const char *retrans = NULL;
+    const char *shm_name = NULL;
+    size_t ring_mb = DEFAULT_RING_MB;
+    int rx_cpu = -1;
+    int decode_cpu = -1;
+    int wire_latency = 0;
+    int book_latency = 0;
+    const char *stats_path = NULL;
+    uint64_t stats_ms = DEFAULT_STATS_MS;
+    const char *symbols = NULL;
+    const char *types = NULL;
+    double bar_seconds = 0;
+    const char *bars_path = "bars.csv";
+    const char *snapshot = NULL;
+    
+    int opt;
+    while ((opt = getopt(argc, argv, "vbs:t:B:O:k:TLJ:i:f:P:g:I:R:M:r:a:")) != -1) {
+        switch (opt) {
+            case 'v': verbose = 1; break;
+            case 'b': build_book = 1; break;
+            case 's': symbols = optarg; break;
+            case 't': types = optarg; break;
+            case 'B':
+                bar_seconds = atof(optarg);
+                if (bar_seconds < 1e-9) {
+                    fprintf(stderr, "Bar interval must be positive: %s\n", optarg);
+                    return 1;
+                }
                 break;
+            case 'O': bars_path = optarg; break;
+            case 'k': snapshot = optarg; break;
+            case 'T': wire_latency = 1; break;
+            case 'L': book_latency = 1; break;
+            case 'J': stats_path = optarg; break;
+            case 'i':
+                stats_ms = strtoull(optarg, NULL, 10);
+                if (stats_ms == 0) {
+                    fprintf(stderr, "Stats interval must be positive: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'f':
+                if (itch_framing_parse(optarg, &framing) < 0) {
+                    fprintf(stderr, "Unknown framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                if (itch_protocol_parse(optarg, &protocol) < 0) {
+                    fprintf(stderr, "Unknown protocol: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'g': mcast = optarg; break;
+            case 'I': mcast_iface = optarg; break;
+            case 'R': retrans = optarg; break;
+            case 'M': shm_name = optarg; break;
+            case 'r': ring_mb = (size_t)atol(optarg); break;
+            case 'a':
+                if (parse_cpus(optarg, &rx_cpu, &decode_cpu) < 0) {
+                    fprintf(stderr, "Invalid CPU list: %s (want rx_cpu[,decode_cpu])\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-r ring_mb] [-a rx_cpu[,decode_cpu]] [-f framing] [host] [port]\n"
+                                "       %s [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-r ring_mb] [-a rx_cpu[,decode_cpu]] -g group:port [-I iface] [-R host:port]\n"
+                                "       %s [-v] [-b] [-s SYMBOLS] [-t TYPES] [-B sec [-O file]] [-k snap@time] [-T] [-L] [-J file [-i ms]] [-P protocol] [-a cpu] -M name\n",
+                        argv[0], argv[0], argv[0]);
+                return 1;
+        }
+    }
+    
+    if (symbols && protocol == PROTOCOL_ITTO) {
+        fprintf(stderr, "Symbol filters support ITCH feeds only\n");
+        return 1;
+    }
+    if (bar_seconds > 0 && protocol == PROTOCOL_ITTO) {
+        fprintf(stderr, "Bars support ITCH feeds only\n");
+        return 1;
+    }
+    if (snapshot && protocol == PROTOCOL_ITTO) {
+        fprintf(stderr, "Snapshots support ITCH feeds only\n");
+        return 1;
+    }
+    if (optind < argc) {
+        host = argv[optind];
+    }
+    if (optind + 1 < argc) {
+        port = atoi(argv[optind + 1]);
+    }
+    
+    printf("ITCH Client\n");
+    
+    FILE *stats_out = NULL;
+    if (stats_path) {
+        stats_out = strcmp(stats_path, "-") == 0 ? stdout : fopen(stats_path, "a");
+        if (!stats_out) {
+            perror(stats_path);
+            return 1;
+        }
+    }
+    
+    // Open the transport before starting the decoder
+    mold_recv_t *mold = NULL;
+    shm_ring_reader_t *shm = NULL;
+    int sock_fd = -1;
+    if (shm_name) {
+        shm = shm_ring_reader_open(shm_name, SHM_OPEN_TIMEOUT_MS);
+        if (!shm) return 1;
+        printf("Attached to shared memory ring %s (%.1f MB)\n\n", shm_name, shm->size / 1048576.0);
+    } else if (mcast) {
+        char group[64];
+        char retrans_host[64];
+        mold_recv_config_t mcfg = { .group = group, .iface = mcast_iface, .retrans_host = host };
+        if (mold_parse_endpoint(mcast, group, sizeof(group), &mcfg.port) < 0) {
+            fprintf(stderr, "Invalid multicast group: %s (want group:port)\n", mcast);
+            return 1;
+        }
+        if (retrans) {
+            if (mold_parse_endpoint(retrans, retrans_host, sizeof(retrans_host), &mcfg.retrans_port) < 0) {
+                fprintf(stderr, "Invalid retransmission server: %s (want host:port)\n", retrans);
+                return 1;
             }
-            
-            // Parse message
-            if (verbose) {
-                parse_itch_message(buffer, msg_len);
-            }
-            
-            // Update stats
-            stats.total_messages++;
-            stats.total_bytes += msg_len;
-            stats.messages_by_type[msg_type]++;
-            
-            // Print progress every 100k messages
-            if (stats.total_messages % 100000 == 0) {
-                printf("Received %lu messages (%.2f MB)\n", 
-                       stats.total_messages, stats.total_bytes / 1048576.0);
-            }
-            
-            // Remove message from buffer
-            memmove(buffer, buffer + msg_len, buffer_used - msg_len);
-            buffer_used -= msg_len;
+            mcfg.retrans_host = retrans_host;
+        }
+        mold = mold_recv_create(&mcfg);
+        if (!mold) return 1;
+        printf("Joined %s:%d, retransmission from %s:%d\n\n", mcfg.group, mcfg.port,
+               mcfg.retrans_host, mcfg.retrans_port ? mcfg.retrans_port : mcfg.port + 1);
+    } else {
+        printf("Connecting to %s:%d...\n", host, port);
+        
+        // Create socket
+        sock_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (sock_fd < 0) {
+            perror("socket");
+            return 1;
+        }
+        
+        // Connect to server
+        struct sockaddr_in server_addr = {
+            .sin_family = AF_INET,
+            .sin_port = htons(port),
+        };
+        
+        if (inet_pton(AF_INET, host, &server_addr.sin_addr) <= 0) {
+            fprintf(stderr, "Invalid address: %s\n", host);
+            close(sock_fd);
+            return 1;
+        }
+        
+        if (connect(sock_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+            perror("connect");
+            close(sock_fd);
+            return 1;
         }
         
-        // Check if buffer is getting full
-        if (buffer_used > BUFFER_SIZE * 0.9) {
-            fprintf(stderr, "Warning: buffer nearly full, may be falling behind\n");
+        if ((symbols || types) && send_subscription(sock_fd, symbols, types) < 0) {
+            close(sock_fd);
+            return 1;
         }
+        printf("Connected!\n\n");
     }
     
-    // Print final stats
-    print_stats(&stats);
+    // Initialize stats
+    stats_t stats;
+    init_stats(&stats);
     
-    close(sock_fd);
-    return 0;
+    order_book_t *book = NULL;
+    itto_book_t *options = NULL;
+    spsc_ring_t *ring = shm ? NULL : spsc_ring_create(ring_mb << 20);
+    if (build_book && protocol == PROTOCOL_ITTO) {
+        options = itto_book_create(NULL);
+    } else if (build_book || bar_seconds > 0) {
+        book = order_book_create(NULL);   // -B prices E executions from it
+    }
+    if ((!shm && !ring) || ((build_book || bar_seconds > 0) && !book && !options)) {
+        fprintf(stderr, "Failed to allocate %s\n", (shm || ring) ? "order book" : "receive ring");
+        spsc_ring_destroy(ring);
+        mold_recv_destroy(mold);
+        shm_ring_reader_close(shm);
+        if (sock_fd >= 0) close(sock_fd);
+        return 1;
+    }
+    client_ctx_t ctx = { .stats = &stats, .book = book, .options = options, .verbose = verbose, .protocol = protocol,
+                         .ts_offset = itch_protocol_timestamp_offset(protocol) };
+    if (protocol == PROTOCOL_ITCH) {
+        ctx.dir = itch_directory_create();
+        if (!ctx.dir) {
+            fprintf(stderr, "Failed to allocate symbol directory\n");
+            return 1;
+        }
+        if (symbols) {
+            if (itch_directory_select(ctx.dir, symbols) < 0) return 1;
+            ctx.filter = 1;
+        }
+    }
+    if (snapshot && load_snapshot(snapshot, book, ctx.dir) < 0) return 1;
+    if (types) {
+        for (const char *t = types; *t; t++) ctx.types[(uint8_t)*t >> 6] |= 1ULL << ((uint8_t)*t & 63);
+        ctx.type_filter = 1;
+    }
+    if (bar_seconds > 0) {
+        itch_bars_config_t bcfg = { .interval_ns = (uint64_t)(bar_seconds * 1e9 + 0.5), .on_bar = on_bar, .ctx = &ctx };
+        ctx.bars_out = strcmp(bars_path, "-") == 0 ? stdout : fopen(bars_path, "w");
+        if (!ctx.bars_out) {
+            perror(bars_path);
+            return 1;
+        }
+        ctx.bars = itch_bars_create(&bcfg);
+        if (!ctx.bars) {
+            fprintf(stderr, "Failed to allocate bars\n");
+            return 1;
+        }
+        fprintf(ctx.bars_out, "time,symbol,locate,open,high,low,close,volume,vwap,trades\n");
+    }
+    if (wire_latency) ctx.wire = latency_hist_create();
+    if (book_latency) ctx.book_lat = latency_hist_create();
+    if ((wire_latency && !ctx.wire) || (book_latency && !ctx.book_lat)) {
+        fprintf(stderr, "Failed to allocate latency histograms\n");
+        return 1;
+    }
+    
+    // Receive on this thread, decode on another (shared memory: decode here)
+    decoder_t decoder = { .ctx = &ctx, .ring = ring, .cpu = decode_cpu };
+    pthread_t decode_tid;
+    if (!shm && pthread_create(&decode_tid, NULL, decode_thread, &decoder) != 0) {
+        perror("pthread_create");
+        return 1;
+    }
+    
+    // Stats reporting runs on its own thread, reading snapshots only
+    reporter_t reporter = { .ctx = &ctx, .out = stats_out, .interval_ns = stats_ms * 1000000 };
+    pthread_t reporter_tid;
+    if (stats_out) {
+        for (int i = 0; i < 2; i++) {
+            reporter.snap[i] = latency_hist_create();
+            reporter.prev[i] = latency_hist_create();
+            if (!reporter.snap[i] || !reporter.prev[i]) {
+                fprintf(stderr, "Failed to allocate latency snapshots\n");
+                return 1;
+            }
+        }
+        if (pthread_create(&reporter_tid, NULL, reporter_thread, &reporter) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    if (rx_cpu >= 0 && pacer_pin_thread(rx_cpu) < 0) {
+        fprintf(stderr, "Cannot pin receive thread to CPU %d\n", rx_cpu);
+    }
+    
+    itch_stream_t stream = { 0 };
+    int rc = 0;
+    if (shm) {
+        decode_shm(&ctx, shm);
+    } else if (mold) {
+        rc = receive_multicast(mold, ring);
+    } else if (itch_stream_init(&stream, ITCH_STREAM_DEFAULT_SIZE, framing) < 0) {
+        fprintf(stderr, "Failed to allocate receive buffer\n");
+        rc = -1;
+    } else {
+        itch_framer_set_protocol(&stream.framer, protocol);
+        receive_tcp(sock_fd, &stream, ring);
+    }
+    if (ring) {
+        spsc_ring_close(ring);
+        pthread_join(decode_tid, NULL);
+    }
+    if (stats_out) {
+        atomic_store_explicit(&reporter.stop, 1, memory_order_relaxed);
+        pthread_join(reporter_tid, NULL);
+        for (int i = 0; i < 2; i++) {
+            latency_hist_destroy(reporter.snap[i]);
+            latency_hist_destroy(reporter.prev[i]);
+        }
+        if (stats_out != stdout) fclose(stats_out);
+    }
+    
+    if (ctx.bars) itch_bars_close(ctx.bars);
+    
+    // Print final stats
+    print_stats(&stats, protocol);
+    print_latency_summary(&ctx);
+    if (ring) spsc_ring_print_stats(ring, stdout);
+    if (shm) {
+        shm_ring_reader_print_stats(shm, stdout);
+        shm_ring_reader_close(shm);
+    } else if (mold) {
+        mold_recv_print_stats(mold, stdout);
+        mold_recv_destroy(mold);
+    } else {
+        itch_framer_print_stats(&stream.framer);
+        itch_stream_free(&stream);
+        close(sock_fd);
+    }
+    if (ctx.dir && (ctx.filter || book)) itch_directory_print_stats(ctx.dir, stdout);
+    if (ctx.bars) {
+        itch_bars_print_stats(ctx.bars, stdout);
+        if (ctx.bars_out != stdout) fclose(ctx.bars_out);
+        itch_bars_destroy(ctx.bars);
+    }
+    if (book) {
+        if (build_book) print_book_summary(book, ctx.dir);
+        order_book_destroy(book);
+    }
+    if (options) {
+        print_options_summary(options);
+        itto_book_destroy(options);
+    }
+    itch_directory_destroy(ctx.dir);
+    latency_hist_destroy(ctx.wire);
+    latency_hist_destroy(ctx.book_lat);
+    spsc_ring_destroy(ring);
+    return rc < 0 ? 1 : 0;
 }
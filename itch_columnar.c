@@ -0,0 +1,613 @@
+/*
+ * ITCH Columnar - see itch_columnar.h
+ *
+ * Export is two passes over the mapped input. Pass one counts rows per type
+ * and per (type, stockLocate) and builds the symbol dictionary, which fixes
+ * the size of every section. The output is then sized with ftruncate, mapped
+ * shared, and pass two decodes each message straight into its row slot and
+ * appends the row to its locate group. The magic is written last, so an
+ * interrupted export never opens as a valid store.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "itch_columnar.h"
+#include "itch_file.h"
+#include "itch_parser.h"
+
+#define LOCATES 65536
+
+/* ========== Schema ========== */
+
+typedef enum { F_UINT, F_ALPHA, F_STOCK } field_kind_t;
+
+typedef struct {
+    const char *name;
+    uint8_t offset;
+    uint8_t size;       // bytes in the message (6 for timestamps)
+    uint8_t kind;
+} col_field_t;
+
+#define HEADER_FIELDS                             \
+    { "stockLocate", 1, 2, F_UINT },              \
+    { "trackingNumber", 3, 2, F_UINT },           \
+    { "timestamp", 5, 6, F_UINT }
+
+static const col_field_t FIELDS_S[] = { HEADER_FIELDS, { "eventCode", 11, 1, F_ALPHA }, { 0 } };
+
+static const col_field_t FIELDS_R[] = {
+    HEADER_FIELDS,
+    { "stock", 11, 8, F_STOCK },
+    { "marketCategory", 19, 1, F_ALPHA },
+    { "financialStatusIndicator", 20, 1, F_ALPHA },
+    { "roundLotSize", 21, 4, F_UINT },
+    { "roundLotsOnly", 25, 1, F_ALPHA },
+    { "issueClassification", 26, 1, F_ALPHA },
+    { "issueSubType", 27, 2, F_ALPHA },
+    { "authenticity", 29, 1, F_ALPHA },
+    { "shortSaleThreshold", 30, 1, F_ALPHA },
+    { "ipoFlag", 31, 1, F_ALPHA },
+    { "luldReferencePriceTier", 32, 1, F_ALPHA },
+    { "etpFlag", 33, 1, F_ALPHA },
+    { "etpLeverageFactor", 34, 4, F_UINT },
+    { "inverseIndicator", 38, 1, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_H[] = {
+    HEADER_FIELDS,
+    { "stock", 11, 8, F_STOCK },
+    { "tradingState", 19, 1, F_ALPHA },
+    { "reserved", 20, 1, F_ALPHA },
+    { "reason", 21, 4, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_Y[] = {
+    HEADER_FIELDS, { "stock", 11, 8, F_STOCK }, { "regSHOAction", 19, 1, F_ALPHA }, { 0 }
+};
+
+static const col_field_t FIELDS_L[] = {
+    HEADER_FIELDS,
+    { "mpid", 11, 4, F_ALPHA },
+    { "stock", 15, 8, F_STOCK },
+    { "primaryMarketMaker", 23, 1, F_ALPHA },
+    { "marketMakerMode", 24, 1, F_ALPHA },
+    { "marketParticipantState", 25, 1, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_V[] = {
+    HEADER_FIELDS,
+    { "level1", 11, 8, F_UINT },
+    { "level2", 19, 8, F_UINT },
+    { "level3", 27, 8, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_W[] = { HEADER_FIELDS, { "breachedLevel", 11, 1, F_ALPHA }, { 0 } };
+
+static const col_field_t FIELDS_K[] = {
+    HEADER_FIELDS,
+    { "stock", 11, 8, F_STOCK },
+    { "ipoQuotationReleaseTime", 19, 4, F_UINT },
+    { "ipoQuotationReleaseQualifier", 23, 1, F_ALPHA },
+    { "ipoPrice", 24, 4, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_A[] = {
+    HEADER_FIELDS,
+    { "orderRefNum", 11, 8, F_UINT },
+    { "buySellIndicator", 19, 1, F_ALPHA },
+    { "shares", 20, 4, F_UINT },
+    { "stock", 24, 8, F_STOCK },
+    { "price", 32, 4, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_F[] = {
+    HEADER_FIELDS,
+    { "orderRefNum", 11, 8, F_UINT },
+    { "buySellIndicator", 19, 1, F_ALPHA },
+    { "shares", 20, 4, F_UINT },
+    { "stock", 24, 8, F_STOCK },
+    { "price", 32, 4, F_UINT },
+    { "attribution", 36, 4, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_E[] = {
+    HEADER_FIELDS,
+    { "orderRefNum", 11, 8, F_UINT },
+    { "executedShares", 19, 4, F_UINT },
+    { "matchNumber", 23, 8, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_C[] = {
+    HEADER_FIELDS,
+    { "orderRefNum", 11, 8, F_UINT },
+    { "executedShares", 19, 4, F_UINT },
+    { "matchNumber", 23, 8, F_UINT },
+    { "printable", 31, 1, F_ALPHA },
+    { "executionPrice", 32, 4, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_X[] = {
+    HEADER_FIELDS, { "orderRefNum", 11, 8, F_UINT }, { "cancelledShares", 19, 4, F_UINT }, { 0 }
+};
+
+static const col_field_t FIELDS_D[] = { HEADER_FIELDS, { "orderRefNum", 11, 8, F_UINT }, { 0 } };
+
+static const col_field_t FIELDS_U[] = {
+    HEADER_FIELDS,
+    { "origOrderRefNum", 11, 8, F_UINT },
+    { "newOrderRefNum", 19, 8, F_UINT },
+    { "shares", 27, 4, F_UINT },
+    { "price", 31, 4, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_P[] = {
+    HEADER_FIELDS,
+    { "orderRefNum", 11, 8, F_UINT },
+    { "buySellIndicator", 19, 1, F_ALPHA },
+    { "shares", 20, 4, F_UINT },
+    { "stock", 24, 8, F_STOCK },
+    { "price", 32, 4, F_UINT },
+    { "matchNumber", 36, 8, F_UINT },
+    { 0 }
+};
+
+static const col_field_t FIELDS_Q[] = {
+    HEADER_FIELDS,
+    { "shares", 11, 8, F_UINT },
+    { "stock", 19, 8, F_STOCK },
+    { "crossPrice", 27, 4, F_UINT },
+    { "matchNumber", 31, 8, F_UINT },
+    { "crossType", 39, 1, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_B[] = { HEADER_FIELDS, { "matchNumber", 11, 8, F_UINT }, { 0 } };
+
+static const col_field_t FIELDS_I[] = {
+    HEADER_FIELDS,
+    { "pairedShares", 11, 8, F_UINT },
+    { "imbalanceShares", 19, 8, F_UINT },
+    { "imbalanceDirection", 27, 1, F_ALPHA },
+    { "stock", 28, 8, F_STOCK },
+    { "farPrice", 36, 4, F_UINT },
+    { "nearPrice", 40, 4, F_UINT },
+    { "currentReferencePrice", 44, 4, F_UINT },
+    { "crossType", 48, 1, F_ALPHA },
+    { "priceVariationIndicator", 49, 1, F_ALPHA },
+    { 0 }
+};
+
+static const col_field_t FIELDS_N[] = {
+    HEADER_FIELDS, { "stock", 11, 8, F_STOCK }, { "interestFlag", 19, 1, F_ALPHA }, { 0 }
+};
+
+static const col_field_t *const SCHEMA[256] = {
+    ['S'] = FIELDS_S, ['R'] = FIELDS_R, ['H'] = FIELDS_H, ['Y'] = FIELDS_Y,
+    ['L'] = FIELDS_L, ['V'] = FIELDS_V, ['W'] = FIELDS_W, ['K'] = FIELDS_K,
+    ['A'] = FIELDS_A, ['F'] = FIELDS_F, ['E'] = FIELDS_E, ['C'] = FIELDS_C,
+    ['X'] = FIELDS_X, ['D'] = FIELDS_D, ['U'] = FIELDS_U, ['P'] = FIELDS_P,
+    ['Q'] = FIELDS_Q, ['B'] = FIELDS_B, ['I'] = FIELDS_I, ['N'] = FIELDS_N,
+};
+
+static inline uint64_t align_up(uint64_t x) {
+    return (x + ITCH_COL_ALIGN - 1) & ~(uint64_t)(ITCH_COL_ALIGN - 1);
+}
+
+/* On-disk width of a schema field */
+static inline uint8_t column_width(const col_field_t *f, int dictionary) {
+    if (f->kind == F_STOCK) return dictionary ? 4 : 8;
+    if (f->kind == F_ALPHA) return f->size;
+    return f->size == 6 ? 8 : f->size;
+}
+
+/* ========== Symbol dictionary ========== */
+
+typedef struct {
+    uint64_t *keys;
+    uint32_t *codes;        // UINT32_MAX = empty slot
+    size_t mask;
+    uint64_t *symbols;      // code -> symbol, first-seen order
+    size_t count;
+    size_t symbol_cap;
+} symbol_dict_t;
+
+static int dict_init(symbol_dict_t *d, size_t capacity) {
+    memset(d, 0, sizeof(*d));
+    d->keys = malloc(capacity * sizeof(uint64_t));
+    d->codes = malloc(capacity * sizeof(uint32_t));
+    d->symbols = malloc(capacity / 2 * sizeof(uint64_t));
+    if (!d->keys || !d->codes || !d->symbols) return -1;
+    memset(d->codes, 0xFF, capacity * sizeof(uint32_t));
+    d->mask = capacity - 1;
+    d->symbol_cap = capacity / 2;
+    return 0;
+}
+
+static void dict_free(symbol_dict_t *d) {
+    free(d->keys);
+    free(d->codes);
+    free(d->symbols);
+    memset(d, 0, sizeof(*d));
+}
+
+static inline size_t dict_hash(uint64_t key, size_t mask) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static int dict_grow(symbol_dict_t *d) {
+    symbol_dict_t next;
+    if (dict_init(&next, (d->mask + 1) * 2) < 0) {
+        dict_free(&next);
+        return -1;
+    }
+    for (size_t i = 0; i < d->count; i++) {
+        size_t slot = dict_hash(d->symbols[i], next.mask);
+        while (next.codes[slot] != UINT32_MAX) slot = (slot + 1) & next.mask;
+        next.keys[slot] = d->symbols[i];
+        next.codes[slot] = (uint32_t)i;
+        next.symbols[i] = d->symbols[i];
+    }
+    next.count = d->count;
+    dict_free(d);
+    *d = next;
+    return 0;
+}
+
+/* Code for an 8-byte symbol, inserting it if new. UINT32_MAX on allocation failure. */
+static uint32_t dict_code(symbol_dict_t *d, const uint8_t *stock) {
+    uint64_t key;
+    memcpy(&key, stock, 8);
+    size_t slot = dict_hash(key, d->mask);
+    while (d->codes[slot] != UINT32_MAX) {
+        if (d->keys[slot] == key) return d->codes[slot];
+        slot = (slot + 1) & d->mask;
+    }
+    if (d->count == d->symbol_cap) {
+        if (dict_grow(d) < 0) return UINT32_MAX;
+        return dict_code(d, stock);
+    }
+    uint32_t code = (uint32_t)d->count++;
+    d->keys[slot] = key;
+    d->codes[slot] = code;
+    d->symbols[code] = key;
+    return code;
+}
+
+/* ========== Export ========== */
+
+typedef struct {
+    uint64_t rows[256];
+    uint32_t *locate_counts[256];   // per type, LOCATES entries; reused as write cursors
+    uint64_t next_row[256];
+    int table_of[256];              // type -> table index, -1 if absent
+    symbol_dict_t dict;
+    uint8_t *out;
+    size_t out_size;
+    int fd;
+} exporter_t;
+
+static void exporter_free(exporter_t *x) {
+    for (int t = 0; t < 256; t++) free(x->locate_counts[t]);
+    dict_free(&x->dict);
+    if (x->out) munmap(x->out, x->out_size);
+    if (x->fd >= 0) close(x->fd);
+}
+
+/* Pass one: row counts, locate group sizes and the symbol dictionary */
+static int count_pass(exporter_t *x, const uint8_t *data, size_t size,
+                      const itch_col_export_options_t *opts, uint64_t *messages) {
+    itch_cursor_t cur;
+    itch_cursor_init(&cur, data, size, opts->framing);
+    const uint8_t *msg;
+    size_t len;
+    while (itch_cursor_next(&cur, &msg, &len)) {
+        uint8_t t = msg[0];
+        if (!SCHEMA[t]) continue;
+        if (!x->locate_counts[t]) {
+            x->locate_counts[t] = calloc(LOCATES, sizeof(uint32_t));
+            if (!x->locate_counts[t]) return -1;
+        }
+        if (++x->rows[t] > UINT32_MAX) {
+            fprintf(stderr, "Export: more than 2^32 '%c' messages\n", t);
+            return -1;
+        }
+        x->locate_counts[t][itch_read_u16(msg + 1)]++;
+        (*messages)++;
+
+        if (opts->dictionary) {
+            for (const col_field_t *f = SCHEMA[t]; f->name; f++) {
+                if (f->kind == F_STOCK && dict_code(&x->dict, msg + f->offset) == UINT32_MAX) return -1;
+            }
+        }
+    }
+    itch_framer_print_stats(&cur.framer);
+    return 0;
+}
+
+/* Lay out every section and fill in the headers; returns the file size */
+static uint64_t layout(exporter_t *x, itch_col_header_t *hdr, itch_col_table_t *tables,
+                       const itch_col_export_options_t *opts) {
+    uint64_t pos = align_up(sizeof(itch_col_header_t));
+    hdr->table_offset = pos;
+    pos = align_up(pos + hdr->table_count * sizeof(itch_col_table_t));
+
+    hdr->symbol_count = opts->dictionary ? x->dict.count : 0;
+    hdr->symbol_offset = pos;
+    pos = align_up(pos + hdr->symbol_count * 8);
+
+    for (int t = 0; t < 256; t++) {
+        if (x->table_of[t] < 0) continue;
+        itch_col_table_t *tab = &tables[x->table_of[t]];
+        tab->type = (uint8_t)t;
+        tab->rows = x->rows[t];
+
+        int c = 0;
+        for (const col_field_t *f = SCHEMA[t]; f->name; f++, c++) {
+            itch_col_column_t *col = &tab->columns[c];
+            strncpy(col->name, f->name, ITCH_COL_NAME_LEN - 1);
+            col->kind = f->kind == F_UINT ? ITCH_COL_UINT
+                      : (f->kind == F_STOCK && opts->dictionary) ? ITCH_COL_SYMBOL : ITCH_COL_ALPHA;
+            col->width = column_width(f, opts->dictionary);
+            col->offset = pos;
+            pos = align_up(pos + tab->rows * col->width);
+        }
+        tab->column_count = (uint8_t)c;
+
+        uint32_t distinct = 0;
+        for (size_t l = 0; l < LOCATES; l++) distinct += x->locate_counts[t][l] != 0;
+        tab->locate_count = distinct;
+        tab->locate_ids_offset = pos;
+        pos = align_up(pos + distinct * sizeof(uint16_t));
+        tab->locate_start_offset = pos;
+        pos = align_up(pos + (distinct + 1) * sizeof(uint64_t));
+        tab->row_index_offset = pos;
+        pos = align_up(pos + tab->rows * sizeof(uint32_t));
+    }
+    hdr->file_size = pos;
+    return pos;
+}
+
+/* Write locate ids/starts and turn the per-locate counts into write cursors */
+static void build_locate_groups(exporter_t *x, itch_col_table_t *tab) {
+    uint16_t *ids = (uint16_t *)(x->out + tab->locate_ids_offset);
+    uint64_t *start = (uint64_t *)(x->out + tab->locate_start_offset);
+    uint32_t *counts = x->locate_counts[tab->type];
+    uint32_t sum = 0;
+    uint32_t i = 0;
+    for (size_t l = 0; l < LOCATES; l++) {
+        uint32_t n = counts[l];
+        if (n == 0) continue;
+        ids[i] = (uint16_t)l;
+        start[i] = sum;
+        i++;
+        counts[l] = sum;
+        sum += n;
+    }
+    start[i] = sum;
+}
+
+static inline void write_field(uint8_t *dst, const uint8_t *msg, const col_field_t *f,
+                               symbol_dict_t *dict, int dictionary) {
+    switch (f->kind) {
+        case F_UINT:
+            switch (f->size) {
+                case 1: *dst = msg[f->offset]; break;
+                case 2: { uint16_t v = itch_read_u16(msg + f->offset); memcpy(dst, &v, 2); break; }
+                case 4: { uint32_t v = itch_read_u32(msg + f->offset); memcpy(dst, &v, 4); break; }
+                case 6: {
+                    uint64_t v = ((uint64_t)itch_read_u16(msg + f->offset) << 32) |
+                                 itch_read_u32(msg + f->offset + 2);
+                    memcpy(dst, &v, 8);
+                    break;
+                }
+                case 8: { uint64_t v = itch_read_u64(msg + f->offset); memcpy(dst, &v, 8); break; }
+            }
+            break;
+        case F_STOCK:
+            if (dictionary) {
+                uint32_t code = dict_code(dict, msg + f->offset);
+                memcpy(dst, &code, 4);
+                break;
+            }
+            // fall through
+        case F_ALPHA:
+            memcpy(dst, msg + f->offset, f->size);
+            break;
+    }
+}
+
+/* Pass two: decode every message into its row and locate group */
+static void fill_pass(exporter_t *x, const uint8_t *data, size_t size,
+                      const itch_col_table_t *tables, const itch_col_export_options_t *opts) {
+    itch_cursor_t cur;
+    itch_cursor_init(&cur, data, size, opts->framing);
+    const uint8_t *msg;
+    size_t len;
+    while (itch_cursor_next(&cur, &msg, &len)) {
+        uint8_t t = msg[0];
+        if (x->table_of[t] < 0) continue;
+        const itch_col_table_t *tab = &tables[x->table_of[t]];
+        uint64_t row = x->next_row[t]++;
+
+        const col_field_t *f = SCHEMA[t];
+        for (int c = 0; c < tab->column_count; c++, f++) {
+            const itch_col_column_t *col = &tab->columns[c];
+            write_field(x->out + col->offset + row * col->width, msg, f, &x->dict, opts->dictionary);
+        }
+
+        uint32_t *row_index = (uint32_t *)(x->out + tab->row_index_offset);
+        row_index[x->locate_counts[t][itch_read_u16(msg + 1)]++] = (uint32_t)row;
+    }
+}
+
+int itch_col_export(const uint8_t *data, size_t size, const char *out_path,
+                    const itch_col_export_options_t *opts) {
+    exporter_t x;
+    memset(&x, 0, sizeof(x));
+    x.fd = -1;
+    if (opts->dictionary && dict_init(&x.dict, 1 << 14) < 0) {
+        fprintf(stderr, "Export: out of memory\n");
+        exporter_free(&x);
+        return -1;
+    }
+
+    uint64_t messages = 0;
+    if (count_pass(&x, data, size, opts, &messages) < 0) {
+        fprintf(stderr, "Export: counting pass failed\n");
+        exporter_free(&x);
+        return -1;
+    }
+
+    itch_col_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    for (int t = 0; t < 256; t++) {
+        x.table_of[t] = x.rows[t] ? (int)hdr.table_count++ : -1;
+    }
+    itch_col_table_t *tables = calloc(hdr.table_count ? hdr.table_count : 1, sizeof(itch_col_table_t));
+    if (!tables) {
+        exporter_free(&x);
+        return -1;
+    }
+    hdr.version = ITCH_COL_VERSION;
+    hdr.source_messages = messages;
+    uint64_t file_size = layout(&x, &hdr, tables, opts);
+
+    x.fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (x.fd < 0 || ftruncate(x.fd, (off_t)file_size) < 0) {
+        fprintf(stderr, "Export: cannot create %s (%s)\n", out_path, strerror(errno));
+        free(tables);
+        exporter_free(&x);
+        return -1;
+    }
+    void *out = mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, x.fd, 0);
+    if (out == MAP_FAILED) {
+        fprintf(stderr, "Export: cannot map %s (%s)\n", out_path, strerror(errno));
+        free(tables);
+        exporter_free(&x);
+        return -1;
+    }
+    x.out = out;
+    x.out_size = file_size;
+
+    for (uint32_t i = 0; i < hdr.table_count; i++) build_locate_groups(&x, &tables[i]);
+    if (hdr.symbol_count) memcpy(x.out + hdr.symbol_offset, x.dict.symbols, hdr.symbol_count * 8);
+
+    fill_pass(&x, data, size, tables, opts);
+
+    memcpy(x.out + hdr.table_offset, tables, hdr.table_count * sizeof(itch_col_table_t));
+    memcpy(x.out, &hdr, sizeof(hdr));
+    memcpy(x.out, ITCH_COL_MAGIC, 8);
+
+    free(tables);
+    exporter_free(&x);
+    return 0;
+}
+
+/* ========== Reader ========== */
+
+int itch_col_open(itch_col_store_t *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    s->fd = open(path, O_RDONLY);
+    if (s->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(s->fd, &st) < 0 || (size_t)st.st_size < sizeof(itch_col_header_t)) {
+        itch_col_close(s);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, s->fd, 0);
+    if (base == MAP_FAILED) {
+        itch_col_close(s);
+        return -1;
+    }
+    s->base = base;
+    s->size = (size_t)st.st_size;
+
+    // Queries jump between columns; let itch_col_data() ask for read-ahead
+    madvise(base, s->size, MADV_RANDOM);
+
+    const itch_col_header_t *h = base;
+    if (memcmp(h->magic, ITCH_COL_MAGIC, 8) != 0 || h->version != ITCH_COL_VERSION ||
+        h->file_size != s->size ||
+        h->table_offset + (uint64_t)h->table_count * sizeof(itch_col_table_t) > s->size) {
+        errno = EINVAL;
+        itch_col_close(s);
+        return -1;
+    }
+    s->header = h;
+    s->tables = (const itch_col_table_t *)(s->base + h->table_offset);
+    return 0;
+}
+
+void itch_col_close(itch_col_store_t *s) {
+    if (s->base) munmap((void *)s->base, s->size);
+    if (s->fd >= 0) close(s->fd);
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+}
+
+const itch_col_table_t *itch_col_table(const itch_col_store_t *s, uint8_t type) {
+    for (uint32_t i = 0; i < s->header->table_count; i++) {
+        if (s->tables[i].type == type) return &s->tables[i];
+    }
+    return NULL;
+}
+
+const void *itch_col_data(const itch_col_store_t *s, const itch_col_table_t *t,
+                          const char *name, const itch_col_column_t **col) {
+    if (!t) return NULL;
+    for (int c = 0; c < t->column_count; c++) {
+        const itch_col_column_t *cc = &t->columns[c];
+        if (strncmp(cc->name, name, ITCH_COL_NAME_LEN) != 0) continue;
+        if (col) *col = cc;
+
+        // Page-align the hint; the column start itself is only 64-byte aligned
+        size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        size_t start = cc->offset & ~(page - 1);
+        madvise((void *)(s->base + start), cc->offset - start + t->rows * cc->width, MADV_WILLNEED);
+        return s->base + cc->offset;
+    }
+    return NULL;
+}
+
+const uint32_t *itch_col_locate_rows(const itch_col_store_t *s, const itch_col_table_t *t,
+                                     uint16_t locate, size_t *n) {
+    *n = 0;
+    if (!t || t->locate_count == 0) return NULL;
+    const uint16_t *ids = (const uint16_t *)(s->base + t->locate_ids_offset);
+    const uint64_t *start = (const uint64_t *)(s->base + t->locate_start_offset);
+
+    // Binary search the sorted locate ids
+    uint32_t lo = 0, hi = t->locate_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (ids[mid] < locate) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == t->locate_count || ids[lo] != locate) return NULL;
+
+    *n = start[lo + 1] - start[lo];
+    return (const uint32_t *)(s->base + t->row_index_offset) + start[lo];
+}
+
+const char *itch_col_symbol(const itch_col_store_t *s, uint32_t code) {
+    if (code >= s->header->symbol_count) return NULL;
+    return (const char *)(s->base + s->header->symbol_offset) + (size_t)code * 8;
+}
@@ -0,0 +1,124 @@
+/*
+ * ITCH Columnar - memory-mappable column store of a parsed ITCH day
+ *
+ * One table per message type, one fixed-width column per field, so a query
+ * maps the file and only faults in the columns it reads. Integers are stored
+ * decoded in host (little-endian) order, timestamps widened to 8 bytes, alpha
+ * fields raw and space padded. With dictionary encoding the 8-byte stock
+ * field becomes a 4-byte code into a shared symbol table.
+ *
+ * File layout (every section 64-byte aligned):
+ *
+ *   itch_col_header_t
+ *   itch_col_table_t[table_count]
+ *   symbols          char[8] x symbol_count       (dictionary, optional)
+ *   per table:
+ *     columns        width x rows each
+ *     locate_ids     uint16_t x locate_count      (sorted, distinct)
+ *     locate_start   uint64_t x (locate_count + 1)
+ *     row_index      uint32_t x rows              (rows grouped by locate)
+ *
+ * The rows of stockLocate L in table t are
+ *   row_index[locate_start[i] .. locate_start[i + 1])  where locate_ids[i] == L
+ * in stream order.
+ *
+ * Usage:
+ *   itch_col_store_t store;
+ *   itch_col_open(&store, "day.itchc");
+ *   const itch_col_table_t *adds = itch_col_table(&store, 'A');
+ *   const uint32_t *price = itch_col_data(&store, adds, "price", NULL);
+ *   size_t n;
+ *   const uint32_t *rows = itch_col_locate_rows(&store, adds, 13, &n);
+ *   itch_col_close(&store);
+ */
+
+#ifndef ITCH_COLUMNAR_H
+#define ITCH_COLUMNAR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "itch_framing.h"
+
+#define ITCH_COL_MAGIC "ITCHCOL1"
+#define ITCH_COL_VERSION 1
+#define ITCH_COL_MAX_COLUMNS 20
+#define ITCH_COL_NAME_LEN 32
+#define ITCH_COL_ALIGN 64
+
+typedef enum {
+    ITCH_COL_UINT = 1,      // unsigned integer, width 1/2/4/8
+    ITCH_COL_ALPHA = 2,     // raw bytes, width = field size
+    ITCH_COL_SYMBOL = 3,    // uint32_t code into the symbol dictionary
+} itch_col_kind_t;
+
+typedef struct {
+    char name[ITCH_COL_NAME_LEN];
+    uint8_t kind;
+    uint8_t width;
+    uint16_t reserved;
+    uint32_t reserved2;
+    uint64_t offset;        // from start of file
+} itch_col_column_t;
+
+typedef struct {
+    uint8_t type;           // ITCH message type byte
+    uint8_t column_count;
+    uint16_t reserved;
+    uint32_t locate_count;
+    uint64_t rows;
+    uint64_t locate_ids_offset;
+    uint64_t locate_start_offset;
+    uint64_t row_index_offset;
+    itch_col_column_t columns[ITCH_COL_MAX_COLUMNS];
+} itch_col_table_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t table_count;
+    uint64_t symbol_count;
+    uint64_t symbol_offset;
+    uint64_t table_offset;
+    uint64_t file_size;
+    uint64_t source_messages;
+} itch_col_header_t;
+
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    const itch_col_header_t *header;
+    const itch_col_table_t *tables;
+    int fd;
+} itch_col_store_t;
+
+typedef struct {
+    itch_framing_t framing;
+    int dictionary;         // dictionary-encode stock symbols
+} itch_col_export_options_t;
+
+/* Export a mapped ITCH byte range to a column store at out_path.
+ * Returns 0 on success, -1 on error (message on stderr). */
+int itch_col_export(const uint8_t *data, size_t size, const char *out_path,
+                    const itch_col_export_options_t *opts);
+
+/* Map a column store read-only. Returns 0, or -1 if it cannot be opened or
+ * is not a complete store of this version. */
+int itch_col_open(itch_col_store_t *s, const char *path);
+void itch_col_close(itch_col_store_t *s);
+
+/* Table for a message type, NULL if the day had none */
+const itch_col_table_t *itch_col_table(const itch_col_store_t *s, uint8_t type);
+
+/* Column data by field name, NULL if the table has no such column. Hints the
+ * kernel to read ahead just this column. */
+const void *itch_col_data(const itch_col_store_t *s, const itch_col_table_t *t,
+                          const char *name, const itch_col_column_t **col);
+
+/* Row numbers of one stockLocate in table t, in stream order */
+const uint32_t *itch_col_locate_rows(const itch_col_store_t *s, const itch_col_table_t *t,
+                                     uint16_t locate, size_t *n);
+
+/* 8-byte space padded symbol for a dictionary code, NULL if out of range */
+const char *itch_col_symbol(const itch_col_store_t *s, uint32_t code);
+
+#endif /* ITCH_COLUMNAR_H */
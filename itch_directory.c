@@ -0,0 +1,135 @@
+/*
+ * ITCH Directory - see itch_directory.h
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "itch_directory.h"
+#include "itch_parser.h"
+
+itch_directory_t *itch_directory_create(void) {
+    itch_directory_t *d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    memset(d->selected, 0xff, sizeof(d->selected));
+    return d;
+}
+
+void itch_directory_destroy(itch_directory_t *d) {
+    if (!d) return;
+    free(d->wanted);
+    free(d);
+}
+
+static int key_cmp(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void set_selected(itch_directory_t *d, uint16_t locate, int on) {
+    uint64_t bit = 1ULL << (locate & 63);
+    int was = (d->selected[locate >> 6] & bit) != 0;
+    if (was == on) return;
+    if (on) {
+        d->selected[locate >> 6] |= bit;
+        d->matched++;
+    } else {
+        d->selected[locate >> 6] &= ~bit;
+        d->matched--;
+    }
+}
+
+int itch_symbol_keys(const char *list, uint64_t **out) {
+    size_t cap = 1;
+    for (const char *p = list; *p; p++) cap += *p == ',';
+    uint64_t *keys = malloc(cap * sizeof(uint64_t));
+    if (!keys) return -1;
+
+    size_t n = 0;
+    for (const char *p = list; *p; ) {
+        size_t len = strcspn(p, ",");
+        if (len > 8) {
+            fprintf(stderr, "Invalid symbol (more than 8 characters): %.*s\n", (int)len, p);
+            free(keys);
+            return -1;
+        }
+        if (len > 0) {
+            char padded[8];
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, p, len);
+            keys[n++] = itch_stock_key(padded);
+        }
+        p += len;
+        if (*p == ',') p++;
+    }
+    qsort(keys, n, sizeof(uint64_t), key_cmp);
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (unique == 0 || keys[i] != keys[unique - 1]) keys[unique++] = keys[i];
+    }
+    *out = keys;
+    return (int)unique;
+}
+
+int itch_directory_select(itch_directory_t *d, const char *list) {
+    uint64_t *wanted;
+    int n = itch_symbol_keys(list, &wanted);
+    if (n < 0) return -1;
+    free(d->wanted);
+    d->wanted = wanted;
+    d->nwanted = (size_t)n;
+
+    // Rebind the locates named so far; the rest bind as their R arrives
+    memset(d->selected, 0, sizeof(d->selected));
+    d->selected[0] = 1;
+    d->matched = 0;
+    for (uint32_t locate = 1; locate < ITCH_DIRECTORY_LOCATES; locate++) {
+        const itch_symbol_t *s = &d->symbols[locate];
+        if (!s->symbol[0]) continue;
+        set_selected(d, (uint16_t)locate, itch_symbol_key_find(d->wanted, d->nwanted, itch_stock_key(s->stock)));
+    }
+    return 0;
+}
+
+void itch_directory_apply(itch_directory_t *d, const uint8_t *msg, size_t len) {
+    if (len < itch_message_lengths[msg[0]]) return;
+    if (msg[0] == 'H') {
+        ITCHTradingAction m;
+        itch_decode_H(msg, &m);
+        d->symbols[m.header.stockLocate].tradingState = m.tradingState;
+        d->trading_actions++;
+        return;
+    }
+
+    ITCHStockDirectory m;
+    itch_decode_R(msg, &m);
+    itch_symbol_t *s = &d->symbols[m.header.stockLocate];
+    if (!s->symbol[0]) d->count++;
+    size_t n = 8;
+    while (n > 0 && m.stock[n - 1] == ' ') n--;
+    memcpy(s->symbol, m.stock, n);
+    s->symbol[n] = '\0';
+    memcpy(s->stock, m.stock, 8);
+    s->marketCategory = m.marketCategory;
+    s->financialStatus = m.financialStatusIndicator;
+    s->roundLotsOnly = m.roundLotsOnly;
+    s->issueClassification = m.issueClassification;
+    s->roundLotSize = m.roundLotSize;
+    if (d->wanted && m.header.stockLocate != 0) {
+        set_selected(d, m.header.stockLocate, itch_symbol_key_find(d->wanted, d->nwanted, itch_stock_key(m.stock)));
+    }
+}
+
+int itch_directory_find(const itch_directory_t *d, const char *symbol) {
+    if (!symbol[0]) return -1;
+    for (uint32_t locate = 1; locate < ITCH_DIRECTORY_LOCATES; locate++) {
+        if (strcmp(d->symbols[locate].symbol, symbol) == 0) return (int)locate;
+    }
+    return -1;
+}
+
+void itch_directory_print_stats(const itch_directory_t *d, FILE *out) {
+    fprintf(out, "Directory: %u symbols", d->count);
+    if (d->wanted) fprintf(out, ", %u of %zu selected seen", d->matched, d->nwanted);
+    fprintf(out, ", %lu trading actions\n", d->trading_actions);
+}
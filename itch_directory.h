@@ -0,0 +1,119 @@
+/*
+ * ITCH Directory - stockLocate -> symbol cache built from the feed
+ *
+ * ITCH names a stock once a day, in its R (Stock Directory) message; every
+ * later message for it carries only the 2-byte stockLocate. The directory
+ * keeps one entry per locate in a dense array, filled from R and kept
+ * current from H (Trading Action): the trimmed symbol, round lot, market
+ * category, financial status and trading state. Consumers resolve a locate
+ * with one array index and never copy, trim or compare the 8-byte stock
+ * field of a message.
+ *
+ * Symbol filters are a bitmap over locates. Symbols are picked by name up
+ * front (itch_directory_select) and bound to their locates as their R
+ * messages go by, so filtering a message is one bit test on its locate.
+ * Locate 0 (system events, MWCB) always passes. A feed joined after its
+ * directory messages has no names to bind: only an unfiltered directory
+ * passes those locates.
+ *
+ * Usage:
+ *   itch_directory_t *d = itch_directory_create();
+ *   itch_directory_select(d, "AAPL,MSFT");          // optional filter
+ *   itch_directory_update(d, msg, len);             // every ITCH message, in order
+ *   if (!itch_directory_selected(d, itch_read_u16(msg + 1))) continue;
+ *   const itch_symbol_t *s = itch_directory_get(d, locate);   // s->symbol
+ *   itch_directory_destroy(d);
+ */
+
+#ifndef ITCH_DIRECTORY_H
+#define ITCH_DIRECTORY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#define ITCH_DIRECTORY_LOCATES 65536
+
+/* One stock, as of the last R and H messages for its locate */
+typedef struct {
+    char symbol[9];             // trimmed and NUL terminated; "" before its R
+    char stock[8];              // as sent: space padded
+    char marketCategory;
+    char financialStatus;
+    char tradingState;          // H: 'H' halted, 'P' paused, 'Q' quoting, 'T' trading; 0 before any H
+    char roundLotsOnly;
+    char issueClassification;
+    uint32_t roundLotSize;
+} itch_symbol_t;
+
+typedef struct {
+    itch_symbol_t symbols[ITCH_DIRECTORY_LOCATES];
+    uint64_t selected[ITCH_DIRECTORY_LOCATES / 64];   // filter bitmap, by locate
+    uint64_t *wanted;           // selected symbols, as space-padded 8-byte keys, sorted
+    size_t nwanted;
+    uint32_t count;             // locates named by an R message
+    uint32_t matched;           // of those, selected
+    uint64_t trading_actions;
+} itch_directory_t;
+
+/* An empty directory that passes every locate. NULL on allocation failure. */
+itch_directory_t *itch_directory_create(void);
+void itch_directory_destroy(itch_directory_t *d);
+
+/* Pass only these comma-separated symbols (and locate 0) from now on.
+ * Returns 0, or -1 for a symbol longer than 8 characters. */
+int itch_directory_select(itch_directory_t *d, const char *list);
+
+/* Out of line part of itch_directory_update: apply an R or H message */
+void itch_directory_apply(itch_directory_t *d, const uint8_t *msg, size_t len);
+
+/* Locate of a symbol named so far, or -1 */
+int itch_directory_find(const itch_directory_t *d, const char *symbol);
+
+/* Parse a comma-separated symbol list into sorted, unique keys (the 8-byte
+ * space-padded stock field, as itch_stock_key reads it). Returns the count
+ * and a malloc'd array in *out, or -1 for a symbol longer than 8 characters
+ * (message on stderr) or no memory. */
+int itch_symbol_keys(const char *list, uint64_t **out);
+
+/* "Directory: n symbols, m selected, k trading actions" */
+void itch_directory_print_stats(const itch_directory_t *d, FILE *out);
+
+/* Feed every ITCH message through here, in feed order */
+static inline void itch_directory_update(itch_directory_t *d, const uint8_t *msg, size_t len) {
+    if (msg[0] == 'R' || msg[0] == 'H') itch_directory_apply(d, msg, len);
+}
+
+/* An 8-byte stock field as one comparable key */
+static inline uint64_t itch_stock_key(const char stock[8]) {
+    uint64_t k;
+    memcpy(&k, stock, sizeof(k));
+    return k;
+}
+
+/* Whether key is in a sorted itch_symbol_keys array */
+static inline int itch_symbol_key_find(const uint64_t *keys, size_t n, uint64_t key) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (keys[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < n && keys[lo] == key;
+}
+
+static inline const itch_symbol_t *itch_directory_get(const itch_directory_t *d, uint16_t locate) {
+    return &d->symbols[locate];
+}
+
+/* The symbol for a locate, or NULL if no R message has named it */
+static inline const char *itch_directory_symbol(const itch_directory_t *d, uint16_t locate) {
+    return d->symbols[locate].symbol[0] ? d->symbols[locate].symbol : NULL;
+}
+
+static inline int itch_directory_selected(const itch_directory_t *d, uint16_t locate) {
+    return (int)((d->selected[locate >> 6] >> (locate & 63)) & 1);
+}
+
+#endif /* ITCH_DIRECTORY_H */
@@ -0,0 +1,552 @@
+/*
+ * ITCH Dump - batch parser for raw ITCH files
+ *
+ * Maps the file, walks every message in place and decodes it through the
+ * typed handler table. With no flags it reports throughput and a message type
+ * breakdown; nothing is copied between the page cache and the decoders.
+ *
+ * With -j N the decode is spread over N worker threads. The main thread
+ * makes the single framing pass and routes each message (as a pointer into
+ * the mapping) to worker stockLocate % N through that worker's SPSC ring.
+ * Book state is per stock, so each worker keeps its own books and counters
+ * with nothing shared; the totals are merged once the workers finish.
+ * Each worker maps its own order and level pools (its arena, slab_pool.h)
+ * on its own thread, so with -a the arena's pages sit on the NUMA node of
+ * the CPU the worker is pinned to. Pages are touched as orders arrive; -F
+ * touches the whole arena up front instead, at its full capacity (-O).
+ *
+ * Usage:
+ *   ./itch_dump [-v] [-b] [-c] [-j workers [-a cpus]] [-H] [-F] [-O max_orders] [-f framing] <itch_file>
+ *
+ *   -v  print every decoded message
+ *   -b  reconstruct order books and print top of book on exit
+ *   -c  columnar scan: batch boundary scan + SIMD hot-field gather instead
+ *       of per-message decode (ignores -v and -b)
+ *   -j  decode on this many worker threads partitioned by stockLocate
+ *       (ignores -v)
+ *   -a  pin worker i to the i-th CPU of this comma-separated list (wrapping)
+ *   -H  back the book pools with hugetlbfs pages (falls back to
+ *       transparent huge pages)
+ *   -F  prefault each book's pools before the first message (keeps page
+ *       faults off the decode, costs the full capacity in memory per book)
+ *   -O  live orders each book holds (default 4M, or with -j over 2 twice
+ *       a worker's share of 4M, at least 256K; price levels get a quarter
+ *       as many)
+ *   -f  file framing: raw (default), binaryfile, soupbintcp, moldudp64
+ *
+ * Example:
+ *   ./itch_dump -b data/01302019.NASDAQ_ITCH50
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include "itch_parser.h"
+#include "itch_file.h"
+#include "itch_framing.h"
+#include "itch_scan.h"
+#include "order_book.h"
+#include "spsc_ring.h"
+#include "pacer.h"
+
+/* Running totals; touching the decoded fields keeps the decode honest */
+typedef struct {
+    uint64_t messages_by_type[256];
+    uint64_t shares_added;
+    uint64_t shares_executed;
+    uint64_t shares_traded;
+    uint64_t last_timestamp;
+    order_book_t *book;
+} dump_ctx_t;
+
+static void on_add_order(const ITCHAddOrder *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_added += m->shares;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) {
+        order_book_add(d->book, m->header.stockLocate, m->header.timestamp,
+                       m->orderRefNum, m->buySellIndicator, m->shares, m->price);
+    }
+}
+
+static void on_add_order_mpid(const ITCHAddOrderMPID *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_added += m->shares;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) {
+        order_book_add(d->book, m->header.stockLocate, m->header.timestamp,
+                       m->orderRefNum, m->buySellIndicator, m->shares, m->price);
+    }
+}
+
+static void on_order_executed(const ITCHOrderExecuted *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_executed += m->executedShares;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) order_book_execute(d->book, m->header.timestamp, m->orderRefNum, m->executedShares);
+}
+
+static void on_order_executed_with_price(const ITCHOrderExecutedWithPrice *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_executed += m->executedShares;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) order_book_execute(d->book, m->header.timestamp, m->orderRefNum, m->executedShares);
+}
+
+static void on_order_cancel(const ITCHOrderCancel *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) order_book_cancel(d->book, m->header.timestamp, m->orderRefNum, m->cancelledShares);
+}
+
+static void on_order_delete(const ITCHOrderDelete *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) order_book_delete(d->book, m->header.timestamp, m->orderRefNum);
+}
+
+static void on_order_replace(const ITCHOrderReplace *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->last_timestamp = m->header.timestamp;
+    if (d->book) {
+        order_book_replace(d->book, m->header.timestamp, m->origOrderRefNum,
+                           m->newOrderRefNum, m->shares, m->price);
+    }
+}
+
+static void on_trade(const ITCHTrade *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_traded += m->shares;
+    d->last_timestamp = m->header.timestamp;
+}
+
+static void on_cross_trade(const ITCHCrossTrade *m, void *ctx) {
+    dump_ctx_t *d = ctx;
+    d->shares_traded += m->shares;
+    d->last_timestamp = m->header.timestamp;
+}
+
+static const itch_handlers_t dump_handlers = {
+    .on_add_order = on_add_order,
+    .on_add_order_mpid = on_add_order_mpid,
+    .on_order_executed = on_order_executed,
+    .on_order_executed_with_price = on_order_executed_with_price,
+    .on_order_cancel = on_order_cancel,
+    .on_order_delete = on_order_delete,
+    .on_order_replace = on_order_replace,
+    .on_trade = on_trade,
+    .on_cross_trade = on_cross_trade,
+};
+
+#define SCAN_BATCH 8192
+#define MAX_JOBS 256
+
+/* Order message types gathered in columnar mode */
+static const char SCAN_TYPES[] = "AFECXDUP";
+
+/* Columnar mode: scan boundaries a batch at a time, then gather the hot
+ * fields of every order message type into columns and fold them */
+static int dump_columnar(const itch_file_t *file, itch_framing_t framing, dump_ctx_t *d,
+                         uint64_t *messages, uint64_t *bytes) {
+    itch_scan_t scan;
+    itch_columns_t cols;
+    if (itch_scan_init(&scan, SCAN_BATCH, framing) < 0) return -1;
+    if (itch_columns_init(&cols, SCAN_BATCH) < 0) {
+        itch_scan_free(&scan);
+        return -1;
+    }
+
+    const uint8_t *data = file->data;
+    size_t remaining = file->size;
+    while (remaining) {
+        size_t used = itch_scan_batch(&scan, data, remaining);
+        if (used == 0) break;
+
+        for (size_t i = 0; i < scan.count; i++) {
+            d->messages_by_type[scan.types[i]]++;
+            *bytes += itch_message_lengths[scan.types[i]];
+        }
+        *messages += scan.count;
+
+        for (const char *t = SCAN_TYPES; *t; t++) {
+            size_t n;
+            const uint32_t *idx = itch_scan_select(&scan, (uint8_t)*t, &n);
+            if (n == 0) continue;
+            itch_gather(&cols, data, idx, n, (uint8_t)*t);
+
+            uint64_t shares = 0;
+            for (size_t j = 0; j < n; j++) shares += cols.shares[j];
+            if (*t == 'A' || *t == 'F') d->shares_added += shares;
+            else if (*t == 'E' || *t == 'C') d->shares_executed += shares;
+            else if (*t == 'P') d->shares_traded += shares;
+            if (cols.timestamp[n - 1] > d->last_timestamp) d->last_timestamp = cols.timestamp[n - 1];
+        }
+
+        // Cross trades carry 8-byte shares and are rare; read them directly
+        size_t nq;
+        const uint32_t *q = itch_scan_select(&scan, 'Q', &nq);
+        for (size_t j = 0; j < nq; j++) d->shares_traded += itch_read_u64(data + q[j] + 11);
+
+        data += used;
+        remaining -= used;
+    }
+
+    itch_framer_print_stats(&scan.framer);
+    itch_columns_free(&cols);
+    itch_scan_free(&scan);
+    return 0;
+}
+
+#define WORKER_RING_BYTES (1u << 20)
+#define ROUTE_BATCH 256             // slices routed to a worker per ring commit
+#define DUMP_BOOK_ORDERS (1u << 22) // order_book's default capacity
+#define WORKER_MIN_ORDERS (1u << 18)
+
+/* One routed message: a pointer into the mapping */
+typedef struct {
+    const uint8_t *msg;
+    uint32_t len;
+} dump_slice_t;
+
+typedef struct {
+    pthread_t tid;
+    spsc_ring_t *ring;
+    const order_book_config_t *book_cfg;    // NULL = no books
+    int cpu;                        // -1 = not pinned
+    int failed;                     // pinning or the arena failed
+    dump_ctx_t ctx;
+    uint64_t messages;
+    uint64_t bytes;
+    uint32_t unsent;                // routed since the last commit
+} dump_worker_t;
+
+static void *dump_worker(void *arg) {
+    dump_worker_t *w = arg;
+    if (w->cpu >= 0 && pacer_pin_thread(w->cpu) < 0) w->failed = 1;
+    // Created here, after pinning: first touch puts the arena on this CPU's node
+    if (w->book_cfg && !(w->ctx.book = order_book_create(w->book_cfg))) w->failed = 1;
+    unsigned spins = 0;
+    for (;;) {
+        const uint8_t *rec;
+        size_t rec_len;
+        int n = 0;
+        while (n < ROUTE_BATCH && (rec = spsc_ring_peek(w->ring, &rec_len))) {
+            dump_slice_t s;
+            memcpy(&s, rec, sizeof(s));
+            itch_decode(s.msg, s.len, &dump_handlers, &w->ctx);
+            w->ctx.messages_by_type[s.msg[0]]++;
+            w->messages++;
+            w->bytes += s.len;
+            spsc_ring_next(w->ring);
+            n++;
+        }
+        if (n > 0) {
+            spsc_ring_release(w->ring);
+            spins = 0;
+        } else if (spsc_ring_drained(w->ring)) {
+            break;
+        } else {
+            spsc_ring_backoff(&spins);
+        }
+    }
+    return NULL;
+}
+
+static void route_slice(dump_worker_t *w, const uint8_t *msg, size_t len) {
+    dump_slice_t s = { .msg = msg, .len = (uint32_t)len };
+    uint8_t *slot;
+    unsigned spins = 0;
+    while (!(slot = spsc_ring_reserve(w->ring, sizeof(s)))) {
+        spsc_ring_commit(w->ring);
+        w->unsent = 0;
+        spsc_ring_backoff(&spins);
+    }
+    memcpy(slot, &s, sizeof(s));
+    if (++w->unsent == ROUTE_BATCH) {
+        spsc_ring_commit(w->ring);
+        w->unsent = 0;
+    }
+}
+
+/* Parallel mode: one framing pass routing by stockLocate to jobs workers,
+ * then merge their counters into d, their book stats into bs and their
+ * arenas' occupancy into pools[0] (orders) and pools[1] (levels) */
+static int dump_parallel(const itch_file_t *file, itch_framing_t framing, int jobs,
+                         const order_book_config_t *book_cfg, const int *cpus, int ncpus,
+                         dump_ctx_t *d, order_book_stats_t *bs, slab_pool_stats_t *pools,
+                         uint64_t *messages, uint64_t *bytes) {
+    dump_worker_t *workers = calloc((size_t)jobs, sizeof(dump_worker_t));
+    if (!workers) return -1;
+
+    // Stocks do not split evenly, so each arena gets twice its share of the
+    // single-book default, and never less than WORKER_MIN_ORDERS; -O overrides
+    order_book_config_t arena_cfg;
+    if (book_cfg) {
+        arena_cfg = *book_cfg;
+        if (!arena_cfg.max_orders && jobs > 2) {
+            uint32_t share = (uint32_t)(2 * (uint64_t)DUMP_BOOK_ORDERS / (uint64_t)jobs);
+            arena_cfg.max_orders = share > WORKER_MIN_ORDERS ? share : WORKER_MIN_ORDERS;
+            arena_cfg.max_levels = arena_cfg.max_orders / 4;
+        }
+    }
+
+    int started = 0;
+    int rc = 0;
+    for (; started < jobs; started++) {
+        dump_worker_t *w = &workers[started];
+        w->ring = spsc_ring_create(WORKER_RING_BYTES);
+        w->book_cfg = book_cfg ? &arena_cfg : NULL;
+        w->cpu = ncpus ? cpus[started % ncpus] : -1;
+        if (!w->ring || pthread_create(&w->tid, NULL, dump_worker, w) != 0) {
+            spsc_ring_destroy(w->ring);
+            rc = -1;
+            break;
+        }
+    }
+
+    if (rc == 0) {
+        itch_cursor_t cur;
+        itch_cursor_init(&cur, file->data, file->size, framing);
+        const uint8_t *msg;
+        size_t len;
+        while (itch_cursor_next(&cur, &msg, &len)) {
+            uint16_t locate = len >= 3 ? itch_read_u16(msg + 1) : 0;
+            route_slice(&workers[locate % jobs], msg, len);
+        }
+        itch_framer_print_stats(&cur.framer);
+    }
+
+    memset(bs, 0, sizeof(*bs));
+    memset(pools, 0, 2 * sizeof(*pools));
+    for (int i = 0; i < started; i++) {
+        dump_worker_t *w = &workers[i];
+        spsc_ring_close(w->ring);
+        pthread_join(w->tid, NULL);
+        if (w->failed) {
+            fprintf(stderr, "Worker %d: %s\n", i, w->book_cfg && !w->ctx.book ?
+                    "failed to allocate its order book" : "failed to pin to its CPU");
+            if (w->book_cfg && !w->ctx.book) rc = -1;
+        }
+
+        for (int t = 0; t < 256; t++) d->messages_by_type[t] += w->ctx.messages_by_type[t];
+        d->shares_added += w->ctx.shares_added;
+        d->shares_executed += w->ctx.shares_executed;
+        d->shares_traded += w->ctx.shares_traded;
+        if (w->ctx.last_timestamp > d->last_timestamp) d->last_timestamp = w->ctx.last_timestamp;
+        *messages += w->messages;
+        *bytes += w->bytes;
+
+        if (w->ctx.book) {
+            order_book_stats_t ws;
+            order_book_get_stats(w->ctx.book, &ws);
+            bs->adds += ws.adds;
+            bs->executes += ws.executes;
+            bs->cancels += ws.cancels;
+            bs->deletes += ws.deletes;
+            bs->replaces += ws.replaces;
+            bs->top_updates += ws.top_updates;
+            bs->unknown_refs += ws.unknown_refs;
+            bs->pool_exhausted += ws.pool_exhausted;
+            bs->duplicate_refs += ws.duplicate_refs;
+            bs->live_orders += ws.live_orders;
+            bs->live_levels += ws.live_levels;
+            slab_pool_stats_t orders, levels;
+            order_book_get_pool_stats(w->ctx.book, &orders, &levels);
+            slab_pool_stats_add(&pools[0], &orders);
+            slab_pool_stats_add(&pools[1], &levels);
+            order_book_destroy(w->ctx.book);
+        }
+        spsc_ring_destroy(w->ring);
+    }
+    free(workers);
+    return rc;
+}
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void print_summary(const dump_ctx_t *d, const order_book_stats_t *bs, const slab_pool_stats_t *pools,
+                          uint64_t messages, uint64_t bytes, double elapsed) {
+    printf("\n=== ITCH Dump ===\n");
+    printf("Total Messages: %" PRIu64 "\n", messages);
+    printf("Total Bytes: %.2f MB\n", bytes / 1048576.0);
+    printf("Elapsed Time: %.3f seconds\n", elapsed);
+    printf("Message Rate: %.0f msg/sec\n", messages / elapsed);
+    printf("Throughput: %.2f GB/sec\n", bytes / elapsed / 1e9);
+    printf("Shares Added: %" PRIu64 "  Executed: %" PRIu64 "  Traded (P/Q): %" PRIu64 "\n",
+           d->shares_added, d->shares_executed, d->shares_traded);
+
+    printf("\nMessage Type Breakdown:\n");
+    for (int i = 0; i < 256; i++) {
+        if (d->messages_by_type[i] > 0) {
+            printf("  [%c] %12" PRIu64 " (%.1f%%)\n", (char)i, d->messages_by_type[i],
+                   100.0 * d->messages_by_type[i] / messages);
+        }
+    }
+
+    if (bs) {
+        printf("\n=== Order Book ===\n");
+        printf("Live Orders: %" PRIu64 "  Live Levels: %" PRIu64 "  Top Updates: %" PRIu64 "\n",
+               bs->live_orders, bs->live_levels, bs->top_updates);
+        printf("Unknown Refs: %" PRIu64 "  Pool Exhausted: %" PRIu64 "  Duplicate Refs: %" PRIu64 "\n",
+               bs->unknown_refs, bs->pool_exhausted, bs->duplicate_refs);
+        slab_pool_print_stats("Order pool", &pools[0], stdout);
+        slab_pool_print_stats("Level pool", &pools[1], stdout);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    int verbose = 0;
+    int build_book = 0;
+    int columnar = 0;
+    int jobs = 0;
+    int cpus[MAX_JOBS];
+    int ncpus = 0;
+    order_book_config_t book_cfg = { 0 };
+    itch_framing_t framing = FRAMING_RAW;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "vbcj:a:HFO:f:")) != -1) {
+        switch (opt) {
+            case 'v': verbose = 1; break;
+            case 'b': build_book = 1; break;
+            case 'c': columnar = 1; break;
+            case 'j':
+                jobs = atoi(optarg);
+                if (jobs < 1 || jobs > MAX_JOBS) {
+                    fprintf(stderr, "Workers must be 1-%d: %s\n", MAX_JOBS, optarg);
+                    return 1;
+                }
+                break;
+            case 'a':
+                for (char *p = optarg; *p && ncpus < MAX_JOBS; ) {
+                    char *end;
+                    long cpu = strtol(p, &end, 10);
+                    if (end == p || cpu < 0 || (*end && *end != ',')) {
+                        fprintf(stderr, "Invalid CPU list: %s\n", optarg);
+                        return 1;
+                    }
+                    cpus[ncpus++] = (int)cpu;
+                    p = *end ? end + 1 : end;
+                }
+                break;
+            case 'H': book_cfg.pages |= SLAB_PAGES_HUGETLB; break;
+            case 'F': book_cfg.pages |= SLAB_PAGES_PREFAULT; break;
+            case 'O': {
+                unsigned long n = strtoul(optarg, NULL, 10);
+                if (n < 4 || n > UINT32_MAX / 2) {
+                    fprintf(stderr, "Invalid order capacity: %s\n", optarg);
+                    return 1;
+                }
+                book_cfg.max_orders = (uint32_t)n;
+                book_cfg.max_levels = (uint32_t)(n / 4);
+                break;
+            }
+            case 'f':
+                if (itch_framing_parse(optarg, &framing) < 0) {
+                    fprintf(stderr, "Unknown framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf(stderr, "Usage: %s [-v] [-b] [-c] [-j workers [-a cpus]] [-H] [-F] [-O max_orders] [-f framing] <itch_file>\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-v] [-b] [-c] [-j workers [-a cpus]] [-H] [-F] [-O max_orders] [-f framing] <itch_file>\n", argv[0]);
+        return 1;
+    }
+    const char *filename = argv[optind];
+
+    itch_file_t file;
+    if (itch_file_open(&file, filename) < 0) {
+        fprintf(stderr, "Failed to map file: %s (%s)\n", filename, strerror(errno));
+        return 1;
+    }
+
+    dump_ctx_t *d = calloc(1, sizeof(dump_ctx_t));
+    if (!d) {
+        itch_file_close(&file);
+        return 1;
+    }
+    if (columnar && jobs) {
+        fprintf(stderr, "-c and -j cannot be combined\n");
+        free(d);
+        itch_file_close(&file);
+        return 1;
+    }
+    if (build_book && !columnar && !jobs) {
+        d->book = order_book_create(&book_cfg);
+        if (!d->book) {
+            fprintf(stderr, "Failed to allocate order book\n");
+            free(d);
+            itch_file_close(&file);
+            return 1;
+        }
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t messages = 0;
+    uint64_t bytes = 0;
+    if (columnar) {
+        if (dump_columnar(&file, framing, d, &messages, &bytes) < 0) {
+            fprintf(stderr, "Failed to allocate scan buffers\n");
+        }
+        print_summary(d, NULL, NULL, messages, bytes, elapsed_since(&start));
+        printf("Gather kernels: %s\n\n", itch_scan_isa());
+    } else if (jobs) {
+        order_book_stats_t bs;
+        slab_pool_stats_t pools[2];
+        if (dump_parallel(&file, framing, jobs, build_book ? &book_cfg : NULL, cpus, ncpus,
+                          d, &bs, pools, &messages, &bytes) < 0) {
+            fprintf(stderr, "Failed to start %d workers\n", jobs);
+        }
+        print_summary(d, build_book ? &bs : NULL, pools, messages, bytes, elapsed_since(&start));
+        if (build_book && bs.pool_exhausted) {
+            fprintf(stderr, "Book arenas ran out of orders or levels: raise the capacity with -O\n");
+        }
+        printf("Workers: %d (partitioned by stockLocate %% %d)%s\n\n", jobs, jobs,
+               build_book ? ", one book arena each" : "");
+    } else {
+        itch_cursor_t cur;
+        itch_cursor_init(&cur, file.data, file.size, framing);
+
+        const uint8_t *msg;
+        size_t len;
+        while (itch_cursor_next(&cur, &msg, &len)) {
+            itch_decode(msg, len, &dump_handlers, d);
+            if (verbose) parse_itch_message(msg, len);
+            d->messages_by_type[msg[0]]++;
+            messages++;
+            bytes += len;
+        }
+
+        order_book_stats_t bs;
+        slab_pool_stats_t pools[2];
+        if (d->book) {
+            order_book_get_stats(d->book, &bs);
+            order_book_get_pool_stats(d->book, &pools[0], &pools[1]);
+        }
+        print_summary(d, d->book ? &bs : NULL, pools, messages, bytes, elapsed_since(&start));
+        itch_framer_print_stats(&cur.framer);
+    }
+
+    order_book_destroy(d->book);
+    free(d);
+    itch_file_close(&file);
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * ITCH File - see itch_file.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "itch_file.h"
+
+int itch_file_open(itch_file_t *f, const char *path) {
+    memset(f, 0, sizeof(*f));
+    f->fd = -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (size_t)st.st_size;
+    size_t mapped = ((size + page - 1) / page + 1) * page;
+
+    // Reserve file + guard page as anonymous zero memory, then map the file over it
+    void *base = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+    if (size > 0 &&
+        mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int err = errno;
+        munmap(base, mapped);
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    // Advice is best effort: not every kernel/filesystem honours it
+    madvise(base, size, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+    madvise(base, size, MADV_HUGEPAGE);
+#endif
+
+    f->data = base;
+    f->size = size;
+    f->mapped = mapped;
+    f->fd = fd;
+    return 0;
+}
+
+void itch_file_close(itch_file_t *f) {
+    if (f->data) munmap((void *)f->data, f->mapped);
+    if (f->fd >= 0) close(f->fd);
+    f->data = NULL;
+    f->fd = -1;
+}
@@ -0,0 +1,98 @@
+/*
+ * ITCH Framing - see itch_framing.h
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include "itch_framing.h"
+
+static const char *FRAMING_NAMES[] = {
+    [FRAMING_RAW] = "raw",
+    [FRAMING_BINARYFILE] = "binaryfile",
+    [FRAMING_SOUPBINTCP] = "soupbintcp",
+    [FRAMING_MOLDUDP64] = "moldudp64",
+};
+
+static const char *PROTOCOL_NAMES[] = {
+    [PROTOCOL_ITCH] = "itch",
+    [PROTOCOL_ITTO] = "itto",
+};
+
+#define DETECT_MESSAGES 256
+#define DAY_NS 86400000000000ULL
+
+int itch_framing_parse(const char *name, itch_framing_t *out) {
+    for (size_t i = 0; i < sizeof(FRAMING_NAMES) / sizeof(FRAMING_NAMES[0]); i++) {
+        if (strcasecmp(name, FRAMING_NAMES[i]) == 0) {
+            *out = (itch_framing_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *itch_framing_name(itch_framing_t framing) {
+    if ((size_t)framing < sizeof(FRAMING_NAMES) / sizeof(FRAMING_NAMES[0])) {
+        return FRAMING_NAMES[framing];
+    }
+    return "unknown";
+}
+
+void itch_framer_print_stats(const itch_framer_t *f) {
+    if (f->unknown_types || f->length_mismatches || f->skipped_bytes) {
+        fprintf(stderr, "Framing (%s): %llu unknown types, %llu length mismatches, %llu resync bytes skipped\n",
+                itch_framing_name(f->framing),
+                (unsigned long long)f->unknown_types,
+                (unsigned long long)f->length_mismatches,
+                (unsigned long long)f->skipped_bytes);
+    }
+}
+
+int itch_protocol_parse(const char *name, itch_protocol_t *out) {
+    for (size_t i = 0; i < sizeof(PROTOCOL_NAMES) / sizeof(PROTOCOL_NAMES[0]); i++) {
+        if (strcasecmp(name, PROTOCOL_NAMES[i]) == 0) {
+            *out = (itch_protocol_t)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *itch_protocol_name(itch_protocol_t protocol) {
+    if ((size_t)protocol < sizeof(PROTOCOL_NAMES) / sizeof(PROTOCOL_NAMES[0])) {
+        return PROTOCOL_NAMES[protocol];
+    }
+    return "unknown";
+}
+
+/* Messages that frame and carry an in-day timestamp, less the bytes and
+ * messages the table could not account for */
+static long detect_score(const uint8_t *buf, size_t len, itch_framing_t framing, itch_protocol_t protocol) {
+    itch_framer_t f;
+    itch_framer_init(&f, framing);
+    itch_framer_set_protocol(&f, protocol);
+    size_t ts_off = itch_protocol_timestamp_offset(protocol);
+
+    long good = 0;
+    size_t pos = 0;
+    for (int n = 0; n < DETECT_MESSAGES && pos < len; ) {
+        const uint8_t *msg;
+        size_t msg_len;
+        size_t used = itch_frame_next(&f, buf + pos, len - pos, &msg, &msg_len);
+        if (used == 0) break;
+        pos += used;
+        if (msg_len == 0) continue;
+        n++;
+        // Only where 8 bytes are readable: the buffer may end right after msg
+        if (msg + ts_off + 8 <= buf + len && itch_read_timestamp(msg + ts_off) < DAY_NS) good++;
+    }
+    long bad = (long)(f.unknown_types + f.length_mismatches + f.skipped_bytes);
+    return good - 4 * bad;
+}
+
+itch_protocol_t itch_protocol_detect(const uint8_t *buf, size_t len, itch_framing_t framing) {
+    long itch = detect_score(buf, len, framing, PROTOCOL_ITCH);
+    long itto = detect_score(buf, len, framing, PROTOCOL_ITTO);
+    return itto > itch ? PROTOCOL_ITTO : PROTOCOL_ITCH;
+}
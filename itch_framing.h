@@ -0,0 +1,216 @@
+/*
+ * ITCH Framing - message boundaries for the transports NASDAQ uses
+ *
+ * Supported framings:
+ * - raw:        [type][body]                   length from the per-type table
+ * - binaryfile: [len:2][type][body]            NASDAQ daily BinaryFILE dumps
+ * - soupbintcp: [len:2][packet type][payload]  sequenced data packets ('S')
+ *                                              carry one message each
+ * - moldudp64:  [session:10][seq:8][count:2] then count x [len:2][message]
+ *
+ * Every length-prefixed framing is validated against the per-type table: a
+ * message whose prefix disagrees with its type's length, or whose type is
+ * unknown, is skipped in O(1) using the prefix instead of resyncing byte by
+ * byte. Raw framing has no prefix, so an unknown type byte can only be
+ * skipped one byte at a time (counted in skipped_bytes, never logged per byte).
+ *
+ * The per-type table is the protocol: ITCH 5.0 by default, or ITTO 4.0
+ * (options) after itch_framer_set_protocol. The framings are the same for
+ * both.
+ *
+ * itch_frame_next() is inline: it is the innermost loop of every reader.
+ */
+
+#ifndef ITCH_FRAMING_H
+#define ITCH_FRAMING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "itch_parser.h"
+#include "itto_parser.h"
+
+typedef enum {
+    FRAMING_RAW = 0,
+    FRAMING_BINARYFILE,
+    FRAMING_SOUPBINTCP,
+    FRAMING_MOLDUDP64,
+} itch_framing_t;
+
+/* Message set carried inside the framing */
+typedef enum {
+    PROTOCOL_ITCH = 0,          // ITCH 5.0 equities
+    PROTOCOL_ITTO,              // ITTO 4.0 options
+} itch_protocol_t;
+
+#define MOLDUDP64_HEADER_SIZE 20
+#define MOLDUDP64_END_OF_SESSION 0xFFFF
+
+typedef struct {
+    itch_framing_t framing;
+    const uint8_t *lengths;     // per-type message length table, 0 for unknown
+
+    // MoldUDP64 packet state
+    uint32_t mold_remaining;    // message blocks left in the current packet
+    uint64_t mold_seq;          // sequence number of the next message block
+    char mold_session[10];
+
+    // Counters
+    uint64_t unknown_types;     // length-prefixed messages with an unknown type
+    uint64_t length_mismatches; // prefix disagreed with the per-type table
+    uint64_t skipped_bytes;     // raw framing resync bytes
+    uint64_t control_packets;   // SoupBinTCP non-data / MoldUDP64 heartbeat packets
+} itch_framer_t;
+
+/* Parse a framing name ("raw", "binaryfile", "soupbintcp", "moldudp64").
+ * Returns 0 on success, -1 if unknown. */
+int itch_framing_parse(const char *name, itch_framing_t *out);
+const char *itch_framing_name(itch_framing_t framing);
+
+/* Parse a protocol name ("itch", "itto"). Returns 0 on success, -1 if unknown. */
+int itch_protocol_parse(const char *name, itch_protocol_t *out);
+const char *itch_protocol_name(itch_protocol_t protocol);
+
+/* Guess the protocol from the first bytes of a feed in the given framing:
+ * frame a few hundred messages with each length table and keep the one
+ * that frames cleanly with in-day timestamps. ITCH when in doubt. */
+itch_protocol_t itch_protocol_detect(const uint8_t *buf, size_t len, itch_framing_t framing);
+
+/* Offset of the 6-byte timestamp in a message of this protocol */
+static inline size_t itch_protocol_timestamp_offset(itch_protocol_t protocol) {
+    return protocol == PROTOCOL_ITTO ? 3 : 5;
+}
+
+/* Print non-zero skip/mismatch counters to stderr */
+void itch_framer_print_stats(const itch_framer_t *f);
+
+/* Initialize a framer for ITCH 5.0 messages */
+static inline void itch_framer_init(itch_framer_t *f, itch_framing_t framing) {
+    memset(f, 0, sizeof(*f));
+    f->framing = framing;
+    f->lengths = itch_message_lengths;
+}
+
+/* Switch the length table to another protocol's */
+static inline void itch_framer_set_protocol(itch_framer_t *f, itch_protocol_t protocol) {
+    f->lengths = protocol == PROTOCOL_ITTO ? itto_message_lengths : itch_message_lengths;
+}
+
+/* Size of the framing prefix in front of each message on output */
+static inline size_t itch_framing_prefix_size(itch_framing_t framing) {
+    switch (framing) {
+        case FRAMING_BINARYFILE: return 2;
+        case FRAMING_SOUPBINTCP: return 3;
+        default: return 0;
+    }
+}
+
+/* Write the per-message prefix for framing into out; returns its size.
+ * MoldUDP64 packs messages into datagrams and is handled by its publisher. */
+static inline size_t itch_framing_write_prefix(itch_framing_t framing, uint8_t *out, size_t msg_len) {
+    switch (framing) {
+        case FRAMING_BINARYFILE:
+            out[0] = (uint8_t)(msg_len >> 8);
+            out[1] = (uint8_t)msg_len;
+            return 2;
+        case FRAMING_SOUPBINTCP:
+            out[0] = (uint8_t)((msg_len + 1) >> 8);
+            out[1] = (uint8_t)(msg_len + 1);
+            out[2] = 'S';
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+/* Validate a length-prefixed message against the type table */
+static inline int itch_framer_check(itch_framer_t *f, const uint8_t *msg, size_t len) {
+    size_t expect = len ? f->lengths[msg[0]] : 0;
+    if (expect == 0) {
+        f->unknown_types++;
+        return 0;
+    }
+    if (expect != len) {
+        f->length_mismatches++;
+        return 0;
+    }
+    return 1;
+}
+
+/* Frame the next message from buf[0, avail).
+ * Returns the number of bytes consumed, 0 if more data is needed.
+ * When bytes were consumed, *msg and *len describe the message, or *len is 0
+ * if the bytes were framing overhead or a skipped message. */
+static inline size_t itch_frame_next(itch_framer_t *f, const uint8_t *buf, size_t avail,
+                                     const uint8_t **msg, size_t *len) {
+    *len = 0;
+    if (avail == 0) return 0;
+
+    switch (f->framing) {
+        case FRAMING_RAW: {
+            size_t n = f->lengths[buf[0]];
+            if (n == 0) {
+                f->skipped_bytes++;
+                return 1;
+            }
+            if (avail < n) return 0;
+            *msg = buf;
+            *len = n;
+            return n;
+        }
+
+        case FRAMING_BINARYFILE: {
+            if (avail < 2) return 0;
+            size_t n = ((size_t)buf[0] << 8) | buf[1];
+            if (avail < 2 + n) return 0;
+            if (itch_framer_check(f, buf + 2, n)) {
+                *msg = buf + 2;
+                *len = n;
+            }
+            return 2 + n;
+        }
+
+        case FRAMING_SOUPBINTCP: {
+            if (avail < 2) return 0;
+            size_t n = ((size_t)buf[0] << 8) | buf[1];
+            if (avail < 2 + n) return 0;
+            if (n >= 1 && buf[2] == 'S') {
+                if (itch_framer_check(f, buf + 3, n - 1)) {
+                    *msg = buf + 3;
+                    *len = n - 1;
+                }
+            } else {
+                f->control_packets++;
+            }
+            return 2 + n;
+        }
+
+        case FRAMING_MOLDUDP64: {
+            if (f->mold_remaining == 0) {
+                if (avail < MOLDUDP64_HEADER_SIZE) return 0;
+                memcpy(f->mold_session, buf, 10);
+                f->mold_seq = itch_read_u64(buf + 10);
+                uint16_t count = itch_read_u16(buf + 18);
+                if (count == 0 || count == MOLDUDP64_END_OF_SESSION) {
+                    f->control_packets++;
+                } else {
+                    f->mold_remaining = count;
+                }
+                return MOLDUDP64_HEADER_SIZE;
+            }
+            if (avail < 2) return 0;
+            size_t n = ((size_t)buf[0] << 8) | buf[1];
+            if (avail < 2 + n) return 0;
+            f->mold_remaining--;
+            f->mold_seq++;
+            if (itch_framer_check(f, buf + 2, n)) {
+                *msg = buf + 2;
+                *len = n;
+            }
+            return 2 + n;
+        }
+    }
+    return 0;
+}
+
+#endif /* ITCH_FRAMING_H */
@@ -0,0 +1,401 @@
+/*
+ * ITCH Gzip - see itch_gz.h
+ *
+ * Chunk c always lands in queue slot c % depth. A worker may fill it once
+ * the reader has moved past chunk c - depth; the reader may copy from it
+ * once the slot is tagged with c. One mutex guards the tags and indices;
+ * it is taken once per chunk, never per byte.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "itch_gz.h"
+
+#define CHUNK_TARGET (1u << 20)         // uncompressed bytes per chunk
+#define BGZF_MAX_BLOCK 65536
+#define PLAIN_READ_BUFFER (256 * 1024)  // zlib input buffer for plain gzip
+#define DEFAULT_MAX_THREADS 8
+
+typedef struct {
+    uint64_t offset;            // member start in the file
+    uint64_t uoffset;           // uncompressed offset of its first byte
+    uint32_t size;              // whole member, header to trailer
+    uint32_t header;            // header length
+    uint32_t usize;             // ISIZE from the trailer
+} gz_block_t;
+
+typedef struct {
+    uint64_t first;             // block range [first, end)
+    uint64_t end;
+    size_t usize;
+} gz_chunk_t;
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    int64_t chunk;              // chunk held, -1 = none yet
+    int error;
+} gz_slot_t;
+
+struct itch_gz {
+    int fd;
+    const uint8_t *data;
+    size_t size;
+
+    int blocked;
+    gz_block_t *blocks;
+    uint64_t nblocks;
+    gz_chunk_t *chunks;
+    uint64_t nchunks;           // UINT64_MAX for plain gzip: ends on an empty chunk
+    uint64_t total;
+
+    pthread_mutex_t lock;
+    pthread_cond_t ready;       // a slot was filled
+    pthread_cond_t space;       // the reader moved on to a new chunk
+    gz_slot_t *slots;
+    int depth;
+    size_t slot_cap;
+    uint64_t next_chunk;        // next chunk a worker claims
+    uint64_t read_chunk;        // chunk the reader is copying from
+    size_t read_pos;
+    int started;
+    int stop;
+
+    pthread_t threads[ITCH_GZ_MAX_THREADS];
+    int nthreads;
+    int running;                // threads actually started
+    itch_gz_stats_t stats;
+};
+
+static inline uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static inline uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Walk the BGZF member headers. Returns 0 with the block table built, or -1
+ * if the file is not BGZF (any member without a BC field). */
+static int parse_bgzf(itch_gz_t *g) {
+    uint64_t cap = 1024;
+    gz_block_t *blocks = malloc(cap * sizeof(gz_block_t));
+    if (!blocks) return -1;
+
+    uint64_t n = 0, off = 0, uoff = 0;
+    while (off < g->size) {
+        const uint8_t *h = g->data + off;
+        size_t left = g->size - off;
+        if (left < 18 || h[0] != 0x1f || h[1] != 0x8b || h[2] != 8 || !(h[3] & 4)) goto not_bgzf;
+
+        uint32_t xlen = le16(h + 10);
+        uint32_t bsize = 0;
+        for (uint32_t x = 0; x + 4 <= xlen && 12 + x + 4 <= left; ) {
+            uint16_t slen = le16(h + 12 + x + 2);
+            if (h[12 + x] == 'B' && h[12 + x + 1] == 'C' && slen == 2 && 12 + x + 6 <= left) {
+                bsize = (uint32_t)le16(h + 12 + x + 4) + 1;
+                break;
+            }
+            x += 4 + slen;
+        }
+        if (bsize == 0 || bsize > left || bsize < 12 + xlen + 8) goto not_bgzf;
+
+        if (n == cap) {
+            cap *= 2;
+            gz_block_t *grown = realloc(blocks, cap * sizeof(gz_block_t));
+            if (!grown) goto not_bgzf;
+            blocks = grown;
+        }
+        uint32_t usize = le32(h + bsize - 4);
+        if (usize > BGZF_MAX_BLOCK) goto not_bgzf;
+        blocks[n++] = (gz_block_t){ .offset = off, .uoffset = uoff, .size = bsize,
+                                    .header = 12 + xlen, .usize = usize };
+        off += bsize;
+        uoff += usize;
+    }
+    g->blocks = blocks;
+    g->nblocks = n;
+    g->total = uoff;
+    return n > 0 ? 0 : -1;
+
+not_bgzf:
+    free(blocks);
+    return -1;
+}
+
+/* Group blocks [first, nblocks) into chunks of about CHUNK_TARGET bytes */
+static int build_chunks(itch_gz_t *g, uint64_t first) {
+    free(g->chunks);
+    g->chunks = malloc((g->nblocks - first + 1) * sizeof(gz_chunk_t));
+    if (!g->chunks) return -1;
+    g->nchunks = 0;
+    for (uint64_t b = first; b < g->nblocks; ) {
+        gz_chunk_t *c = &g->chunks[g->nchunks++];
+        c->first = b;
+        c->usize = 0;
+        while (b < g->nblocks && c->usize + g->blocks[b].usize <= g->slot_cap) {
+            c->usize += g->blocks[b].usize;
+            b++;
+        }
+        c->end = b;
+    }
+    return 0;
+}
+
+/* Inflate every block of a chunk into out */
+static int inflate_chunk(const itch_gz_t *g, z_stream *z, const gz_chunk_t *c, uint8_t *out) {
+    size_t pos = 0;
+    for (uint64_t b = c->first; b < c->end; b++) {
+        const gz_block_t *blk = &g->blocks[b];
+        const uint8_t *member = g->data + blk->offset;
+        if (inflateReset(z) != Z_OK) return -1;
+        z->next_in = (Bytef *)(member + blk->header);
+        z->avail_in = blk->size - blk->header - 8;
+        z->next_out = out + pos;
+        z->avail_out = blk->usize;
+        int ret = inflate(z, Z_FINISH);
+        if (ret != Z_STREAM_END || z->avail_out != 0) return -1;
+        if (crc32(0, out + pos, blk->usize) != le32(member + blk->size - 8)) return -1;
+        pos += blk->usize;
+    }
+    return 0;
+}
+
+/* Wait until chunk c may be written into its slot; lock held */
+static int wait_for_slot(itch_gz_t *g, uint64_t c) {
+    int waited = 0;
+    while (!g->stop && c >= g->read_chunk + (uint64_t)g->depth) {
+        if (!waited) g->stats.worker_waits++;
+        waited = 1;
+        pthread_cond_wait(&g->space, &g->lock);
+    }
+    return !g->stop;
+}
+
+/* Tag a filled slot and wake the reader; returns with the lock held */
+static void publish_slot(itch_gz_t *g, gz_slot_t *s, uint64_t c, size_t len, int error) {
+    pthread_mutex_lock(&g->lock);
+    s->len = len;
+    s->error = error;
+    s->chunk = (int64_t)c;
+    pthread_cond_broadcast(&g->ready);
+}
+
+static void *bgzf_worker(void *arg) {
+    itch_gz_t *g = arg;
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    int init_failed = inflateInit2(&z, -15) != Z_OK;
+
+    pthread_mutex_lock(&g->lock);
+    while (!g->stop && g->next_chunk < g->nchunks) {
+        uint64_t c = g->next_chunk++;
+        if (!wait_for_slot(g, c)) break;
+        gz_slot_t *s = &g->slots[c % (uint64_t)g->depth];
+        pthread_mutex_unlock(&g->lock);
+
+        int err = init_failed || inflate_chunk(g, &z, &g->chunks[c], s->buf) < 0;
+        publish_slot(g, s, c, g->chunks[c].usize, err);
+    }
+    pthread_mutex_unlock(&g->lock);
+    if (!init_failed) inflateEnd(&z);
+    return NULL;
+}
+
+static void *plain_worker(void *arg) {
+    itch_gz_t *g = arg;
+    int fd = dup(g->fd);
+    gzFile f = fd >= 0 ? gzdopen(fd, "rb") : NULL;
+    if (!f && fd >= 0) close(fd);
+    if (f) gzbuffer(f, PLAIN_READ_BUFFER);
+
+    pthread_mutex_lock(&g->lock);
+    for (uint64_t c = 0; !g->stop; c++) {
+        if (!wait_for_slot(g, c)) break;
+        gz_slot_t *s = &g->slots[c % (uint64_t)g->depth];
+        pthread_mutex_unlock(&g->lock);
+
+        // A whole slot per chunk; 0 bytes marks the end of the stream
+        size_t len = 0;
+        int err = !f;
+        while (!err && len < g->slot_cap) {
+            int n = gzread(f, s->buf + len, (unsigned)(g->slot_cap - len));
+            int zerr = Z_OK;
+            if (n == 0) gzerror(f, &zerr);          // Z_BUF_ERROR: truncated file
+            // Hand over what was inflated first; the error sticks for the next chunk
+            if ((n < 0 || zerr != Z_OK) && len == 0) err = 1;
+            if (n <= 0) break;
+            len += (size_t)n;
+        }
+        publish_slot(g, s, c, len, err);
+        if (err || len == 0) break;
+    }
+    pthread_mutex_unlock(&g->lock);
+    if (f) gzclose(f);
+    return NULL;
+}
+
+itch_gz_t *itch_gz_open(const char *path, int threads, int depth) {
+    itch_gz_t *g = calloc(1, sizeof(itch_gz_t));
+    if (!g) return NULL;
+    g->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (g->fd < 0 || fstat(g->fd, &st) < 0) {
+        fprintf(stderr, "Failed to open gzip file: %s (%s)\n", path, strerror(errno));
+        if (g->fd >= 0) close(g->fd);
+        free(g);
+        return NULL;
+    }
+    g->size = (size_t)st.st_size;
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->ready, NULL);
+    pthread_cond_init(&g->space, NULL);
+    g->slot_cap = CHUNK_TARGET;
+
+    if (g->size > 0) {
+        void *m = mmap(NULL, g->size, PROT_READ, MAP_PRIVATE, g->fd, 0);
+        if (m != MAP_FAILED) {
+            g->data = m;
+            madvise(m, g->size, MADV_SEQUENTIAL);
+            g->blocked = parse_bgzf(g) == 0;
+        }
+    }
+
+    if (g->blocked) {
+        if (threads <= 0) {
+            long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+            threads = cpus > 1 ? (int)cpus - 1 : 1;
+            if (threads > DEFAULT_MAX_THREADS) threads = DEFAULT_MAX_THREADS;
+        }
+        if (threads > ITCH_GZ_MAX_THREADS) threads = ITCH_GZ_MAX_THREADS;
+    } else {
+        threads = 1;
+        g->nchunks = UINT64_MAX;
+    }
+    g->nthreads = threads;
+    g->depth = depth > 0 ? depth : 2 * threads;
+    if (g->depth < 2) g->depth = 2;
+
+    g->slots = calloc((size_t)g->depth, sizeof(gz_slot_t));
+    int ok = g->slots != NULL && (!g->blocked || build_chunks(g, 0) == 0);
+    for (int i = 0; ok && i < g->depth; i++) {
+        g->slots[i].chunk = -1;
+        g->slots[i].buf = malloc(g->slot_cap);
+        ok = g->slots[i].buf != NULL;
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate decompression buffers\n");
+        itch_gz_close(g);
+        return NULL;
+    }
+
+    g->stats.blocked = g->blocked;
+    g->stats.threads = g->nthreads;
+    g->stats.depth = g->depth;
+    g->stats.blocks = g->nblocks;
+    g->stats.compressed_bytes = g->size;
+    return g;
+}
+
+void itch_gz_close(itch_gz_t *g) {
+    if (!g) return;
+    pthread_mutex_lock(&g->lock);
+    g->stop = 1;
+    pthread_cond_broadcast(&g->space);
+    pthread_cond_broadcast(&g->ready);
+    pthread_mutex_unlock(&g->lock);
+    for (int i = 0; i < g->running; i++) pthread_join(g->threads[i], NULL);
+
+    if (g->slots) {
+        for (int i = 0; i < g->depth; i++) free(g->slots[i].buf);
+        free(g->slots);
+    }
+    free(g->blocks);
+    free(g->chunks);
+    if (g->data) munmap((void *)g->data, g->size);
+    close(g->fd);
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->ready);
+    pthread_cond_destroy(&g->space);
+    free(g);
+}
+
+uint64_t itch_gz_size(const itch_gz_t *g) {
+    return g->blocked ? g->total : 0;
+}
+
+int itch_gz_seek(itch_gz_t *g, uint64_t offset) {
+    if (!g->blocked || g->started || offset > g->total) return -1;
+    // Last block starting at or before offset
+    uint64_t lo = 0, hi = g->nblocks;
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (g->blocks[mid].uoffset <= offset) lo = mid;
+        else hi = mid;
+    }
+    if (offset == g->total) lo = g->nblocks;
+    if (build_chunks(g, lo) < 0) return -1;
+    g->read_pos = lo < g->nblocks ? (size_t)(offset - g->blocks[lo].uoffset) : 0;
+    return 0;
+}
+
+static int start_threads(itch_gz_t *g) {
+    g->started = 1;
+    for (int i = 0; i < g->nthreads; i++) {
+        if (pthread_create(&g->threads[i], NULL, g->blocked ? bgzf_worker : plain_worker, g) != 0) break;
+        g->running++;
+    }
+    return g->running > 0 ? 0 : -1;
+}
+
+ssize_t itch_gz_read(itch_gz_t *g, uint8_t *dst, size_t len) {
+    if (!g->started && start_threads(g) < 0) return -1;
+
+    size_t done = 0;
+    pthread_mutex_lock(&g->lock);
+    while (done < len && g->read_chunk < g->nchunks) {
+        gz_slot_t *s = &g->slots[g->read_chunk % (uint64_t)g->depth];
+        if (s->chunk != (int64_t)g->read_chunk) {
+            if (done) break;        // hand back what we have rather than wait
+            g->stats.reader_waits++;
+            while (!g->stop && s->chunk != (int64_t)g->read_chunk) {
+                pthread_cond_wait(&g->ready, &g->lock);
+            }
+            continue;
+        }
+        if (s->error) {
+            pthread_mutex_unlock(&g->lock);
+            return done ? (ssize_t)done : -1;
+        }
+        if (s->len == 0 && !g->blocked) break;      // end of a plain stream
+
+        // The slot is not reused until read_chunk moves on: copy unlocked
+        size_t n = s->len - g->read_pos;
+        if (n > len - done) n = len - done;
+        pthread_mutex_unlock(&g->lock);
+        memcpy(dst + done, s->buf + g->read_pos, n);
+        pthread_mutex_lock(&g->lock);
+        done += n;
+        g->read_pos += n;
+        g->stats.bytes_out += n;
+        if (g->read_pos == s->len) {
+            g->read_chunk++;
+            g->read_pos = 0;
+            pthread_cond_broadcast(&g->space);
+        }
+    }
+    pthread_mutex_unlock(&g->lock);
+    return (ssize_t)done;
+}
+
+void itch_gz_get_stats(itch_gz_t *g, itch_gz_stats_t *out) {
+    pthread_mutex_lock(&g->lock);
+    *out = g->stats;
+    pthread_mutex_unlock(&g->lock);
+}
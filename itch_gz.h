@@ -0,0 +1,66 @@
+/*
+ * ITCH Gzip - multi-threaded decompression front end for .gz files
+ *
+ * Decompressed data reaches the reader through a bounded queue of chunks
+ * (about 1 MB each), so inflate runs on other threads while the reader
+ * frames and replays.
+ *
+ * - BGZF files (blocked gzip as written by `bgzip`: a series of gzip members
+ *   of at most 64 KB each, with the compressed length in a header field)
+ *   are inflated in parallel. The block table is built from the headers at
+ *   open without inflating anything, then worker threads claim chunks of
+ *   consecutive blocks and inflate them independently. The reader takes
+ *   chunks strictly in order. The table also maps uncompressed offsets to
+ *   blocks, so a BGZF file is seekable (itch_gz_seek).
+ * - Any other gzip stream has no member boundaries that can be found
+ *   without inflating, so one thread inflates it sequentially into the same
+ *   queue.
+ *
+ * Usage:
+ *   itch_gz_t *g = itch_gz_open("day.itch.gz", 0, 0);   // default threads/depth
+ *   itch_gz_seek(g, offset);                            // optional, BGZF only
+ *   while ((n = itch_gz_read(g, buf, sizeof(buf))) > 0) { ... }
+ *   itch_gz_close(g);
+ */
+
+#ifndef ITCH_GZ_H
+#define ITCH_GZ_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define ITCH_GZ_MAX_THREADS 64
+
+typedef struct itch_gz itch_gz_t;
+
+typedef struct {
+    int blocked;                // 1 = BGZF, inflated in parallel
+    int threads;                // inflate threads
+    int depth;                  // chunks in the queue
+    uint64_t blocks;            // BGZF blocks (0 for plain gzip)
+    uint64_t compressed_bytes;
+    uint64_t bytes_out;         // decompressed bytes handed to the reader
+    uint64_t reader_waits;      // reads that found the next chunk not ready
+    uint64_t worker_waits;      // chunks that waited for a free queue slot
+} itch_gz_stats_t;
+
+/* Open path. threads 0 = one per online CPU but one (up to 8), depth 0 =
+ * twice the thread count. NULL on failure (message on stderr). */
+itch_gz_t *itch_gz_open(const char *path, int threads, int depth);
+void itch_gz_close(itch_gz_t *g);
+
+/* Uncompressed size, known for BGZF only (0 otherwise) */
+uint64_t itch_gz_size(const itch_gz_t *g);
+
+/* Start reading at an uncompressed offset. BGZF only, and only before the
+ * first read. Returns 0, or -1. */
+int itch_gz_seek(itch_gz_t *g, uint64_t offset);
+
+/* Copy up to len decompressed bytes. Returns the count, 0 at end of file,
+ * -1 on a corrupt or truncated file. */
+ssize_t itch_gz_read(itch_gz_t *g, uint8_t *dst, size_t len);
+
+void itch_gz_get_stats(itch_gz_t *g, itch_gz_stats_t *out);
+
+#endif /* ITCH_GZ_H */
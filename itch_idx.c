@@ -0,0 +1,299 @@
+/*
+ * ITCH Index - see itch_idx.h
+ *
+ * Two passes, like the column store export: the first counts messages per
+ * stockLocate, fills the time buckets and collects the 'R' directory, which
+ * sizes the file; the second writes every message offset into its locate
+ * group through the mapped output. The magic goes in last.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "itch_idx.h"
+#include "itch_parser.h"
+
+#define IDX_ALIGN 64
+
+static inline uint64_t align_up(uint64_t x) {
+    return (x + IDX_ALIGN - 1) & ~(uint64_t)(IDX_ALIGN - 1);
+}
+
+/* 6-byte timestamp without the 8-byte over-read: index input has no guarantee
+ * of slack past the last message */
+static inline uint64_t message_timestamp(const uint8_t *msg) {
+    return ((uint64_t)itch_read_u16(msg + 5) << 32) | itch_read_u32(msg + 7);
+}
+
+typedef struct {
+    uint64_t *locate_counts;    // pass 1 counts, then pass 2 write cursors
+    uint64_t *buckets;
+    uint64_t bucket_ns;
+    uint64_t bucket_count;
+    uint64_t buckets_filled;
+    itch_idx_symbol_t *symbols;
+    uint64_t symbol_count;
+    uint8_t *locate_seen;       // 'R' already recorded for this locate
+    uint64_t messages;
+    uint64_t *out_offsets;      // pass 2 destination
+} idx_builder_t;
+
+typedef void (*visit_fn)(idx_builder_t *b, uint64_t unit, uint64_t msg_off, const uint8_t *msg);
+
+/* Walk every message, reporting the framing unit it can be resumed from */
+static void walk(const uint8_t *data, size_t size, itch_framing_t framing,
+                 idx_builder_t *b, visit_fn visit, int print_stats) {
+    itch_framer_t f;
+    itch_framer_init(&f, framing);
+    size_t pos = 0;
+    size_t unit = 0;
+    while (pos < size) {
+        // A MoldUDP64 reader can only resume at a packet header
+        if (framing != FRAMING_MOLDUDP64 || f.mold_remaining == 0) unit = pos;
+        const uint8_t *msg;
+        size_t len;
+        size_t used = itch_frame_next(&f, data + pos, size - pos, &msg, &len);
+        if (used == 0) break;
+        pos += used;
+        if (len) visit(b, unit, (uint64_t)(msg - data), msg);
+    }
+    if (print_stats) itch_framer_print_stats(&f);
+}
+
+static void count_message(idx_builder_t *b, uint64_t unit, uint64_t msg_off, const uint8_t *msg) {
+    (void)msg_off;
+    uint16_t locate = itch_read_u16(msg + 1);
+    b->locate_counts[locate]++;
+    b->messages++;
+
+    uint64_t bucket = message_timestamp(msg) / b->bucket_ns;
+    if (bucket >= b->bucket_count) bucket = b->bucket_count - 1;
+    while (b->buckets_filled <= bucket) b->buckets[b->buckets_filled++] = unit;
+
+    if (msg[0] == 'R' && !b->locate_seen[locate]) {
+        b->locate_seen[locate] = 1;
+        itch_idx_symbol_t *s = &b->symbols[b->symbol_count++];
+        memset(s, 0, sizeof(*s));
+        memcpy(s->stock, msg + 11, 8);
+        s->stockLocate = locate;
+    }
+}
+
+static void place_message(idx_builder_t *b, uint64_t unit, uint64_t msg_off, const uint8_t *msg) {
+    (void)unit;
+    b->out_offsets[b->locate_counts[itch_read_u16(msg + 1)]++] = msg_off;
+}
+
+static void builder_free(idx_builder_t *b) {
+    free(b->locate_counts);
+    free(b->buckets);
+    free(b->symbols);
+    free(b->locate_seen);
+}
+
+int itch_idx_build(const uint8_t *data, size_t size, itch_framing_t framing,
+                   uint64_t bucket_ns, const char *out_path) {
+    idx_builder_t b;
+    memset(&b, 0, sizeof(b));
+    b.bucket_ns = bucket_ns ? bucket_ns : ITCH_IDX_DEFAULT_BUCKET_NS;
+    b.bucket_count = (ITCH_IDX_DAY_NS + b.bucket_ns - 1) / b.bucket_ns;
+    b.locate_counts = calloc(ITCH_IDX_LOCATES, sizeof(uint64_t));
+    b.buckets = malloc(b.bucket_count * sizeof(uint64_t));
+    b.symbols = malloc(ITCH_IDX_LOCATES * sizeof(itch_idx_symbol_t));
+    b.locate_seen = calloc(ITCH_IDX_LOCATES, 1);
+    if (!b.locate_counts || !b.buckets || !b.symbols || !b.locate_seen) {
+        fprintf(stderr, "Index: out of memory\n");
+        builder_free(&b);
+        return -1;
+    }
+
+    walk(data, size, framing, &b, count_message, 1);
+    while (b.buckets_filled < b.bucket_count) b.buckets[b.buckets_filled++] = size;
+
+    itch_idx_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.version = ITCH_IDX_VERSION;
+    hdr.framing = (uint32_t)framing;
+    hdr.source_size = size;
+    hdr.message_count = b.messages;
+    hdr.bucket_ns = b.bucket_ns;
+    hdr.bucket_count = b.bucket_count;
+    hdr.symbol_count = b.symbol_count;
+
+    uint64_t pos = align_up(sizeof(hdr));
+    hdr.buckets_offset = pos;
+    pos = align_up(pos + b.bucket_count * sizeof(uint64_t));
+    hdr.symbols_offset = pos;
+    pos = align_up(pos + b.symbol_count * sizeof(itch_idx_symbol_t));
+    hdr.locate_start_offset = pos;
+    pos = align_up(pos + (ITCH_IDX_LOCATES + 1) * sizeof(uint64_t));
+    hdr.offsets_offset = pos;
+    pos = align_up(pos + b.messages * sizeof(uint64_t));
+    hdr.file_size = pos;
+
+    int fd = open(out_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)hdr.file_size) < 0) {
+        fprintf(stderr, "Index: cannot create %s (%s)\n", out_path, strerror(errno));
+        if (fd >= 0) close(fd);
+        builder_free(&b);
+        return -1;
+    }
+    uint8_t *out = mmap(NULL, hdr.file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (out == MAP_FAILED) {
+        fprintf(stderr, "Index: cannot map %s (%s)\n", out_path, strerror(errno));
+        close(fd);
+        builder_free(&b);
+        return -1;
+    }
+
+    memcpy(out + hdr.buckets_offset, b.buckets, b.bucket_count * sizeof(uint64_t));
+    memcpy(out + hdr.symbols_offset, b.symbols, b.symbol_count * sizeof(itch_idx_symbol_t));
+
+    // Counts become group starts and per-locate write cursors
+    uint64_t *start = (uint64_t *)(out + hdr.locate_start_offset);
+    uint64_t sum = 0;
+    for (size_t l = 0; l < ITCH_IDX_LOCATES; l++) {
+        start[l] = sum;
+        uint64_t n = b.locate_counts[l];
+        b.locate_counts[l] = sum;
+        sum += n;
+    }
+    start[ITCH_IDX_LOCATES] = sum;
+
+    b.out_offsets = (uint64_t *)(out + hdr.offsets_offset);
+    walk(data, size, framing, &b, place_message, 0);
+
+    memcpy(out, &hdr, sizeof(hdr));
+    memcpy(out, ITCH_IDX_MAGIC, 8);
+
+    munmap(out, hdr.file_size);
+    close(fd);
+    builder_free(&b);
+    return 0;
+}
+
+/* n elements of elem bytes at off lie inside size bytes, aligned for loads */
+static int section_fits(uint64_t off, uint64_t n, uint64_t elem, size_t size) {
+    return off % 8 == 0 && off <= size && n <= (size - off) / elem;
+}
+
+/* Every section lies inside the mapping, bucket offsets inside the source
+ * and the per-locate ranges inside the offset table */
+static int idx_valid(const itch_idx_header_t *h, const uint8_t *base, size_t size) {
+    if (memcmp(h->magic, ITCH_IDX_MAGIC, 8) != 0 || h->version != ITCH_IDX_VERSION ||
+        h->file_size != size || h->bucket_ns == 0 ||
+        !section_fits(h->buckets_offset, h->bucket_count, sizeof(uint64_t), size) ||
+        !section_fits(h->symbols_offset, h->symbol_count, sizeof(itch_idx_symbol_t), size) ||
+        !section_fits(h->locate_start_offset, ITCH_IDX_LOCATES + 1, sizeof(uint64_t), size) ||
+        !section_fits(h->offsets_offset, h->message_count, sizeof(uint64_t), size)) {
+        return 0;
+    }
+    const uint64_t *buckets = (const uint64_t *)(base + h->buckets_offset);
+    for (uint64_t i = 0; i < h->bucket_count; i++) {
+        if (buckets[i] > h->source_size) return 0;
+    }
+    const uint64_t *starts = (const uint64_t *)(base + h->locate_start_offset);
+    for (uint32_t l = 0; l < ITCH_IDX_LOCATES; l++) {
+        if (starts[l] > starts[l + 1]) return 0;
+    }
+    return starts[ITCH_IDX_LOCATES] <= h->message_count;
+}
+
+int itch_idx_open(itch_idx_t *ix, const char *path) {
+    memset(ix, 0, sizeof(*ix));
+    ix->fd = open(path, O_RDONLY);
+    if (ix->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(ix->fd, &st) < 0 || (size_t)st.st_size < sizeof(itch_idx_header_t)) {
+        itch_idx_close(ix);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, ix->fd, 0);
+    if (base == MAP_FAILED) {
+        itch_idx_close(ix);
+        return -1;
+    }
+    ix->base = base;
+    ix->size = (size_t)st.st_size;
+
+    const itch_idx_header_t *h = base;
+    if (!idx_valid(h, ix->base, ix->size)) {
+        errno = EINVAL;
+        itch_idx_close(ix);
+        return -1;
+    }
+    ix->header = h;
+    ix->buckets = (const uint64_t *)(ix->base + h->buckets_offset);
+    ix->symbols = (const itch_idx_symbol_t *)(ix->base + h->symbols_offset);
+    ix->locate_start = (const uint64_t *)(ix->base + h->locate_start_offset);
+    ix->offsets = (const uint64_t *)(ix->base + h->offsets_offset);
+    return 0;
+}
+
+void itch_idx_close(itch_idx_t *ix) {
+    if (ix->base) munmap((void *)ix->base, ix->size);
+    if (ix->fd >= 0) close(ix->fd);
+    memset(ix, 0, sizeof(*ix));
+    ix->fd = -1;
+}
+
+uint64_t itch_idx_seek_time(const itch_idx_t *ix, uint64_t ts) {
+    uint64_t bucket = ts / ix->header->bucket_ns;
+    if (bucket >= ix->header->bucket_count) return ix->header->source_size;
+    return ix->buckets[bucket];
+}
+
+int itch_idx_find_symbol(const itch_idx_t *ix, const char *symbol) {
+    char padded[8];
+    size_t len = strlen(symbol);
+    if (len > 8) return -1;
+    memset(padded, ' ', sizeof(padded));
+    memcpy(padded, symbol, len);
+    for (uint64_t i = 0; i < ix->header->symbol_count; i++) {
+        if (memcmp(ix->symbols[i].stock, padded, 8) == 0) return ix->symbols[i].stockLocate;
+    }
+    return -1;
+}
+
+const uint64_t *itch_idx_locate_offsets(const itch_idx_t *ix, uint16_t locate, size_t *n) {
+    *n = ix->locate_start[locate + 1] - ix->locate_start[locate];
+    return ix->offsets + ix->locate_start[locate];
+}
+
+int itch_parse_time(const char *s, uint64_t *ns) {
+    char *end;
+    if (!strchr(s, ':')) {
+        *ns = strtoull(s, &end, 10);
+        return (*end == '\0' && end != s) ? 0 : -1;
+    }
+
+    unsigned long h = strtoul(s, &end, 10);
+    if (*end != ':') return -1;
+    unsigned long m = strtoul(end + 1, &end, 10);
+    unsigned long sec = 0;
+    uint64_t frac = 0;
+    if (*end == ':') {
+        sec = strtoul(end + 1, &end, 10);
+        if (*end == '.') {
+            // Up to 9 fractional digits, right-padded to nanoseconds
+            const char *p = end + 1;
+            int digits = 0;
+            while (*p >= '0' && *p <= '9' && digits < 9) {
+                frac = frac * 10 + (uint64_t)(*p++ - '0');
+                digits++;
+            }
+            while (digits++ < 9) frac *= 10;
+            end = (char *)p;
+        }
+    }
+    if (*end != '\0' || h > 23 || m > 59 || sec > 59) return -1;
+    *ns = ((h * 60 + m) * 60 + sec) * 1000000000ULL + frac;
+    return 0;
+}
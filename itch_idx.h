@@ -0,0 +1,101 @@
+/*
+ * ITCH Index - sidecar seek index for a raw/framed ITCH file
+ *
+ * Built once per file by itch_index; lets a reader start at a feed time or
+ * jump straight between one stock's messages without scanning the day.
+ *
+ * File layout (every section 64-byte aligned):
+ *
+ *   itch_idx_header_t
+ *   buckets        uint64_t x bucket_count   frame-unit offset of the first
+ *                                            message at or after bucket * bucket_ns
+ *   symbols        itch_idx_symbol_t x symbol_count   (from 'R' messages)
+ *   locate_start   uint64_t x 65537
+ *   offsets        uint64_t x message_count  message offsets grouped by
+ *                                            stockLocate, in file order
+ *
+ * A bucket offset is a framing boundary the framer can resume from (a packet
+ * start for MoldUDP64). A per-locate offset points at the message itself
+ * (past any length prefix), whose length comes from the type table.
+ *
+ * Usage:
+ *   itch_idx_t ix;
+ *   itch_idx_open(&ix, "day.itch.idx");
+ *   uint64_t start = itch_idx_seek_time(&ix, 9 * 3600 * 1000000000ULL);
+ *   int locate = itch_idx_find_symbol(&ix, "AAPL");
+ *   size_t n;
+ *   const uint64_t *offs = itch_idx_locate_offsets(&ix, locate, &n);
+ *   itch_idx_close(&ix);
+ */
+
+#ifndef ITCH_IDX_H
+#define ITCH_IDX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "itch_framing.h"
+
+#define ITCH_IDX_MAGIC "ITCHIDX1"
+#define ITCH_IDX_VERSION 1
+#define ITCH_IDX_LOCATES 65536
+#define ITCH_IDX_DEFAULT_BUCKET_NS 1000000000ULL   // 1 second
+#define ITCH_IDX_DAY_NS (86400ULL * 1000000000ULL)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t framing;           // itch_framing_t of the source
+    uint64_t source_size;       // must match the file being replayed
+    uint64_t message_count;
+    uint64_t bucket_ns;
+    uint64_t bucket_count;
+    uint64_t symbol_count;
+    uint64_t buckets_offset;
+    uint64_t symbols_offset;
+    uint64_t locate_start_offset;
+    uint64_t offsets_offset;
+    uint64_t file_size;
+} itch_idx_header_t;
+
+typedef struct {
+    char stock[8];              // space padded, as in the 'R' message
+    uint16_t stockLocate;
+    uint16_t reserved[3];
+} itch_idx_symbol_t;
+
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    const itch_idx_header_t *header;
+    const uint64_t *buckets;
+    const itch_idx_symbol_t *symbols;
+    const uint64_t *locate_start;
+    const uint64_t *offsets;
+    int fd;
+} itch_idx_t;
+
+/* Build the index for data[0, size) into out_path. bucket_ns 0 = default.
+ * Returns 0 on success, -1 on error (message on stderr). */
+int itch_idx_build(const uint8_t *data, size_t size, itch_framing_t framing,
+                   uint64_t bucket_ns, const char *out_path);
+
+/* Map an index read-only, checking every section lies inside it.
+ * Returns 0, or -1 if missing or invalid. */
+int itch_idx_open(itch_idx_t *ix, const char *path);
+void itch_idx_close(itch_idx_t *ix);
+
+/* Frame-unit offset to resume from for feed time ts (ns since midnight).
+ * Messages before ts may follow and must be skipped by the caller. */
+uint64_t itch_idx_seek_time(const itch_idx_t *ix, uint64_t ts);
+
+/* stockLocate for a symbol (case sensitive, unpadded), -1 if not listed */
+int itch_idx_find_symbol(const itch_idx_t *ix, const char *symbol);
+
+/* Message offsets for one stockLocate, in file order */
+const uint64_t *itch_idx_locate_offsets(const itch_idx_t *ix, uint16_t locate, size_t *n);
+
+/* Parse "HH:MM[:SS[.fraction]]" or plain nanoseconds since midnight.
+ * Returns 0 on success, -1 on malformed input. */
+int itch_parse_time(const char *s, uint64_t *ns);
+
+#endif /* ITCH_IDX_H */
@@ -0,0 +1,163 @@
+/*
+ * ITCH Merge - k-way merge of several feeds by timestamp, and merged recordings
+ *
+ * Replaying an ITCH day and an ITTO day together (a cross-asset session)
+ * means interleaving two feeds by feed time under one pacing clock. Each
+ * feed is a cursor over its mapped file with its own framing state and
+ * length table; a min-heap over the feeds' head messages, keyed on
+ * (timestamp, feed index), picks the next message. A tie goes to the feed
+ * added first and a feed's own messages keep their file order, so the merge
+ * is deterministic: the same inputs always give the same sequence.
+ *
+ * The heap holds at most ITCH_MERGE_MAX_FEEDS entries, so a step is one
+ * frame on the winning feed plus a sift-down of a few compares.
+ *
+ * A merged session can also be recorded to a file (itch_record) and replayed
+ * without any of that: records are stored pre-framed in merge order,
+ *
+ *   itch_merged_header_t (64 bytes)
+ *   records        [len:2][feed:1][message] x messages
+ *
+ * so a reader walks them with one length load per message, and the feed
+ * byte names the message's protocol through the header.
+ *
+ * Usage:
+ *   itch_merge_t m;
+ *   itch_merge_init(&m);
+ *   itch_merge_add(&m, itch.data, itch.size, FRAMING_RAW, PROTOCOL_ITCH);
+ *   itch_merge_add(&m, itto.data, itto.size, FRAMING_BINARYFILE, PROTOCOL_ITTO);
+ *   int feed;
+ *   while ((feed = itch_merge_next(&m, &msg, &len, &ts)) >= 0) ...
+ *
+ *   const itch_merged_header_t *h = itch_merged_header(data, size);   // NULL = not a recording
+ *   itch_merged_cursor_t c = { data + sizeof(*h), data + size };
+ *   while ((feed = itch_merged_next(&c, &msg, &len)) >= 0) ...
+ */
+
+#ifndef ITCH_MERGE_H
+#define ITCH_MERGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "itch_framing.h"
+#include "itch_file.h"
+
+#define ITCH_MERGE_MAX_FEEDS 16
+#define ITCH_MERGED_MAGIC "ITCHMRG1"
+#define ITCH_MERGED_VERSION 1
+#define ITCH_MERGED_RECORD_HEADER 3
+
+typedef struct {
+    itch_cursor_t cur;
+    itch_protocol_t protocol;
+    size_t ts_offset;
+    const uint8_t *msg;         // head message, NULL once the feed is done
+    size_t len;
+    uint64_t ts;                // head message's timestamp
+    uint64_t messages;          // taken from this feed
+} itch_merge_feed_t;
+
+typedef struct {
+    itch_merge_feed_t feeds[ITCH_MERGE_MAX_FEEDS];
+    uint8_t heap[ITCH_MERGE_MAX_FEEDS];   // feed indices, min-heap on (ts, index)
+    int nfeeds;
+    int nheap;
+} itch_merge_t;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t feeds;
+    uint8_t protocols[ITCH_MERGE_MAX_FEEDS];   // itch_protocol_t of each feed
+    uint64_t messages;
+    uint64_t first_ts;
+    uint64_t last_ts;
+    uint64_t data_size;         // record bytes after the header
+} itch_merged_header_t;
+
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+} itch_merged_cursor_t;
+
+void itch_merge_init(itch_merge_t *m);
+
+/* Add a feed over data[0, size). Returns its index, or -1 if there are
+ * already ITCH_MERGE_MAX_FEEDS. Feeds must be added before the first next. */
+int itch_merge_add(itch_merge_t *m, const uint8_t *data, size_t size, itch_framing_t framing,
+                   itch_protocol_t protocol);
+
+/* Drain the merge into a recording at path, keeping messages with
+ * start_ns <= timestamp <= end_ns. Returns the number of messages written,
+ * or -1 on error (message on stderr). */
+long itch_merge_record(itch_merge_t *m, const char *path, uint64_t start_ns, uint64_t end_ns);
+
+/* Print per-feed message counts and framing counters */
+void itch_merge_print_stats(const itch_merge_t *m, FILE *out);
+
+/* The header if data is a complete merged recording, else NULL */
+const itch_merged_header_t *itch_merged_header(const uint8_t *data, size_t size);
+
+/* 6-byte timestamp at off, without reading past it */
+static inline uint64_t itch_merge_timestamp(const uint8_t *msg, size_t off) {
+    return ((uint64_t)itch_read_u16(msg + off) << 32) | itch_read_u32(msg + off + 2);
+}
+
+/* Load the feed's next message as its head; 0 when the feed is done */
+static inline int itch_merge_pull(itch_merge_feed_t *f) {
+    if (!itch_cursor_next(&f->cur, &f->msg, &f->len)) {
+        f->msg = NULL;
+        return 0;
+    }
+    // A message too short for a timestamp keeps its place after the previous one
+    if (f->len >= f->ts_offset + 6) f->ts = itch_merge_timestamp(f->msg, f->ts_offset);
+    return 1;
+}
+
+static inline int itch_merge_before(const itch_merge_t *m, int a, int b) {
+    uint64_t ta = m->feeds[a].ts, tb = m->feeds[b].ts;
+    return ta < tb || (ta == tb && a < b);
+}
+
+static inline void itch_merge_sift_down(itch_merge_t *m, int i) {
+    for (;;) {
+        int l = 2 * i + 1, best = i;
+        if (l < m->nheap && itch_merge_before(m, m->heap[l], m->heap[best])) best = l;
+        if (l + 1 < m->nheap && itch_merge_before(m, m->heap[l + 1], m->heap[best])) best = l + 1;
+        if (best == i) return;
+        uint8_t t = m->heap[i];
+        m->heap[i] = m->heap[best];
+        m->heap[best] = t;
+        i = best;
+    }
+}
+
+/* Next message in merge order with its timestamp: returns its feed index,
+ * or -1 once every feed is done. Messages point into the feeds' data. */
+static inline int itch_merge_next(itch_merge_t *m, const uint8_t **msg, size_t *len, uint64_t *ts) {
+    if (m->nheap == 0) return -1;
+    int feed = m->heap[0];
+    itch_merge_feed_t *f = &m->feeds[feed];
+    *msg = f->msg;
+    *len = f->len;
+    *ts = f->ts;
+    f->messages++;
+    if (!itch_merge_pull(f)) m->heap[0] = m->heap[--m->nheap];
+    itch_merge_sift_down(m, 0);
+    return feed;
+}
+
+/* Next record of a merged recording: returns its feed index, or -1 at the end */
+static inline int itch_merged_next(itch_merged_cursor_t *c, const uint8_t **msg, size_t *len) {
+    if ((size_t)(c->end - c->pos) < ITCH_MERGED_RECORD_HEADER) return -1;
+    size_t n = ((size_t)c->pos[0] << 8) | c->pos[1];
+    if ((size_t)(c->end - c->pos) < ITCH_MERGED_RECORD_HEADER + n) return -1;
+    int feed = c->pos[2];
+    *msg = c->pos + ITCH_MERGED_RECORD_HEADER;
+    *len = n;
+    c->pos += ITCH_MERGED_RECORD_HEADER + n;
+    return feed;
+}
+
+#endif /* ITCH_MERGE_H */
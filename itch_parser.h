@@ -0,0 +1,263 @@
+/*
+ * NASDAQ ITCH 5.0 Parser - decode API
+ *
+ * Two ways to consume a framed message (type byte first):
+ * - itch_decode() fills the typed struct for the message on the stack and
+ *   calls the matching slot of a user-supplied handler table. NULL slots are
+ *   skipped without decoding. No allocation, no stdio, no string trimming:
+ *   alpha fields are copied raw and stay space padded.
+ * - itch_decode_<type>() are the per-type field extractors, inline here so
+ *   callers that switch on the type byte themselves pay no call overhead.
+ *   itch_encode_<type>() write a message back out from the same struct.
+ *
+ * parse_itch_message() is the old printing entry point; it is now just
+ * itch_decode() with itch_print_handlers.
+ */
+
+#ifndef ITCH_PARSER_H
+#define ITCH_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "itch_schema.h"
+
+#define ITCH_HEADER_SIZE 11
+
+typedef struct {
+    uint64_t timestamp;      // 6 bytes (nanoseconds since midnight)
+    uint16_t stockLocate;    // 2 bytes
+    uint16_t trackingNumber; // 2 bytes
+    char messageType;        // 1 byte
+} ITCHHeader;
+
+/* Message schema. One entry per type in spec order:
+ *   M(type byte, suffix, struct, spec length, handler slot)
+ * and one field list per type, in wire order after the 11-byte header.
+ * Structs, wire layouts, decoders, encoders, the length table and the
+ * dispatch switch are all generated from these (itch_schema.h). */
+
+#define ITCH_MESSAGES(M) \
+    M('S', S, ITCHSystemEvent,               12, on_system_event)                /* System Event */ \
+    M('R', R, ITCHStockDirectory,            39, on_stock_directory)             /* Stock Directory */ \
+    M('H', H, ITCHTradingAction,             25, on_trading_action)              /* Stock Trading Action */ \
+    M('Y', Y, ITCHRegSHORestriction,         20, on_reg_sho_restriction)         /* Reg SHO Restriction */ \
+    M('L', L, ITCHMarketParticipantPosition, 26, on_market_participant_position) /* Market Participant Position */ \
+    M('V', V, ITCHMWCBDeclineLevel,          35, on_mwcb_decline_level)          /* MWCB Decline Level */ \
+    M('W', W, ITCHMWCBStatus,                12, on_mwcb_status)                 /* MWCB Status */ \
+    M('K', K, ITCHIPOQuotingPeriod,          28, on_ipo_quoting_period)          /* IPO Quoting Period Update */ \
+    M('A', A, ITCHAddOrder,                  36, on_add_order)                   /* Add Order (No MPID) */ \
+    M('F', F, ITCHAddOrderMPID,              40, on_add_order_mpid)              /* Add Order (MPID) */ \
+    M('E', E, ITCHOrderExecuted,             31, on_order_executed)              /* Order Executed */ \
+    M('C', C, ITCHOrderExecutedWithPrice,    36, on_order_executed_with_price)   /* Order Executed With Price */ \
+    M('X', X, ITCHOrderCancel,               23, on_order_cancel)                /* Order Cancel */ \
+    M('D', D, ITCHOrderDelete,               19, on_order_delete)                /* Order Delete */ \
+    M('U', U, ITCHOrderReplace,              35, on_order_replace)               /* Order Replace */ \
+    M('P', P, ITCHTrade,                     44, on_trade)                       /* Trade (Non-Cross) */ \
+    M('Q', Q, ITCHCrossTrade,                40, on_cross_trade)                 /* Cross Trade */ \
+    M('B', B, ITCHBrokenTrade,               19, on_broken_trade)                /* Broken Trade */ \
+    M('I', I, ITCHNOII,                      50, on_noii)                        /* NOII */ \
+    M('N', N, ITCHRPII,                      20, on_rpii)                        /* RPII */
+
+#define ITCH_FIELDS_S(F) \
+    F(CHAR, eventCode)
+
+#define ITCH_FIELDS_R(F) \
+    F(A8,   stock) \
+    F(CHAR, marketCategory) \
+    F(CHAR, financialStatusIndicator) \
+    F(U32,  roundLotSize) \
+    F(CHAR, roundLotsOnly) \
+    F(CHAR, issueClassification) \
+    F(A2,   issueSubType) \
+    F(CHAR, authenticity) \
+    F(CHAR, shortSaleThresholdIndicator) \
+    F(CHAR, ipoFlag) \
+    F(CHAR, luldReferencePriceTier) \
+    F(CHAR, etpFlag) \
+    F(U32,  etpLeverageFactor) \
+    F(CHAR, inverseIndicator)
+
+#define ITCH_FIELDS_H(F) \
+    F(A8,   stock) \
+    F(CHAR, tradingState) \
+    F(CHAR, reserved) \
+    F(A4,   reason)
+
+#define ITCH_FIELDS_Y(F) \
+    F(A8,   stock) \
+    F(CHAR, regSHOAction)
+
+#define ITCH_FIELDS_L(F) \
+    F(A4,   mpid) \
+    F(A8,   stock) \
+    F(CHAR, primaryMarketMaker) \
+    F(CHAR, marketMakerMode) \
+    F(CHAR, marketParticipantState)
+
+#define ITCH_FIELDS_V(F) \
+    F(U64,  level1) \
+    F(U64,  level2) \
+    F(U64,  level3)
+
+#define ITCH_FIELDS_W(F) \
+    F(CHAR, breachedLevel)
+
+#define ITCH_FIELDS_K(F) \
+    F(A8,   stock) \
+    F(U32,  ipoQuotationReleaseTime) \
+    F(CHAR, ipoQuotationReleaseQualifier) \
+    F(U32,  ipoPrice)
+
+#define ITCH_FIELDS_A(F) \
+    F(U64,  orderRefNum) \
+    F(CHAR, buySellIndicator) \
+    F(U32,  shares) \
+    F(A8,   stock) \
+    F(U32,  price)
+
+#define ITCH_FIELDS_F(F) \
+    F(U64,  orderRefNum) \
+    F(CHAR, buySellIndicator) \
+    F(U32,  shares) \
+    F(A8,   stock) \
+    F(U32,  price) \
+    F(A4,   attribution)
+
+#define ITCH_FIELDS_E(F) \
+    F(U64,  orderRefNum) \
+    F(U32,  executedShares) \
+    F(U64,  matchNumber)
+
+#define ITCH_FIELDS_C(F) \
+    F(U64,  orderRefNum) \
+    F(U32,  executedShares) \
+    F(U64,  matchNumber) \
+    F(CHAR, printable) \
+    F(U32,  executionPrice)
+
+#define ITCH_FIELDS_X(F) \
+    F(U64,  orderRefNum) \
+    F(U32,  cancelledShares)
+
+#define ITCH_FIELDS_D(F) \
+    F(U64,  orderRefNum)
+
+#define ITCH_FIELDS_U(F) \
+    F(U64,  origOrderRefNum) \
+    F(U64,  newOrderRefNum) \
+    F(U32,  shares) \
+    F(U32,  price)
+
+#define ITCH_FIELDS_P(F) \
+    F(U64,  orderRefNum) \
+    F(CHAR, buySellIndicator) \
+    F(U32,  shares) \
+    F(A8,   stock) \
+    F(U32,  price) \
+    F(U64,  matchNumber)
+
+#define ITCH_FIELDS_Q(F) \
+    F(U64,  shares) \
+    F(A8,   stock) \
+    F(U32,  crossPrice) \
+    F(U64,  matchNumber) \
+    F(CHAR, crossType)
+
+#define ITCH_FIELDS_B(F) \
+    F(U64,  matchNumber)
+
+#define ITCH_FIELDS_I(F) \
+    F(U64,  pairedShares) \
+    F(U64,  imbalanceShares) \
+    F(CHAR, imbalanceDirection) \
+    F(A8,   stock) \
+    F(U32,  farPrice) \
+    F(U32,  nearPrice) \
+    F(U32,  currentReferencePrice) \
+    F(CHAR, crossType) \
+    F(CHAR, priceVariationIndicator)
+
+#define ITCH_FIELDS_N(F) \
+    F(A8,   stock) \
+    F(CHAR, interestFlag)
+
+/* Message structs (ITCHAddOrder, ...), fields in host order */
+#define ITCH_GEN_STRUCT(c, T, Name, len, slot) \
+    typedef struct { ITCHHeader header; ITCH_FIELDS_##T(ITCH_SCHEMA_DECL) } Name;
+ITCH_MESSAGES(ITCH_GEN_STRUCT)
+#undef ITCH_GEN_STRUCT
+
+/* Wire layouts (itch_wire_A, ...): offsetof(itch_wire_A, price) is where
+ * the price field starts, sizeof is the message length */
+#define ITCH_GEN_WIRE(c, T, Name, len, slot)                                               \
+    typedef struct { uint8_t header[ITCH_HEADER_SIZE]; ITCH_FIELDS_##T(ITCH_SCHEMA_WIRE) } itch_wire_##T; \
+    _Static_assert(sizeof(itch_wire_##T) == (len), "ITCH '" #T "' fields do not add up to the spec length");
+ITCH_MESSAGES(ITCH_GEN_WIRE)
+#undef ITCH_GEN_WIRE
+
+/* Handler table. Any slot may be NULL; ctx is passed through untouched. */
+#define ITCH_GEN_SLOT(c, T, Name, len, slot) void (*slot)(const Name *m, void *ctx);
+typedef struct {
+    ITCH_MESSAGES(ITCH_GEN_SLOT)
+    void (*on_unknown)(const uint8_t *msg, size_t len, void *ctx);
+} itch_handlers_t;
+#undef ITCH_GEN_SLOT
+
+/* Handler table that prints every message (the classic parse_itch_message output) */
+extern const itch_handlers_t itch_print_handlers;
+
+/* Decode one framed message and dispatch it.
+ * Returns the message length on success, 0 if len is shorter than the
+ * message type requires, -1 for an unknown type (on_unknown is called). */
+int itch_decode(const uint8_t *msg, size_t len, const itch_handlers_t *h, void *ctx);
+
+/* Print one message to stdout */
+void parse_itch_message(const uint8_t *msg, size_t len);
+
+/* Message length for a type byte, 0 if unknown */
+size_t get_itch_message_length(uint8_t msg_type);
+
+/* The same lengths as a table, for inline use in framing loops */
+extern const uint8_t itch_message_lengths[256];
+
+static inline void itch_decode_header(const uint8_t *msg, ITCHHeader *h) {
+    h->messageType = (char)msg[0];
+    h->stockLocate = itch_read_u16(msg + 1);
+    h->trackingNumber = itch_read_u16(msg + 3);
+    h->timestamp = itch_read_timestamp(msg + 5);
+}
+
+static inline void itch_encode_header(uint8_t *msg, char type, const ITCHHeader *h) {
+    msg[0] = (uint8_t)type;
+    itch_write_u16(msg + 1, h->stockLocate);
+    itch_write_u16(msg + 3, h->trackingNumber);
+    itch_write_timestamp(msg + 5, h->timestamp);
+}
+
+/* Per-type extractors: itch_decode_<type>(msg, &m). Caller guarantees msg
+ * holds a full message of that type (plus the timestamp over-read: a 12-byte
+ * S/W message is read 1 byte past its end). */
+#define ITCH_GEN_DECODE(c, T, Name, len, slot)                        \
+    static inline void itch_decode_##T(const uint8_t *msg, Name *m) { \
+        typedef itch_wire_##T wire_t;                                 \
+        itch_decode_header(msg, &m->header);                          \
+        ITCH_FIELDS_##T(ITCH_SCHEMA_READ)                             \
+    }
+ITCH_MESSAGES(ITCH_GEN_DECODE)
+#undef ITCH_GEN_DECODE
+
+/* Per-type writers: itch_encode_<type>(msg, &m) writes the whole message
+ * (type byte from the schema, not m->header.messageType) and returns its
+ * length. msg needs room for exactly that many bytes. */
+#define ITCH_GEN_ENCODE(c, T, Name, len, slot)                            \
+    static inline size_t itch_encode_##T(uint8_t *msg, const Name *m) {   \
+        typedef itch_wire_##T wire_t;                                     \
+        itch_encode_header(msg, c, &m->header);                           \
+        ITCH_FIELDS_##T(ITCH_SCHEMA_WRITE)                                \
+        return sizeof(wire_t);                                            \
+    }
+ITCH_MESSAGES(ITCH_GEN_ENCODE)
+#undef ITCH_GEN_ENCODE
+
+#endif /* ITCH_PARSER_H */
@@ -0,0 +1,102 @@
+/*
+ * ITCH Read-ahead - see itch_readahead.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "itch_readahead.h"
+
+#define IDLE_NS 200000
+
+static inline uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Bring [off, off + len) into the page cache and the page tables */
+static void populate_range(itch_readahead_t *ra, size_t off, size_t len) {
+    const uint8_t *p = ra->file->data + off;
+#ifdef MADV_POPULATE_READ
+    if (ra->populate) {
+        if (madvise((void *)p, len, MADV_POPULATE_READ) == 0) return;
+        ra->populate = 0;       // pre-5.14 kernel: fall back for the rest of the file
+    }
+#endif
+    readahead(ra->file->fd, (off_t)off, len);
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    uint8_t sum = 0;
+    for (size_t i = 0; i < len; i += page) sum += ((volatile const uint8_t *)p)[i];
+    (void)sum;
+}
+
+static void *readahead_thread(void *arg) {
+    itch_readahead_t *ra = arg;
+    size_t size = ra->file->size;
+    size_t off = ra->start;
+
+    while (!atomic_load_explicit(&ra->stop, memory_order_relaxed) && off < size) {
+        size_t pos = atomic_load_explicit(&ra->pos, memory_order_relaxed);
+        if (off >= pos + ra->depth) {
+            struct timespec ts = { 0, IDLE_NS };
+            nanosleep(&ts, NULL);
+            continue;
+        }
+        size_t len = size - off < ITCH_READAHEAD_CHUNK ? size - off : ITCH_READAHEAD_CHUNK;
+        uint64_t t0 = now_ns();
+        populate_range(ra, off, len);
+        ra->populate_ns += now_ns() - t0;
+        ra->chunks++;
+        off += len;
+        atomic_store_explicit(&ra->ready, off, memory_order_release);
+    }
+    return NULL;
+}
+
+itch_readahead_t *itch_readahead_start(const itch_file_t *file, size_t offset, size_t depth) {
+    itch_readahead_t *ra = aligned_alloc(64, sizeof(itch_readahead_t));
+    if (!ra) return NULL;
+    memset(ra, 0, sizeof(*ra));
+
+    // Chunks start on a page boundary for madvise
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    ra->file = file;
+    ra->depth = depth ? depth : ITCH_READAHEAD_DEFAULT_DEPTH;
+    ra->start = offset / page * page;
+    ra->next_report = offset;
+    ra->populate = 1;
+    atomic_init(&ra->pos, offset);
+    atomic_init(&ra->ready, ra->start);
+    atomic_init(&ra->stop, 0);
+
+    if (pthread_create(&ra->tid, NULL, readahead_thread, ra) != 0) {
+        free(ra);
+        return NULL;
+    }
+    return ra;
+}
+
+void itch_readahead_stop(itch_readahead_t *ra) {
+    if (ra->joined) return;
+    atomic_store_explicit(&ra->stop, 1, memory_order_relaxed);
+    pthread_join(ra->tid, NULL);
+    ra->joined = 1;
+}
+
+void itch_readahead_destroy(itch_readahead_t *ra) {
+    if (!ra) return;
+    itch_readahead_stop(ra);
+    free(ra);
+}
+
+void itch_readahead_print_stats(const itch_readahead_t *ra, FILE *out) {
+    fprintf(out, "Read-ahead: %.0f MB deep, %lu chunks populated in %.1f ms (%s), reader stalls %lu\n",
+            ra->depth / 1048576.0, ra->chunks, ra->populate_ns / 1e6,
+            ra->populate ? "MADV_POPULATE_READ" : "readahead + touch", ra->reader_stalls);
+}
@@ -0,0 +1,80 @@
+/*
+ * ITCH Read-ahead - keeps a mapped file resident ahead of its reader
+ *
+ * A mapped file is read from disk on page faults, so a cold page stalls
+ * whoever touches it first: the replay loop, in the middle of pacing. A
+ * read-ahead thread walks ahead of the reader's position and populates the
+ * mapping one chunk at a time (MADV_POPULATE_READ, or readahead() plus a
+ * touch per page on older kernels). The disk reads and the page table
+ * setup move to that thread; the reader only finds mapped pages.
+ *
+ * The reader reports its position with itch_readahead_advance, which costs
+ * a compare per message and one store per chunk. `depth` bounds how far
+ * ahead of the reader the thread runs, so memory use does not grow with the
+ * file.
+ *
+ * Usage:
+ *   itch_readahead_t *ra = itch_readahead_start(&file, seek, 64 << 20);
+ *   while (itch_cursor_next(&cur, &msg, &len)) {
+ *       itch_readahead_advance(ra, (size_t)(cur.pos - file.data));
+ *       ...
+ *   }
+ *   itch_readahead_stop(ra);
+ *   itch_readahead_print_stats(ra, stdout);
+ *   itch_readahead_destroy(ra);
+ */
+
+#ifndef ITCH_READAHEAD_H
+#define ITCH_READAHEAD_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "itch_file.h"
+
+#define ITCH_READAHEAD_CHUNK (1u << 20)
+#define ITCH_READAHEAD_DEFAULT_DEPTH (64u << 20)
+
+typedef struct {
+    // Reader side
+    size_t next_report;         // position of the next store to pos
+    uint64_t reader_stalls;     // chunks the reader reached before they were populated
+
+    // Shared: pos written by the reader, ready by the thread
+    _Alignas(64) _Atomic size_t pos;
+    _Alignas(64) _Atomic size_t ready;
+    _Atomic int stop;
+
+    // Thread side
+    _Alignas(64) const itch_file_t *file;
+    size_t depth;
+    size_t start;
+    uint64_t chunks;
+    uint64_t populate_ns;
+    int populate;               // 1 = MADV_POPULATE_READ works here
+    pthread_t tid;
+    int joined;
+} itch_readahead_t;
+
+/* Start populating file from offset with up to depth bytes ahead of the
+ * reader (0 = ITCH_READAHEAD_DEFAULT_DEPTH). NULL on failure. */
+itch_readahead_t *itch_readahead_start(const itch_file_t *file, size_t offset, size_t depth);
+
+/* Stop the thread (stats are final after this); destroy also frees, and
+ * ignores NULL */
+void itch_readahead_stop(itch_readahead_t *ra);
+void itch_readahead_destroy(itch_readahead_t *ra);
+
+void itch_readahead_print_stats(const itch_readahead_t *ra, FILE *out);
+
+/* Reader's current file offset */
+static inline void itch_readahead_advance(itch_readahead_t *ra, size_t pos) {
+    if (pos < ra->next_report) return;
+    ra->next_report = pos + ITCH_READAHEAD_CHUNK;
+    atomic_store_explicit(&ra->pos, pos, memory_order_relaxed);
+    if (pos >= atomic_load_explicit(&ra->ready, memory_order_relaxed)) ra->reader_stalls++;
+}
+
+#endif /* ITCH_READAHEAD_H */
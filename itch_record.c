@@ -0,0 +1,176 @@
+/*
+ * ITCH Record - merge several feeds into one pre-framed recording
+ *
+ * Runs the k-way merge (itch_merge.h) over ITCH and ITTO files once and
+ * writes the interleaved session to a merged recording, so the replay
+ * server can replay it again and again without framing or merging the
+ * feeds: one length load per message.
+ *
+ * Usage:
+ *   ./itch_record [-f framing] [-P protocol] [-t start] [-e end] -o <recording> <feed_file>...
+ *   ./itch_record -i <recording>
+ *
+ *   -f  framing of every feed file: raw (default), binaryfile, soupbintcp, moldudp64
+ *   -P  messages in the feed files: itch, itto or auto (default; decided
+ *       per file from its first messages)
+ *   -t  keep messages from feed time HH:MM[:SS[.fraction]]
+ *   -e  keep messages up to feed time HH:MM[:SS[.fraction]]
+ *   -o  recording to write
+ *   -i  describe an existing recording
+ *
+ * Up to 16 feeds; ties in feed time go to the feed named first.
+ *
+ * Example:
+ *   ./itch_record -o data/cross.rec data/01302019.NASDAQ_ITCH50 data/01302019.NASDAQ_ITTO40
+ *   ./itch_replay_server -o binaryfile data/cross.rec 9999 1.0
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include "itch_file.h"
+#include "itch_framing.h"
+#include "itch_idx.h"
+#include "itch_merge.h"
+
+#define DETECT_BYTES 65536
+
+static double elapsed_since(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static void print_time(const char *label, uint64_t ts) {
+    printf("%s%02u:%02u:%02u.%09u", label, (unsigned)(ts / 3600000000000ULL), (unsigned)(ts / 60000000000ULL % 60),
+           (unsigned)(ts / 1000000000ULL % 60), (unsigned)(ts % 1000000000ULL));
+}
+
+static void describe(const itch_merged_header_t *h) {
+    printf("%lu messages from %u feeds (", h->messages, h->feeds);
+    for (uint32_t i = 0; i < h->feeds; i++) {
+        printf("%s%s", i ? ", " : "", itch_protocol_name((itch_protocol_t)h->protocols[i]));
+    }
+    printf("), %.2f MB", h->data_size / 1048576.0);
+    if (h->messages) {
+        print_time(", ", h->first_ts);
+        print_time(" - ", h->last_ts);
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[]) {
+    itch_framing_t framing = FRAMING_RAW;
+    itch_protocol_t protocol = PROTOCOL_ITCH;
+    int detect = 1;
+    uint64_t start_ns = 0, end_ns = UINT64_MAX;
+    const char *out_path = NULL;
+    int info = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:P:t:e:o:i")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (itch_framing_parse(optarg, &framing) < 0) {
+                    fprintf(stderr, "Unknown framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                detect = strcmp(optarg, "auto") == 0;
+                if (!detect && itch_protocol_parse(optarg, &protocol) < 0) {
+                    fprintf(stderr, "Unknown protocol: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+            case 'e':
+                if (itch_parse_time(optarg, opt == 't' ? &start_ns : &end_ns) < 0) {
+                    fprintf(stderr, "Invalid time (want HH:MM[:SS[.fraction]]): %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o': out_path = optarg; break;
+            case 'i': info = 1; break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    if (optind >= argc || (!info && !out_path)) {
+        fprintf(stderr, "Usage: %s [-f framing] [-P protocol] [-t start] [-e end] -o <recording> <feed_file>...\n"
+                        "       %s -i <recording>\n", argv[0], argv[0]);
+        return 1;
+    }
+
+    if (info) {
+        itch_file_t rec;
+        if (itch_file_open(&rec, argv[optind]) < 0) {
+            fprintf(stderr, "Failed to map file: %s (%s)\n", argv[optind], strerror(errno));
+            return 1;
+        }
+        const itch_merged_header_t *h = itch_merged_header(rec.data, rec.size);
+        if (h) describe(h);
+        else fprintf(stderr, "%s is not a merged recording (or is incomplete)\n", argv[optind]);
+        itch_file_close(&rec);
+        return h ? 0 : 1;
+    }
+
+    itch_file_t files[ITCH_MERGE_MAX_FEEDS];
+
+    int nfeeds = argc - optind;
+    if (nfeeds > ITCH_MERGE_MAX_FEEDS) {
+        fprintf(stderr, "At most %d feeds\n", ITCH_MERGE_MAX_FEEDS);
+        return 1;
+    }
+
+    itch_merge_t *m = malloc(sizeof(*m));
+    if (!m) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    itch_merge_init(m);
+    int opened = 0;
+    int rc = 0;
+    for (int i = 0; i < nfeeds; i++) {
+        const char *path = argv[optind + i];
+        if (itch_file_open(&files[i], path) < 0) {
+            fprintf(stderr, "Failed to map file: %s (%s)\n", path, strerror(errno));
+            rc = -1;
+            break;
+        }
+        opened++;
+        itch_protocol_t p = detect ? itch_protocol_detect(files[i].data, files[i].size < DETECT_BYTES ?
+                                                          files[i].size : DETECT_BYTES, framing) : protocol;
+        itch_merge_add(m, files[i].data, files[i].size, framing, p);
+        printf("Feed %d: %s (%s)\n", i, path, itch_protocol_name(p));
+    }
+
+    if (rc == 0) {
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        long n = itch_merge_record(m, out_path, start_ns, end_ns);
+        double elapsed = elapsed_since(&start);
+        if (n < 0) {
+            rc = -1;
+        } else {
+            itch_merge_print_stats(m, stdout);
+            printf("Wrote %ld messages -> %s in %.3f seconds\n", n, out_path, elapsed);
+        }
+    }
+
+    itch_file_t rec;
+    if (rc == 0 && itch_file_open(&rec, out_path) == 0) {
+        const itch_merged_header_t *h = itch_merged_header(rec.data, rec.size);
+        if (h) describe(h);
+        itch_file_close(&rec);
+    }
+    for (int i = 0; i < opened; i++) itch_file_close(&files[i]);
+    free(m);
+    return rc < 0 ? 1 : 0;
+}
@@ -1,19 +1,103 @@
 /*
- * ITCH Replay Server - High-performance TCP server for streaming historical ITCH data
+ * ITCH Replay Server - High-performance TCP / multicast server for streaming historical ITCH data
  * 
  * Features:
- * - Timestamp-accurate replay with configurable speed multiplier
- * - Support for gzip-compressed ITCH files
- * - Multiple concurrent client connections
- * - Zero-copy message streaming where possible
+ * - Timestamp-accurate replay with configurable speed multiplier: messages go
+ *   out at absolute deadlines (sleep, then spin the last microseconds) so
+ *   timing never drifts, with a send skew histogram at the end
+ * - ITCH 5.0 and ITTO 4.0 (options) files, told apart automatically
+ * - Gzip-compressed ITCH files are inflated ahead of the replay on worker
+ *   threads; BGZF files (bgzip) inflate in parallel and seek with the index
+ * - Hundreds of concurrent clients: an epoll IO thread fans out one shared
+ *   ring with non-blocking writev, so a slow client never stalls the others
+ * - Raw files are memory-mapped and streamed in place (zero-copy), with a
+ *   read-ahead thread faulting the mapping in ahead of the replay
+ * - Start time / end time / symbol filters seek through an itch_index sidecar;
+ *   without one, symbols are filtered while scanning by a stockLocate bitmap
+ *   bound from the directory (R) messages
+ * - MoldUDP64 multicast output with a retransmission server, for any number
+ *   of consumers at constant cost
+ * - Shared-memory output for consumers on the same host: one broadcast ring
+ *   in /dev/shm that readers decode in place, with no socket in between
+ * - Mid-day starts from an order book snapshot (itch_snapshot): the server
+ *   resumes at the snapshot's file offset and sends the book as messages,
+ *   so clients have a full book without the server replaying from the open
+ * - Per-client subscriptions over TCP: a client that sends a SUBSCRIBE line
+ *   on connect gets only its symbols / locates and message types, filtered
+ *   on the IO thread, instead of the whole feed
+ * - Multi-feed sessions: ITCH and ITTO files merged by feed time (a heap
+ *   over the feeds) under one pacing clock, or replayed from a merged
+ *   recording (itch_record) that skips the merge altogether
  * 
  * Usage:
- *   ./itch_replay_server <itch_file.bin> [port] [speed_multiplier]
+ *   ./itch_replay_server [-f framing] [-o framing] [-P protocol] [-t start] [-e end] [-s SYMBOLS] [-i index]
+ *                        [-c max_clients] [-p policy] [-r ring_mb] [-m mode] [-n bytes] [-u usec]
+ *                        [-w spin_us] [-a cpu] [-z threads] [-d mb] [-T] [-W ms] [-g group:port [-R port] [-S session] [-I iface]]
+ *                        [-M name] [-k snapshots [-K]] [-X feed_file]... <itch_file.bin> [port] [speed_multiplier]
+ * 
+ *   -f  input file framing: raw (default), binaryfile, soupbintcp, moldudp64
+ *   -o  framing sent to clients: raw (default), binaryfile, soupbintcp
+ *       (moldudp64 is the multicast output, -g)
+ *   -P  messages in the file: itch (5.0), itto (4.0 options) or auto
+ *       (default; decided from the first messages)
+ *   -t  start at feed time HH:MM[:SS[.fraction]]
+ *   -e  stop after feed time HH:MM[:SS[.fraction]]
+ *   -s  only replay these comma-separated symbols (plus system messages)
+ *   -i  index file (default <itch_file>.idx, built with itch_index); for a
+ *       .gz file, build it from the uncompressed file
+ *   -k  snapshot file (built with itch_snapshot): with -t, resume at the last
+ *       snapshot at or before the start time instead of the index bucket.
+ *       The snapshot goes out first as R, H and one A per live order, then
+ *       the messages from its offset up to -t unpaced, then the replay.
+ *       Raw (uncompressed) ITCH files only.
+ *   -K  with -k: do not send the snapshot; clients load it themselves
+ *       (itch_client -k file@time)
+ *   -c  maximum connected clients (default 1024)
+ *   -p  slow client policy: drop (default), disconnect, backpressure
+ *   -r  fan-out ring size in MB (default 64); a client more than half a
+ *       ring behind is a slow client. Also sizes the -M ring.
+ *   -m  send mode: latency (default; TCP_NODELAY, one flush per timestamp)
+ *       or throughput (Nagle + MSG_MORE, flush every -n bytes or -u usec)
+ *   -n  most bytes coalesced into one flush (default 65536)
+ *   -u  throughput mode: longest a message waits for its flush (default 100)
+ *   -w  spin this long before each deadline instead of sleeping (default 50)
+ *   -a  pin the replay thread to this CPU
+ *   -d  raw files: keep this many MB populated ahead of the replay on a
+ *       read-ahead thread (default 64, 0 = off)
+ *   -z  gzip input: inflate threads (default one per CPU but one, up to 8);
+ *       only BGZF files inflate in parallel
+ *   -T  stamp each message's timestamp with its send time (CLOCK_REALTIME ns
+ *       since UTC midnight) instead of its feed time, for client -T latency
+ *   -W  TCP: wait this long (ms, default 100, 0 = off) for a new client's
+ *       subscription line before sending it the whole feed:
+ *         SUBSCRIBE [symbols=AAPL,MSFT] [locates=1,5-9] [types=PQEC]
+ *       Without symbols or locates every stock is sent, without types every
+ *       message type; system messages (locate 0) always pass. ITTO feeds,
+ *       and the ITTO messages of a merged feed, filter by type only.
+ *   -g  publish MoldUDP64 to this multicast group instead of serving TCP
+ *       clients; -m/-n/-u still decide when a packet is sent
+ *   -R  retransmission request port (default group port + 1)
+ *   -S  MoldUDP64 session name (default ITCHREPLAY)
+ *   -I  local interface address for multicast
+ *   -M  publish into the shared-memory ring /dev/shm/<name> instead of
+ *       serving TCP clients (itch_client -M). The publisher never waits:
+ *       a reader a ring behind is overrun. -m/-n/-u decide when messages
+ *       become visible; -o does not apply (records carry their length).
+ *   -X  merge another feed file into the replay by feed time (repeatable,
+ *       up to 15). Every file uses -f; each one's protocol is detected
+ *       unless -P is given. Raw, uncompressed files; no -s, -i or -k.
+ *       A merged recording (itch_record) given as <itch_file> is replayed
+ *       as recorded, with -t/-e only.
+ *       ITCH mixed with ITTO needs a length-carrying output (-o binaryfile
+ *       or soupbintcp, -g or -M): the two message sets share type letters.
  * 
  * Example:
- *   ./itch_replay_server data/01302019.NASDAQ_ITCH50.gz 9999 1.0
+ *   ./itch_replay_server -f binaryfile data/01302019.NASDAQ_ITCH50.gz 9999 1.0
+ *   ./itch_replay_server -t 09:30 -e 10:00 -s AAPL data/01302019.NASDAQ_ITCH50 9999 1.0
+ *   ./itch_replay_server -o binaryfile -X data/01302019.NASDAQ_ITTO40 data/01302019.NASDAQ_ITCH50 9999 1.0
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -26,21 +110,34 @@
 #include <arpa/inet.h>
 #include <time.h>
 #include <pthread.h>
-#include <zlib.h>
+#include "itch_parser.h"
+#include "itch_file.h"
+#include "itch_readahead.h"
+#include "itch_framing.h"
+#include "itch_stream.h"
+#include "itch_gz.h"
+#include "itch_idx.h"
+#include "itch_directory.h"
+#include "itch_snap.h"
+#include "itch_merge.h"
+#include "fanout.h"
+#include "pacer.h"
+#include "mold_pub.h"
+#include "mold.h"
+#include "shm_ring.h"
+#include "latency.h"
 
 #define DEFAULT_PORT 9999
 #define DEFAULT_SPEED 1.0
-#define BUFFER_SIZE (64 * 1024)  // 64KB buffer
-#define MAX_CLIENTS 32
-
-/* ITCH message length lookup table */
-static const uint8_t ITCH_MSG_LENGTHS[256] = {
-    ['S'] = 12, ['R'] = 39, ['H'] = 25, ['Y'] = 20,
-    ['L'] = 26, ['V'] = 35, ['W'] = 12, ['K'] = 28,
-    ['A'] = 36, ['F'] = 40, ['E'] = 31, ['C'] = 36,
-    ['X'] = 23, ['D'] = 19, ['U'] = 35, ['P'] = 44,
-    ['Q'] = 40, ['B'] = 19, ['I'] = 50, ['N'] = 20,
-};
+#define DEFAULT_MAX_CLIENTS 1024
+#define DEFAULT_RING_MB 64
+#define LISTEN_BACKLOG 1024
+#define DRAIN_TIMEOUT_MS 2000
+#define DEFAULT_FLUSH_BYTES (64 * 1024)
+#define DEFAULT_FLUSH_US 100
+#define MAX_FILTER_SYMBOLS 16
+#define MAX_MESSAGE_SIZE 64     // longest ITCH (50) or ITTO (57) message, rounded up
+#define DEFAULT_HANDSHAKE_MS 100
 
 /* Server configuration */
 typedef struct {
@@ -48,19 +145,61 @@ typedef struct {
     int port;
     double speed_multiplier;
     int is_gzip;
+    itch_framing_t input_framing;
+    itch_framing_t output_framing;
+    itch_protocol_t protocol;
+    int detect_protocol;
+    const char *index_path;
+    const char *symbols;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int max_clients;
+    fanout_policy_t policy;
+    size_t ring_mb;
+    fanout_mode_t mode;
+    size_t flush_bytes;
+    uint64_t flush_us;
+    uint64_t spin_us;
+    int cpu;                    // -1 = no pinning
+    int gz_threads;             // 0 = default
+    size_t read_ahead_mb;       // 0 = off
+    int stamp_send_time;        // -T
+    char mcast_group[64];       // empty = TCP output
+    int mcast_port;
+    int retrans_port;
+    const char *session;
+    const char *mcast_iface;
+    const char *shm_name;       // NULL = no shared-memory output
+    int handshake_ms;           // -W
+    const char *snapshot_path;  // -k, NULL = none
+    int send_snapshot;          // not -K
+    const char *merge_files[ITCH_MERGE_MAX_FEEDS - 1];   // -X, merged with filename
+    int merge_count;
 } server_config_t;
 
-/* Client connection state */
-typedef struct {
-    int socket_fd;
-    struct sockaddr_in address;
-    int active;
-} client_t;
-
 /* Global state */
-static client_t clients[MAX_CLIENTS];
-static pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
 static volatile int server_running = 1;
+static itch_framing_t output_framing = FRAMING_RAW;
+static fanout_t *fanout;         // TCP output
+static mold_pub_t *mold;         // or multicast output
+static shm_ring_pub_t *shm;      // or shared-memory output
+static size_t shm_flush_bytes;   // pending bytes that force a commit, like fanout's flush_bytes
+static int keyed_feed;           // some feed is ITCH: symbol and locate subscriptions work
+
+/* A TCP subscriber's symbols not yet bound to a locate. sub_dir names the
+ * locates from the R messages published so far; the replay thread binds
+ * each new R to the subscribers that want it, the IO thread binds the known
+ * ones when a request arrives, both under sub_lock. */
+typedef struct {
+    fanout_filter_t *filter;    // NULL = no subscription
+    uint64_t *wanted;           // sorted itch_symbol_keys
+    size_t nwanted;
+} subscriber_t;
+
+static subscriber_t *subscribers;   // by fanout client slot
+static int subscriber_slots;
+static itch_directory_t *sub_dir;
+static pthread_mutex_t sub_lock = PTHREAD_MUTEX_INITIALIZER;
 
 /* Read big-endian uint64 from 6 bytes (timestamp) */
 static inline uint64_t read_timestamp(const uint8_t *b) {
@@ -70,318 +209,1195 @@ static inline uint64_t read_timestamp(const uint8_t *b) {
     return tmp >> 16;
 }
 
-/* Get message length for ITCH message type */
-static inline size_t get_message_length(uint8_t msg_type) {
-    return ITCH_MSG_LENGTHS[msg_type];
+/* Name the locate of a directory message and hand it to every subscriber
+ * waiting for its symbol, before the message itself is published */
+static void bind_subscribers(const uint8_t *msg, size_t len) {
+    pthread_mutex_lock(&sub_lock);
+    itch_directory_update(sub_dir, msg, len);
+    if (len >= itch_message_lengths['R']) {
+        uint16_t locate = itch_read_u16(msg + 1);
+        uint64_t key = itch_stock_key((const char *)msg + 11);
+        for (int i = 0; i < subscriber_slots; i++) {
+            subscriber_t *s = &subscribers[i];
+            if (s->filter && itch_symbol_key_find(s->wanted, s->nwanted, key)) {
+                fanout_filter_set_key(s->filter, locate);
+            }
+        }
+    }
+    pthread_mutex_unlock(&sub_lock);
 }
 
-/* Nanosleep helper */
-static void nsleep(uint64_t nanoseconds) {
-    struct timespec ts;
-    ts.tv_sec = nanoseconds / 1000000000ULL;
-    ts.tv_nsec = nanoseconds % 1000000000ULL;
-    nanosleep(&ts, NULL);
+/* Parse "1,5-9" into key bits. Returns 0, or -1 on a bad list. */
+static int parse_locates(const char *list, fanout_filter_t *filter) {
+    const char *p = list;
+    while (*p) {
+        char *end;
+        unsigned long lo = strtoul(p, &end, 10), hi = lo;
+        if (end == p) return -1;
+        if (*end == '-') {
+            p = end + 1;
+            hi = strtoul(p, &end, 10);
+            if (end == p) return -1;
+        }
+        if (lo > hi || hi >= FANOUT_KEYS) return -1;
+        for (unsigned long k = lo; k <= hi; k++) fanout_filter_set_key(filter, (uint16_t)k);
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return -1;
+    }
+    return 0;
 }
 
-/* Broadcast message to all connected clients */
-static ssize_t broadcast_message(const uint8_t *msg, size_t len) {
-    pthread_mutex_lock(&clients_mutex);
+/* fanout on_request: SUBSCRIBE [symbols=A,B] [locates=1,5-9] [types=PQEC] */
+static int on_subscribe(void *ctx, int client, const char *line, fanout_filter_t *filter) {
+    (void)ctx;
+    char buf[16384];
+    snprintf(buf, sizeof(buf), "%s", line);
+    char *save;
+    char *word = strtok_r(buf, " \t", &save);
+    if (!word || strcmp(word, "SUBSCRIBE") != 0 || client >= subscriber_slots) {
+        printf("Client %d: not a subscription: %.64s\n", client, line);
+        return -1;
+    }
+
+    const char *symbols = NULL, *locates = NULL, *types = NULL;
+    while ((word = strtok_r(NULL, " \t", &save))) {
+        if (strncmp(word, "symbols=", 8) == 0) symbols = word + 8;
+        else if (strncmp(word, "locates=", 8) == 0) locates = word + 8;
+        else if (strncmp(word, "types=", 6) == 0) types = word + 6;
+        else {
+            printf("Client %d: unknown subscription field: %.64s\n", client, word);
+            return -1;
+        }
+    }
+    if ((symbols || locates) && !keyed_feed) {
+        printf("Client %d: symbol and locate subscriptions need an ITCH feed\n", client);
+        return -1;
+    }
+
+    if (types) {
+        for (const char *t = types; *t; t++) filter->types[(uint8_t)*t >> 6] |= 1ULL << ((uint8_t)*t & 63);
+    } else {
+        memset(filter->types, 0xff, sizeof(filter->types));
+    }
+
+    uint64_t *wanted = NULL;
+    int nwanted = 0;
+    if (symbols && (nwanted = itch_symbol_keys(symbols, &wanted)) < 0) return -1;
+    if (locates && parse_locates(locates, filter) < 0) {
+        printf("Client %d: bad locate list: %.64s\n", client, locates);
+        free(wanted);
+        return -1;
+    }
+    if (!symbols && !locates) {
+        for (uint32_t k = 0; k < FANOUT_KEYS; k++) fanout_filter_set_key(filter, (uint16_t)k);
+    } else {
+        fanout_filter_set_key(filter, 0);
+    }
+
+    // Bind the symbols named so far; bind_subscribers does the rest
+    pthread_mutex_lock(&sub_lock);
+    for (uint32_t locate = 1; nwanted > 0 && locate < ITCH_DIRECTORY_LOCATES; locate++) {
+        const itch_symbol_t *s = itch_directory_get(sub_dir, (uint16_t)locate);
+        if (s->symbol[0] && itch_symbol_key_find(wanted, (size_t)nwanted, itch_stock_key(s->stock))) {
+            fanout_filter_set_key(filter, (uint16_t)locate);
+        }
+    }
+    subscribers[client] = (subscriber_t){ filter, wanted, (size_t)nwanted };
+    pthread_mutex_unlock(&sub_lock);
+
+    printf("Client %d subscribed:%s%s%s%s%s%s\n", client,
+           symbols ? " symbols=" : "", symbols ? symbols : "",
+           locates ? " locates=" : "", locates ? locates : "",
+           types ? " types=" : "", types ? types : "");
+    return 0;
+}
+
+/* fanout on_close: forget a subscriber before its filter is freed */
+static void on_unsubscribe(void *ctx, int client) {
+    (void)ctx;
+    if (client >= subscriber_slots) return;
+    pthread_mutex_lock(&sub_lock);
+    free(subscribers[client].wanted);
+    subscribers[client] = (subscriber_t){ 0 };
+    pthread_mutex_unlock(&sub_lock);
+}
+
+/* Broadcast message to all connected clients: one copy into the fanout ring,
+ * the IO thread does the sends. Multicast packs it into the current packet;
+ * shared memory copies it straight into the readers' ring. */
+static ssize_t broadcast_message(const uint8_t *msg, size_t len, int keyed) {
+    if (mold) return mold_pub_message(mold, msg, len) < 0 ? -1 : (ssize_t)(len + 2);
+    if (shm) {
+        memcpy(shm_ring_reserve(shm, len), msg, len);
+        if (shm_ring_pending(shm) >= shm_flush_bytes) shm_ring_commit(shm);
+        return (ssize_t)(SHM_RING_RECORD_HEADER + len);
+    }
     
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (!clients[i].active) continue;
-        
-        ssize_t sent = send(clients[i].socket_fd, msg, len, MSG_NOSIGNAL);
-        if (sent < 0) {
-            if (errno == EPIPE || errno == ECONNRESET) {
-                printf("Client %d disconnected\n", i);
-                close(clients[i].socket_fd);
-                clients[i].active = 0;
-            } else {
-                perror("send");
-            }
+    uint8_t prefix[3];
+    size_t prefix_len = itch_framing_prefix_size(output_framing);
+    if (prefix_len) itch_framing_write_prefix(output_framing, prefix, len);
+    
+    uint16_t key = keyed && len >= 3 ? itch_read_u16(msg + 1) : 0;
+    if (msg[0] == 'R' && keyed && sub_dir) bind_subscribers(msg, len);
+    if (fanout_publish(fanout, prefix, prefix_len, msg, len, FANOUT_TAG(msg[0], key)) < 0) return -1;
+    return (ssize_t)(prefix_len + len);
+}
+
+/* Per-replay pacing and counters */
+typedef struct {
+    double speed_multiplier;
+    itch_framing_t framing;
+    itch_protocol_t protocol;
+    int detect;                 // pick the protocol from the first bytes
+    size_t ts_offset;           // timestamp offset for the protocol
+    int keyed;                  // ITCH message: tag it with its stockLocate
+    const char *index_path;     // NULL = no seek index
+    const char *symbols;        // NULL = all symbols
+    itch_directory_t *dir;      // symbol filter while scanning (no index), NULL = off
+    uint64_t filtered;          // messages the directory filter dropped
+    const char *snapshot_path;  // resume from a snapshot, NULL = off
+    int send_snapshot;
+    int catch_up;               // send the messages before start_ns too, unpaced
+    int gz_threads;             // inflate threads for gzip input, 0 = default
+    size_t read_ahead;          // raw files: bytes populated ahead of the replay, 0 = off
+    uint64_t start_ns;
+    uint64_t end_ns;
+    int stamp;                  // send times replace feed times on the wire
+    fanout_mode_t mode;
+    uint64_t flush_ns;          // throughput mode: flush age limit
+    uint64_t pending_since;     // when the oldest unflushed message was published
+    pacer_t pacer;
+    uint64_t prev_timestamp;
+    uint64_t messages_sent;
+    uint64_t total_bytes;
+    uint64_t progress_ns;       // last progress line, for the syscall rate
+    uint64_t progress_syscalls;
+} replay_state_t;
+
+/* Hand the coalesced messages to the output */
+static void output_flush(void) {
+    if (mold) mold_pub_flush(mold);
+    else if (shm) shm_ring_commit(shm);
+    else fanout_flush(fanout);
+}
+
+static size_t output_pending(void) {
+    if (shm) return shm_ring_pending(shm);
+    return mold ? mold_pub_pending(mold) : fanout_pending(fanout);
+}
+
+/* Sender syscalls so far: IO thread writes plus publisher wakeups over TCP,
+ * datagrams over multicast, none over shared memory */
+static uint64_t output_syscalls(void) {
+    if (shm) return 0;
+    if (mold) {
+        mold_pub_stats_t ms;
+        mold_pub_get_stats(mold, &ms);
+        return ms.packets + ms.heartbeats + ms.retrans_packets;
+    }
+    fanout_stats_t fs;
+    fanout_get_stats(fanout, &fs);
+    return fs.writev_calls + fs.wakeups;
+}
+
+/* Pace and broadcast one framed message. Messages are coalesced: a new
+ * timestamp flushes the previous group (latency mode) or a group older than
+ * flush_ns (throughput mode), and nothing is left unflushed across a sleep. */
+static void replay_message(replay_state_t *st, const uint8_t *msg, size_t msg_len) {
+    // Parse timestamp (6 bytes at the protocol's offset) if message has header
+    uint64_t current_timestamp = 0;
+    int has_header = msg_len >= st->ts_offset + 6;
+    if (has_header) {
+        current_timestamp = read_timestamp(msg + st->ts_offset);
+    }
+    
+    if (current_timestamp != st->prev_timestamp && output_pending() &&
+        (st->mode == FANOUT_LATENCY || pacer_now() - st->pending_since >= st->flush_ns)) {
+        output_flush();
+    }
+    
+    // Wait for this message's deadline (feed gaps are capped at 1 second).
+    // Catch-up from a snapshot goes out unpaced until the start time.
+    if (st->speed_multiplier > 0 && has_header && current_timestamp >= st->start_ns) {
+        uint64_t deadline = pacer_deadline(&st->pacer, current_timestamp);
+        uint64_t now = pacer_now();
+        if (now < deadline) {
+            output_flush();
+            now = pacer_wait(&st->pacer, deadline);
         }
+        pacer_record(&st->pacer, deadline, now);
+    }
+    
+    // Broadcast message to all clients. With -T the copy carries its send
+    // time; pacing and flushing above still follow the feed time.
+    if (st->mode == FANOUT_THROUGHPUT && output_pending() == 0) st->pending_since = pacer_now();
+    uint8_t stamped[MAX_MESSAGE_SIZE];
+    if (st->stamp && has_header && msg_len <= sizeof(stamped)) {
+        memcpy(stamped, msg, msg_len);
+        itch_write_timestamp(stamped + st->ts_offset, latency_wall_ns());
+        msg = stamped;
     }
+    broadcast_message(msg, msg_len, st->keyed);
     
-    pthread_mutex_unlock(&clients_mutex);
-    return len;
+    st->messages_sent++;
+    st->total_bytes += msg_len;
+    st->prev_timestamp = current_timestamp;
+    
+    // Progress update every 100k messages
+    if (st->messages_sent % 100000 == 0) {
+        uint64_t now = pacer_now();
+        uint64_t syscalls = output_syscalls();
+        double rate = now > st->progress_ns ? (syscalls - st->progress_syscalls) * 1e9 / (now - st->progress_ns) : 0;
+        printf("Sent %lu messages (%.2f MB), %.0f syscalls/sec\n", st->messages_sent,
+               st->total_bytes / 1048576.0, rate);
+        st->progress_ns = now;
+        st->progress_syscalls = syscalls;
+    }
 }
 
-/* Replay ITCH file with timestamp-accurate streaming */
-static int replay_itch_file(const char *filename, double speed_multiplier, int is_gzip) {
-    void *fp = NULL;
-    uint8_t buffer[BUFFER_SIZE];
-    size_t buffer_used = 0;
-    uint64_t prev_timestamp = 0;
-    uint64_t messages_sent = 0;
-    uint64_t total_bytes = 0;
-    
-    // Open file (gzip or raw)
-    if (is_gzip) {
-        fp = gzopen(filename, "rb");
-        if (!fp) {
-            fprintf(stderr, "Failed to open gzip file: %s\n", filename);
+/* Scanning symbol filter: every message goes through the directory, in
+ * file order and before the time filter, so symbols bind to their locates
+ * as the R messages go by. Returns 1 if the message is filtered out. */
+static inline int symbol_filtered(replay_state_t *st, const uint8_t *msg, size_t msg_len) {
+    if (!st->dir) return 0;
+    itch_directory_update(st->dir, msg, msg_len);
+    if (msg_len < 3 || itch_directory_selected(st->dir, itch_read_u16(msg + 1))) return 0;
+    st->filtered++;
+    return 1;
+}
+
+/* Replay a snapshot as messages: its R and H messages, then one A per live
+ * order stamped with the snapshot time, so a client builds the book from
+ * the feed alone */
+static int replay_snapshot(replay_state_t *st, const itch_snap_t *snap, const itch_snap_entry_t *e) {
+    itch_directory_t *names = itch_directory_create();   // stock fields for the A messages
+    if (!names) {
+        fprintf(stderr, "Failed to allocate symbol directory\n");
+        return -1;
+    }
+    const uint8_t *p = itch_snap_directory(snap, e);
+    const uint8_t *end = p + e->directory_bytes;
+    while (server_running && p < end) {
+        size_t n = itch_message_lengths[*p];
+        if (n == 0 || n > (size_t)(end - p)) break;
+        itch_directory_update(names, p, n);
+        if (!symbol_filtered(st, p, n)) replay_message(st, p, n);
+        p += n;
+    }
+
+    const order_book_order_t *orders = itch_snap_orders(snap, e);
+    for (uint64_t i = 0; server_running && i < e->orders; i++) {
+        const order_book_order_t *o = &orders[i];
+        ITCHAddOrder m;
+        memset(&m, 0, sizeof(m));
+        m.header.stockLocate = o->stockLocate;
+        m.header.timestamp = e->timestamp;
+        m.orderRefNum = o->orderRefNum;
+        m.buySellIndicator = o->side;
+        m.shares = o->shares;
+        const itch_symbol_t *sym = itch_directory_get(names, o->stockLocate);
+        if (sym->symbol[0]) memcpy(m.stock, sym->stock, sizeof(m.stock));
+        else memset(m.stock, ' ', sizeof(m.stock));
+        m.price = o->price;
+
+        uint8_t msg[MAX_MESSAGE_SIZE];
+        size_t n = itch_encode_A(msg, &m);
+        if (!symbol_filtered(st, msg, n)) replay_message(st, msg, n);
+    }
+    itch_directory_destroy(names);
+    return 0;
+}
+
+/* With -k: where to start reading, after sending the snapshot unless -K.
+ * Returns the offset, or -1 on error. */
+static int64_t resume_from_snapshot(const itch_file_t *file, replay_state_t *st) {
+    itch_snap_t snap;
+    if (itch_snap_open(&snap, st->snapshot_path) < 0) {
+        fprintf(stderr, "Failed to open snapshots: %s (%s)\n", st->snapshot_path, strerror(errno));
+        return -1;
+    }
+    if (snap.header->source_size != file->size || snap.header->framing != (uint32_t)st->framing) {
+        fprintf(stderr, "Snapshots %s do not match the file (stale, or built with another framing)\n",
+                st->snapshot_path);
+        itch_snap_close(&snap);
+        return -1;
+    }
+
+    // Everything from the offset on is sent, so clients' books stay whole
+    st->catch_up = 1;
+    const itch_snap_entry_t *e = itch_snap_find(&snap, st->start_ns);
+    if (!e) {
+        printf("No snapshot at or before the start time: replaying from the open, unpaced until then\n");
+        itch_snap_close(&snap);
+        return 0;
+    }
+    uint64_t ts = e->timestamp;
+    printf("Snapshot %02u:%02u:%02u.%09u: %lu orders, resuming at offset %lu (%lu messages skipped)%s\n",
+           (unsigned)(ts / 3600000000000ULL), (unsigned)(ts / 60000000000ULL % 60),
+           (unsigned)(ts / 1000000000ULL % 60), (unsigned)(ts % 1000000000ULL),
+           e->orders, e->file_offset, e->messages, st->send_snapshot ? "" : ", not sent (-K)");
+    int rc = st->send_snapshot ? replay_snapshot(st, &snap, e) : 0;
+    int64_t offset = (int64_t)e->file_offset;
+    itch_snap_close(&snap);
+    return rc < 0 ? -1 : offset;
+}
+
+/* One stockLocate's offsets from the index, consumed in file order */
+typedef struct {
+    const uint64_t *offsets;
+    size_t count;
+    size_t next;
+} locate_stream_t;
+
+/* Replay only the selected symbols by merging their per-locate offset lists.
+ * Locate 0 (system messages) is always included. */
+static int replay_symbols(const itch_file_t *file, const itch_idx_t *ix, replay_state_t *st) {
+    locate_stream_t streams[MAX_FILTER_SYMBOLS + 1];
+    int nstreams = 0;
+    uint64_t seek = itch_idx_seek_time(ix, st->start_ns);
+    
+    char list[256];
+    snprintf(list, sizeof(list), "0,%s", st->symbols);
+    char *save;
+    for (char *sym = strtok_r(list, ",", &save); sym; sym = strtok_r(NULL, ",", &save)) {
+        int locate = nstreams == 0 ? 0 : itch_idx_find_symbol(ix, sym);
+        if (locate < 0) {
+            fprintf(stderr, "Symbol not in index directory: %s\n", sym);
             return -1;
         }
-    } else {
-        fp = fopen(filename, "rb");
-        if (!fp) {
-            fprintf(stderr, "Failed to open file: %s\n", filename);
+        if (nstreams == MAX_FILTER_SYMBOLS + 1) {
+            fprintf(stderr, "At most %d symbols can be filtered\n", MAX_FILTER_SYMBOLS);
             return -1;
         }
+        locate_stream_t *ls = &streams[nstreams++];
+        ls->offsets = itch_idx_locate_offsets(ix, (uint16_t)locate, &ls->count);
+        
+        // Skip straight to the start-time bucket
+        size_t lo = 0, hi = ls->count;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (ls->offsets[mid] < seek) lo = mid + 1;
+            else hi = mid;
+        }
+        ls->next = lo;
+        if (nstreams > 1) printf("Filtering %s (locate %d): %zu messages\n", sym, locate, ls->count);
     }
     
-    printf("Starting replay: %s (speed: %.2fx)\n", filename, speed_multiplier);
-    
     while (server_running) {
-        // Read more data if buffer is low
-        if (buffer_used < BUFFER_SIZE / 2) {
-            ssize_t bytes_read;
-            
-            if (is_gzip) {
-                bytes_read = gzread(fp, buffer + buffer_used, BUFFER_SIZE - buffer_used);
-            } else {
-                bytes_read = fread(buffer + buffer_used, 1, BUFFER_SIZE - buffer_used, fp);
-            }
-            
-            if (bytes_read < 0) {
-                fprintf(stderr, "Read error\n");
-                break;
+        // Pick the earliest message across the streams (few streams: a linear scan)
+        int best = -1;
+        for (int i = 0; i < nstreams; i++) {
+            if (streams[i].next == streams[i].count) continue;
+            if (best < 0 || streams[i].offsets[streams[i].next] < streams[best].offsets[streams[best].next]) {
+                best = i;
             }
-            
-            if (bytes_read == 0 && buffer_used == 0) {
-                printf("End of file reached\n");
-                break;
-            }
-            
-            buffer_used += bytes_read;
         }
+        if (best < 0) break;
         
-        // Need at least 1 byte for message type
-        if (buffer_used < 1) break;
-        
-        uint8_t msg_type = buffer[0];
-        size_t msg_len = get_message_length(msg_type);
-        
-        if (msg_len == 0) {
-            fprintf(stderr, "Unknown message type: %c (0x%02X)\n", msg_type, msg_type);
-            // Skip this byte and continue
-            memmove(buffer, buffer + 1, buffer_used - 1);
-            buffer_used--;
+        uint64_t offset = streams[best].offsets[streams[best].next++];
+        if (offset >= file->size || itch_message_lengths[file->data[offset]] > file->size - offset) {
+            fprintf(stderr, "Index offset %lu runs past the end of the file\n", offset);
+            return -1;
+        }
+        const uint8_t *msg = file->data + offset;
+        uint64_t ts = read_timestamp(msg + st->ts_offset);
+        if (ts < st->start_ns) continue;
+        if (ts > st->end_ns) {
+            streams[best].next = streams[best].count;
             continue;
         }
-        
-        // Wait for complete message
-        if (buffer_used < msg_len) {
-            // Need more data
-            if (is_gzip) {
-                ssize_t bytes_read = gzread(fp, buffer + buffer_used, BUFFER_SIZE - buffer_used);
-                if (bytes_read <= 0) break;
-                buffer_used += bytes_read;
-            } else {
-                ssize_t bytes_read = fread(buffer + buffer_used, 1, BUFFER_SIZE - buffer_used, fp);
-                if (bytes_read <= 0) break;
-                buffer_used += bytes_read;
-            }
-            
-            if (buffer_used < msg_len) {
-                fprintf(stderr, "Incomplete message at end of file\n");
-                break;
-            }
+        replay_message(st, msg, itch_message_lengths[msg[0]]);
+    }
+    return 0;
+}
+
+#define DETECT_BYTES 65536
+
+/* Settle the protocol, sniffing buf when it was left to auto-detection */
+static int resolve_protocol(replay_state_t *st, const uint8_t *buf, size_t len) {
+    if (st->detect) {
+        st->protocol = itch_protocol_detect(buf, len < DETECT_BYTES ? len : DETECT_BYTES, st->framing);
+        st->detect = 0;
+        printf("Detected %s messages\n", st->protocol == PROTOCOL_ITTO ? "ITTO 4.0" : "ITCH 5.0");
+    }
+    st->ts_offset = itch_protocol_timestamp_offset(st->protocol);
+    st->keyed = keyed_feed = st->protocol == PROTOCOL_ITCH;
+    if (st->protocol == PROTOCOL_ITTO && (st->index_path || st->symbols || st->snapshot_path)) {
+        fprintf(stderr, "Index seeking, snapshots and symbol filters support ITCH files only\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Output that carries each message's length, so ITCH and ITTO messages can
+ * share one stream */
+static int output_carries_length(void) {
+    return mold || shm || itch_framing_prefix_size(output_framing) > 0;
+}
+
+/* Check a merged session's protocols against the output and note whether
+ * subscriptions can key on locates */
+static int merge_protocols(const uint8_t *protocols, int n) {
+    int itch = 0, itto = 0;
+    for (int i = 0; i < n; i++) {
+        if (protocols[i] == PROTOCOL_ITTO) itto++;
+        else itch++;
+    }
+    keyed_feed = itch > 0;
+    if (itch && itto && !output_carries_length()) {
+        fprintf(stderr, "ITCH merged with ITTO needs -o binaryfile or soupbintcp (or -g, -M): "
+                        "raw output cannot tell the messages apart\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Replay a merged recording: records are framed and in merge order already,
+ * so each one costs a length load and a lookup of its feed's protocol */
+static int replay_recording(const itch_file_t *file, const itch_merged_header_t *h, replay_state_t *st) {
+    if (st->index_path || st->symbols || st->snapshot_path) {
+        fprintf(stderr, "Merged recordings replay whole or by time (-t/-e): no -s, -i or -k\n");
+        return -1;
+    }
+    printf("Merged recording: %lu messages from %u feeds (", h->messages, h->feeds);
+    for (uint32_t i = 0; i < h->feeds; i++) {
+        printf("%s%s", i ? ", " : "", itch_protocol_name((itch_protocol_t)h->protocols[i]));
+    }
+    printf(")\n");
+    if (merge_protocols(h->protocols, (int)h->feeds) < 0) return -1;
+
+    itch_readahead_t *ra = NULL;
+    if (st->read_ahead) {
+        ra = itch_readahead_start(file, 0, st->read_ahead);
+        if (!ra) fprintf(stderr, "Failed to start read-ahead thread: faulting pages in on demand\n");
+    }
+
+    uint64_t per_feed[ITCH_MERGE_MAX_FEEDS] = { 0 };
+    itch_merged_cursor_t c = { file->data + sizeof(*h), file->data + file->size };
+    const uint8_t *msg;
+    size_t msg_len;
+    int feed;
+    while (server_running && (feed = itch_merged_next(&c, &msg, &msg_len)) >= 0) {
+        if (ra) itch_readahead_advance(ra, (size_t)(c.pos - file->data));
+        if ((uint32_t)feed >= h->feeds) {
+            fprintf(stderr, "Corrupt record at offset %lu\n", (uint64_t)(msg - file->data));
+            break;
         }
-        
-        // Parse timestamp (offset 5, 6 bytes) if message has header
-        uint64_t current_timestamp = 0;
-        if (msg_len >= 11) {
-            current_timestamp = read_timestamp(buffer + 5);
+        st->ts_offset = itch_protocol_timestamp_offset((itch_protocol_t)h->protocols[feed]);
+        st->keyed = h->protocols[feed] == PROTOCOL_ITCH;
+        uint64_t ts = read_timestamp(msg + st->ts_offset);
+        if (ts < st->start_ns) continue;
+        if (ts > st->end_ns) break;
+        replay_message(st, msg, msg_len);
+        per_feed[feed]++;
+    }
+    for (uint32_t i = 0; i < h->feeds; i++) {
+        printf("Feed %u: %s, %lu messages\n", i, itch_protocol_name((itch_protocol_t)h->protocols[i]), per_feed[i]);
+    }
+    if (ra) {
+        itch_readahead_stop(ra);
+        itch_readahead_print_stats(ra, stdout);
+        itch_readahead_destroy(ra);
+    }
+    return 0;
+}
+
+/* Replay raw files merged by feed time (itch_merge.h). Each feed keeps its
+ * own framing state and read-ahead; the one pacer sees a single clock. */
+static int replay_merged_feeds(const char *const *paths, int n, replay_state_t *st) {
+    itch_merge_t *m = malloc(sizeof(*m));
+    if (!m) {
+        fprintf(stderr, "Failed to allocate the feed merge\n");
+        return -1;
+    }
+    itch_merge_init(m);
+    itch_file_t files[ITCH_MERGE_MAX_FEEDS];
+    itch_readahead_t *ra[ITCH_MERGE_MAX_FEEDS] = { 0 };
+    uint8_t protocols[ITCH_MERGE_MAX_FEEDS];
+    int opened = 0;
+    int rc = 0;
+    for (int i = 0; i < n; i++) {
+        if (itch_file_open(&files[i], paths[i]) < 0) {
+            fprintf(stderr, "Failed to map file: %s (%s)\n", paths[i], strerror(errno));
+            rc = -1;
+            break;
         }
-        
-        // Calculate sleep time based on timestamp delta
-        if (prev_timestamp > 0 && current_timestamp > prev_timestamp && speed_multiplier > 0) {
-            uint64_t delta_ns = current_timestamp - prev_timestamp;
-            uint64_t sleep_ns = (uint64_t)(delta_ns / speed_multiplier);
-            
-            // Cap sleep to prevent huge delays (max 1 second)
-            if (sleep_ns > 1000000000ULL) {
-                sleep_ns = 1000000000ULL;
-            }
-            
-            if (sleep_ns > 1000) {  // Only sleep if > 1 microsecond
-                nsleep(sleep_ns);
-            }
+        opened++;
+        if (itch_merged_header(files[i].data, files[i].size)) {
+            fprintf(stderr, "%s is a merged recording: replay it on its own\n", paths[i]);
+            rc = -1;
+            break;
         }
-        
-        // Broadcast message to all clients
-        broadcast_message(buffer, msg_len);
-        
-        messages_sent++;
-        total_bytes += msg_len;
-        prev_timestamp = current_timestamp;
-        
-        // Progress update every 100k messages
-        if (messages_sent % 100000 == 0) {
-            printf("Sent %lu messages (%.2f MB)\n", messages_sent, total_bytes / 1048576.0);
+        itch_protocol_t p = st->detect ? itch_protocol_detect(files[i].data, files[i].size < DETECT_BYTES ?
+                                                              files[i].size : DETECT_BYTES, st->framing)
+                                       : st->protocol;
+        protocols[i] = (uint8_t)p;
+        itch_merge_add(m, files[i].data, files[i].size, st->framing, p);
+        printf("Feed %d: %s (%s)\n", i, paths[i], itch_protocol_name(p));
+    }
+    if (rc == 0) rc = merge_protocols(protocols, n);
+
+    for (int i = 0; rc == 0 && st->read_ahead && i < n; i++) {
+        ra[i] = itch_readahead_start(&files[i], 0, st->read_ahead);
+        if (!ra[i]) fprintf(stderr, "Failed to start read-ahead thread: faulting pages in on demand\n");
+    }
+
+    const uint8_t *msg;
+    size_t msg_len;
+    uint64_t ts;
+    int feed;
+    while (rc == 0 && server_running && (feed = itch_merge_next(m, &msg, &msg_len, &ts)) >= 0) {
+        const itch_merge_feed_t *f = &m->feeds[feed];
+        if (ra[feed]) itch_readahead_advance(ra[feed], (size_t)(f->cur.pos - files[feed].data));
+        if (ts < st->start_ns) continue;
+        if (ts > st->end_ns) break;
+        st->ts_offset = f->ts_offset;
+        st->keyed = f->protocol == PROTOCOL_ITCH;
+        replay_message(st, msg, msg_len);
+    }
+    if (rc == 0) itch_merge_print_stats(m, stdout);
+
+    for (int i = 0; i < n; i++) {
+        if (!ra[i]) continue;
+        itch_readahead_stop(ra[i]);
+        itch_readahead_print_stats(ra[i], stdout);
+        itch_readahead_destroy(ra[i]);
+    }
+    for (int i = 0; i < opened; i++) itch_file_close(&files[i]);
+    free(m);
+    return rc;
+}
+
+/* Replay a raw file by walking the mapping in place */
+static int replay_mapped_file(const char *filename, replay_state_t *st) {
+    itch_file_t file;
+    if (itch_file_open(&file, filename) < 0) {
+        fprintf(stderr, "Failed to map file: %s (%s)\n", filename, strerror(errno));
+        return -1;
+    }
+    const itch_merged_header_t *rec = itch_merged_header(file.data, file.size);
+    if (rec) {
+        int rc = replay_recording(&file, rec, st);
+        itch_file_close(&file);
+        return rc;
+    }
+    if (resolve_protocol(st, file.data, file.size) < 0) {
+        itch_file_close(&file);
+        return -1;
+    }
+    
+    itch_idx_t ix;
+    int have_index = 0;
+    if (st->index_path) {
+        if (itch_idx_open(&ix, st->index_path) < 0) {
+            fprintf(stderr, "Failed to open index: %s (%s)\n", st->index_path, strerror(errno));
+            itch_file_close(&file);
+            return -1;
         }
-        
-        // Remove message from buffer
-        memmove(buffer, buffer + msg_len, buffer_used - msg_len);
-        buffer_used -= msg_len;
+        if (ix.header->source_size != file.size || ix.header->framing != (uint32_t)st->framing) {
+            fprintf(stderr, "Index %s does not match %s (stale, or built with another framing)\n",
+                    st->index_path, filename);
+            itch_idx_close(&ix);
+            itch_file_close(&file);
+            return -1;
+        }
+        have_index = 1;
     }
     
-    printf("Replay complete: %lu messages, %.2f MB\n", messages_sent, total_bytes / 1048576.0);
+    if (st->symbols && have_index && !st->snapshot_path) {
+        int rc = replay_symbols(&file, &ix, st);
+        itch_idx_close(&ix);
+        itch_file_close(&file);
+        return rc;
+    }
     
-    if (is_gzip) {
-        gzclose(fp);
-    } else {
-        fclose(fp);
+    uint64_t seek = 0;
+    if (st->snapshot_path) {
+        int64_t off = resume_from_snapshot(&file, st);
+        if (off < 0) {
+            if (have_index) itch_idx_close(&ix);
+            itch_file_close(&file);
+            return -1;
+        }
+        seek = (uint64_t)off;
+    } else if (have_index) {
+        seek = itch_idx_seek_time(&ix, st->start_ns);
+        if (seek > 0) printf("Seeking to offset %lu for start time\n", seek);
+    }
+    
+    // Disk reads and page faults happen on the read-ahead thread, not between deadlines
+    itch_readahead_t *ra = NULL;
+    if (st->read_ahead) {
+        ra = itch_readahead_start(&file, seek, st->read_ahead);
+        if (!ra) fprintf(stderr, "Failed to start read-ahead thread: faulting pages in on demand\n");
     }
     
+    itch_cursor_t cur;
+    itch_cursor_init(&cur, file.data + seek, file.size - seek, st->framing);
+    itch_framer_set_protocol(&cur.framer, st->protocol);
+    
+    const uint8_t *msg;
+    size_t msg_len;
+    int reached_end_time = 0;
+    while (server_running && itch_cursor_next(&cur, &msg, &msg_len)) {
+        if (ra) itch_readahead_advance(ra, (size_t)(cur.pos - file.data));
+        if (symbol_filtered(st, msg, msg_len)) continue;
+        uint64_t ts = read_timestamp(msg + st->ts_offset);
+        if (ts < st->start_ns && !st->catch_up) continue;
+        if (ts > st->end_ns) {
+            reached_end_time = 1;
+            break;
+        }
+        replay_message(st, msg, msg_len);
+    }
+    
+    itch_framer_print_stats(&cur.framer);
+    if (cur.pos < cur.end && server_running && !reached_end_time) {
+        fprintf(stderr, "Incomplete message at end of file\n");
+    }
+    if (ra) {
+        itch_readahead_stop(ra);
+        itch_readahead_print_stats(ra, stdout);
+        itch_readahead_destroy(ra);
+    }
+    
+    if (have_index) itch_idx_close(&ix);
+    itch_file_close(&file);
     return 0;
 }
 
-/* Accept client connections */
-static void* accept_clients_thread(void *arg) {
-    int server_fd = *(int*)arg;
+/* Replay a gzip file through the stream ring; inflate runs on itch_gz threads */
+static int replay_gzip_file(const char *filename, replay_state_t *st) {
+    itch_stream_t stream;
+    int eof = 0;
+    int reached_end_time = 0;
+    int rc = 0;
     
-    while (server_running) {
-        struct sockaddr_in client_addr;
-        socklen_t addr_len = sizeof(client_addr);
-        
-        int client_fd = accept(server_fd, (struct sockaddr*)&client_addr, &addr_len);
-        if (client_fd < 0) {
-            if (errno == EINTR) continue;
-            perror("accept");
-            continue;
+    if (!st->detect && resolve_protocol(st, NULL, 0) < 0) return -1;
+    itch_gz_t *gz = itch_gz_open(filename, st->gz_threads, 0);
+    if (!gz) return -1;
+    
+    // A BGZF file maps uncompressed offsets to blocks, so the index can seek.
+    // A symbol filter scans from the start instead: it needs the R messages.
+    if (st->index_path && !st->dir) {
+        itch_idx_t ix;
+        if (itch_idx_open(&ix, st->index_path) < 0) {
+            fprintf(stderr, "Failed to open index: %s (%s)\n", st->index_path, strerror(errno));
+            itch_gz_close(gz);
+            return -1;
         }
-        
-        // Find free slot
-        pthread_mutex_lock(&clients_mutex);
-        int slot = -1;
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (!clients[i].active) {
-                slot = i;
+        if (itch_gz_size(gz) == 0) {
+            fprintf(stderr, "Index seeking in gzip needs a BGZF file (bgzip)\n");
+            itch_idx_close(&ix);
+            itch_gz_close(gz);
+            return -1;
+        }
+        if (ix.header->source_size != itch_gz_size(gz) || ix.header->framing != (uint32_t)st->framing) {
+            fprintf(stderr, "Index %s does not match %s (stale, or built with another framing)\n",
+                    st->index_path, filename);
+            itch_idx_close(&ix);
+            itch_gz_close(gz);
+            return -1;
+        }
+        uint64_t seek = itch_idx_seek_time(&ix, st->start_ns);
+        itch_idx_close(&ix);
+        if (seek > 0) printf("Seeking to offset %lu for start time\n", seek);
+        if (itch_gz_seek(gz, seek) < 0) {
+            itch_gz_close(gz);
+            return -1;
+        }
+    }
+    
+    if (itch_stream_init(&stream, ITCH_STREAM_DEFAULT_SIZE, st->framing) < 0) {
+        fprintf(stderr, "Failed to allocate read buffer\n");
+        itch_gz_close(gz);
+        return -1;
+    }
+    itch_framer_set_protocol(&stream.framer, st->protocol);
+    
+    while (server_running && !eof) {
+        size_t space;
+        uint8_t *dst = itch_stream_fill_ptr(&stream, &space);
+        ssize_t bytes_read = itch_gz_read(gz, dst, space);
+        if (bytes_read < 0) {
+            fprintf(stderr, "Read error: %s is corrupt or truncated\n", filename);
+            rc = -1;
+            break;
+        }
+        if (bytes_read == 0) eof = 1;
+        if (st->detect) {
+            // The first read lands at the start of the ring, so it is contiguous
+            if (resolve_protocol(st, dst, (size_t)bytes_read) < 0) {
+                rc = -1;
                 break;
             }
+            itch_framer_set_protocol(&stream.framer, st->protocol);
         }
+        itch_stream_filled(&stream, (size_t)bytes_read);
         
-        if (slot >= 0) {
-            clients[slot].socket_fd = client_fd;
-            clients[slot].address = client_addr;
-            clients[slot].active = 1;
-            printf("Client %d connected from %s:%d\n", 
-                   slot, inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
-        } else {
-            printf("Max clients reached, rejecting connection\n");
-            close(client_fd);
+        // Frame every complete message in place; a partial tail waits for the next read
+        const uint8_t *msg;
+        size_t msg_len;
+        while (server_running && itch_stream_next(&stream, &msg, &msg_len)) {
+            if (symbol_filtered(st, msg, msg_len)) continue;
+            uint64_t ts = read_timestamp(msg + st->ts_offset);
+            if (ts < st->start_ns) continue;
+            if (ts > st->end_ns) {
+                eof = 1;
+                reached_end_time = 1;
+                break;
+            }
+            replay_message(st, msg, msg_len);
         }
-        
-        pthread_mutex_unlock(&clients_mutex);
     }
     
-    return NULL;
+    if (eof && !reached_end_time && itch_stream_pending(&stream) > 0) {
+        fprintf(stderr, "Incomplete message at end of file\n");
+    }
+    itch_framer_print_stats(&stream.framer);
+    
+    itch_gz_stats_t gs;
+    itch_gz_get_stats(gz, &gs);
+    printf("Gzip: %s, %d inflate thread%s, queue of %d chunks", gs.blocked ? "BGZF" : "single stream",
+           gs.threads, gs.threads == 1 ? "" : "s", gs.depth);
+    if (gs.blocked) printf(", %lu blocks", gs.blocks);
+    printf("\n      %.2f MB in, %.2f MB out, reader waits %lu, inflate waits %lu\n",
+           gs.compressed_bytes / 1048576.0, gs.bytes_out / 1048576.0, gs.reader_waits, gs.worker_waits);
+    
+    itch_stream_free(&stream);
+    itch_gz_close(gz);
+    return rc;
 }
 
-/* Main server function */
-int main(int argc, char *argv[]) {
-    server_config_t config = {
-        .filename = NULL,
-        .port = DEFAULT_PORT,
-        .speed_multiplier = DEFAULT_SPEED,
-        .is_gzip = 0,
+/* Replay ITCH file with timestamp-accurate streaming */
+static int replay_itch_file(const server_config_t *cfg) {
+    replay_state_t st = {
+        .speed_multiplier = cfg->speed_multiplier,
+        .framing = cfg->input_framing,
+        .protocol = cfg->protocol,
+        .detect = cfg->detect_protocol,
+        .ts_offset = itch_protocol_timestamp_offset(cfg->protocol),
+        .keyed = keyed_feed,
+        .index_path = cfg->index_path,
+        .symbols = cfg->symbols,
+        .gz_threads = cfg->gz_threads,
+        .read_ahead = cfg->read_ahead_mb << 20,
+        .start_ns = cfg->start_ns,
+        .end_ns = cfg->end_ns,
+        .snapshot_path = cfg->snapshot_path,
+        .send_snapshot = cfg->send_snapshot,
+        .stamp = cfg->stamp_send_time,
+        .mode = cfg->mode,
+        .flush_ns = cfg->flush_us * 1000,
+        .progress_ns = pacer_now(),
+        .progress_syscalls = output_syscalls(),
     };
+    if (cfg->speed_multiplier > 0) pacer_init(&st.pacer, cfg->speed_multiplier, cfg->spin_us * 1000);
     
-    // Parse arguments
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s <itch_file> [port] [speed_multiplier]\n", argv[0]);
-        fprintf(stderr, "Example: %s data/01302019.NASDAQ_ITCH50 9999 1.0\n", argv[0]);
-        return 1;
+    // The index merges per-symbol offset lists; without one (or in gzip) filter while scanning
+    if (cfg->symbols && (cfg->is_gzip || !cfg->index_path || cfg->snapshot_path)) {
+        st.dir = itch_directory_create();
+        if (!st.dir) {
+            fprintf(stderr, "Failed to allocate symbol directory\n");
+            return -1;
+        }
+        if (itch_directory_select(st.dir, cfg->symbols) < 0) {
+            itch_directory_destroy(st.dir);
+            return -1;
+        }
     }
     
-    config.filename = argv[1];
+    printf("Starting replay: %s (speed: %.2fx, %s, %s framing)\n", cfg->filename, cfg->speed_multiplier,
+           cfg->is_gzip ? "gzip stream" : "mmap", itch_framing_name(cfg->input_framing));
     
-    if (argc >= 3) {
-        config.port = atoi(argv[2]);
+    int rc;
+    if (cfg->merge_count) {
+        const char *paths[ITCH_MERGE_MAX_FEEDS] = { cfg->filename };
+        memcpy(paths + 1, cfg->merge_files, (size_t)cfg->merge_count * sizeof(paths[0]));
+        rc = replay_merged_feeds(paths, cfg->merge_count + 1, &st);
+    } else {
+        rc = cfg->is_gzip ? replay_gzip_file(cfg->filename, &st) : replay_mapped_file(cfg->filename, &st);
     }
-    
-    if (argc >= 4) {
-        config.speed_multiplier = atof(argv[3]);
+    if (rc == 0 && st.dir) {
+        itch_directory_print_stats(st.dir, stdout);
+        printf("Symbol filter: %lu messages skipped\n", st.filtered);
     }
+    itch_directory_destroy(st.dir);
+    if (rc < 0) return rc;
     
-    // Check if file is gzipped
-    size_t len = strlen(config.filename);
-    if (len > 3 && strcmp(config.filename + len - 3, ".gz") == 0) {
-        config.is_gzip = 1;
-    }
-    
-    printf("ITCH Replay Server\n");
-    printf("  File: %s\n", config.filename);
-    printf("  Port: %d\n", config.port);
-    printf("  Speed: %.2fx\n", config.speed_multiplier);
-    printf("  Format: %s\n", config.is_gzip ? "gzip" : "raw binary");
-    printf("\n");
-    
-    // Create server socket
+    printf("Replay complete: %lu messages, %.2f MB\n", st.messages_sent, st.total_bytes / 1048576.0);
+    if (cfg->speed_multiplier > 0) pacer_print_stats(&st.pacer, stdout);
+    return 0;
+}
+
+/* Bound, listening TCP socket, or -1 */
+static int open_listener(int port) {
     int server_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (server_fd < 0) {
         perror("socket");
-        return 1;
+        return -1;
     }
     
     // Set socket options
-    int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+    int reuse = 1;
+    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0) {
         perror("setsockopt");
         close(server_fd);
-        return 1;
+        return -1;
     }
     
     // Bind to port
     struct sockaddr_in server_addr = {
         .sin_family = AF_INET,
         .sin_addr.s_addr = INADDR_ANY,
-        .sin_port = htons(config.port),
+        .sin_port = htons(port),
     };
     
     if (bind(server_fd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
         perror("bind");
         close(server_fd);
-        return 1;
+        return -1;
     }
     
     // Listen for connections
-    if (listen(server_fd, 5) < 0) {
+    if (listen(server_fd, LISTEN_BACKLOG) < 0) {
         perror("listen");
         close(server_fd);
+        return -1;
+    }
+    return server_fd;
+}
+
+/* Main server function */
+int main(int argc, char *argv[]) {
+    server_config_t config = {
+        .filename = NULL,
+        .port = DEFAULT_PORT,
+        .speed_multiplier = DEFAULT_SPEED,
+        .is_gzip = 0,
+        .input_framing = FRAMING_RAW,
+        .output_framing = FRAMING_RAW,
+        .protocol = PROTOCOL_ITCH,
+        .detect_protocol = 1,
+        .index_path = NULL,
+        .symbols = NULL,
+        .start_ns = 0,
+        .end_ns = UINT64_MAX,
+        .max_clients = DEFAULT_MAX_CLIENTS,
+        .policy = FANOUT_DROP,
+        .ring_mb = DEFAULT_RING_MB,
+        .mode = FANOUT_LATENCY,
+        .flush_bytes = DEFAULT_FLUSH_BYTES,
+        .flush_us = DEFAULT_FLUSH_US,
+        .spin_us = PACER_DEFAULT_SPIN_NS / 1000,
+        .cpu = -1,
+        .read_ahead_mb = ITCH_READAHEAD_DEFAULT_DEPTH >> 20,
+        .handshake_ms = DEFAULT_HANDSHAKE_MS,
+        .send_snapshot = 1,
+    };
+    
+    // Parse arguments
+    int opt;
+    while ((opt = getopt(argc, argv, "f:o:P:t:e:s:i:k:Kc:p:r:m:n:u:w:a:z:d:TW:g:R:S:I:M:X:")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (itch_framing_parse(optarg, &config.input_framing) < 0) {
+                    fprintf(stderr, "Unknown framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (itch_framing_parse(optarg, &config.output_framing) < 0) {
+                    fprintf(stderr, "Unsupported output framing: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'P':
+                config.detect_protocol = strcmp(optarg, "auto") == 0;
+                if (!config.detect_protocol && itch_protocol_parse(optarg, &config.protocol) < 0) {
+                    fprintf(stderr, "Unknown protocol: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+            case 'e':
+                if (itch_parse_time(optarg, opt == 't' ? &config.start_ns : &config.end_ns) < 0) {
+                    fprintf(stderr, "Invalid time (want HH:MM[:SS[.fraction]]): %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 's': config.symbols = optarg; break;
+            case 'i': config.index_path = optarg; break;
+            case 'k': config.snapshot_path = optarg; break;
+            case 'K': config.send_snapshot = 0; break;
+            case 'c': config.max_clients = atoi(optarg); break;
+            case 'p':
+                if (fanout_policy_parse(optarg, &config.policy) < 0) {
+                    fprintf(stderr, "Unknown slow client policy: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'r': config.ring_mb = strtoull(optarg, NULL, 10); break;
+            case 'm':
+                if (fanout_mode_parse(optarg, &config.mode) < 0) {
+                    fprintf(stderr, "Unknown send mode: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'n': config.flush_bytes = strtoull(optarg, NULL, 10); break;
+            case 'u': config.flush_us = strtoull(optarg, NULL, 10); break;
+            case 'w': config.spin_us = strtoull(optarg, NULL, 10); break;
+            case 'a': config.cpu = atoi(optarg); break;
+            case 'd': config.read_ahead_mb = strtoull(optarg, NULL, 10); break;
+            case 'T': config.stamp_send_time = 1; break;
+            case 'W': config.handshake_ms = atoi(optarg); break;
+            case 'z':
+                config.gz_threads = atoi(optarg);
+                if (config.gz_threads < 1 || config.gz_threads > ITCH_GZ_MAX_THREADS) {
+                    fprintf(stderr, "Inflate threads must be 1..%d\n", ITCH_GZ_MAX_THREADS);
+                    return 1;
+                }
+                break;
+            case 'g':
+                if (mold_parse_endpoint(optarg, config.mcast_group, sizeof(config.mcast_group),
+                                        &config.mcast_port) < 0) {
+                    fprintf(stderr, "Invalid multicast group (want group:port): %s\n", optarg);
+                    return 1;
+                }
+                config.output_framing = FRAMING_MOLDUDP64;
+                break;
+            case 'R': config.retrans_port = atoi(optarg); break;
+            case 'S': config.session = optarg; break;
+            case 'I': config.mcast_iface = optarg; break;
+            case 'M': config.shm_name = optarg; break;
+            case 'X':
+                if (config.merge_count == ITCH_MERGE_MAX_FEEDS - 1) {
+                    fprintf(stderr, "At most %d feeds merge (-X up to %d)\n", ITCH_MERGE_MAX_FEEDS,
+                            ITCH_MERGE_MAX_FEEDS - 1);
+                    return 1;
+                }
+                config.merge_files[config.merge_count++] = optarg;
+                break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-f framing] [-o framing] [-P protocol] [-t start] [-e end] [-s SYMBOLS] [-i index]\n"
+                        "          [-c max_clients] [-p policy] [-r ring_mb] [-m mode] [-n bytes] [-u usec]\n"
+                        "          [-w spin_us] [-a cpu] [-z threads] [-d mb] [-T] [-W ms] [-g group:port [-R port] [-S session] [-I iface]]\n"
+                        "          [-M name] [-k snapshots [-K]] [-X feed_file]... <itch_file> [port] [speed_multiplier]\n", argv[0]);
+        fprintf(stderr, "Example: %s -t 09:30 -e 10:00 -s AAPL data/01302019.NASDAQ_ITCH50 9999 1.0\n", argv[0]);
         return 1;
     }
     
-    printf("Listening on port %d...\n", config.port);
-    printf("Waiting for clients (press Ctrl+C to stop)...\n\n");
+    config.filename = argv[optind];
+    
+    if (optind + 1 < argc) {
+        config.port = atoi(argv[optind + 1]);
+    }
     
-    // Initialize client slots
-    memset(clients, 0, sizeof(clients));
+    if (optind + 2 < argc) {
+        config.speed_multiplier = atof(argv[optind + 2]);
+    }
+    output_framing = config.output_framing;
+    keyed_feed = config.detect_protocol || config.protocol == PROTOCOL_ITCH;   // until detected
+    if (output_framing == FRAMING_MOLDUDP64 && !config.mcast_group[0]) {
+        fprintf(stderr, "MoldUDP64 output is multicast: give a group with -g\n");
+        return 1;
+    }
+    if (config.shm_name && config.mcast_group[0]) {
+        fprintf(stderr, "Choose one output: -M (shared memory) or -g (multicast)\n");
+        return 1;
+    }
     
-    // Start accept thread
-    pthread_t accept_thread;
-    pthread_create(&accept_thread, NULL, accept_clients_thread, &server_fd);
+    // Check if file is gzipped
+    size_t len = strlen(config.filename);
+    if (len > 3 && strcmp(config.filename + len - 3, ".gz") == 0) {
+        config.is_gzip = 1;
+    }
+    
+    if (config.snapshot_path && config.is_gzip) {
+        fprintf(stderr, "Snapshots resume raw (uncompressed) files only\n");
+        return 1;
+    }
+    if (config.merge_count) {
+        int gzip = config.is_gzip;
+        for (int i = 0; i < config.merge_count; i++) {
+            size_t n = strlen(config.merge_files[i]);
+            gzip |= n > 3 && strcmp(config.merge_files[i] + n - 3, ".gz") == 0;
+        }
+        if (gzip || config.symbols || config.index_path || config.snapshot_path) {
+            fprintf(stderr, "Merged feeds (-X) are raw (uncompressed) files, without -s, -i or -k\n");
+            return 1;
+        }
+    }
+    
+    // Seeking needs the index (or a snapshot); look for the default sidecar next to the file
+    static char default_index[4096];
+    if (!config.index_path && !config.snapshot_path && !config.merge_count && (config.symbols || config.start_ns)) {
+        snprintf(default_index, sizeof(default_index), "%s.idx", config.filename);
+        if (access(default_index, R_OK) == 0) {
+            config.index_path = default_index;
+        } else if (config.symbols) {
+            fprintf(stderr, "No index %s: filtering symbols while scanning from the start of the file\n",
+                    default_index);
+        } else {
+            fprintf(stderr, "No index %s: scanning from the start of the file\n", default_index);
+        }
+    }
+    
+    printf("ITCH Replay Server\n");
+    printf("  File: %s\n", config.filename);
+    for (int i = 0; i < config.merge_count; i++) printf("  Merged with: %s\n", config.merge_files[i]);
+    int tcp_output = !config.mcast_group[0] && !config.shm_name;
+    if (tcp_output) printf("  Port: %d\n", config.port);
+    printf("  Speed: %.2fx\n", config.speed_multiplier);
+    printf("  Format: %s\n", config.is_gzip ? "gzip" : "raw binary");
+    printf("  Protocol: %s\n", config.detect_protocol ? "auto" : itch_protocol_name(config.protocol));
+    printf("  Framing: %s in, %s out\n", itch_framing_name(config.input_framing),
+           itch_framing_name(config.output_framing));
+    if (config.index_path) printf("  Index: %s\n", config.index_path);
+    if (config.snapshot_path) {
+        printf("  Snapshots: %s%s\n", config.snapshot_path, config.send_snapshot ? "" : " (not sent)");
+    }
+    if (config.stamp_send_time) printf("  Timestamps: send time (-T)\n");
+    if (config.symbols) printf("  Symbols: %s\n", config.symbols);
+    if (tcp_output) {
+        printf("  Clients: up to %d, %zu MB ring, %s slow clients\n", config.max_clients, config.ring_mb,
+               fanout_policy_name(config.policy));
+        if (config.handshake_ms > 0) printf("  Subscriptions: %d ms handshake\n", config.handshake_ms);
+    }
+    if (config.mcast_group[0]) {
+        printf("  Send mode: %s, packets of up to %d bytes", fanout_mode_name(config.mode), MOLD_DEFAULT_MTU);
+    } else if (config.shm_name) {
+        printf("  Send mode: %s, commit at %zu bytes", fanout_mode_name(config.mode), config.flush_bytes);
+    } else {
+        printf("  Send mode: %s, flush at %zu bytes", fanout_mode_name(config.mode), config.flush_bytes);
+    }
+    if (config.mode == FANOUT_THROUGHPUT) printf(" or %lu us", config.flush_us);
+    printf("\n");
+    printf("\n");
+    
+    int server_fd = -1;
+    if (config.mcast_group[0]) {
+        mold_pub_config_t mcfg = {
+            .group = config.mcast_group,
+            .port = config.mcast_port,
+            .iface = config.mcast_iface,
+            .retrans_port = config.retrans_port,
+            .session = config.session,
+        };
+        mold = mold_pub_create(&mcfg);
+        if (!mold) {
+            fprintf(stderr, "Failed to start MoldUDP64 publisher\n");
+            return 1;
+        }
+        printf("Publishing MoldUDP64 to %s:%d (session %s), retransmission on port %d\n\n",
+               config.mcast_group, config.mcast_port, config.session ? config.session : MOLD_DEFAULT_SESSION,
+               config.retrans_port ? config.retrans_port : config.mcast_port + 1);
+    } else if (config.shm_name) {
+        shm = shm_ring_pub_create(config.shm_name, config.ring_mb << 20);
+        if (!shm) {
+            fprintf(stderr, "Failed to create shared memory ring %s\n", config.shm_name);
+            return 1;
+        }
+        shm_flush_bytes = config.flush_bytes;
+        printf("Publishing to shared memory ring %s (%.1f MB)\n\n", config.shm_name, shm->size / 1048576.0);
+    } else {
+        server_fd = open_listener(config.port);
+        if (server_fd < 0) return 1;
+        
+        printf("Listening on port %d...\n", config.port);
+        printf("Waiting for clients (press Ctrl+C to stop)...\n\n");
+        
+        if (config.handshake_ms > 0) {
+            subscriber_slots = config.max_clients > 0 ? config.max_clients : DEFAULT_MAX_CLIENTS;
+            subscribers = calloc((size_t)subscriber_slots, sizeof(subscriber_t));
+            sub_dir = itch_directory_create();
+            if (!subscribers || !sub_dir) {
+                fprintf(stderr, "Failed to allocate subscriptions\n");
+                close(server_fd);
+                return 1;
+            }
+        }
+
+        // Start the IO thread: it accepts and serves clients from here on
+        fanout_config_t fcfg = {
+            .listen_fd = server_fd,
+            .max_clients = config.max_clients,
+            .ring_size = config.ring_mb << 20,
+            .policy = config.policy,
+            .mode = config.mode,
+            .flush_bytes = config.flush_bytes,
+            .handshake_ms = config.handshake_ms,
+            .on_request = on_subscribe,
+            .on_close = on_unsubscribe,
+        };
+        fanout = fanout_create(&fcfg);
+        if (!fanout) {
+            fprintf(stderr, "Failed to start client fan-out\n");
+            close(server_fd);
+            return 1;
+        }
+    }
+    
+    // Pin only the replay thread: the IO thread was started unpinned
+    if (config.cpu >= 0) {
+        if (pacer_pin_thread(config.cpu) < 0) {
+            fprintf(stderr, "Failed to pin replay thread to CPU %d\n", config.cpu);
+        } else {
+            printf("Replay thread pinned to CPU %d\n", config.cpu);
+        }
+    }
     
     // Wait a moment for clients to connect
     sleep(2);
     
     // Start replay
-    replay_itch_file(config.filename, config.speed_multiplier, config.is_gzip);
+    replay_itch_file(&config);
     
-    // Cleanup
+    // Let clients catch up, then cleanup
     server_running = 0;
-    pthread_join(accept_thread, NULL);
+    if (mold) {
+        mold_pub_flush(mold);
+        mold_pub_stats_t ms;
+        mold_pub_get_stats(mold, &ms);
+        printf("MoldUDP64: %lu packets, %lu messages (%.1f per packet), %.2f MB, %lu heartbeats\n",
+               ms.packets, ms.messages, ms.packets ? (double)ms.messages / ms.packets : 0.0,
+               ms.bytes / 1048576.0, ms.heartbeats);
+        printf("Retransmission: %lu requests, %lu packets resent, %lu misses\n",
+               ms.retrans_requests, ms.retrans_packets, ms.retrans_misses);
+        mold_pub_destroy(mold);
+        printf("Server shutdown complete\n");
+        return 0;
+    }
+    if (shm) {
+        shm_ring_pub_close(shm);
+        shm_ring_pub_print_stats(shm, stdout);
+        shm_ring_pub_destroy(shm);
+        printf("Server shutdown complete\n");
+        return 0;
+    }
+    fanout_drain(fanout, DRAIN_TIMEOUT_MS);
     
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (clients[i].active) {
-            close(clients[i].socket_fd);
-        }
+    fanout_stats_t fs;
+    fanout_get_stats(fanout, &fs);
+    printf("Clients: %lu accepted, %lu rejected, %lu disconnected, %lu slow disconnected\n",
+           fs.clients_accepted, fs.clients_rejected, fs.disconnects, fs.slow_disconnects);
+    printf("Fan-out: %lu flushes, %lu writev calls, %lu wakeups, %.2f MB sent, %lu drops (%.2f MB), %lu publisher waits\n",
+           fs.flushes, fs.writev_calls, fs.wakeups, fs.bytes_out / 1048576.0, fs.drops,
+           fs.dropped_bytes / 1048576.0, fs.publisher_waits);
+    if (fs.subscriptions) {
+        printf("Subscriptions: %lu, %.2f MB filtered out\n", fs.subscriptions, fs.filtered_bytes / 1048576.0);
     }
-    pthread_mutex_unlock(&clients_mutex);
     
+    fanout_destroy(fanout);
+    free(subscribers);
+    itch_directory_destroy(sub_dir);
     close(server_fd);
     
     printf("Server shutdown complete\n");
@@ -0,0 +1,420 @@
+/*
+ * ITCH Scan - see itch_scan.h
+ *
+ * Every gather kernel loads the field with one unaligned load per message and
+ * byte-swaps in register. The timestamp trick from itch_read_timestamp() is
+ * shifted by two bytes here: an 8-byte load at offset 3 ends exactly at the
+ * end of the timestamp, so a swap and a 48-bit mask yield it without reading
+ * past the header. stockLocate is a 4-byte load at offset 1 for the same
+ * reason. No kernel reads outside the message it gathers from.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "itch_scan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ITCH_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define ITCH_SCAN_NEON 1
+#endif
+
+// Keep gather indices (offset + field) inside int32
+#define SCAN_MAX_SPAN ((size_t)INT32_MAX - 64)
+
+#define TIMESTAMP_LOAD 3
+#define TIMESTAMP_MASK 0x0000FFFFFFFFFFFFULL
+#define LOCATE_OFFSET 1
+
+/* Hot field offsets per type, 0 = field absent */
+typedef struct {
+    uint8_t ref;
+    uint8_t shares;
+    uint8_t price;
+} field_layout_t;
+
+static const field_layout_t LAYOUTS[256] = {
+    ['A'] = { 11, 20, 32 },
+    ['F'] = { 11, 20, 32 },
+    ['E'] = { 11, 19, 0 },
+    ['C'] = { 11, 19, 32 },
+    ['X'] = { 11, 19, 0 },
+    ['D'] = { 11, 0, 0 },
+    ['U'] = { 11, 27, 31 },
+    ['P'] = { 11, 20, 32 },
+};
+
+typedef void (*gather16_fn)(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint16_t *out);
+typedef void (*gather32_fn)(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint32_t *out);
+typedef void (*gather64_fn)(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint64_t mask, uint64_t *out);
+
+typedef struct {
+    const char *name;
+    gather16_fn gather16;
+    gather32_fn gather32;
+    gather64_fn gather64;
+} scan_kernels_t;
+
+/* ========== Scalar reference ========== */
+
+static void gather16_scalar(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint16_t *out) {
+    for (size_t i = 0; i < n; i++) out[i] = itch_read_u16(base + off[i] + field);
+}
+
+static void gather32_scalar(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint32_t *out) {
+    for (size_t i = 0; i < n; i++) out[i] = itch_read_u32(base + off[i] + field);
+}
+
+static void gather64_scalar(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint64_t mask, uint64_t *out) {
+    for (size_t i = 0; i < n; i++) out[i] = itch_read_u64(base + off[i] + field) & mask;
+}
+
+static const scan_kernels_t KERNELS_SCALAR = {
+    "scalar", gather16_scalar, gather32_scalar, gather64_scalar
+};
+
+#ifdef ITCH_SCAN_X86
+
+/* ========== AVX2: 8 x 32-bit / 4 x 64-bit gathers ========== */
+
+__attribute__((target("avx2")))
+static void gather16_avx2(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint16_t *out) {
+    // Swap the first two bytes of each dword and pack them into the low 8 bytes of each lane
+    const __m256i pack = _mm256_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m256i add = _mm256_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(off + i)), add);
+        __m256i v = _mm256_i32gather_epi32((const int *)base, idx, 1);
+        v = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, pack), 0x08);
+        _mm_storeu_si128((__m128i *)(out + i), _mm256_castsi256_si128(v));
+    }
+    gather16_scalar(base, off + i, n - i, field, out + i);
+}
+
+__attribute__((target("avx2")))
+static void gather32_avx2(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint32_t *out) {
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i add = _mm256_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(off + i)), add);
+        __m256i v = _mm256_i32gather_epi32((const int *)base, idx, 1);
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_shuffle_epi8(v, swap));
+    }
+    gather32_scalar(base, off + i, n - i, field, out + i);
+}
+
+__attribute__((target("avx2")))
+static void gather64_avx2(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint64_t mask, uint64_t *out) {
+    const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i vmask = _mm256_set1_epi64x((long long)mask);
+    const __m128i add = _mm_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i idx = _mm_add_epi32(_mm_loadu_si128((const __m128i *)(off + i)), add);
+        __m256i v = _mm256_i32gather_epi64((const long long *)base, idx, 1);
+        v = _mm256_and_si256(_mm256_shuffle_epi8(v, swap), vmask);
+        _mm256_storeu_si256((__m256i *)(out + i), v);
+    }
+    gather64_scalar(base, off + i, n - i, field, mask, out + i);
+}
+
+static const scan_kernels_t KERNELS_AVX2 = {
+    "avx2", gather16_avx2, gather32_avx2, gather64_avx2
+};
+
+/* ========== AVX-512: 16 x 32-bit / 8 x 64-bit gathers ========== */
+
+__attribute__((target("avx512f,avx512bw")))
+static void gather16_avx512(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint16_t *out) {
+    const __m512i swap = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(1, 0, -1, -1, 5, 4, -1, -1, 9, 8, -1, -1, 13, 12, -1, -1));
+    const __m512i add = _mm512_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i idx = _mm512_add_epi32(_mm512_loadu_si512(off + i), add);
+        __m512i v = _mm512_i32gather_epi32(idx, base, 1);
+        __m256i w = _mm512_cvtepi32_epi16(_mm512_shuffle_epi8(v, swap));
+        _mm256_storeu_si256((__m256i *)(out + i), w);
+    }
+    gather16_scalar(base, off + i, n - i, field, out + i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void gather32_avx512(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint32_t *out) {
+    const __m512i swap = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    const __m512i add = _mm512_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512i idx = _mm512_add_epi32(_mm512_loadu_si512(off + i), add);
+        __m512i v = _mm512_i32gather_epi32(idx, base, 1);
+        _mm512_storeu_si512(out + i, _mm512_shuffle_epi8(v, swap));
+    }
+    gather32_scalar(base, off + i, n - i, field, out + i);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static void gather64_avx512(const uint8_t *base, const uint32_t *off, size_t n,
+                            uint32_t field, uint64_t mask, uint64_t *out) {
+    const __m512i swap = _mm512_broadcast_i32x4(
+        _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+    const __m512i vmask = _mm512_set1_epi64((long long)mask);
+    const __m256i add = _mm256_set1_epi32((int)field);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i idx = _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)(off + i)), add);
+        __m512i v = _mm512_i32gather_epi64(idx, base, 1);
+        v = _mm512_and_si512(_mm512_shuffle_epi8(v, swap), vmask);
+        _mm512_storeu_si512(out + i, v);
+    }
+    gather64_scalar(base, off + i, n - i, field, mask, out + i);
+}
+
+static const scan_kernels_t KERNELS_AVX512 = {
+    "avx512", gather16_avx512, gather32_avx512, gather64_avx512
+};
+
+#endif /* ITCH_SCAN_X86 */
+
+#ifdef ITCH_SCAN_NEON
+
+/* ========== NEON: no gather, lane loads + vrev ========== */
+
+static void gather16_neon(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint16_t *out) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint16_t tmp[8];
+        for (int j = 0; j < 8; j++) memcpy(&tmp[j], base + off[i + j] + field, 2);
+        uint8x16_t v = vrev16q_u8(vreinterpretq_u8_u16(vld1q_u16(tmp)));
+        vst1q_u16(out + i, vreinterpretq_u16_u8(v));
+    }
+    gather16_scalar(base, off + i, n - i, field, out + i);
+}
+
+static void gather32_neon(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint32_t *out) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t tmp[4];
+        for (int j = 0; j < 4; j++) memcpy(&tmp[j], base + off[i + j] + field, 4);
+        uint8x16_t v = vrev32q_u8(vreinterpretq_u8_u32(vld1q_u32(tmp)));
+        vst1q_u32(out + i, vreinterpretq_u32_u8(v));
+    }
+    gather32_scalar(base, off + i, n - i, field, out + i);
+}
+
+static void gather64_neon(const uint8_t *base, const uint32_t *off, size_t n,
+                          uint32_t field, uint64_t mask, uint64_t *out) {
+    const uint64x2_t vmask = vdupq_n_u64(mask);
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        uint64_t tmp[2];
+        memcpy(&tmp[0], base + off[i] + field, 8);
+        memcpy(&tmp[1], base + off[i + 1] + field, 8);
+        uint8x16_t v = vrev64q_u8(vreinterpretq_u8_u64(vld1q_u64(tmp)));
+        vst1q_u64(out + i, vandq_u64(vreinterpretq_u64_u8(v), vmask));
+    }
+    gather64_scalar(base, off + i, n - i, field, mask, out + i);
+}
+
+static const scan_kernels_t KERNELS_NEON = {
+    "neon", gather16_neon, gather32_neon, gather64_neon
+};
+
+#endif /* ITCH_SCAN_NEON */
+
+/* ========== Dispatch ========== */
+
+static const scan_kernels_t *pick_kernels(void) {
+    const char *force = getenv("ITCH_SCAN_ISA");
+    if (force && strcmp(force, "scalar") == 0) return &KERNELS_SCALAR;
+#ifdef ITCH_SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        !(force && strcmp(force, "avx2") == 0)) {
+        return &KERNELS_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) return &KERNELS_AVX2;
+#endif
+#ifdef ITCH_SCAN_NEON
+    return &KERNELS_NEON;
+#endif
+    return &KERNELS_SCALAR;
+}
+
+// Picked once; a racing first call just picks the same table twice
+static const scan_kernels_t *kernels(void) {
+    static const scan_kernels_t *k;
+    if (!k) k = pick_kernels();
+    return k;
+}
+
+const char *itch_scan_isa(void) {
+    return kernels()->name;
+}
+
+/* ========== Boundary scan ========== */
+
+int itch_scan_init(itch_scan_t *s, size_t capacity, itch_framing_t framing) {
+    memset(s, 0, sizeof(*s));
+    s->offsets = malloc(capacity * sizeof(uint32_t));
+    s->types = malloc(capacity);
+    s->grouped = malloc(capacity * sizeof(uint32_t));
+    if (!s->offsets || !s->types || !s->grouped) {
+        itch_scan_free(s);
+        return -1;
+    }
+    s->capacity = capacity;
+    itch_framer_init(&s->framer, framing);
+    return 0;
+}
+
+void itch_scan_free(itch_scan_t *s) {
+    free(s->offsets);
+    free(s->types);
+    free(s->grouped);
+    s->offsets = NULL;
+    s->types = NULL;
+    s->grouped = NULL;
+    s->capacity = 0;
+}
+
+size_t itch_scan_batch(itch_scan_t *s, const uint8_t *buf, size_t size) {
+    size_t limit = size < SCAN_MAX_SPAN ? size : SCAN_MAX_SPAN;
+    size_t pos = 0;
+    size_t n = 0;
+    uint32_t *offsets = s->offsets;
+    uint8_t *types = s->types;
+
+    if (s->framer.framing == FRAMING_RAW) {
+        const uint8_t *lengths = s->framer.lengths;
+        while (n < s->capacity && pos < limit) {
+            uint8_t type = buf[pos];
+            size_t len = lengths[type];
+            if (len == 0) {
+                s->framer.skipped_bytes++;
+                pos++;
+                continue;
+            }
+            if (len > size - pos) break;
+            offsets[n] = (uint32_t)pos;
+            types[n] = type;
+            n++;
+            pos += len;
+        }
+    } else {
+        while (n < s->capacity && pos < limit) {
+            const uint8_t *msg;
+            size_t len;
+            size_t used = itch_frame_next(&s->framer, buf + pos, size - pos, &msg, &len);
+            if (used == 0) break;
+            if (len) {
+                offsets[n] = (uint32_t)(msg - buf);
+                types[n] = msg[0];
+                n++;
+            }
+            pos += used;
+        }
+    }
+
+    s->count = n;
+    s->grouped_valid = 0;
+    return pos;
+}
+
+/* Stable counting sort of the batch offsets by type byte */
+static void group_by_type(itch_scan_t *s) {
+    uint32_t counts[256] = {0};
+    for (size_t i = 0; i < s->count; i++) counts[s->types[i]]++;
+
+    uint32_t sum = 0;
+    for (int t = 0; t < 256; t++) {
+        s->type_start[t] = sum;
+        sum += counts[t];
+    }
+    s->type_start[256] = sum;
+
+    uint32_t next[256];
+    memcpy(next, s->type_start, sizeof(next));
+    for (size_t i = 0; i < s->count; i++) {
+        s->grouped[next[s->types[i]]++] = s->offsets[i];
+    }
+    s->grouped_valid = 1;
+}
+
+const uint32_t *itch_scan_select(itch_scan_t *s, uint8_t msg_type, size_t *n) {
+    if (!s->grouped_valid) group_by_type(s);
+    *n = s->type_start[msg_type + 1] - s->type_start[msg_type];
+    return s->grouped + s->type_start[msg_type];
+}
+
+/* ========== Column gather ========== */
+
+int itch_columns_init(itch_columns_t *c, size_t capacity) {
+    memset(c, 0, sizeof(*c));
+    c->timestamp = malloc(capacity * sizeof(uint64_t));
+    c->orderRef = malloc(capacity * sizeof(uint64_t));
+    c->shares = malloc(capacity * sizeof(uint32_t));
+    c->price = malloc(capacity * sizeof(uint32_t));
+    c->stockLocate = malloc(capacity * sizeof(uint16_t));
+    if (!c->timestamp || !c->orderRef || !c->shares || !c->price || !c->stockLocate) {
+        itch_columns_free(c);
+        return -1;
+    }
+    c->capacity = capacity;
+    return 0;
+}
+
+void itch_columns_free(itch_columns_t *c) {
+    free(c->timestamp);
+    free(c->orderRef);
+    free(c->shares);
+    free(c->price);
+    free(c->stockLocate);
+    memset(c, 0, sizeof(*c));
+}
+
+int itch_gather(itch_columns_t *c, const uint8_t *base, const uint32_t *offsets,
+                size_t n, uint8_t msg_type) {
+    const field_layout_t *l = &LAYOUTS[msg_type];
+    if (l->ref == 0 || n > c->capacity) return -1;
+
+    const scan_kernels_t *k = kernels();
+    k->gather64(base, offsets, n, TIMESTAMP_LOAD, TIMESTAMP_MASK, c->timestamp);
+    k->gather16(base, offsets, n, LOCATE_OFFSET, c->stockLocate);
+    k->gather64(base, offsets, n, l->ref, UINT64_MAX, c->orderRef);
+
+    if (l->shares) {
+        k->gather32(base, offsets, n, l->shares, c->shares);
+    } else {
+        memset(c->shares, 0, n * sizeof(uint32_t));
+    }
+    if (l->price) {
+        k->gather32(base, offsets, n, l->price, c->price);
+    } else {
+        memset(c->price, 0, n * sizeof(uint32_t));
+    }
+
+    c->count = n;
+    return 0;
+}
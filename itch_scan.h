@@ -0,0 +1,97 @@
+/*
+ * ITCH Scan - batch boundary scan and SoA hot-field gather
+ *
+ * Bulk processing in two passes over a batch of messages:
+ *
+ *   1. itch_scan_batch() walks the buffer once and records where every
+ *      message starts and its type byte. Boundaries are inherently serial
+ *      (each length depends on the previous type byte), so this pass is a
+ *      tight table-driven loop with no decoding.
+ *   2. itch_scan_select() returns the offsets of one message type (the batch
+ *      is grouped by type with one counting-sort pass on first use), and
+ *      itch_gather() pulls the hot fields (timestamp, stockLocate, order
+ *      ref, shares, price) of all of them into column arrays. This pass is
+ *      vectorized: AVX-512 or AVX2 gathers plus a byte-shuffle swap on x86,
+ *      NEON lane reversal on arm64, and the scalar itch_read_* readers
+ *      otherwise. The ISA is picked once at runtime.
+ *
+ * Offsets are 32-bit and relative to the batch base, so one batch spans at
+ * most 2 GB; itch_scan_batch() stops early rather than overflow. Batches of
+ * a few thousand messages keep the gather pass hitting L2 right behind the
+ * scan.
+ *
+ * Usage:
+ *   itch_scan_t scan;
+ *   itch_columns_t cols;
+ *   itch_scan_init(&scan, BATCH, FRAMING_RAW);
+ *   itch_columns_init(&cols, BATCH);
+ *   while (size) {
+ *       size_t used = itch_scan_batch(&scan, data, size);
+ *       size_t n;
+ *       const uint32_t *idx = itch_scan_select(&scan, 'A', &n);
+ *       itch_gather(&cols, data, idx, n, 'A');
+ *       // cols.price[0..n) ...
+ *       if (used == 0) break;
+ *       data += used; size -= used;
+ *   }
+ */
+
+#ifndef ITCH_SCAN_H
+#define ITCH_SCAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "itch_framing.h"
+
+typedef struct {
+    uint32_t *offsets;      // message start, relative to the batch base
+    uint8_t *types;         // message type byte
+    size_t count;           // messages in the last batch
+    size_t capacity;
+    itch_framer_t framer;   // framing state and skip counters across batches
+
+    // Offsets grouped by type, built lazily by itch_scan_select()
+    uint32_t *grouped;
+    uint32_t type_start[257];
+    int grouped_valid;
+} itch_scan_t;
+
+/* Hot-field columns for one message type. A field the type does not carry
+ * (e.g. price on 'D') is filled with zero. */
+typedef struct {
+    uint64_t *timestamp;
+    uint64_t *orderRef;     // original ref for 'U'
+    uint32_t *shares;
+    uint32_t *price;
+    uint16_t *stockLocate;
+    size_t count;
+    size_t capacity;
+} itch_columns_t;
+
+/* Returns 0 on success, -1 on allocation failure */
+int itch_scan_init(itch_scan_t *s, size_t capacity, itch_framing_t framing);
+void itch_scan_free(itch_scan_t *s);
+
+/* Scan buf[0, size) for up to capacity messages. Returns the bytes consumed,
+ * which always ends on a message boundary; the next batch starts there.
+ * Returns 0 when no complete message is left. */
+size_t itch_scan_batch(itch_scan_t *s, const uint8_t *buf, size_t size);
+
+/* Offsets of all messages of msg_type in the last batch, in stream order.
+ * *n receives the count. Valid until the next itch_scan_batch(). */
+const uint32_t *itch_scan_select(itch_scan_t *s, uint8_t msg_type, size_t *n);
+
+int itch_columns_init(itch_columns_t *c, size_t capacity);
+void itch_columns_free(itch_columns_t *c);
+
+/* Gather the hot fields of n messages of msg_type at base + offsets[i].
+ * Supported types: A F E C X D U P. Returns 0, or -1 for an unsupported type
+ * or n above the column capacity. */
+int itch_gather(itch_columns_t *c, const uint8_t *base, const uint32_t *offsets,
+                size_t n, uint8_t msg_type);
+
+/* Kernel set in use: "avx512", "avx2", "neon" or "scalar". Setting the
+ * environment variable ITCH_SCAN_ISA=scalar forces the scalar reference. */
+const char *itch_scan_isa(void);
+
+#endif /* ITCH_SCAN_H */
@@ -0,0 +1,155 @@
+/*
+ * ITCH Schema - message layouts generated from one field list per type
+ *
+ * Each message type is described once, as an X-macro list of (kind, name)
+ * pairs in wire order after the header (see ITCH_FIELDS_* in itch_parser.h
+ * and ITTO_FIELDS_* in itto_parser.h). Everything else is generated from
+ * that list at compile time:
+ * - the decoded struct (host-order members, alpha fields raw)
+ * - a wire struct of byte arrays whose member offsets are the field
+ *   offsets, so no offset is ever written by hand; its size is checked
+ *   against the spec length with a static assert
+ * - the inline decoder and encoder, one fixed-offset load (or store) and
+ *   byte swap per field, with no loops or branches
+ * - the length table and the dispatch switch
+ *
+ * Field kinds:
+ *   CHAR, U8           1 byte
+ *   U16, U32, U64      big-endian unsigned
+ *   S16                16-bit size widened to a uint32_t member (ITTO short forms)
+ *   P16                16-bit price with 2 implied decimals, scaled to 4 in a
+ *                      uint32_t member (ITTO short forms); encoding divides back
+ *   A2, A3, A4, A6, A8, A13  alpha, copied raw (space padded)
+ *
+ * The big-endian readers and writers used by the generated code live here
+ * too, and are what every other module uses for ad-hoc fields.
+ */
+
+#ifndef ITCH_SCHEMA_H
+#define ITCH_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define ITTO_SHORT_PRICE_SCALE 100  // 2 implied decimals -> 4
+
+/* Big-endian field readers: one unaligned load and a byte swap each */
+
+static inline uint16_t itch_read_u16(const uint8_t *b) {
+    uint16_t v;
+    memcpy(&v, b, 2);
+    return __builtin_bswap16(v);
+}
+
+static inline uint32_t itch_read_u32(const uint8_t *b) {
+    uint32_t v;
+    memcpy(&v, b, 4);
+    return __builtin_bswap32(v);
+}
+
+static inline uint64_t itch_read_u64(const uint8_t *b) {
+    uint64_t v;
+    memcpy(&v, b, 8);
+    return __builtin_bswap64(v);
+}
+
+/* 6-byte timestamp: load 8 bytes, swap, drop the two trailing bytes.
+ * Reads 2 bytes past the field, so the buffer must have at least 8 bytes
+ * available from the timestamp start. */
+static inline uint64_t itch_read_timestamp(const uint8_t *b) {
+    uint64_t tmp;
+    memcpy(&tmp, b, 8);
+    tmp = __builtin_bswap64(tmp);
+    return tmp >> 16;
+}
+
+/* Big-endian field writers */
+
+static inline void itch_write_u16(uint8_t *b, uint16_t v) {
+    v = __builtin_bswap16(v);
+    memcpy(b, &v, 2);
+}
+
+static inline void itch_write_u32(uint8_t *b, uint32_t v) {
+    v = __builtin_bswap32(v);
+    memcpy(b, &v, 4);
+}
+
+static inline void itch_write_u64(uint8_t *b, uint64_t v) {
+    v = __builtin_bswap64(v);
+    memcpy(b, &v, 8);
+}
+
+/* Writes exactly 6 bytes (a 2-byte and a 4-byte store) */
+static inline void itch_write_timestamp(uint8_t *b, uint64_t ts) {
+    itch_write_u16(b, (uint16_t)(ts >> 32));
+    itch_write_u32(b + 2, (uint32_t)ts);
+}
+
+/* Field kinds: wire width, struct member, read, write */
+
+#define ITCH_SCHEMA_W_CHAR 1
+#define ITCH_SCHEMA_W_U8   1
+#define ITCH_SCHEMA_W_U16  2
+#define ITCH_SCHEMA_W_U32  4
+#define ITCH_SCHEMA_W_U64  8
+#define ITCH_SCHEMA_W_S16  2
+#define ITCH_SCHEMA_W_P16  2
+#define ITCH_SCHEMA_W_A2   2
+#define ITCH_SCHEMA_W_A3   3
+#define ITCH_SCHEMA_W_A4   4
+#define ITCH_SCHEMA_W_A6   6
+#define ITCH_SCHEMA_W_A8   8
+#define ITCH_SCHEMA_W_A13  13
+
+#define ITCH_SCHEMA_DECL_CHAR(n) char n;
+#define ITCH_SCHEMA_DECL_U8(n)   uint8_t n;
+#define ITCH_SCHEMA_DECL_U16(n)  uint16_t n;
+#define ITCH_SCHEMA_DECL_U32(n)  uint32_t n;
+#define ITCH_SCHEMA_DECL_U64(n)  uint64_t n;
+#define ITCH_SCHEMA_DECL_S16(n)  uint32_t n;
+#define ITCH_SCHEMA_DECL_P16(n)  uint32_t n;
+#define ITCH_SCHEMA_DECL_A2(n)   char n[2];
+#define ITCH_SCHEMA_DECL_A3(n)   char n[3];
+#define ITCH_SCHEMA_DECL_A4(n)   char n[4];
+#define ITCH_SCHEMA_DECL_A6(n)   char n[6];
+#define ITCH_SCHEMA_DECL_A8(n)   char n[8];
+#define ITCH_SCHEMA_DECL_A13(n)  char n[13];
+
+#define ITCH_SCHEMA_RD_CHAR(p, d) (d) = (char)(p)[0]
+#define ITCH_SCHEMA_RD_U8(p, d)   (d) = (p)[0]
+#define ITCH_SCHEMA_RD_U16(p, d)  (d) = itch_read_u16(p)
+#define ITCH_SCHEMA_RD_U32(p, d)  (d) = itch_read_u32(p)
+#define ITCH_SCHEMA_RD_U64(p, d)  (d) = itch_read_u64(p)
+#define ITCH_SCHEMA_RD_S16(p, d)  (d) = itch_read_u16(p)
+#define ITCH_SCHEMA_RD_P16(p, d)  (d) = (uint32_t)itch_read_u16(p) * ITTO_SHORT_PRICE_SCALE
+#define ITCH_SCHEMA_RD_A2(p, d)   memcpy((d), (p), 2)
+#define ITCH_SCHEMA_RD_A3(p, d)   memcpy((d), (p), 3)
+#define ITCH_SCHEMA_RD_A4(p, d)   memcpy((d), (p), 4)
+#define ITCH_SCHEMA_RD_A6(p, d)   memcpy((d), (p), 6)
+#define ITCH_SCHEMA_RD_A8(p, d)   memcpy((d), (p), 8)
+#define ITCH_SCHEMA_RD_A13(p, d)  memcpy((d), (p), 13)
+
+#define ITCH_SCHEMA_WR_CHAR(p, s) (p)[0] = (uint8_t)(s)
+#define ITCH_SCHEMA_WR_U8(p, s)   (p)[0] = (s)
+#define ITCH_SCHEMA_WR_U16(p, s)  itch_write_u16((p), (s))
+#define ITCH_SCHEMA_WR_U32(p, s)  itch_write_u32((p), (s))
+#define ITCH_SCHEMA_WR_U64(p, s)  itch_write_u64((p), (s))
+#define ITCH_SCHEMA_WR_S16(p, s)  itch_write_u16((p), (uint16_t)(s))
+#define ITCH_SCHEMA_WR_P16(p, s)  itch_write_u16((p), (uint16_t)((s) / ITTO_SHORT_PRICE_SCALE))
+#define ITCH_SCHEMA_WR_A2(p, s)   memcpy((p), (s), 2)
+#define ITCH_SCHEMA_WR_A3(p, s)   memcpy((p), (s), 3)
+#define ITCH_SCHEMA_WR_A4(p, s)   memcpy((p), (s), 4)
+#define ITCH_SCHEMA_WR_A6(p, s)   memcpy((p), (s), 6)
+#define ITCH_SCHEMA_WR_A8(p, s)   memcpy((p), (s), 8)
+#define ITCH_SCHEMA_WR_A13(p, s)  memcpy((p), (s), 13)
+
+/* Per-field generators, applied to a field list: FIELDS(ITCH_SCHEMA_DECL).
+ * READ and WRITE expect `msg`, `m` and a `wire_t` typedef in scope. */
+#define ITCH_SCHEMA_DECL(kind, name)  ITCH_SCHEMA_DECL_##kind(name)
+#define ITCH_SCHEMA_WIRE(kind, name)  uint8_t name[ITCH_SCHEMA_W_##kind];
+#define ITCH_SCHEMA_READ(kind, name)  ITCH_SCHEMA_RD_##kind(msg + offsetof(wire_t, name), m->name);
+#define ITCH_SCHEMA_WRITE(kind, name) ITCH_SCHEMA_WR_##kind(msg + offsetof(wire_t, name), m->name);
+
+#endif /* ITCH_SCHEMA_H */
@@ -0,0 +1,288 @@
+/*
+ * ITCH Snapshots - see itch_snap.h
+ *
+ * One pass: every message goes through an order book, and the latest R and
+ * H of each locate are kept raw. At each interval boundary the live orders
+ * and those messages are appended to the file. The entry table goes after
+ * the last snapshot and the header, magic included, is written last.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "itch_snap.h"
+#include "itch_parser.h"
+
+#define SNAP_ALIGN 64
+#define SNAP_LOCATES 65536
+#define R_LEN 39
+#define H_LEN 25
+
+/* 6-byte timestamp without the 8-byte over-read, as in the index builder */
+static inline uint64_t message_timestamp(const uint8_t *msg) {
+    return ((uint64_t)itch_read_u16(msg + 5) << 32) | itch_read_u32(msg + 7);
+}
+
+typedef struct {
+    FILE *out;
+    uint64_t pos;
+    order_book_t *book;
+    order_book_order_t *orders;
+    size_t orders_cap;
+    uint8_t *last_r;            // latest R per locate
+    uint8_t *last_h;            // latest H per locate
+    uint8_t *seen;              // bit 0: R kept, bit 1: H kept
+    uint8_t *directory;         // one snapshot's directory messages
+    itch_snap_entry_t *entries;
+    size_t count;
+    size_t cap;
+} snap_builder_t;
+
+static void builder_free(snap_builder_t *b) {
+    order_book_destroy(b->book);
+    free(b->orders);
+    free(b->last_r);
+    free(b->last_h);
+    free(b->seen);
+    free(b->directory);
+    free(b->entries);
+}
+
+/* Append len bytes and pad to the next section boundary */
+static int append(snap_builder_t *b, const void *data, size_t len) {
+    static const uint8_t zeros[SNAP_ALIGN];
+    size_t pad = (SNAP_ALIGN - (b->pos + len) % SNAP_ALIGN) % SNAP_ALIGN;
+    if ((len && fwrite(data, 1, len, b->out) != len) || (pad && fwrite(zeros, 1, pad, b->out) != pad)) {
+        return -1;
+    }
+    b->pos += len + pad;
+    return 0;
+}
+
+static int take_snapshot(snap_builder_t *b, uint64_t timestamp, uint64_t file_offset, uint64_t messages) {
+    order_book_stats_t bs;
+    order_book_get_stats(b->book, &bs);
+    if (bs.live_orders > b->orders_cap) {
+        size_t cap = bs.live_orders + bs.live_orders / 4;
+        order_book_order_t *o = realloc(b->orders, cap * sizeof(order_book_order_t));
+        if (!o) return -1;
+        b->orders = o;
+        b->orders_cap = cap;
+    }
+    if (b->count == b->cap) {
+        size_t cap = b->cap ? b->cap * 2 : 64;
+        itch_snap_entry_t *e = realloc(b->entries, cap * sizeof(itch_snap_entry_t));
+        if (!e) return -1;
+        b->entries = e;
+        b->cap = cap;
+    }
+
+    size_t dir_bytes = 0;
+    for (uint32_t l = 0; l < SNAP_LOCATES; l++) {
+        if (!(b->seen[l] & 1)) continue;
+        memcpy(b->directory + dir_bytes, b->last_r + (size_t)l * R_LEN, R_LEN);
+        dir_bytes += R_LEN;
+    }
+    for (uint32_t l = 0; l < SNAP_LOCATES; l++) {
+        if (!(b->seen[l] & 2)) continue;
+        memcpy(b->directory + dir_bytes, b->last_h + (size_t)l * H_LEN, H_LEN);
+        dir_bytes += H_LEN;
+    }
+
+    itch_snap_entry_t *e = &b->entries[b->count++];
+    memset(e, 0, sizeof(*e));
+    e->timestamp = timestamp;
+    e->file_offset = file_offset;
+    e->messages = messages;
+    e->orders = order_book_save(b->book, b->orders);
+    e->orders_offset = b->pos;
+    if (append(b, b->orders, e->orders * sizeof(order_book_order_t)) < 0) return -1;
+    e->directory_offset = b->pos;
+    e->directory_bytes = dir_bytes;
+    return append(b, b->directory, dir_bytes);
+}
+
+long itch_snap_build(const uint8_t *data, size_t size, itch_framing_t framing,
+                     uint64_t interval_ns, const char *out_path) {
+    snap_builder_t b;
+    memset(&b, 0, sizeof(b));
+    if (!interval_ns) interval_ns = ITCH_SNAP_DEFAULT_INTERVAL_NS;
+    b.book = order_book_create(NULL);
+    b.last_r = malloc((size_t)SNAP_LOCATES * R_LEN);
+    b.last_h = malloc((size_t)SNAP_LOCATES * H_LEN);
+    b.seen = calloc(SNAP_LOCATES, 1);
+    b.directory = malloc((size_t)SNAP_LOCATES * (R_LEN + H_LEN));
+    if (!b.book || !b.last_r || !b.last_h || !b.seen || !b.directory) {
+        fprintf(stderr, "Snapshot: out of memory\n");
+        builder_free(&b);
+        return -1;
+    }
+    b.out = fopen(out_path, "wb");
+    if (!b.out) {
+        fprintf(stderr, "Snapshot: cannot create %s (%s)\n", out_path, strerror(errno));
+        builder_free(&b);
+        return -1;
+    }
+
+    itch_snap_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    int rc = append(&b, &hdr, sizeof(hdr));
+
+    itch_framer_t f;
+    itch_framer_init(&f, framing);
+    size_t pos = 0;
+    size_t unit = 0;
+    int fresh = 1;              // nothing framed from the current unit yet
+    uint64_t messages = 0;
+    uint64_t next = 0;
+    while (rc == 0 && pos < size) {
+        // A MoldUDP64 reader can only resume at a packet header
+        if (framing != FRAMING_MOLDUDP64 || f.mold_remaining == 0) {
+            unit = pos;
+            fresh = 1;
+        }
+        const uint8_t *msg;
+        size_t len;
+        size_t used = itch_frame_next(&f, data + pos, size - pos, &msg, &len);
+        if (used == 0) break;
+        pos += used;
+        if (len < 11) continue;
+
+        uint64_t ts = message_timestamp(msg);
+        if (next == 0) {
+            next = (ts / interval_ns + 1) * interval_ns;
+        } else if (ts >= next && fresh) {
+            rc = take_snapshot(&b, ts, unit, messages);
+            next = (ts / interval_ns + 1) * interval_ns;
+        }
+        fresh = 0;
+
+        order_book_process(b.book, msg, len);
+        uint16_t locate = itch_read_u16(msg + 1);
+        if (msg[0] == 'R' && len >= R_LEN) {
+            memcpy(b.last_r + (size_t)locate * R_LEN, msg, R_LEN);
+            b.seen[locate] |= 1;
+        } else if (msg[0] == 'H' && len >= H_LEN) {
+            memcpy(b.last_h + (size_t)locate * H_LEN, msg, H_LEN);
+            b.seen[locate] |= 2;
+        }
+        messages++;
+    }
+    itch_framer_print_stats(&f);
+
+    order_book_stats_t bs;
+    order_book_get_stats(b.book, &bs);
+    if (bs.pool_exhausted) {
+        fprintf(stderr, "Snapshot: order book full, %lu adds dropped; snapshots are incomplete\n",
+                bs.pool_exhausted);
+    }
+
+    hdr.version = ITCH_SNAP_VERSION;
+    hdr.framing = (uint32_t)framing;
+    hdr.source_size = size;
+    hdr.interval_ns = interval_ns;
+    hdr.count = b.count;
+    hdr.entries_offset = b.pos;
+    if (rc == 0) rc = append(&b, b.entries, b.count * sizeof(itch_snap_entry_t));
+    hdr.file_size = b.pos;
+    memcpy(hdr.magic, ITCH_SNAP_MAGIC, 8);
+    if (rc == 0 && (fseek(b.out, 0, SEEK_SET) < 0 || fwrite(&hdr, sizeof(hdr), 1, b.out) != 1)) rc = -1;
+    if (fclose(b.out) != 0) rc = -1;
+    if (rc < 0) fprintf(stderr, "Snapshot: cannot write %s (%s)\n", out_path, strerror(errno));
+
+    long count = (long)b.count;
+    builder_free(&b);
+    return rc < 0 ? -1 : count;
+}
+
+/* n elements of elem bytes at off lie inside size bytes, aligned for loads */
+static int section_fits(uint64_t off, uint64_t n, uint64_t elem, size_t size) {
+    return off % 8 == 0 && off <= size && n <= (size - off) / elem;
+}
+
+/* Every offset in the header and entry table stays inside the mapping, so
+ * find and load never leave it whatever the file holds */
+static int snap_valid(const itch_snap_header_t *h, const uint8_t *base, size_t size) {
+    if (memcmp(h->magic, ITCH_SNAP_MAGIC, 8) != 0 || h->version != ITCH_SNAP_VERSION ||
+        h->file_size != size ||
+        !section_fits(h->entries_offset, h->count, sizeof(itch_snap_entry_t), size)) {
+        return 0;
+    }
+    const itch_snap_entry_t *entries = (const itch_snap_entry_t *)(base + h->entries_offset);
+    for (uint64_t i = 0; i < h->count; i++) {
+        const itch_snap_entry_t *e = &entries[i];
+        if (e->file_offset > h->source_size ||
+            !section_fits(e->orders_offset, e->orders, sizeof(order_book_order_t), size) ||
+            !section_fits(e->directory_offset, e->directory_bytes, 1, size)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int itch_snap_open(itch_snap_t *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    s->fd = open(path, O_RDONLY);
+    if (s->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(s->fd, &st) < 0 || (size_t)st.st_size < sizeof(itch_snap_header_t)) {
+        itch_snap_close(s);
+        return -1;
+    }
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, s->fd, 0);
+    if (base == MAP_FAILED) {
+        itch_snap_close(s);
+        return -1;
+    }
+    s->base = base;
+    s->size = (size_t)st.st_size;
+
+    const itch_snap_header_t *h = base;
+    if (!snap_valid(h, s->base, s->size)) {
+        errno = EINVAL;
+        itch_snap_close(s);
+        return -1;
+    }
+    s->header = h;
+    s->entries = (const itch_snap_entry_t *)(s->base + h->entries_offset);
+    return 0;
+}
+
+void itch_snap_close(itch_snap_t *s) {
+    if (s->base) munmap((void *)s->base, s->size);
+    if (s->fd >= 0) close(s->fd);
+    memset(s, 0, sizeof(*s));
+    s->fd = -1;
+}
+
+const itch_snap_entry_t *itch_snap_find(const itch_snap_t *s, uint64_t ts) {
+    size_t lo = 0, hi = s->header->count;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (s->entries[mid].timestamp <= ts) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo ? &s->entries[lo - 1] : NULL;
+}
+
+int itch_snap_load(const itch_snap_t *s, const itch_snap_entry_t *e, order_book_t *book, itch_directory_t *dir) {
+    if (dir) {
+        const uint8_t *p = itch_snap_directory(s, e);
+        const uint8_t *end = p + e->directory_bytes;
+        while (p < end) {
+            size_t n = itch_message_lengths[*p];
+            if (n == 0 || n > (size_t)(end - p)) break;
+            itch_directory_update(dir, p, n);
+            p += n;
+        }
+    }
+    if (book) return order_book_load(book, itch_snap_orders(s, e), e->orders, e->timestamp);
+    return 0;
+}
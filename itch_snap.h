@@ -0,0 +1,102 @@
+/*
+ * ITCH Snapshots - order book checkpoints for starting a replay mid-day
+ *
+ * Book state depends on every add, cancel and execute since the open, so a
+ * replay that starts at 14:00 normally has to rebuild the book from the
+ * first message. A snapshot file, written once per day file by itch_snapshot,
+ * holds the book at fixed feed-time intervals: every live order plus the
+ * directory messages (the latest R and H per stockLocate) seen so far. A
+ * reader maps the file, picks the last snapshot at or before its start time,
+ * loads it, and resumes at the snapshot's file offset.
+ *
+ * File layout (every section 64-byte aligned):
+ *
+ *   itch_snap_header_t
+ *   per snapshot:
+ *     orders       order_book_order_t x orders
+ *     directory    R and H messages, back to back (types give the lengths)
+ *   entries        itch_snap_entry_t x count
+ *
+ * A snapshot is taken just before the first message at or after each
+ * interval boundary: it holds every message before file_offset, and
+ * timestamp is the feed time of the message at file_offset. The offset is a
+ * framing boundary, as in the index (a packet start for MoldUDP64).
+ *
+ * Usage:
+ *   itch_snap_t s;
+ *   itch_snap_open(&s, "day.itch.snap");
+ *   const itch_snap_entry_t *e = itch_snap_find(&s, 14 * 3600 * 1000000000ULL);
+ *   itch_snap_load(&s, e, book, dir);          // then read the file from e->file_offset
+ *   itch_snap_close(&s);
+ */
+
+#ifndef ITCH_SNAP_H
+#define ITCH_SNAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "itch_framing.h"
+#include "order_book.h"
+#include "itch_directory.h"
+
+#define ITCH_SNAP_MAGIC "ITCHSNP1"
+#define ITCH_SNAP_VERSION 1
+#define ITCH_SNAP_DEFAULT_INTERVAL_NS (600ULL * 1000000000ULL)   // 10 minutes
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t framing;           // itch_framing_t of the source
+    uint64_t source_size;       // must match the file being replayed
+    uint64_t interval_ns;
+    uint64_t count;
+    uint64_t entries_offset;
+    uint64_t file_size;
+} itch_snap_header_t;
+
+typedef struct {
+    uint64_t timestamp;         // feed time of the message at file_offset
+    uint64_t file_offset;       // resume here
+    uint64_t messages;          // messages before file_offset
+    uint64_t orders;
+    uint64_t orders_offset;
+    uint64_t directory_bytes;
+    uint64_t directory_offset;
+    uint64_t reserved;
+} itch_snap_entry_t;
+
+typedef struct {
+    const uint8_t *base;
+    size_t size;
+    const itch_snap_header_t *header;
+    const itch_snap_entry_t *entries;
+    int fd;
+} itch_snap_t;
+
+/* Replay data[0, size) through an order book and write a snapshot every
+ * interval_ns of feed time (0 = default) into out_path. Returns the number
+ * of snapshots, or -1 on error (message on stderr). */
+long itch_snap_build(const uint8_t *data, size_t size, itch_framing_t framing,
+                     uint64_t interval_ns, const char *out_path);
+
+/* Map a snapshot file read-only, checking every entry lies inside it.
+ * Returns 0, or -1 if missing or invalid. */
+int itch_snap_open(itch_snap_t *s, const char *path);
+void itch_snap_close(itch_snap_t *s);
+
+/* The last snapshot whose timestamp is at or before ts, or NULL */
+const itch_snap_entry_t *itch_snap_find(const itch_snap_t *s, uint64_t ts);
+
+/* Apply a snapshot to an empty book and/or directory (either may be NULL).
+ * Returns 0, or -1 if the book ran out of room. */
+int itch_snap_load(const itch_snap_t *s, const itch_snap_entry_t *e, order_book_t *book, itch_directory_t *dir);
+
+static inline const order_book_order_t *itch_snap_orders(const itch_snap_t *s, const itch_snap_entry_t *e) {
+    return (const order_book_order_t *)(s->base + e->orders_offset);
+}
+
+static inline const uint8_t *itch_snap_directory(const itch_snap_t *s, const itch_snap_entry_t *e) {
+    return s->base + e->directory_offset;
+}
+
+#endif /* ITCH_SNAP_H */
@@ -0,0 +1,75 @@
+/*
+ * ITCH Stream - see itch_stream.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "itch_stream.h"
+
+/* Map one memfd twice, back to back. Returns the base or NULL. */
+static uint8_t *map_mirrored(size_t size) {
+    int fd = memfd_create("itch_stream", MFD_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (ftruncate(fd, (off_t)size) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    // Reserve both halves, then map the same pages over each
+    uint8_t *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+    if (mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        close(fd);
+        return NULL;
+    }
+    close(fd);      // the mappings keep the pages
+    return base;
+}
+
+int itch_stream_init(itch_stream_t *s, size_t size, itch_framing_t framing) {
+    memset(s, 0, sizeof(*s));
+    itch_framer_init(&s->framer, framing);
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t n = page;
+    while (n < size) n <<= 1;
+
+    s->base = map_mirrored(n);
+    if (s->base) {
+        s->size = n;
+        s->mask = n - 1;
+        s->mirrored = 1;
+        return 0;
+    }
+
+    s->base = malloc(n + ITCH_STREAM_SLACK);
+    if (!s->base) return -1;
+    memset(s->base + n, 0, ITCH_STREAM_SLACK);
+    s->size = n;
+    s->mask = ~(uint64_t)0;
+    return 0;
+}
+
+void itch_stream_free(itch_stream_t *s) {
+    if (!s->base) return;
+    if (s->mirrored) munmap(s->base, 2 * s->size);
+    else free(s->base);
+    s->base = NULL;
+}
+
+void itch_stream_compact(itch_stream_t *s) {
+    if (s->mirrored || s->rd == 0) return;
+    size_t pending = itch_stream_pending(s);
+    memmove(s->base, s->base + s->rd, pending);
+    s->rd = 0;
+    s->wr = pending;
+}
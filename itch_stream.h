@@ -0,0 +1,93 @@
+/*
+ * ITCH Stream - framed reading from a socket or decompressor without memmove
+ *
+ * Bytes are read into a ring whose backing pages are mapped twice, back to
+ * back. Any span of up to `size` bytes starting anywhere in the first copy
+ * is contiguous in memory, so a message that wraps the end of the ring is
+ * still handed out as one pointer: nothing is ever split, copied or
+ * compacted. Read and write positions only move forward.
+ *
+ * Where the double mapping is unavailable (no memfd), the stream falls back
+ * to a flat buffer that is compacted only when the free space after the
+ * data runs short (then only the unread tail, usually a partial message,
+ * moves), not once per read.
+ *
+ * Message pointers stay valid until the next itch_stream_fill_ptr. There
+ * are always at least 8 readable bytes past the unread data for the
+ * 8-byte timestamp load.
+ *
+ * Usage:
+ *   itch_stream_t s;
+ *   itch_stream_init(&s, 1 << 20, FRAMING_RAW);
+ *   for (;;) {
+ *       size_t space;
+ *       uint8_t *p = itch_stream_fill_ptr(&s, &space);
+ *       ssize_t n = recv(fd, p, space, 0);
+ *       if (n <= 0) break;
+ *       itch_stream_filled(&s, n);
+ *       while (itch_stream_next(&s, &msg, &len)) { ... }
+ *   }
+ *   itch_stream_free(&s);
+ */
+
+#ifndef ITCH_STREAM_H
+#define ITCH_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "itch_framing.h"
+
+#define ITCH_STREAM_DEFAULT_SIZE (1 << 20)
+#define ITCH_STREAM_SLACK 8
+
+typedef struct {
+    uint8_t *base;
+    size_t size;            // ring size (power of two, page multiple)
+    uint64_t mask;          // size - 1 when mirrored, all ones for the flat buffer
+    uint64_t rd;            // next byte to frame
+    uint64_t wr;            // next byte to fill
+    int mirrored;
+    itch_framer_t framer;   // skip/mismatch counters live here
+} itch_stream_t;
+
+/* Returns 0, or -1 if no buffer could be allocated */
+int itch_stream_init(itch_stream_t *s, size_t size, itch_framing_t framing);
+void itch_stream_free(itch_stream_t *s);
+
+/* Flat buffer only: move the unread bytes to the front */
+void itch_stream_compact(itch_stream_t *s);
+
+/* Unframed bytes (a partial message once itch_stream_next returns 0) */
+static inline size_t itch_stream_pending(const itch_stream_t *s) {
+    return (size_t)(s->wr - s->rd);
+}
+
+/* Where the next read should land and how many bytes fit there */
+static inline uint8_t *itch_stream_fill_ptr(itch_stream_t *s, size_t *space) {
+    if (s->mirrored) {
+        *space = s->size - ITCH_STREAM_SLACK - itch_stream_pending(s);
+        return s->base + (s->wr & s->mask);
+    }
+    if (s->size - s->wr < s->size / 2) itch_stream_compact(s);
+    *space = s->size - s->wr;
+    return s->base + s->wr;
+}
+
+static inline void itch_stream_filled(itch_stream_t *s, size_t n) {
+    s->wr += n;
+}
+
+/* Frame the next complete message. Returns 1 with msg/len set, 0 when the
+ * rest is a partial message (or nothing). */
+static inline int itch_stream_next(itch_stream_t *s, const uint8_t **msg, size_t *len) {
+    while (s->rd < s->wr) {
+        size_t used = itch_frame_next(&s->framer, s->base + (s->rd & s->mask),
+                                      itch_stream_pending(s), msg, len);
+        if (used == 0) return 0;
+        s->rd += used;
+        if (*len) return 1;
+    }
+    return 0;
+}
+
+#endif /* ITCH_STREAM_H */
@@ -0,0 +1,660 @@
+/*
+ * Options Book - see itto_book.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "itto_book.h"
+#include "order_map.h"
+#include "itto_parser.h"
+
+#define DEFAULT_MAX_ORDERS (1u << 22)
+#define DEFAULT_MAX_LEVELS (1u << 20)
+#define DEFAULT_MAX_OPTIONS (1u << 16)
+#define POOL_NIL SLAB_POOL_NIL
+
+enum { SIDE_BID = 0, SIDE_ASK = 1 };
+
+/* An order, or one side of a quote (32 bytes) */
+typedef struct {
+    uint64_t ref;
+    uint32_t volume;
+    uint32_t price;
+    uint32_t level;         // level pool index
+    uint32_t option;        // dense series index
+    uint32_t pair;          // other side of the quote, POOL_NIL for orders
+    uint8_t side;
+    uint8_t pad[3];
+} ib_order_t;
+
+typedef struct {
+    uint64_t volume;
+    uint32_t price;
+    uint32_t orders;        // live orders at this level
+} ib_level_t;
+
+/* A side's level index with its sort key inline, so a search stays inside
+ * the side array instead of chasing every probe into the level pool */
+typedef struct {
+    uint32_t key;
+    uint32_t level;
+} ib_slot_t;
+
+/* Levels sorted worst -> best, so the top of book is slots[count - 1] */
+typedef struct {
+    ib_slot_t *slots;
+    uint32_t count;
+    uint32_t cap;
+} ib_side_t;
+
+/* One series: both sides plus the last published top (one cache line) */
+typedef struct {
+    ib_side_t side[2];
+    uint32_t optionId;
+    uint32_t topBidPrice;
+    uint32_t topAskPrice;
+    uint32_t pad;
+    uint64_t topBidSize;
+    uint64_t topAskSize;
+} ib_option_t;
+
+struct itto_book {
+    slab_pool_t order_pool;
+    ib_order_t *orders;     // order_pool's slots
+    slab_pool_t level_pool;
+    ib_level_t *levels;
+
+    order_map_t map;
+
+    // optionId -> dense index + 1 (0 = not seen), then dense index -> series
+    uint32_t *dense;
+    uint32_t dense_cap;
+    ib_option_t *options;
+    uint32_t option_count;
+    uint32_t option_cap;
+
+    itto_book_top_cb on_top;
+    void *ctx;
+    itto_book_stats_t stats;
+};
+
+/* Sort key that is ascending towards the best price on either side */
+static inline uint32_t level_key(int side, uint32_t price) {
+    return side == SIDE_BID ? price : ~price;
+}
+
+/* Series directory */
+
+static uint32_t find_option(const itto_book_t *ob, uint32_t optionId) {
+    if (optionId >= ob->dense_cap || ob->dense[optionId] == 0) return POOL_NIL;
+    return ob->dense[optionId] - 1;
+}
+
+static uint32_t register_option(itto_book_t *ob, uint32_t optionId) {
+    if (optionId >= ITTO_BOOK_MAX_OPTION_ID) {
+        ob->stats.bad_options++;
+        return POOL_NIL;
+    }
+
+    if (optionId >= ob->dense_cap) {
+        uint32_t cap = ob->dense_cap ? ob->dense_cap : 1024;
+        while (cap <= optionId) cap *= 2;
+        uint32_t *grown = realloc(ob->dense, (size_t)cap * sizeof(uint32_t));
+        if (!grown) return POOL_NIL;
+        memset(grown + ob->dense_cap, 0, (size_t)(cap - ob->dense_cap) * sizeof(uint32_t));
+        ob->dense = grown;
+        ob->dense_cap = cap;
+    }
+    if (ob->dense[optionId]) return ob->dense[optionId] - 1;
+
+    if (ob->option_count == ob->option_cap) {
+        uint32_t cap = ob->option_cap * 2;
+        ib_option_t *grown = realloc(ob->options, (size_t)cap * sizeof(ib_option_t));
+        if (!grown) return POOL_NIL;
+        ob->options = grown;
+        ob->option_cap = cap;
+    }
+
+    uint32_t idx = ob->option_count++;
+    memset(&ob->options[idx], 0, sizeof(ib_option_t));
+    ob->options[idx].optionId = optionId;
+    ob->dense[optionId] = idx + 1;
+    ob->stats.options++;
+    return idx;
+}
+
+/* Dense index for optionId, registering the series on first sight */
+static inline uint32_t option_index(itto_book_t *ob, uint32_t optionId) {
+    if (optionId < ob->dense_cap && ob->dense[optionId]) return ob->dense[optionId] - 1;
+    return register_option(ob, optionId);
+}
+
+/* Pool management */
+
+static inline uint32_t alloc_order(itto_book_t *ob) {
+    return slab_pool_alloc(&ob->order_pool);
+}
+
+static inline void free_order(itto_book_t *ob, uint32_t idx) {
+    slab_pool_free(&ob->order_pool, idx);
+}
+
+static inline uint32_t alloc_level(itto_book_t *ob) {
+    return slab_pool_alloc(&ob->level_pool);
+}
+
+static inline void free_level(itto_book_t *ob, uint32_t idx) {
+    slab_pool_free(&ob->level_pool, idx);
+}
+
+/* Price level arrays */
+
+/* First position whose key is >= key (binary search over the sorted side) */
+static uint32_t side_lower_bound(const ib_side_t *s, uint32_t key) {
+    uint32_t lo = 0, hi = s->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (s->slots[mid].key < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Find the level for price, creating it if needed. Returns POOL_NIL on exhaustion. */
+static uint32_t side_get_level(itto_book_t *ob, ib_side_t *s, int side, uint32_t price) {
+    uint32_t key = level_key(side, price);
+
+    // Fast path: top of book
+    if (s->count > 0 && s->slots[s->count - 1].key == key) return s->slots[s->count - 1].level;
+
+    uint32_t pos = side_lower_bound(s, key);
+    if (pos < s->count && s->slots[pos].key == key) return s->slots[pos].level;
+
+    if (s->count == s->cap) {
+        // Options books are shallow: start small, there may be a million of them
+        uint32_t cap = s->cap ? s->cap * 2 : 4;
+        ib_slot_t *grown = realloc(s->slots, cap * sizeof(ib_slot_t));
+        if (!grown) return POOL_NIL;
+        s->slots = grown;
+        s->cap = cap;
+    }
+
+    uint32_t lvl = alloc_level(ob);
+    if (lvl == POOL_NIL) return POOL_NIL;
+    ob->levels[lvl].price = price;
+    ob->levels[lvl].volume = 0;
+    ob->levels[lvl].orders = 0;
+
+    // Shift the better levels (the short tail) up by one
+    memmove(&s->slots[pos + 1], &s->slots[pos], (s->count - pos) * sizeof(ib_slot_t));
+    s->slots[pos].key = key;
+    s->slots[pos].level = lvl;
+    s->count++;
+    ob->stats.live_levels++;
+    return lvl;
+}
+
+static void side_remove_level(itto_book_t *ob, ib_side_t *s, int side, uint32_t lvl) {
+    uint32_t pos;
+    if (s->slots[s->count - 1].level == lvl) {
+        pos = s->count - 1;
+    } else {
+        pos = side_lower_bound(s, level_key(side, ob->levels[lvl].price));
+    }
+    memmove(&s->slots[pos], &s->slots[pos + 1], (s->count - pos - 1) * sizeof(ib_slot_t));
+    s->count--;
+    free_level(ob, lvl);
+    ob->stats.live_levels--;
+}
+
+/* Top of book publication */
+
+static void fill_top(const itto_book_t *ob, const ib_option_t *o, itto_book_top_t *t) {
+    const ib_side_t *bid = &o->side[SIDE_BID];
+    const ib_side_t *ask = &o->side[SIDE_ASK];
+    t->optionId = o->optionId;
+    t->bidPrice = 0;
+    t->bidSize = 0;
+    t->askPrice = 0;
+    t->askSize = 0;
+    if (bid->count) {
+        const ib_level_t *l = &ob->levels[bid->slots[bid->count - 1].level];
+        t->bidPrice = l->price;
+        t->bidSize = l->volume;
+    }
+    if (ask->count) {
+        const ib_level_t *l = &ob->levels[ask->slots[ask->count - 1].level];
+        t->askPrice = l->price;
+        t->askSize = l->volume;
+    }
+}
+
+static void check_top(itto_book_t *ob, uint32_t option, uint64_t timestamp) {
+    ib_option_t *o = &ob->options[option];
+    itto_book_top_t t;
+    fill_top(ob, o, &t);
+
+    if (t.bidPrice == o->topBidPrice && t.bidSize == o->topBidSize &&
+        t.askPrice == o->topAskPrice && t.askSize == o->topAskSize) {
+        return;
+    }
+
+    o->topBidPrice = t.bidPrice;
+    o->topBidSize = t.bidSize;
+    o->topAskPrice = t.askPrice;
+    o->topAskSize = t.askSize;
+    ob->stats.top_updates++;
+
+    if (ob->on_top) {
+        t.timestamp = timestamp;
+        ob->on_top(&t, ob->ctx);
+    }
+}
+
+/* Order operations */
+
+static void link_quote(itto_book_t *ob, uint32_t bid, uint32_t ask) {
+    ob->orders[bid].pair = ask;
+    ob->orders[ask].pair = bid;
+    ob->stats.live_quotes++;
+}
+
+/* Take volume off an order; removes it (and possibly its level) when it
+ * reaches zero, leaving the other side of a quote standing alone */
+static void reduce_order(itto_book_t *ob, uint32_t idx, uint32_t volume) {
+    ib_order_t *o = &ob->orders[idx];
+    ib_level_t *l = &ob->levels[o->level];
+
+    if (volume > o->volume) volume = o->volume;
+    o->volume -= volume;
+    l->volume -= volume;
+
+    if (o->volume == 0) {
+        ib_side_t *s = &ob->options[o->option].side[o->side];
+        if (--l->orders == 0) side_remove_level(ob, s, o->side, o->level);
+        if (o->pair != POOL_NIL) {
+            ob->orders[o->pair].pair = POOL_NIL;
+            ob->stats.live_quotes--;
+        }
+        order_map_erase(&ob->map, o->ref);
+        free_order(ob, idx);
+        ob->stats.live_orders--;
+    }
+}
+
+/* Returns the pool index of the new order, or POOL_NIL */
+static uint32_t insert_order(itto_book_t *ob, uint32_t option, uint64_t ref,
+                             int side, uint32_t volume, uint32_t price) {
+    // A live ref is never overwritten: its order would leak with its volume on the level
+    if (order_map_find(&ob->map, ref) != ORDER_MAP_EMPTY) {
+        ob->stats.duplicate_refs++;
+        return POOL_NIL;
+    }
+    uint32_t idx = alloc_order(ob);
+    if (idx == POOL_NIL) {
+        ob->stats.pool_exhausted++;
+        return POOL_NIL;
+    }
+
+    ib_side_t *s = &ob->options[option].side[side];
+    uint32_t lvl = side_get_level(ob, s, side, price);
+    if (lvl == POOL_NIL) {
+        free_order(ob, idx);
+        ob->stats.pool_exhausted++;
+        return POOL_NIL;
+    }
+
+    ib_order_t *o = &ob->orders[idx];
+    o->ref = ref;
+    o->volume = volume;
+    o->price = price;
+    o->level = lvl;
+    o->option = option;
+    o->pair = POOL_NIL;
+    o->side = (uint8_t)side;
+
+    ob->levels[lvl].volume += volume;
+    ob->levels[lvl].orders++;
+    order_map_insert(&ob->map, ref, idx);
+    ob->stats.live_orders++;
+    return idx;
+}
+
+/* Give an order a new ref, volume and price on the same side, keeping its
+ * quote pairing. Returns its pool index afterwards, POOL_NIL if it is gone. */
+static uint32_t rewrite_order(itto_book_t *ob, uint32_t idx, uint64_t ref,
+                              uint32_t volume, uint32_t price) {
+    ib_order_t *o = &ob->orders[idx];
+
+    // The new ref is live already: the original still goes, the replacement is dropped
+    if (o->ref != ref && order_map_find(&ob->map, ref) != ORDER_MAP_EMPTY) {
+        ob->stats.duplicate_refs++;
+        reduce_order(ob, idx, o->volume);
+        return POOL_NIL;
+    }
+
+    // Same price: rewrite the order in place and keep its level
+    if (o->price == price && volume > 0) {
+        ib_level_t *l = &ob->levels[o->level];
+        l->volume = l->volume - o->volume + volume;
+        o->volume = volume;
+        if (o->ref != ref) {
+            order_map_erase(&ob->map, o->ref);
+            order_map_insert(&ob->map, ref, idx);
+            o->ref = ref;
+        }
+        return idx;
+    }
+
+    uint32_t option = o->option;
+    uint32_t pair = o->pair;
+    int side = o->side;
+    reduce_order(ob, idx, o->volume);
+    if (volume == 0) return POOL_NIL;
+
+    uint32_t n = insert_order(ob, option, ref, side, volume, price);
+    if (n != POOL_NIL && pair != POOL_NIL) link_quote(ob, n, pair);
+    return n;
+}
+
+int itto_book_add_option(itto_book_t *ob, uint32_t optionId) {
+    return option_index(ob, optionId) == POOL_NIL ? -1 : 0;
+}
+
+int itto_book_add_order(itto_book_t *ob, uint64_t timestamp, uint32_t optionId,
+                        uint64_t refNum, char side, uint32_t volume, uint32_t price) {
+    ob->stats.adds++;
+    uint32_t option = option_index(ob, optionId);
+    if (option == POOL_NIL) return -1;
+    if (insert_order(ob, option, refNum, side == 'S' ? SIDE_ASK : SIDE_BID, volume, price) == POOL_NIL) {
+        return -1;
+    }
+    check_top(ob, option, timestamp);
+    return 0;
+}
+
+int itto_book_add_quote(itto_book_t *ob, uint64_t timestamp, uint32_t optionId,
+                        uint64_t bidRefNum, uint32_t bidPrice, uint32_t bidSize,
+                        uint64_t askRefNum, uint32_t askPrice, uint32_t askSize) {
+    ob->stats.quote_adds++;
+    uint32_t option = option_index(ob, optionId);
+    if (option == POOL_NIL) return -1;
+
+    uint32_t bid = POOL_NIL, ask = POOL_NIL;
+    int rc = 0;
+    if (bidSize && (bid = insert_order(ob, option, bidRefNum, SIDE_BID, bidSize, bidPrice)) == POOL_NIL) rc = -1;
+    if (askSize && (ask = insert_order(ob, option, askRefNum, SIDE_ASK, askSize, askPrice)) == POOL_NIL) rc = -1;
+    if (bid != POOL_NIL && ask != POOL_NIL) link_quote(ob, bid, ask);
+
+    check_top(ob, option, timestamp);
+    return rc;
+}
+
+int itto_book_execute(itto_book_t *ob, uint64_t timestamp, uint64_t refNum, uint32_t volume) {
+    ob->stats.executes++;
+    uint32_t idx = order_map_find(&ob->map, refNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[idx].option;
+    reduce_order(ob, idx, volume);
+    check_top(ob, option, timestamp);
+    return 0;
+}
+
+int itto_book_cancel(itto_book_t *ob, uint64_t timestamp, uint64_t refNum, uint32_t volume) {
+    ob->stats.cancels++;
+    uint32_t idx = order_map_find(&ob->map, refNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[idx].option;
+    reduce_order(ob, idx, volume);
+    check_top(ob, option, timestamp);
+    return 0;
+}
+
+int itto_book_delete(itto_book_t *ob, uint64_t timestamp, uint64_t refNum) {
+    ob->stats.deletes++;
+    uint32_t idx = order_map_find(&ob->map, refNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[idx].option;
+    reduce_order(ob, idx, ob->orders[idx].volume);
+    check_top(ob, option, timestamp);
+    return 0;
+}
+
+int itto_book_replace(itto_book_t *ob, uint64_t timestamp, uint64_t origRefNum,
+                      uint64_t newRefNum, uint32_t volume, uint32_t price) {
+    ob->stats.replaces++;
+    uint32_t idx = order_map_find(&ob->map, origRefNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[idx].option;
+    int rc = (rewrite_order(ob, idx, newRefNum, volume, price) == POOL_NIL && volume) ? -1 : 0;
+    check_top(ob, option, timestamp);
+    return rc;
+}
+
+int itto_book_update(itto_book_t *ob, uint64_t timestamp, uint64_t refNum,
+                     uint32_t volume, uint32_t price) {
+    ob->stats.updates++;
+    uint32_t idx = order_map_find(&ob->map, refNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[idx].option;
+    int rc = (rewrite_order(ob, idx, refNum, volume, price) == POOL_NIL && volume) ? -1 : 0;
+    check_top(ob, option, timestamp);
+    return rc;
+}
+
+int itto_book_quote_replace(itto_book_t *ob, uint64_t timestamp,
+                            uint64_t origBidRefNum, uint64_t newBidRefNum, uint32_t bidPrice, uint32_t bidSize,
+                            uint64_t origAskRefNum, uint64_t newAskRefNum, uint32_t askPrice, uint32_t askSize) {
+    ob->stats.quote_replaces++;
+    uint32_t bid = order_map_find(&ob->map, origBidRefNum);
+    uint32_t ask = order_map_find(&ob->map, origAskRefNum);
+    if (bid == ORDER_MAP_EMPTY && ask == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[bid != ORDER_MAP_EMPTY ? bid : ask].option;
+
+    // A side that was not quoted (size 0) comes back as a fresh insert
+    int rc = 0;
+    if (bid != ORDER_MAP_EMPTY) bid = rewrite_order(ob, bid, newBidRefNum, bidSize, bidPrice);
+    else if (bidSize) bid = insert_order(ob, option, newBidRefNum, SIDE_BID, bidSize, bidPrice);
+    else bid = POOL_NIL;
+    if (bid == POOL_NIL && bidSize) rc = -1;
+
+    if (ask != ORDER_MAP_EMPTY) ask = rewrite_order(ob, ask, newAskRefNum, askSize, askPrice);
+    else if (askSize) ask = insert_order(ob, option, newAskRefNum, SIDE_ASK, askSize, askPrice);
+    else ask = POOL_NIL;
+    if (ask == POOL_NIL && askSize) rc = -1;
+
+    if (bid != POOL_NIL && ask != POOL_NIL && ob->orders[bid].pair != ask) link_quote(ob, bid, ask);
+
+    check_top(ob, option, timestamp);
+    return rc;
+}
+
+int itto_book_quote_delete(itto_book_t *ob, uint64_t timestamp, uint64_t bidRefNum, uint64_t askRefNum) {
+    ob->stats.quote_deletes++;
+    uint32_t bid = order_map_find(&ob->map, bidRefNum);
+    uint32_t ask = order_map_find(&ob->map, askRefNum);
+    if (bid == ORDER_MAP_EMPTY && ask == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint32_t option = ob->orders[bid != ORDER_MAP_EMPTY ? bid : ask].option;
+    if (bid != ORDER_MAP_EMPTY) reduce_order(ob, bid, ob->orders[bid].volume);
+    if (ask != ORDER_MAP_EMPTY) reduce_order(ob, ask, ob->orders[ask].volume);
+    check_top(ob, option, timestamp);
+    return 0;
+}
+
+int itto_book_process(itto_book_t *ob, const uint8_t *msg, size_t len) {
+    if (len == 0) return 0;
+
+    switch (msg[0]) {
+        case 'R': {
+            if (len < 44) return -1;
+            ITTOOptionsDirectory m;
+            itto_decode_R(msg, &m);
+            return itto_book_add_option(ob, m.optionId);
+        }
+        case 'a':
+        case 'A': {
+            if (len < (msg[0] == 'a' ? 26u : 30u)) return -1;
+            ITTOAddOrder m;
+            if (msg[0] == 'a') itto_decode_a(msg, &m);
+            else itto_decode_A(msg, &m);
+            return itto_book_add_order(ob, m.header.timestamp, m.optionId, m.orderRefNum,
+                                       m.side, m.volume, m.price);
+        }
+        case 'j':
+        case 'J': {
+            if (len < (msg[0] == 'j' ? 37u : 45u)) return -1;
+            ITTOAddQuote m;
+            if (msg[0] == 'j') itto_decode_j(msg, &m);
+            else itto_decode_J(msg, &m);
+            return itto_book_add_quote(ob, m.header.timestamp, m.optionId,
+                                       m.bidRefNum, m.bidPrice, m.bidSize,
+                                       m.askRefNum, m.askPrice, m.askSize);
+        }
+        case 'E': {
+            if (len < 29) return -1;
+            ITTOOrderExecuted m;
+            itto_decode_E(msg, &m);
+            return itto_book_execute(ob, m.header.timestamp, m.refNum, m.volume);
+        }
+        case 'C': {
+            if (len < 34) return -1;
+            ITTOOrderExecutedWithPrice m;
+            itto_decode_C(msg, &m);
+            return itto_book_execute(ob, m.header.timestamp, m.refNum, m.volume);
+        }
+        case 'X': {
+            if (len < 21) return -1;
+            ITTOOrderCancel m;
+            itto_decode_X(msg, &m);
+            return itto_book_cancel(ob, m.header.timestamp, m.refNum, m.cancelledContracts);
+        }
+        case 'D': {
+            if (len < 17) return -1;
+            ITTOOrderDelete m;
+            itto_decode_D(msg, &m);
+            return itto_book_delete(ob, m.header.timestamp, m.refNum);
+        }
+        case 'u':
+        case 'U': {
+            if (len < (msg[0] == 'u' ? 29u : 33u)) return -1;
+            ITTOOrderReplace m;
+            if (msg[0] == 'u') itto_decode_u(msg, &m);
+            else itto_decode_U(msg, &m);
+            return itto_book_replace(ob, m.header.timestamp, m.origRefNum, m.newRefNum,
+                                     m.volume, m.price);
+        }
+        case 'G': {
+            if (len < 26) return -1;
+            ITTOOrderUpdate m;
+            itto_decode_G(msg, &m);
+            return itto_book_update(ob, m.header.timestamp, m.refNum, m.volume, m.price);
+        }
+        case 'k':
+        case 'K': {
+            if (len < (msg[0] == 'k' ? 49u : 57u)) return -1;
+            ITTOQuoteReplace m;
+            if (msg[0] == 'k') itto_decode_k(msg, &m);
+            else itto_decode_K(msg, &m);
+            return itto_book_quote_replace(ob, m.header.timestamp,
+                                           m.origBidRefNum, m.newBidRefNum, m.bidPrice, m.bidSize,
+                                           m.origAskRefNum, m.newAskRefNum, m.askPrice, m.askSize);
+        }
+        case 'Y': {
+            if (len < 25) return -1;
+            ITTOQuoteDelete m;
+            itto_decode_Y(msg, &m);
+            return itto_book_quote_delete(ob, m.header.timestamp, m.bidRefNum, m.askRefNum);
+        }
+        default:
+            return 0;
+    }
+}
+
+int itto_book_top_at(const itto_book_t *ob, uint32_t index, itto_book_top_t *out) {
+    if (index >= ob->option_count) return -1;
+    const ib_option_t *o = &ob->options[index];
+    fill_top(ob, o, out);
+    out->timestamp = 0;
+    return (o->side[SIDE_BID].count || o->side[SIDE_ASK].count) ? 0 : -1;
+}
+
+int itto_book_top(const itto_book_t *ob, uint32_t optionId, itto_book_top_t *out) {
+    uint32_t idx = find_option(ob, optionId);
+    if (idx == POOL_NIL) {
+        memset(out, 0, sizeof(*out));
+        out->optionId = optionId;
+        return -1;
+    }
+    return itto_book_top_at(ob, idx, out);
+}
+
+void itto_book_get_stats(const itto_book_t *ob, itto_book_stats_t *out) {
+    *out = ob->stats;
+}
+
+void itto_book_get_pool_stats(const itto_book_t *ob, slab_pool_stats_t *orders, slab_pool_stats_t *levels) {
+    if (orders) slab_pool_get_stats(&ob->order_pool, orders);
+    if (levels) slab_pool_get_stats(&ob->level_pool, levels);
+}
+
+itto_book_t *itto_book_create(const itto_book_config_t *cfg) {
+    itto_book_t *ob = calloc(1, sizeof(itto_book_t));
+    if (!ob) return NULL;
+
+    uint32_t max_orders = (cfg && cfg->max_orders) ? cfg->max_orders : DEFAULT_MAX_ORDERS;
+    uint32_t max_levels = (cfg && cfg->max_levels) ? cfg->max_levels : DEFAULT_MAX_LEVELS;
+    int pages = cfg ? cfg->pages : 0;
+    ob->option_cap = (cfg && cfg->max_options) ? cfg->max_options : DEFAULT_MAX_OPTIONS;
+    ob->on_top = cfg ? cfg->on_top : NULL;
+    ob->ctx = cfg ? cfg->ctx : NULL;
+
+    // Pools are reserved up front; without SLAB_PAGES_PREFAULT pages are only
+    // touched as the bump pointers advance
+    int rc = slab_pool_init(&ob->order_pool, sizeof(ib_order_t), max_orders, pages);
+    if (rc == 0) rc = slab_pool_init(&ob->level_pool, sizeof(ib_level_t), max_levels, pages);
+    if (rc == 0) rc = order_map_init(&ob->map, max_orders, pages);
+    ob->orders = (ib_order_t *)ob->order_pool.base;
+    ob->levels = (ib_level_t *)ob->level_pool.base;
+    ob->options = malloc((size_t)ob->option_cap * sizeof(ib_option_t));
+
+    if (rc < 0 || !ob->options) {
+        itto_book_destroy(ob);
+        return NULL;
+    }
+    return ob;
+}
+
+void itto_book_destroy(itto_book_t *ob) {
+    if (!ob) return;
+    for (uint32_t i = 0; i < ob->option_count; i++) {
+        free(ob->options[i].side[SIDE_BID].slots);
+        free(ob->options[i].side[SIDE_ASK].slots);
+    }
+    free(ob->options);
+    free(ob->dense);
+    slab_pool_destroy(&ob->order_pool);
+    slab_pool_destroy(&ob->level_pool);
+    order_map_free(&ob->map);
+    free(ob);
+}
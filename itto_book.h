@@ -0,0 +1,122 @@
+/*
+ * Options Book - per-series order and quote book reconstruction for ITTO
+ *
+ * An options feed carries far more instruments than an equities feed (well
+ * over a million series, each quoted by market makers on both sides) and far
+ * more updates, most of them quote replaces. The book is laid out for that:
+ * - Option ids are densified on first sight (R message, or the first order
+ *   that names them): a flat array indexed by optionId gives the dense index,
+ *   and per-series state lives in a flat array indexed by the dense index.
+ *   Looking up a series is two loads, with no hashing.
+ * - Orders and both sides of quotes share one fixed-size pool (slab_pool.h)
+ *   mapped at create time, found through the order-ref map (order_map.h). The two sides of a
+ *   quote point at each other, so a quote replace or delete updates both
+ *   sides and publishes the top of book once.
+ * - Each side of each series is an array of price levels sorted best-last,
+ *   as in order_book.h; options books are shallow and activity sits at the
+ *   top, so inserts and removals touch the tail of the array.
+ * - Best bid/offer changes are published through a callback.
+ *
+ * Prices carry 4 implied decimals (the short forms are scaled at decode).
+ *
+ * Usage:
+ *   itto_book_config_t cfg = { .max_orders = 1 << 23, .on_top = my_cb };
+ *   itto_book_t *ob = itto_book_create(&cfg);
+ *   itto_book_process(ob, msg, len);   // for every framed ITTO message
+ *   itto_book_destroy(ob);
+ */
+
+#ifndef ITTO_BOOK_H
+#define ITTO_BOOK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "slab_pool.h"
+
+#define ITTO_BOOK_MAX_OPTION_ID (1u << 24)
+
+typedef struct itto_book itto_book_t;
+
+/* Best bid/offer of one series, published whenever best price or size changes */
+typedef struct {
+    uint32_t optionId;
+    uint64_t timestamp;
+    uint32_t bidPrice;       // 0 if no bids
+    uint64_t bidSize;
+    uint32_t askPrice;       // 0 if no asks
+    uint64_t askSize;
+} itto_book_top_t;
+
+typedef void (*itto_book_top_cb)(const itto_book_top_t *top, void *ctx);
+
+typedef struct {
+    uint32_t max_orders;     // live order + quote side capacity (default 4M)
+    uint32_t max_levels;     // live price level capacity (default 1M)
+    uint32_t max_options;    // initial series capacity; grows as needed (default 64K)
+    int pages;               // SLAB_PAGES_* for the pools and the order map
+    itto_book_top_cb on_top;
+    void *ctx;
+} itto_book_config_t;
+
+typedef struct {
+    uint64_t adds;           // a/A
+    uint64_t quote_adds;     // j/J
+    uint64_t executes;       // E/C
+    uint64_t cancels;        // X
+    uint64_t deletes;        // D
+    uint64_t replaces;       // u/U
+    uint64_t updates;        // G
+    uint64_t quote_replaces; // k/K
+    uint64_t quote_deletes;  // Y
+    uint64_t top_updates;
+    uint64_t unknown_refs;   // references to an order or quote side we never saw
+    uint64_t bad_options;    // option ids above ITTO_BOOK_MAX_OPTION_ID
+    uint64_t pool_exhausted; // sides dropped because max_orders/max_levels was hit
+    uint64_t duplicate_refs; // adds/replaces reusing a live order's ref, dropped
+    uint64_t live_orders;    // including quote sides
+    uint64_t live_quotes;    // quotes with both sides live
+    uint64_t live_levels;
+    uint64_t options;        // series seen
+} itto_book_stats_t;
+
+itto_book_t *itto_book_create(const itto_book_config_t *cfg);
+void itto_book_destroy(itto_book_t *ob);
+
+/* Apply one framed ITTO message (type byte first). Non-book types are ignored.
+ * Returns 0 on success, -1 if the message could not be applied. */
+int itto_book_process(itto_book_t *ob, const uint8_t *msg, size_t len);
+
+/* Direct entry points, for callers that already decoded the message.
+ * A quote side with size 0 is not entered into the book, so a quote replace
+ * or delete counts an unknown ref only when neither side is found. */
+int itto_book_add_option(itto_book_t *ob, uint32_t optionId);
+int itto_book_add_order(itto_book_t *ob, uint64_t timestamp, uint32_t optionId,
+                        uint64_t refNum, char side, uint32_t volume, uint32_t price);
+int itto_book_add_quote(itto_book_t *ob, uint64_t timestamp, uint32_t optionId,
+                        uint64_t bidRefNum, uint32_t bidPrice, uint32_t bidSize,
+                        uint64_t askRefNum, uint32_t askPrice, uint32_t askSize);
+int itto_book_execute(itto_book_t *ob, uint64_t timestamp, uint64_t refNum, uint32_t volume);
+int itto_book_cancel(itto_book_t *ob, uint64_t timestamp, uint64_t refNum, uint32_t volume);
+int itto_book_delete(itto_book_t *ob, uint64_t timestamp, uint64_t refNum);
+int itto_book_replace(itto_book_t *ob, uint64_t timestamp, uint64_t origRefNum,
+                      uint64_t newRefNum, uint32_t volume, uint32_t price);
+int itto_book_update(itto_book_t *ob, uint64_t timestamp, uint64_t refNum,
+                     uint32_t volume, uint32_t price);
+int itto_book_quote_replace(itto_book_t *ob, uint64_t timestamp,
+                            uint64_t origBidRefNum, uint64_t newBidRefNum, uint32_t bidPrice, uint32_t bidSize,
+                            uint64_t origAskRefNum, uint64_t newAskRefNum, uint32_t askPrice, uint32_t askSize);
+int itto_book_quote_delete(itto_book_t *ob, uint64_t timestamp, uint64_t bidRefNum, uint64_t askRefNum);
+
+/* Current best bid/offer for a series. Returns 0 if its book has any orders,
+ * -1 if it is empty or unknown. */
+int itto_book_top(const itto_book_t *ob, uint32_t optionId, itto_book_top_t *out);
+
+/* Same, by dense index (0 .. stats.options - 1, in order of first sight) */
+int itto_book_top_at(const itto_book_t *ob, uint32_t index, itto_book_top_t *out);
+
+void itto_book_get_stats(const itto_book_t *ob, itto_book_stats_t *out);
+
+/* Occupancy of the order and price level pools (either may be NULL) */
+void itto_book_get_pool_stats(const itto_book_t *ob, slab_pool_stats_t *orders, slab_pool_stats_t *levels);
+
+#endif /* ITTO_BOOK_H */
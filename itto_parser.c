@@ -2,411 +2,246 @@
 #include <stdint.h>
 #include <string.h>
 #include <inttypes.h>
-#include <mach/mach_time.h>
-#include <arpa/inet.h>
-
-/* Common header present in most ITTO messages */
-typedef struct {
-    char messageType;        // 1 byte
-    uint16_t stockLocate;    // 2 bytes
-    uint16_t trackingNumber; // 2 bytes
-    uint64_t timestamp;      // 6 bytes
-} ITTOHeader;
-
-/* Read big-endian integer */
-static inline uint64_t read_be(const uint8_t *b, size_t nbytes) {
-    uint64_t v = 0;
-    for (size_t i = 0; i < nbytes; ++i) v = (v << 8) | b[i];
-    return v;
-}
-
-/* Parse 6-byte timestamp efficiently */
-static inline uint64_t parse_timestamp(const uint8_t *b) {
-    uint64_t tmp;
-    memcpy(&tmp, b, 8);
-    tmp = __builtin_bswap64(tmp);
-    return tmp >> 16;
-}
+#include "itto_parser.h"
+
+/* NASDAQ ITTO 4.0 (Options TotalView-ITCH) Parser
+ * Offsets follow the 9-byte header: type, tracking number, timestamp.
+ */
+
+/* Message length lookup table, 0 for unknown types (sizes of the wire layouts) */
+#define ITTO_GEN_LENGTH(c, T, Name, len, slot) [c] = sizeof(itto_wire_##T),
+const uint8_t itto_message_lengths[256] = { ITTO_MESSAGES(ITTO_GEN_LENGTH) };
+#undef ITTO_GEN_LENGTH
+
+/* Decode into a stack struct and call the handler; skipped entirely when the slot is NULL */
+#define DISPATCH(c, T, Name, len, slot) \
+    case c:                             \
+        if (h->slot) {                  \
+            Name m;                     \
+            itto_decode_##T(msg, &m);   \
+            h->slot(&m, ctx);           \
+        }                               \
+        break;
+
+/* Main dispatcher */
+int itto_decode(const uint8_t *msg, size_t len, const itto_handlers_t *h, void *ctx) {
+    if (len == 0) return 0;
+    size_t need = itto_message_lengths[msg[0]];
+
+    if (need == 0) {
+        if (h->on_unknown) h->on_unknown(msg, len, ctx);
+        return -1;
+    }
+    if (len < need) return 0;
 
-/* Read 2-byte big-endian uint16 */
-static inline uint16_t read_u16(const uint8_t *b) {
-    return (uint16_t)((b[0] << 8) | b[1]);
+    switch (msg[0]) {
+        ITTO_MESSAGES(DISPATCH)
+    }
+    return (int)need;
 }
 
-/* Read 4-byte big-endian uint32 */
-static inline uint32_t read_u32(const uint8_t *b) {
-    return (uint32_t)((b[0] << 24) | (b[1] << 16) | (b[2] << 8) | b[3]);
-}
+#undef DISPATCH
 
-/* Read 8-byte big-endian uint64 */
-static inline uint64_t read_u64(const uint8_t *b) {
-    return read_be(b, 8);
-}
+/* Printing handlers */
 
-/* Copy ASCII field and trim trailing spaces */
-static void read_ascii(const uint8_t *b, size_t len, char *out, size_t outlen) {
-    size_t n = (len < outlen - 1) ? len : outlen - 1;
-    memcpy(out, b, n);
-    while (n > 0 && out[n-1] == ' ') n--;
-    out[n] = '\0';
+/* Length of an alpha field without its trailing space padding */
+static int trimmed(const char *s, int n) {
+    while (n > 0 && s[n-1] == ' ') n--;
+    return n;
 }
 
-/* Parse common header (first 11 bytes for most messages) */
-static ITTOHeader parse_header(const uint8_t *msg) {
-    ITTOHeader h;
-    h.messageType = (char)msg[0];
-    h.stockLocate = read_u16(msg + 1);
-    h.trackingNumber = read_u16(msg + 3);
-    h.timestamp = parse_timestamp(msg + 5);
-    return h;
+/* Short or long form, from the type byte */
+static const char *form(const ITTOHeader *h) {
+    return h->messageType >= 'a' ? "Short" : "Long";
 }
 
 /* [S] System Event (10 bytes) */
-static void parse_S(const uint8_t *msg, size_t len) {
-    if (len < 10) return;
-    ITTOHeader h = parse_header(msg);
-    char eventCode = (char)msg[9];
-    
+static void print_S(const ITTOSystemEvent *m, void *ctx) {
+    (void)ctx;
     printf("[S] System Event\n");
-    printf("  Timestamp: %" PRIu64 "\n", h.timestamp);
-    printf("  Event Code: %c\n", eventCode);
+    printf("  Timestamp: %" PRIu64 " ns\n", m->header.timestamp);
+    printf("  Event Code: %c\n", m->eventCode);
 }
 
 /* [R] Options Directory (44 bytes) */
-static void parse_R(const uint8_t *msg, size_t len) {
-    if (len < 44) return;
-    ITTOHeader h = parse_header(msg);
-    
-    uint32_t optionId = read_u32(msg + 11);
-    char symbol[9], securitySymbol[9], expirationDate[7], underlyingSymbol[14], source[4];
-    read_ascii(msg + 15, 6, symbol, sizeof(symbol));
-    read_ascii(msg + 21, 8, underlyingSymbol, sizeof(underlyingSymbol));
-    uint32_t strikePrice = read_u32(msg + 29);
-    char optionType = (char)msg[33];
-    read_ascii(msg + 34, 8, securitySymbol, sizeof(securitySymbol));
-    read_ascii(msg + 42, 3, source, sizeof(source));
-    
+static void print_R(const ITTOOptionsDirectory *m, void *ctx) {
+    (void)ctx;
     printf("[R] Options Directory\n");
-    printf("  Option ID: %u\n", optionId);
-    printf("  Symbol: %s\n", symbol);
-    printf("  Underlying: %s\n", underlyingSymbol);
-    printf("  Strike: %u\n", strikePrice);
-    printf("  Type: %c\n", optionType);
-    printf("  Source: %s\n", source);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Symbol: %.*s\n", trimmed(m->securitySymbol, 6), m->securitySymbol);
+    printf("  Underlying: %.*s\n", trimmed(m->underlyingSymbol, 13), m->underlyingSymbol);
+    printf("  Expiration: 20%02u-%02u-%02u\n", m->expirationYear, m->expirationMonth, m->expirationDay);
+    printf("  Strike: %u (%.4f)\n", m->explicitStrikePrice, m->explicitStrikePrice / 10000.0);
+    printf("  Type: %c\n", m->optionType);
+    printf("  Source: %u\n", m->source);
 }
 
 /* [H] Trading Action (14 bytes) */
-static void parse_H(const uint8_t *msg, size_t len) {
-    if (len < 14) return;
-    ITTOHeader h = parse_header(msg);
-    uint32_t optionId = read_u32(msg + 11);
-    char currentTradingState = (char)msg[13];
-    
+static void print_H(const ITTOTradingAction *m, void *ctx) {
+    (void)ctx;
     printf("[H] Trading Action\n");
-    printf("  Option ID: %u\n", optionId);
-    printf("  Trading State: %c\n", currentTradingState);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Trading State: %c\n", m->tradingState);
 }
 
 /* [O] Option Open (14 bytes) */
-static void parse_O(const uint8_t *msg, size_t len) {
-    if (len < 14) return;
-    ITTOHeader h = parse_header(msg);
-    uint32_t optionId = read_u32(msg + 11);
-    char openState = (char)msg[13];
-    
+static void print_O(const ITTOOptionOpen *m, void *ctx) {
+    (void)ctx;
     printf("[O] Option Open\n");
-    printf("  Option ID: %u\n", optionId);
-    printf("  Open State: %c\n", openState);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Open State: %c\n", m->openState);
 }
 
-/* [a] Add Order (Short) (26 bytes) */
-static void parse_a(const uint8_t *msg, size_t len) {
-    if (len < 26) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t orderRefNum = read_u64(msg + 11);
-    char side = (char)msg[19];
-    uint16_t size = read_u16(msg + 20);
-    uint32_t optionId = read_u32(msg + 22);
-    
-    printf("[a] Add Order (Short)\n");
-    printf("  Order Ref: %" PRIu64 "\n", orderRefNum);
-    printf("  Side: %c\n", side);
-    printf("  Size: %u\n", size);
-    printf("  Option ID: %u\n", optionId);
-}
-
-/* [A] Add Order (Long) (30 bytes) */
-static void parse_A(const uint8_t *msg, size_t len) {
-    if (len < 30) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t orderRefNum = read_u64(msg + 11);
-    char side = (char)msg[19];
-    uint32_t size = read_u32(msg + 20);
-    uint32_t optionId = read_u32(msg + 24);
-    uint32_t price = read_u32(msg + 26);
-    
-    printf("[A] Add Order (Long)\n");
-    printf("  Order Ref: %" PRIu64 "\n", orderRefNum);
-    printf("  Side: %c\n", side);
-    printf("  Size: %u\n", size);
-    printf("  Option ID: %u\n", optionId);
-    printf("  Price: %u\n", price);
+/* [a] / [A] Add Order (26 / 30 bytes) */
+static void print_add_order(const ITTOAddOrder *m, void *ctx) {
+    (void)ctx;
+    printf("[%c] Add Order (%s)\n", m->header.messageType, form(&m->header));
+    printf("  Order Ref: %" PRIu64 "\n", m->orderRefNum);
+    printf("  Side: %c\n", m->side);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Price: %u (%.4f)\n", m->price, m->price / 10000.0);
+    printf("  Volume: %u\n", m->volume);
 }
 
-/* [j] Add Quote (Short) (37 bytes) */
-static void parse_j(const uint8_t *msg, size_t len) {
-    if (len < 37) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t bidRefNum = read_u64(msg + 11);
-    uint64_t askRefNum = read_u64(msg + 19);
-    uint16_t bidSize = read_u16(msg + 27);
-    uint16_t askSize = read_u16(msg + 29);
-    uint32_t optionId = read_u32(msg + 31);
-    uint16_t bidPrice = read_u16(msg + 35);
-    
-    printf("[j] Add Quote (Short)\n");
-    printf("  Bid Ref: %" PRIu64 "\n", bidRefNum);
-    printf("  Ask Ref: %" PRIu64 "\n", askRefNum);
-    printf("  Bid Size: %u, Ask Size: %u\n", bidSize, askSize);
-    printf("  Option ID: %u\n", optionId);
-}
-
-/* [J] Add Quote (Long) (45 bytes) */
-static void parse_J(const uint8_t *msg, size_t len) {
-    if (len < 45) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t bidRefNum = read_u64(msg + 11);
-    uint64_t askRefNum = read_u64(msg + 19);
-    uint32_t bidSize = read_u32(msg + 27);
-    uint32_t askSize = read_u32(msg + 31);
-    uint32_t optionId = read_u32(msg + 35);
-    uint32_t bidPrice = read_u32(msg + 39);
-    uint32_t askPrice = read_u32(msg + 43);
-    
-    printf("[J] Add Quote (Long)\n");
-    printf("  Bid Ref: %" PRIu64 ", Ask Ref: %" PRIu64 "\n", bidRefNum, askRefNum);
-    printf("  Bid Size: %u, Ask Size: %u\n", bidSize, askSize);
-    printf("  Option ID: %u\n", optionId);
-    printf("  Bid Price: %u, Ask Price: %u\n", bidPrice, askPrice);
+/* [j] / [J] Add Quote (37 / 45 bytes) */
+static void print_add_quote(const ITTOAddQuote *m, void *ctx) {
+    (void)ctx;
+    printf("[%c] Add Quote (%s)\n", m->header.messageType, form(&m->header));
+    printf("  Bid Ref: %" PRIu64 ", Ask Ref: %" PRIu64 "\n", m->bidRefNum, m->askRefNum);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Bid: %u @ %.4f, Ask: %u @ %.4f\n", m->bidSize, m->bidPrice / 10000.0,
+           m->askSize, m->askPrice / 10000.0);
 }
 
 /* [E] Single Side Executed (29 bytes) */
-static void parse_E(const uint8_t *msg, size_t len) {
-    if (len < 29) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    uint32_t contracts = read_u32(msg + 19);
-    uint32_t crossNumber = read_u32(msg + 23);
-    uint32_t matchNumber = read_u32(msg + 27);
-    
+static void print_E(const ITTOOrderExecuted *m, void *ctx) {
+    (void)ctx;
     printf("[E] Single Side Executed\n");
-    printf("  Orig Ref: %" PRIu64 "\n", origRefNum);
-    printf("  Contracts: %u\n", contracts);
-    printf("  Cross: %u, Match: %u\n", crossNumber, matchNumber);
+    printf("  Ref: %" PRIu64 "\n", m->refNum);
+    printf("  Contracts: %u\n", m->volume);
+    printf("  Cross: %u, Match: %u\n", m->crossNumber, m->matchNumber);
 }
 
 /* [C] Single Side Executed With Price (34 bytes) */
-static void parse_C(const uint8_t *msg, size_t len) {
-    if (len < 34) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    uint32_t contracts = read_u32(msg + 19);
-    uint32_t crossNumber = read_u32(msg + 23);
-    uint32_t matchNumber = read_u32(msg + 27);
-    uint32_t price = read_u32(msg + 31);
-    
+static void print_C(const ITTOOrderExecutedWithPrice *m, void *ctx) {
+    (void)ctx;
     printf("[C] Single Side Executed With Price\n");
-    printf("  Orig Ref: %" PRIu64 "\n", origRefNum);
-    printf("  Contracts: %u\n", contracts);
-    printf("  Cross: %u, Match: %u\n", crossNumber, matchNumber);
-    printf("  Price: %u\n", price);
+    printf("  Ref: %" PRIu64 "\n", m->refNum);
+    printf("  Cross: %u, Match: %u\n", m->crossNumber, m->matchNumber);
+    printf("  Printable: %c\n", m->printable);
+    printf("  Price: %u (%.4f)\n", m->price, m->price / 10000.0);
+    printf("  Contracts: %u\n", m->volume);
 }
 
 /* [X] Order Cancel (21 bytes) */
-static void parse_X(const uint8_t *msg, size_t len) {
-    if (len < 21) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    uint32_t cancelledContracts = read_u32(msg + 19);
-    
+static void print_X(const ITTOOrderCancel *m, void *ctx) {
+    (void)ctx;
     printf("[X] Order Cancel\n");
-    printf("  Orig Ref: %" PRIu64 "\n", origRefNum);
-    printf("  Cancelled: %u\n", cancelledContracts);
+    printf("  Ref: %" PRIu64 "\n", m->refNum);
+    printf("  Cancelled: %u\n", m->cancelledContracts);
 }
 
-/* [u] Replace (Short) (29 bytes) */
-static void parse_u(const uint8_t *msg, size_t len) {
-    if (len < 29) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    uint64_t newRefNum = read_u64(msg + 19);
-    uint16_t size = read_u16(msg + 27);
-    
-    printf("[u] Replace (Short)\n");
-    printf("  Orig Ref: %" PRIu64 " -> New Ref: %" PRIu64 "\n", origRefNum, newRefNum);
-    printf("  Size: %u\n", size);
-}
-
-/* [U] Replace (Long) (33 bytes) */
-static void parse_U(const uint8_t *msg, size_t len) {
-    if (len < 33) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    uint64_t newRefNum = read_u64(msg + 19);
-    uint32_t size = read_u32(msg + 27);
-    uint32_t price = read_u32(msg + 31);
-    
-    printf("[U] Replace (Long)\n");
-    printf("  Orig Ref: %" PRIu64 " -> New Ref: %" PRIu64 "\n", origRefNum, newRefNum);
-    printf("  Size: %u, Price: %u\n", size, price);
+/* [u] / [U] Single Side Replace (29 / 33 bytes) */
+static void print_replace(const ITTOOrderReplace *m, void *ctx) {
+    (void)ctx;
+    printf("[%c] Single Side Replace (%s)\n", m->header.messageType, form(&m->header));
+    printf("  Ref: %" PRIu64 " -> %" PRIu64 "\n", m->origRefNum, m->newRefNum);
+    printf("  Price: %u (%.4f), Volume: %u\n", m->price, m->price / 10000.0, m->volume);
 }
 
 /* [D] Single Side Delete (17 bytes) */
-static void parse_D(const uint8_t *msg, size_t len) {
-    if (len < 17) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    
+static void print_D(const ITTOOrderDelete *m, void *ctx) {
+    (void)ctx;
     printf("[D] Single Side Delete\n");
-    printf("  Orig Ref: %" PRIu64 "\n", origRefNum);
+    printf("  Ref: %" PRIu64 "\n", m->refNum);
 }
 
 /* [G] Single Side Update (26 bytes) */
-static void parse_G(const uint8_t *msg, size_t len) {
-    if (len < 26) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origRefNum = read_u64(msg + 11);
-    char side = (char)msg[19];
-    uint32_t price = read_u32(msg + 20);
-    uint32_t size = read_u32(msg + 24);
-    
+static void print_G(const ITTOOrderUpdate *m, void *ctx) {
+    (void)ctx;
     printf("[G] Single Side Update\n");
-    printf("  Orig Ref: %" PRIu64 "\n", origRefNum);
-    printf("  Side: %c, Price: %u, Size: %u\n", side, price, size);
+    printf("  Ref: %" PRIu64 "\n", m->refNum);
+    printf("  Reason: %c, Price: %u (%.4f), Volume: %u\n", m->reason, m->price, m->price / 10000.0, m->volume);
 }
 
-/* [k] Quote Replace (Short) (49 bytes) */
-static void parse_k(const uint8_t *msg, size_t len) {
-    if (len < 49) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origBidRef = read_u64(msg + 11);
-    uint64_t origAskRef = read_u64(msg + 19);
-    uint64_t newBidRef = read_u64(msg + 27);
-    uint64_t newAskRef = read_u64(msg + 35);
-    uint16_t bidSize = read_u16(msg + 43);
-    uint16_t askSize = read_u16(msg + 45);
-    
-    printf("[k] Quote Replace (Short)\n");
-    printf("  Bid: %" PRIu64 " -> %" PRIu64 "\n", origBidRef, newBidRef);
-    printf("  Ask: %" PRIu64 " -> %" PRIu64 "\n", origAskRef, newAskRef);
-    printf("  Sizes: Bid %u, Ask %u\n", bidSize, askSize);
-}
-
-/* [K] Quote Replace (Long) (57 bytes) */
-static void parse_K(const uint8_t *msg, size_t len) {
-    if (len < 57) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t origBidRef = read_u64(msg + 11);
-    uint64_t origAskRef = read_u64(msg + 19);
-    uint64_t newBidRef = read_u64(msg + 27);
-    uint64_t newAskRef = read_u64(msg + 35);
-    uint32_t bidSize = read_u32(msg + 43);
-    uint32_t askSize = read_u32(msg + 47);
-    uint32_t bidPrice = read_u32(msg + 51);
-    uint32_t askPrice = read_u32(msg + 55);
-    
-    printf("[K] Quote Replace (Long)\n");
-    printf("  Bid: %" PRIu64 " -> %" PRIu64 "\n", origBidRef, newBidRef);
-    printf("  Ask: %" PRIu64 " -> %" PRIu64 "\n", origAskRef, newAskRef);
-    printf("  Bid Size: %u, Price: %u\n", bidSize, bidPrice);
-    printf("  Ask Size: %u, Price: %u\n", askSize, askPrice);
+/* [k] / [K] Quote Replace (49 / 57 bytes) */
+static void print_quote_replace(const ITTOQuoteReplace *m, void *ctx) {
+    (void)ctx;
+    printf("[%c] Quote Replace (%s)\n", m->header.messageType, form(&m->header));
+    printf("  Bid Ref: %" PRIu64 " -> %" PRIu64 "\n", m->origBidRefNum, m->newBidRefNum);
+    printf("  Ask Ref: %" PRIu64 " -> %" PRIu64 "\n", m->origAskRefNum, m->newAskRefNum);
+    printf("  Bid: %u @ %.4f, Ask: %u @ %.4f\n", m->bidSize, m->bidPrice / 10000.0,
+           m->askSize, m->askPrice / 10000.0);
 }
 
 /* [Y] Quote Delete (25 bytes) */
-static void parse_Y(const uint8_t *msg, size_t len) {
-    if (len < 25) return;
-    ITTOHeader h = parse_header(msg);
-    uint64_t bidRefNum = read_u64(msg + 11);
-    uint64_t askRefNum = read_u64(msg + 19);
-    
+static void print_Y(const ITTOQuoteDelete *m, void *ctx) {
+    (void)ctx;
     printf("[Y] Quote Delete\n");
-    printf("  Bid Ref: %" PRIu64 "\n", bidRefNum);
-    printf("  Ask Ref: %" PRIu64 "\n", askRefNum);
+    printf("  Bid Ref: %" PRIu64 ", Ask Ref: %" PRIu64 "\n", m->bidRefNum, m->askRefNum);
 }
 
 /* [Q] Cross Trade (30 bytes) */
-static void parse_Q(const uint8_t *msg, size_t len) {
-    if (len < 30) return;
-    ITTOHeader h = parse_header(msg);
-    uint32_t optionId = read_u32(msg + 11);
-    uint32_t contracts = read_u32(msg + 15);
-    uint32_t crossNumber = read_u32(msg + 19);
-    uint32_t matchNumber = read_u32(msg + 23);
-    char crossType = (char)msg[27];
-    uint32_t price = read_u32(msg + 28);
-    
+static void print_Q(const ITTOCrossTrade *m, void *ctx) {
+    (void)ctx;
     printf("[Q] Cross Trade\n");
-    printf("  Option ID: %u\n", optionId);
-    printf("  Contracts: %u\n", contracts);
-    printf("  Cross: %u, Match: %u\n", crossNumber, matchNumber);
-    printf("  Type: %c, Price: %u\n", crossType, price);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Cross: %u, Match: %u, Type: %c\n", m->crossNumber, m->matchNumber, m->crossType);
+    printf("  Price: %u (%.4f), Contracts: %u\n", m->price, m->price / 10000.0, m->volume);
 }
 
 /* [I] NOII (35 bytes) */
-static void parse_I(const uint8_t *msg, size_t len) {
-    if (len < 35) return;
-    ITTOHeader h = parse_header(msg);
-    uint32_t optionId = read_u32(msg + 11);
-    char crossType = (char)msg[15];
-    uint32_t pairedContracts = read_u32(msg + 16);
-    char imbalanceSide = (char)msg[20];
-    uint32_t imbalanceQty = read_u32(msg + 21);
-    uint32_t bestBidQty = read_u32(msg + 25);
-    uint32_t bestAskQty = read_u32(msg + 29);
-    
+static void print_I(const ITTONOII *m, void *ctx) {
+    (void)ctx;
     printf("[I] NOII\n");
-    printf("  Option ID: %u\n", optionId);
-    printf("  Cross Type: %c\n", crossType);
-    printf("  Paired: %u\n", pairedContracts);
-    printf("  Imbalance: %c %u\n", imbalanceSide, imbalanceQty);
-    printf("  Best Bid/Ask: %u / %u\n", bestBidQty, bestAskQty);
+    printf("  Auction ID: %u, Type: %c\n", m->auctionId, m->auctionType);
+    printf("  Option ID: %u\n", m->optionId);
+    printf("  Paired: %u\n", m->pairedContracts);
+    printf("  Imbalance: %c %u @ %.4f\n", m->imbalanceDirection, m->imbalanceVolume, m->imbalancePrice / 10000.0);
+}
+
+static void print_unknown(const uint8_t *msg, size_t len, void *ctx) {
+    (void)len;
+    (void)ctx;
+    printf("[?] Unknown ITTO message type: %c (0x%02X)\n", msg[0], msg[0]);
 }
 
-/* Dispatcher */
-static void parse_message(const uint8_t *msg, size_t len) {
+const itto_handlers_t itto_print_handlers = {
+    .on_system_event = print_S,
+    .on_options_directory = print_R,
+    .on_trading_action = print_H,
+    .on_option_open = print_O,
+    .on_add_order = print_add_order,
+    .on_add_quote = print_add_quote,
+    .on_order_executed = print_E,
+    .on_order_executed_with_price = print_C,
+    .on_order_cancel = print_X,
+    .on_order_replace = print_replace,
+    .on_order_delete = print_D,
+    .on_order_update = print_G,
+    .on_quote_replace = print_quote_replace,
+    .on_quote_delete = print_Y,
+    .on_cross_trade = print_Q,
+    .on_noii = print_I,
+    .on_unknown = print_unknown,
+};
+
+/* Print one message (classic stdout dump) */
+void parse_itto_message(const uint8_t *msg, size_t len) {
     if (len == 0) return;
-    char type = (char)msg[0];
-    
-    switch (type) {
-        case 'S': parse_S(msg, len); break;
-        case 'R': parse_R(msg, len); break;
-        case 'H': parse_H(msg, len); break;
-        case 'O': parse_O(msg, len); break;
-        case 'a': parse_a(msg, len); break;
-        case 'A': parse_A(msg, len); break;
-        case 'j': parse_j(msg, len); break;
-        case 'J': parse_J(msg, len); break;
-        case 'E': parse_E(msg, len); break;
-        case 'C': parse_C(msg, len); break;
-        case 'X': parse_X(msg, len); break;
-        case 'u': parse_u(msg, len); break;
-        case 'U': parse_U(msg, len); break;
-        case 'D': parse_D(msg, len); break;
-        case 'G': parse_G(msg, len); break;
-        case 'k': parse_k(msg, len); break;
-        case 'K': parse_K(msg, len); break;
-        case 'Y': parse_Y(msg, len); break;
-        case 'Q': parse_Q(msg, len); break;
-        case 'I': parse_I(msg, len); break;
-        default:
-            printf("[?] Unknown message type: %c (0x%02X)\n", type, type);
-    }
+    itto_decode(msg, len, &itto_print_handlers, NULL);
     printf("\n");
 }
 
+/* Get message length for stream parsing */
+size_t get_itto_message_length(uint8_t msg_type) {
+    return itto_message_lengths[msg_type];
+}
+
+#ifdef TEST_PARSER
 int main() {
-    // All 19 test messages from your dump
-    uint8_t msgS[] = {0x53,0x00,0x00,0x07,0x3E,0xE0,0x35,0xAE,0x45,0x4F};
+    // All 19 test messages from your dump (S padded: the timestamp read loads 8 bytes)
+    uint8_t msgS[16] = {0x53,0x00,0x00,0x07,0x3E,0xE0,0x35,0xAE,0x45,0x4F};
     uint8_t msgR[] = {0x52,0x00,0x00,0x07,0xD7,0x96,0x11,0x5F,0x18,0x00,0x05,0x3B,0xA3,0x45,0x50,0x41,0x4D,0x20,0x20,0x17,0x06,0x10,0x00,0x21,0x91,0xC0,0x43,0x01,0x45,0x50,0x41,0x4D,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x20,0x4E,0x59,0x53};
     uint8_t msgH[] = {0x48,0x00,0x00,0x07,0xD7,0x96,0x1B,0xDC,0x7C,0x00,0x05,0x3B,0xA3,0x54};
     uint8_t msgO[] = {0x4F,0x00,0x05,0x1F,0x1A,0xD9,0x82,0xB4,0xD4,0x00,0x03,0xD5,0x59,0x59};
@@ -429,41 +264,27 @@ int main() {
 
     printf("=== Parsing all 19 ITTO message types ===\n\n");
     
-    parse_message(msgS, sizeof(msgS));
-    parse_message(msgR, sizeof(msgR));
-    parse_message(msgH, sizeof(msgH));
-    parse_message(msgO, sizeof(msgO));
-    parse_message(msga, sizeof(msga));
-    parse_message(msgA, sizeof(msgA));
-    parse_message(msgj, sizeof(msgj));
-    parse_message(msgJ, sizeof(msgJ));
-    // parse_message(msgE, sizeof(msgE));
-    parse_message(msgC, sizeof(msgC));
-    parse_message(msgX, sizeof(msgX));
-    parse_message(msgu, sizeof(msgu));
-    parse_message(msgU, sizeof(msgU));
-    parse_message(msgD, sizeof(msgD));
-    parse_message(msgG, sizeof(msgG));
-    parse_message(msgk, sizeof(msgk));
-    parse_message(msgK, sizeof(msgK));
-    parse_message(msgY, sizeof(msgY));
-    parse_message(msgQ, sizeof(msgQ));
-    parse_message(msgI, sizeof(msgI));
-
-    printf("=== Performance test ===\n");
-    mach_timebase_info_data_t timebase;
-    mach_timebase_info(&timebase);
-    
-    const int iterations = 1000000;
-    uint64_t start = mach_absolute_time();
-    for (int i = 0; i < iterations; i++) {
-        ITTOHeader h = parse_header(msgJ);
-        (void)h; // suppress unused warning
-    }
-    uint64_t end = mach_absolute_time();
-    
-    double elapsed_ns = (double)(end - start) * timebase.numer / timebase.denom;
-    printf("Header parse: %.2f ns per message (1M iterations)\n", elapsed_ns / iterations);
+    parse_itto_message(msgS, 10);
+    parse_itto_message(msgR, sizeof(msgR));
+    parse_itto_message(msgH, sizeof(msgH));
+    parse_itto_message(msgO, sizeof(msgO));
+    parse_itto_message(msga, sizeof(msga));
+    parse_itto_message(msgA, sizeof(msgA));
+    parse_itto_message(msgj, sizeof(msgj));
+    parse_itto_message(msgJ, sizeof(msgJ));
+    parse_itto_message(msgE, sizeof(msgE));
+    parse_itto_message(msgC, sizeof(msgC));
+    parse_itto_message(msgX, sizeof(msgX));
+    parse_itto_message(msgu, sizeof(msgu));
+    parse_itto_message(msgU, sizeof(msgU));
+    parse_itto_message(msgD, sizeof(msgD));
+    parse_itto_message(msgG, sizeof(msgG));
+    parse_itto_message(msgk, sizeof(msgk));
+    parse_itto_message(msgK, sizeof(msgK));
+    parse_itto_message(msgY, sizeof(msgY));
+    parse_itto_message(msgQ, sizeof(msgQ));
+    parse_itto_message(msgI, sizeof(msgI));
 
     return 0;
 }
+#endif
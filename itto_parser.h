@@ -0,0 +1,299 @@
+/*
+ * NASDAQ ITTO 4.0 (Options TotalView-ITCH) Parser - decode API
+ *
+ * The same shape as itch_parser.h: itto_decode() fills the typed struct for
+ * the message on the stack and calls the matching slot of a handler table
+ * (NULL slots are skipped without decoding), itto_decode_<type>() are
+ * the inline per-type extractors and itto_encode_<type>() the writers. No
+ * allocation, no stdio.
+ *
+ * Every ITTO message starts with a 9-byte header: type, tracking number,
+ * 6-byte timestamp. Options are keyed by a 4-byte option id instead of a
+ * stock locate.
+ *
+ * Short and long forms of a message (a/A, j/J, u/U, k/K) decode into one
+ * struct and one handler slot. The header's messageType still tells them
+ * apart. Short-form prices carry 2 implied decimals and are scaled to the
+ * long form's 4, so every price in these structs has 4 implied decimals.
+ */
+
+#ifndef ITTO_PARSER_H
+#define ITTO_PARSER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "itch_parser.h"
+
+#define ITTO_HEADER_SIZE 9
+
+typedef struct {
+    uint64_t timestamp;      // 6 bytes (nanoseconds since midnight)
+    uint16_t trackingNumber; // 2 bytes
+    char messageType;        // 1 byte
+} ITTOHeader;
+
+/* Message schema, as in itch_parser.h. One entry per type:
+ *   M(type byte, suffix, struct, spec length, handler slot)
+ * and one field list per type, in wire order after the 9-byte header.
+ * Short and long forms share a struct, which is generated from the long
+ * form's field list; the short form's list names the same fields with
+ * 16-bit kinds (S16, P16). ITTO_STRUCTS lists the structs and their slots
+ * in handler table order. */
+
+#define ITTO_MESSAGES(M) \
+    M('S', S, ITTOSystemEvent,            10, on_system_event)              /* System Event */ \
+    M('R', R, ITTOOptionsDirectory,       44, on_options_directory)         /* Options Directory */ \
+    M('H', H, ITTOTradingAction,          14, on_trading_action)            /* Trading Action */ \
+    M('O', O, ITTOOptionOpen,             14, on_option_open)               /* Option Open */ \
+    M('a', a, ITTOAddOrder,               26, on_add_order)                 /* Add Order (Short) */ \
+    M('A', A, ITTOAddOrder,               30, on_add_order)                 /* Add Order (Long) */ \
+    M('j', j, ITTOAddQuote,               37, on_add_quote)                 /* Add Quote (Short) */ \
+    M('J', J, ITTOAddQuote,               45, on_add_quote)                 /* Add Quote (Long) */ \
+    M('E', E, ITTOOrderExecuted,          29, on_order_executed)            /* Single Side Executed */ \
+    M('C', C, ITTOOrderExecutedWithPrice, 34, on_order_executed_with_price) /* Single Side Executed With Price */ \
+    M('X', X, ITTOOrderCancel,            21, on_order_cancel)              /* Order Cancel */ \
+    M('u', u, ITTOOrderReplace,           29, on_order_replace)             /* Single Side Replace (Short) */ \
+    M('U', U, ITTOOrderReplace,           33, on_order_replace)             /* Single Side Replace (Long) */ \
+    M('D', D, ITTOOrderDelete,            17, on_order_delete)              /* Single Side Delete */ \
+    M('G', G, ITTOOrderUpdate,            26, on_order_update)              /* Single Side Update */ \
+    M('k', k, ITTOQuoteReplace,           49, on_quote_replace)             /* Quote Replace (Short) */ \
+    M('K', K, ITTOQuoteReplace,           57, on_quote_replace)             /* Quote Replace (Long) */ \
+    M('Y', Y, ITTOQuoteDelete,            25, on_quote_delete)              /* Quote Delete */ \
+    M('Q', Q, ITTOCrossTrade,             30, on_cross_trade)               /* Cross Trade */ \
+    M('I', I, ITTONOII,                   35, on_noii)                      /* NOII */
+
+/* GEN(struct, suffix of the field list it is generated from, handler slot) */
+#define ITTO_STRUCTS(GEN) \
+    GEN(ITTOSystemEvent,            S, on_system_event) \
+    GEN(ITTOOptionsDirectory,       R, on_options_directory) \
+    GEN(ITTOTradingAction,          H, on_trading_action) \
+    GEN(ITTOOptionOpen,             O, on_option_open) \
+    GEN(ITTOAddOrder,               A, on_add_order) \
+    GEN(ITTOAddQuote,               J, on_add_quote) \
+    GEN(ITTOOrderExecuted,          E, on_order_executed) \
+    GEN(ITTOOrderExecutedWithPrice, C, on_order_executed_with_price) \
+    GEN(ITTOOrderCancel,            X, on_order_cancel) \
+    GEN(ITTOOrderReplace,           U, on_order_replace) \
+    GEN(ITTOOrderDelete,            D, on_order_delete) \
+    GEN(ITTOOrderUpdate,            G, on_order_update) \
+    GEN(ITTOQuoteReplace,           K, on_quote_replace) \
+    GEN(ITTOQuoteDelete,            Y, on_quote_delete) \
+    GEN(ITTOCrossTrade,             Q, on_cross_trade) \
+    GEN(ITTONOII,                   I, on_noii)
+
+#define ITTO_FIELDS_S(F) \
+    F(CHAR, eventCode)
+
+#define ITTO_FIELDS_R(F) \
+    F(U32,  optionId) \
+    F(A6,   securitySymbol) \
+    F(U8,   expirationYear)      /* years since 2000 */ \
+    F(U8,   expirationMonth) \
+    F(U8,   expirationDay) \
+    F(U32,  explicitStrikePrice) \
+    F(CHAR, optionType)          /* C = call, P = put */ \
+    F(U8,   source) \
+    F(A13,  underlyingSymbol) \
+    F(CHAR, optionsClosingType) \
+    F(CHAR, tradable) \
+    F(CHAR, mpv)
+
+#define ITTO_FIELDS_H(F) \
+    F(U32,  optionId) \
+    F(CHAR, tradingState)
+
+#define ITTO_FIELDS_O(F) \
+    F(U32,  optionId) \
+    F(CHAR, openState)
+
+#define ITTO_FIELDS_a(F) \
+    F(U64,  orderRefNum) \
+    F(CHAR, side) \
+    F(U32,  optionId) \
+    F(P16,  price) \
+    F(S16,  volume)
+
+#define ITTO_FIELDS_A(F) \
+    F(U64,  orderRefNum) \
+    F(CHAR, side) \
+    F(U32,  optionId) \
+    F(U32,  price) \
+    F(U32,  volume)
+
+#define ITTO_FIELDS_j(F) \
+    F(U64,  bidRefNum) \
+    F(U64,  askRefNum) \
+    F(U32,  optionId) \
+    F(P16,  bidPrice) \
+    F(S16,  bidSize) \
+    F(P16,  askPrice) \
+    F(S16,  askSize)
+
+#define ITTO_FIELDS_J(F) \
+    F(U64,  bidRefNum) \
+    F(U64,  askRefNum) \
+    F(U32,  optionId) \
+    F(U32,  bidPrice) \
+    F(U32,  bidSize) \
+    F(U32,  askPrice) \
+    F(U32,  askSize)
+
+#define ITTO_FIELDS_E(F) \
+    F(U64,  refNum) \
+    F(U32,  volume) \
+    F(U32,  crossNumber) \
+    F(U32,  matchNumber)
+
+#define ITTO_FIELDS_C(F) \
+    F(U64,  refNum) \
+    F(U32,  crossNumber) \
+    F(U32,  matchNumber) \
+    F(CHAR, printable) \
+    F(U32,  price) \
+    F(U32,  volume)
+
+#define ITTO_FIELDS_X(F) \
+    F(U64,  refNum) \
+    F(U32,  cancelledContracts)
+
+#define ITTO_FIELDS_u(F) \
+    F(U64,  origRefNum) \
+    F(U64,  newRefNum) \
+    F(P16,  price) \
+    F(S16,  volume)
+
+#define ITTO_FIELDS_U(F) \
+    F(U64,  origRefNum) \
+    F(U64,  newRefNum) \
+    F(U32,  price) \
+    F(U32,  volume)
+
+#define ITTO_FIELDS_D(F) \
+    F(U64,  refNum)
+
+#define ITTO_FIELDS_G(F) \
+    F(U64,  refNum) \
+    F(CHAR, reason) \
+    F(U32,  price) \
+    F(U32,  volume)
+
+#define ITTO_FIELDS_k(F) \
+    F(U64,  origBidRefNum) \
+    F(U64,  newBidRefNum) \
+    F(U64,  origAskRefNum) \
+    F(U64,  newAskRefNum) \
+    F(P16,  bidPrice) \
+    F(S16,  bidSize) \
+    F(P16,  askPrice) \
+    F(S16,  askSize)
+
+#define ITTO_FIELDS_K(F) \
+    F(U64,  origBidRefNum) \
+    F(U64,  newBidRefNum) \
+    F(U64,  origAskRefNum) \
+    F(U64,  newAskRefNum) \
+    F(U32,  bidPrice) \
+    F(U32,  bidSize) \
+    F(U32,  askPrice) \
+    F(U32,  askSize)
+
+#define ITTO_FIELDS_Y(F) \
+    F(U64,  bidRefNum) \
+    F(U64,  askRefNum)
+
+#define ITTO_FIELDS_Q(F) \
+    F(U32,  optionId) \
+    F(U32,  crossNumber) \
+    F(U32,  matchNumber) \
+    F(CHAR, crossType) \
+    F(U32,  price) \
+    F(U32,  volume)
+
+#define ITTO_FIELDS_I(F) \
+    F(U32,  auctionId) \
+    F(CHAR, auctionType) \
+    F(U32,  pairedContracts) \
+    F(CHAR, imbalanceDirection) \
+    F(U32,  optionId) \
+    F(U32,  imbalancePrice) \
+    F(U32,  imbalanceVolume) \
+    F(CHAR, customerFirmIndicator) \
+    F(A3,   reserved)
+
+/* Message structs, fields in host order */
+#define ITTO_GEN_STRUCT(Name, T, slot) \
+    typedef struct { ITTOHeader header; ITTO_FIELDS_##T(ITCH_SCHEMA_DECL) } Name;
+ITTO_STRUCTS(ITTO_GEN_STRUCT)
+#undef ITTO_GEN_STRUCT
+
+/* Wire layouts (itto_wire_a, itto_wire_A, ...), size checked against the spec */
+#define ITTO_GEN_WIRE(c, T, Name, len, slot)                                               \
+    typedef struct { uint8_t header[ITTO_HEADER_SIZE]; ITTO_FIELDS_##T(ITCH_SCHEMA_WIRE) } itto_wire_##T; \
+    _Static_assert(sizeof(itto_wire_##T) == (len), "ITTO '" #T "' fields do not add up to the spec length");
+ITTO_MESSAGES(ITTO_GEN_WIRE)
+#undef ITTO_GEN_WIRE
+
+/* Handler table. Any slot may be NULL; ctx is passed through untouched. */
+#define ITTO_GEN_SLOT(Name, T, slot) void (*slot)(const Name *m, void *ctx);
+typedef struct {
+    ITTO_STRUCTS(ITTO_GEN_SLOT)
+    void (*on_unknown)(const uint8_t *msg, size_t len, void *ctx);
+} itto_handlers_t;
+#undef ITTO_GEN_SLOT
+
+/* Handler table that prints every message */
+extern const itto_handlers_t itto_print_handlers;
+
+/* Decode one framed message and dispatch it.
+ * Returns the message length on success, 0 if len is shorter than the
+ * message type requires, -1 for an unknown type (on_unknown is called). */
+int itto_decode(const uint8_t *msg, size_t len, const itto_handlers_t *h, void *ctx);
+
+/* Print one message to stdout */
+void parse_itto_message(const uint8_t *msg, size_t len);
+
+/* Message length for a type byte, 0 if unknown */
+size_t get_itto_message_length(uint8_t msg_type);
+
+/* The same lengths as a table, for inline use in framing loops */
+extern const uint8_t itto_message_lengths[256];
+
+static inline void itto_decode_header(const uint8_t *msg, ITTOHeader *h) {
+    h->messageType = (char)msg[0];
+    h->trackingNumber = itch_read_u16(msg + 1);
+    h->timestamp = itch_read_timestamp(msg + 3);
+}
+
+static inline void itto_encode_header(uint8_t *msg, char type, const ITTOHeader *h) {
+    msg[0] = (uint8_t)type;
+    itch_write_u16(msg + 1, h->trackingNumber);
+    itch_write_timestamp(msg + 3, h->timestamp);
+}
+
+/* Per-type extractors: itto_decode_<type>(msg, &m). Caller guarantees msg
+ * holds a full message of that type, with 8 bytes readable from the
+ * timestamp (the 10-byte S message is read 1 byte past its end). */
+#define ITTO_GEN_DECODE(c, T, Name, len, slot)                        \
+    static inline void itto_decode_##T(const uint8_t *msg, Name *m) { \
+        typedef itto_wire_##T wire_t;                                 \
+        itto_decode_header(msg, &m->header);                          \
+        ITTO_FIELDS_##T(ITCH_SCHEMA_READ)                             \
+    }
+ITTO_MESSAGES(ITTO_GEN_DECODE)
+#undef ITTO_GEN_DECODE
+
+/* Per-type writers: itto_encode_<type>(msg, &m) writes the whole message
+ * and returns its length. The type byte picks the form, so one struct can
+ * be written short or long; short forms truncate prices to 2 decimals. */
+#define ITTO_GEN_ENCODE(c, T, Name, len, slot)                            \
+    static inline size_t itto_encode_##T(uint8_t *msg, const Name *m) {   \
+        typedef itto_wire_##T wire_t;                                     \
+        itto_encode_header(msg, c, &m->header);                           \
+        ITTO_FIELDS_##T(ITCH_SCHEMA_WRITE)                                \
+        return sizeof(wire_t);                                            \
+    }
+ITTO_MESSAGES(ITTO_GEN_ENCODE)
+#undef ITTO_GEN_ENCODE
+
+#endif /* ITTO_PARSER_H */
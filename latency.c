@@ -0,0 +1,104 @@
+/*
+ * Latency - see latency.h
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include "latency.h"
+
+latency_hist_t *latency_hist_create(void) {
+    latency_hist_t *h = aligned_alloc(64, (sizeof(latency_hist_t) + 63) / 64 * 64);
+    if (!h) return NULL;
+    memset(h, 0, sizeof(*h));
+    return h;
+}
+
+void latency_hist_destroy(latency_hist_t *h) {
+    free(h);
+}
+
+/* Highest value that lands in bucket b */
+static uint64_t bucket_top(uint32_t b) {
+    if (b < LATENCY_SUB_BUCKETS) return b;
+    unsigned shift = b / LATENCY_SUB_BUCKETS - 1;
+    uint64_t base = (uint64_t)(LATENCY_SUB_BUCKETS + b % LATENCY_SUB_BUCKETS) << shift;
+    return base + ((1ULL << shift) - 1);
+}
+
+static uint64_t load(const _Atomic uint64_t *c) {
+    return atomic_load_explicit(c, memory_order_relaxed);
+}
+
+void latency_hist_snapshot(const latency_hist_t *h, latency_hist_t *out) {
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++)
+        atomic_store_explicit(&out->buckets[b], load(&h->buckets[b]), memory_order_relaxed);
+    atomic_store_explicit(&out->count, load(&h->count), memory_order_relaxed);
+    atomic_store_explicit(&out->sum, load(&h->sum), memory_order_relaxed);
+    atomic_store_explicit(&out->max, load(&h->max), memory_order_relaxed);
+    atomic_store_explicit(&out->negative, load(&h->negative), memory_order_relaxed);
+}
+
+void latency_hist_summarize(const latency_hist_t *cur, const latency_hist_t *prev,
+                            latency_summary_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint64_t count = 0;
+    uint32_t top = 0;
+    for (uint32_t b = 0; b < LATENCY_BUCKETS; b++) {
+        uint64_t n = load(&cur->buckets[b]) - (prev ? load(&prev->buckets[b]) : 0);
+        if (n) top = b;
+        count += n;
+    }
+    if (count == 0) return;
+
+    // Walk the buckets once more, picking off each percentile as it is passed
+    static const double pct[] = { 0.50, 0.90, 0.99, 0.999 };
+    uint64_t *dest[] = { &out->p50, &out->p90, &out->p99, &out->p999 };
+    uint64_t seen = 0;
+    size_t k = 0;
+    for (uint32_t b = 0; b < LATENCY_BUCKETS && k < 4; b++) {
+        seen += load(&cur->buckets[b]) - (prev ? load(&prev->buckets[b]) : 0);
+        while (k < 4 && seen >= (uint64_t)(pct[k] * (double)count + 0.5) && seen > 0) {
+            *dest[k++] = bucket_top(b);
+        }
+    }
+
+    uint64_t sum = load(&cur->sum) - (prev ? load(&prev->sum) : 0);
+    out->count = count;
+    out->negative = load(&cur->negative) - (prev ? load(&prev->negative) : 0);
+    out->mean = (double)sum / (double)count;
+    // The exact max is only known over the whole run
+    out->max = prev ? bucket_top(top) : load(&cur->max);
+    for (k = 0; k < 4; k++) {
+        if (*dest[k] > out->max) *dest[k] = out->max;
+    }
+}
+
+static void format_ns(char *buf, size_t len, uint64_t ns) {
+    if (ns >= 10000000) snprintf(buf, len, "%.1f ms", ns / 1e6);
+    else if (ns >= 10000) snprintf(buf, len, "%.1f us", ns / 1e3);
+    else snprintf(buf, len, "%lu ns", ns);
+}
+
+void latency_hist_print(const latency_hist_t *h, const char *name, FILE *out) {
+    latency_summary_t s;
+    latency_hist_summarize(h, NULL, &s);
+    if (s.count == 0) {
+        fprintf(out, "%s: no samples\n", name);
+        return;
+    }
+    char mean[24], p50[24], p99[24], p999[24], max[24];
+    format_ns(mean, sizeof(mean), (uint64_t)s.mean);
+    format_ns(p50, sizeof(p50), s.p50);
+    format_ns(p99, sizeof(p99), s.p99);
+    format_ns(p999, sizeof(p999), s.p999);
+    format_ns(max, sizeof(max), s.max);
+    fprintf(out, "%s: %lu samples, mean %s, p50 %s, p99 %s, p99.9 %s, max %s\n",
+            name, s.count, mean, p50, p99, p999, max);
+    if (s.negative) fprintf(out, "  %lu samples below zero (clocks not in sync?)\n", s.negative);
+}
+
+void latency_summary_write_json(const latency_summary_t *s, FILE *out) {
+    fprintf(out, "{\"count\":%lu,\"mean\":%.1f,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"p999\":%lu,\"max\":%lu}",
+            s->count, s->mean, s->p50, s->p90, s->p99, s->p999, s->max);
+}
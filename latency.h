@@ -0,0 +1,122 @@
+/*
+ * Latency - HDR-style latency histograms and the send-time stamp clock
+ *
+ * A histogram is log-linear: values below 2^LATENCY_SUB_BITS ns are counted
+ * exactly, and every power of two above that is split into 2^LATENCY_SUB_BITS
+ * equal buckets, so any value is reported within 1 / 2^LATENCY_SUB_BITS
+ * (under 0.8%) of its true value up to 2^LATENCY_MAX_BITS ns (about 18
+ * minutes; larger values land in the last bucket). Recording is a bit scan,
+ * a shift and one counter increment, with no allocation and no division.
+ *
+ * One thread records; any other thread may read at the same time. Counters
+ * are single-writer atomics updated with relaxed loads and stores (plain
+ * moves on x86 and arm64, no locked instructions), so a reporter thread can
+ * snapshot a live histogram without the recorder ever waiting on it. A
+ * snapshot taken mid-update may be off by the messages in flight.
+ *
+ * Send-time stamps: with -T the replay server overwrites each outgoing
+ * message's timestamp with latency_wall_ns() (CLOCK_REALTIME, ns since UTC
+ * midnight), and the client measures wire-to-decode as its own
+ * latency_wall_ns() minus the stamp. Both ends must share a clock: the same
+ * host, or hosts synchronized with PTP.
+ *
+ * Usage:
+ *   latency_hist_t *h = latency_hist_create();
+ *   latency_hist_record(h, latency_wall_ns() - sent);     // recorder thread
+ *   latency_hist_snapshot(h, snap);                       // any thread
+ *   latency_hist_print(snap, "wire-to-decode", stdout);
+ *   latency_hist_destroy(h);
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#define LATENCY_SUB_BITS 7
+#define LATENCY_MAX_BITS 40
+#define LATENCY_SUB_BUCKETS (1u << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS ((LATENCY_MAX_BITS - LATENCY_SUB_BITS + 1) * LATENCY_SUB_BUCKETS)
+#define LATENCY_NS_PER_DAY 86400000000000ULL
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+    _Atomic uint64_t negative;  // samples below zero (clock skew), recorded as 0
+    _Atomic uint64_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+/* Percentiles of a histogram (or of the difference of two snapshots) */
+typedef struct {
+    uint64_t count;
+    uint64_t negative;
+    double mean;
+    uint64_t p50;
+    uint64_t p90;
+    uint64_t p99;
+    uint64_t p999;
+    uint64_t max;
+} latency_summary_t;
+
+latency_hist_t *latency_hist_create(void);
+void latency_hist_destroy(latency_hist_t *h);
+
+static inline uint32_t latency_bucket(uint64_t v) {
+    if (v < LATENCY_SUB_BUCKETS) return (uint32_t)v;
+    unsigned msb = 63 - (unsigned)__builtin_clzll(v);
+    if (msb >= LATENCY_MAX_BITS) return LATENCY_BUCKETS - 1;
+    unsigned shift = msb - LATENCY_SUB_BITS;
+    return (shift + 1) * LATENCY_SUB_BUCKETS + (uint32_t)((v >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/* Single writer: relaxed load + store, never a locked read-modify-write */
+static inline void latency_add(_Atomic uint64_t *c, uint64_t v) {
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static inline void latency_hist_record(latency_hist_t *h, uint64_t ns) {
+    latency_add(&h->buckets[latency_bucket(ns)], 1);
+    latency_add(&h->count, 1);
+    latency_add(&h->sum, ns);
+    if (ns > atomic_load_explicit(&h->max, memory_order_relaxed))
+        atomic_store_explicit(&h->max, ns, memory_order_relaxed);
+}
+
+/* Record end - start, where both are ns since midnight (end may have wrapped) */
+static inline void latency_hist_record_since(latency_hist_t *h, uint64_t start, uint64_t end) {
+    if (end < start && start - end > LATENCY_NS_PER_DAY / 2) end += LATENCY_NS_PER_DAY;
+    if (end < start) {
+        latency_add(&h->negative, 1);
+        latency_hist_record(h, 0);
+        return;
+    }
+    latency_hist_record(h, end - start);
+}
+
+/* CLOCK_REALTIME in ns since UTC midnight: the send-time stamp clock */
+static inline uint64_t latency_wall_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)(ts.tv_sec % 86400) * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Copy a live histogram into out (any thread) */
+void latency_hist_snapshot(const latency_hist_t *h, latency_hist_t *out);
+
+/* Summarize cur, or only the samples recorded since prev when prev is not
+ * NULL (both snapshots of the same histogram). The interval max is the top
+ * of the highest bucket that gained samples. */
+void latency_hist_summarize(const latency_hist_t *cur, const latency_hist_t *prev,
+                            latency_summary_t *out);
+
+/* One-line summary: "name: n samples, mean, p50, p99, p99.9, max" */
+void latency_hist_print(const latency_hist_t *h, const char *name, FILE *out);
+
+/* {"count":..,"mean":..,"p50":..,"p90":..,"p99":..,"p999":..,"max":..} */
+void latency_summary_write_json(const latency_summary_t *s, FILE *out);
+
+#endif /* LATENCY_H */
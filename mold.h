@@ -0,0 +1,60 @@
+/*
+ * MoldUDP64 - wire helpers shared by the publisher and the receiver
+ *
+ *   packet:   [session:10][seq:8][count:2] then count x [len:2][message]
+ *   request:  [session:10][seq:8][count:2]   (retransmit seq .. seq+count-1)
+ *
+ * count 0 is a heartbeat (seq = next message), count 0xFFFF ends the session.
+ */
+
+#ifndef MOLD_H
+#define MOLD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "itch_framing.h"
+#include "itch_parser.h"
+
+#define MOLD_SESSION_LEN 10
+#define MOLD_MAX_DATAGRAM 2048          // receive slot size; larger than any MTU in use
+
+static inline void mold_put_u16(uint8_t *b, uint16_t v) {
+    b[0] = (uint8_t)(v >> 8);
+    b[1] = (uint8_t)v;
+}
+
+static inline void mold_put_u64(uint8_t *b, uint64_t v) {
+    v = __builtin_bswap64(v);
+    memcpy(b, &v, 8);
+}
+
+/* Packet header, heartbeat or retransmission request */
+static inline void mold_write_header(uint8_t *b, const char *session, uint64_t seq, uint16_t count) {
+    memcpy(b, session, MOLD_SESSION_LEN);
+    mold_put_u64(b + 10, seq);
+    mold_put_u16(b + 18, count);
+}
+
+static inline uint64_t mold_header_seq(const uint8_t *b) {
+    return itch_read_u64(b + 10);
+}
+
+static inline uint16_t mold_header_count(const uint8_t *b) {
+    return itch_read_u16(b + 18);
+}
+
+/* Parse "host:port". Returns 0, or -1 if malformed. */
+static inline int mold_parse_endpoint(const char *s, char *host, size_t host_len, int *port) {
+    const char *colon = strrchr(s, ':');
+    if (!colon || (size_t)(colon - s) >= host_len) return -1;
+    memcpy(host, s, (size_t)(colon - s));
+    host[colon - s] = '\0';
+    char *end;
+    long v = strtol(colon + 1, &end, 10);
+    if (*end != '\0' || v <= 0 || v > 65535) return -1;
+    *port = (int)v;
+    return 0;
+}
+
+#endif /* MOLD_H */
@@ -0,0 +1,273 @@
+/*
+ * MoldUDP64 Publisher - see mold_pub.h
+ *
+ * The publisher builds the current packet without locking. The mutex
+ * guards the packet history and the counters. The publisher takes it once
+ * per sent packet; the retransmission thread takes it per request and per
+ * heartbeat check.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "mold_pub.h"
+#include "mold.h"
+
+#define HEARTBEAT_NS 1000000000ULL
+#define POLL_MS 100
+
+struct mold_pub {
+    mold_pub_config_t cfg;
+    char session[MOLD_SESSION_LEN];
+    int mcast_fd;
+    int retrans_fd;
+    struct sockaddr_in group_addr;
+
+    // Current packet (publisher only)
+    uint8_t *pkt;
+    size_t pkt_len;
+    uint16_t pkt_count;
+    uint64_t next_seq;          // sequence number of the next message added
+
+    // History ring of sent packets, guarded by lock
+    pthread_mutex_t lock;
+    uint8_t *hist_data;         // history x mtu
+    uint16_t *hist_len;
+    uint64_t *hist_seq;
+    uint64_t hist_head;         // packets stored so far
+    uint64_t sent_seq;          // sequence number after the last sent packet
+    uint64_t last_send_ns;
+    mold_pub_stats_t stats;
+
+    volatile int running;
+    pthread_t thread;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Send a header-only packet (heartbeat or end of session); lock held */
+static void send_control(mold_pub_t *p, uint16_t count) {
+    uint8_t b[MOLDUDP64_HEADER_SIZE];
+    mold_write_header(b, p->session, p->sent_seq, count);
+    sendto(p->mcast_fd, b, sizeof(b), 0, (struct sockaddr *)&p->group_addr, sizeof(p->group_addr));
+    p->last_send_ns = now_ns();
+    p->stats.heartbeats++;
+}
+
+/* Index of the stored packet holding message seq, or -1 if it left the ring */
+static int64_t find_packet(const mold_pub_t *p, uint64_t seq) {
+    uint64_t history = p->cfg.history;
+    uint64_t lo = p->hist_head > history ? p->hist_head - history : 0;
+    uint64_t hi = p->hist_head;
+    if (lo == hi || seq < p->hist_seq[lo % history] || seq >= p->sent_seq) return -1;
+    // Last packet whose first sequence number is <= seq
+    while (hi - lo > 1) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (p->hist_seq[mid % history] <= seq) lo = mid;
+        else hi = mid;
+    }
+    return (int64_t)lo;
+}
+
+static void serve_request(mold_pub_t *p, const uint8_t *req, ssize_t len,
+                          const struct sockaddr_in *from) {
+    if (len < MOLDUDP64_HEADER_SIZE || memcmp(req, p->session, MOLD_SESSION_LEN) != 0) return;
+    uint64_t seq = mold_header_seq(req);
+    uint16_t count = mold_header_count(req);
+
+    pthread_mutex_lock(&p->lock);
+    p->stats.retrans_requests++;
+    int64_t i = find_packet(p, seq);
+    if (i < 0) {
+        p->stats.retrans_misses++;
+    } else {
+        uint64_t end = seq + (count ? count : 1);
+        for (int sent = 0; (uint64_t)i < p->hist_head && sent < MOLD_MAX_RETRANS_PACKETS; i++, sent++) {
+            size_t slot = (size_t)((uint64_t)i % p->cfg.history);
+            if (p->hist_seq[slot] >= end) break;
+            sendto(p->retrans_fd, p->hist_data + slot * p->cfg.mtu, p->hist_len[slot], 0,
+                   (const struct sockaddr *)from, sizeof(*from));
+            p->stats.retrans_packets++;
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void *retrans_thread(void *arg) {
+    mold_pub_t *p = arg;
+    uint8_t req[64];
+    struct pollfd pfd = { .fd = p->retrans_fd, .events = POLLIN };
+
+    while (p->running) {
+        if (poll(&pfd, 1, POLL_MS) > 0) {
+            struct sockaddr_in from;
+            socklen_t from_len = sizeof(from);
+            ssize_t n = recvfrom(p->retrans_fd, req, sizeof(req), MSG_DONTWAIT,
+                                 (struct sockaddr *)&from, &from_len);
+            if (n > 0) serve_request(p, req, n, &from);
+        }
+
+        pthread_mutex_lock(&p->lock);
+        if (now_ns() - p->last_send_ns >= HEARTBEAT_NS) send_control(p, 0);
+        pthread_mutex_unlock(&p->lock);
+    }
+    return NULL;
+}
+
+mold_pub_t *mold_pub_create(const mold_pub_config_t *cfg) {
+    mold_pub_t *p = calloc(1, sizeof(mold_pub_t));
+    if (!p) return NULL;
+    p->cfg = *cfg;
+    if (p->cfg.mtu == 0) p->cfg.mtu = MOLD_DEFAULT_MTU;
+    if (p->cfg.history == 0) p->cfg.history = MOLD_DEFAULT_HISTORY;
+    if (p->cfg.ttl == 0) p->cfg.ttl = 1;
+    if (p->cfg.retrans_port == 0) p->cfg.retrans_port = cfg->port + 1;
+    const char *session = cfg->session ? cfg->session : MOLD_DEFAULT_SESSION;
+    memset(p->session, ' ', sizeof(p->session));
+    memcpy(p->session, session, strnlen(session, sizeof(p->session)));
+    p->mcast_fd = -1;
+    p->retrans_fd = -1;
+    p->next_seq = 1;
+    p->sent_seq = 1;
+    p->last_send_ns = now_ns();
+    pthread_mutex_init(&p->lock, NULL);
+
+    p->pkt = malloc(p->cfg.mtu);
+    p->hist_data = malloc(p->cfg.history * p->cfg.mtu);
+    p->hist_len = malloc(p->cfg.history * sizeof(uint16_t));
+    p->hist_seq = malloc(p->cfg.history * sizeof(uint64_t));
+    if (!p->pkt || !p->hist_data || !p->hist_len || !p->hist_seq) {
+        fprintf(stderr, "MoldUDP64: out of memory\n");
+        mold_pub_destroy(p);
+        return NULL;
+    }
+
+    p->group_addr.sin_family = AF_INET;
+    p->group_addr.sin_port = htons((uint16_t)cfg->port);
+    if (inet_pton(AF_INET, cfg->group, &p->group_addr.sin_addr) != 1) {
+        fprintf(stderr, "MoldUDP64: invalid group address %s\n", cfg->group);
+        mold_pub_destroy(p);
+        return NULL;
+    }
+
+    p->mcast_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    unsigned char ttl = (unsigned char)p->cfg.ttl;
+    unsigned char loop = 1;     // consumers on this host see the feed too
+    if (p->mcast_fd < 0 ||
+        setsockopt(p->mcast_fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+        setsockopt(p->mcast_fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0) {
+        perror("MoldUDP64: multicast socket");
+        mold_pub_destroy(p);
+        return NULL;
+    }
+    if (cfg->iface) {
+        struct in_addr iface;
+        if (inet_pton(AF_INET, cfg->iface, &iface) != 1 ||
+            setsockopt(p->mcast_fd, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface)) < 0) {
+            fprintf(stderr, "MoldUDP64: cannot use interface %s\n", cfg->iface);
+            mold_pub_destroy(p);
+            return NULL;
+        }
+    }
+
+    p->retrans_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in raddr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = INADDR_ANY,
+        .sin_port = htons((uint16_t)p->cfg.retrans_port),
+    };
+    if (p->retrans_fd < 0 || bind(p->retrans_fd, (struct sockaddr *)&raddr, sizeof(raddr)) < 0) {
+        fprintf(stderr, "MoldUDP64: cannot bind retransmission port %d (%s)\n",
+                p->cfg.retrans_port, strerror(errno));
+        mold_pub_destroy(p);
+        return NULL;
+    }
+
+    p->running = 1;
+    if (pthread_create(&p->thread, NULL, retrans_thread, p) != 0) {
+        p->running = 0;
+        mold_pub_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+void mold_pub_destroy(mold_pub_t *p) {
+    if (!p) return;
+    if (p->running) {
+        mold_pub_flush(p);
+        p->running = 0;
+        pthread_join(p->thread, NULL);
+        send_control(p, MOLDUDP64_END_OF_SESSION);
+    }
+    if (p->mcast_fd >= 0) close(p->mcast_fd);
+    if (p->retrans_fd >= 0) close(p->retrans_fd);
+    pthread_mutex_destroy(&p->lock);
+    free(p->pkt);
+    free(p->hist_data);
+    free(p->hist_len);
+    free(p->hist_seq);
+    free(p);
+}
+
+int mold_pub_message(mold_pub_t *p, const uint8_t *msg, size_t len) {
+    if (MOLDUDP64_HEADER_SIZE + 2 + len > p->cfg.mtu) return -1;
+    if (p->pkt_count && p->pkt_len + 2 + len > p->cfg.mtu) mold_pub_flush(p);
+    if (p->pkt_count == 0) p->pkt_len = MOLDUDP64_HEADER_SIZE;
+
+    mold_put_u16(p->pkt + p->pkt_len, (uint16_t)len);
+    memcpy(p->pkt + p->pkt_len + 2, msg, len);
+    p->pkt_len += 2 + len;
+    p->pkt_count++;
+    p->next_seq++;
+    return 0;
+}
+
+void mold_pub_flush(mold_pub_t *p) {
+    if (p->pkt_count == 0) return;
+    uint64_t first = p->next_seq - p->pkt_count;
+    mold_write_header(p->pkt, p->session, first, p->pkt_count);
+    if (sendto(p->mcast_fd, p->pkt, p->pkt_len, 0, (struct sockaddr *)&p->group_addr,
+               sizeof(p->group_addr)) < 0 && errno != ENOBUFS) {
+        perror("MoldUDP64: sendto");
+    }
+
+    pthread_mutex_lock(&p->lock);
+    size_t slot = (size_t)(p->hist_head % p->cfg.history);
+    memcpy(p->hist_data + slot * p->cfg.mtu, p->pkt, p->pkt_len);
+    p->hist_len[slot] = (uint16_t)p->pkt_len;
+    p->hist_seq[slot] = first;
+    p->hist_head++;
+    p->sent_seq = p->next_seq;
+    p->last_send_ns = now_ns();
+    p->stats.packets++;
+    p->stats.messages += p->pkt_count;
+    p->stats.bytes += p->pkt_len;
+    pthread_mutex_unlock(&p->lock);
+
+    p->pkt_count = 0;
+    p->pkt_len = 0;
+}
+
+size_t mold_pub_pending(const mold_pub_t *p) {
+    return p->pkt_count ? p->pkt_len : 0;
+}
+
+void mold_pub_get_stats(mold_pub_t *p, mold_pub_stats_t *out) {
+    pthread_mutex_lock(&p->lock);
+    *out = p->stats;
+    pthread_mutex_unlock(&p->lock);
+}
@@ -0,0 +1,83 @@
+/*
+ * MoldUDP64 Publisher - multicast ITCH with sequence numbers and retransmission
+ *
+ * Messages are packed into MoldUDP64 packets of at most mtu bytes:
+ *
+ *   [session:10][seq:8][count:2] then count x [len:2][message]
+ *
+ * where seq numbers the packet's first message (the session's first message
+ * is seq 1). A packet goes to the multicast group when the next message
+ * would not fit or on mold_pub_flush, so the server's cost is the same for
+ * one consumer or a thousand.
+ *
+ * Every sent packet is also kept in a ring of the last `history` packets.
+ * A second thread serves retransmission requests on a unicast UDP port:
+ *
+ *   request:  [session:10][seq:8][count:2]   messages seq .. seq+count-1
+ *   response: the original packets covering that range, sent to the requester
+ *
+ * Packets that have left the ring are not answered. The same thread sends a
+ * heartbeat (count 0, seq = next message) when nothing has gone out for a
+ * second, and mold_pub_destroy ends the session with count 0xFFFF.
+ *
+ * Usage:
+ *   mold_pub_config_t cfg = { .group = "239.1.1.1", .port = 30001 };
+ *   mold_pub_t *p = mold_pub_create(&cfg);
+ *   mold_pub_message(p, msg, len);      // per message
+ *   mold_pub_flush(p);                  // end of a timestamp group
+ *   mold_pub_destroy(p);
+ */
+
+#ifndef MOLD_PUB_H
+#define MOLD_PUB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MOLD_DEFAULT_MTU 1400           // UDP payload; fits a 1500-byte Ethernet frame
+#define MOLD_DEFAULT_HISTORY 16384      // packets kept for retransmission
+#define MOLD_DEFAULT_SESSION "ITCHREPLAY"
+#define MOLD_MAX_RETRANS_PACKETS 64     // per request, to bound the response
+
+typedef struct {
+    const char *group;          // multicast group address
+    int port;
+    const char *iface;          // local interface address, NULL = default route
+    int ttl;                    // default 1 (stay on the local network)
+    int retrans_port;           // unicast retransmission port, default port + 1
+    size_t mtu;                 // default MOLD_DEFAULT_MTU
+    size_t history;             // default MOLD_DEFAULT_HISTORY
+    const char *session;        // up to 10 characters, space padded
+} mold_pub_config_t;
+
+typedef struct {
+    uint64_t packets;
+    uint64_t messages;
+    uint64_t bytes;             // datagram payload bytes, headers included
+    uint64_t heartbeats;
+    uint64_t retrans_requests;
+    uint64_t retrans_packets;
+    uint64_t retrans_misses;    // requests for packets no longer in the ring
+} mold_pub_stats_t;
+
+typedef struct mold_pub mold_pub_t;
+
+/* Open the sockets and start the retransmission thread. NULL on failure. */
+mold_pub_t *mold_pub_create(const mold_pub_config_t *cfg);
+
+/* Flush, send end of session and stop */
+void mold_pub_destroy(mold_pub_t *p);
+
+/* Add one message to the current packet. Returns 0, or -1 if it cannot fit
+ * in a packet. */
+int mold_pub_message(mold_pub_t *p, const uint8_t *msg, size_t len);
+
+/* Send the current packet, if it holds any messages */
+void mold_pub_flush(mold_pub_t *p);
+
+/* Bytes waiting in the current packet */
+size_t mold_pub_pending(const mold_pub_t *p);
+
+void mold_pub_get_stats(mold_pub_t *p, mold_pub_stats_t *out);
+
+#endif /* MOLD_PUB_H */
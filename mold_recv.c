@@ -0,0 +1,417 @@
+/*
+ * MoldUDP64 Receiver - see mold_recv.h
+ *
+ * State is one expected sequence number plus a sorted array of buffered
+ * packets past it. At most one gap is open at a time: the hole from the
+ * expected message to the first buffered packet (or the highest sequence a
+ * packet or heartbeat has announced). Filling it may expose the next hole,
+ * which opens as a new gap.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "mold_recv.h"
+#include "mold.h"
+
+#define SLOT_SIZE (MOLD_MAX_DATAGRAM + 8)      // datagram plus load slack
+#define RCVBUF_BYTES (16 << 20)
+#define MAX_REQUEST_COUNT 0xFFFE
+
+typedef struct {
+    uint64_t seq;
+    size_t len;
+    uint8_t *data;              // copy of the datagram, with slack
+} pending_pkt_t;
+
+struct mold_recv {
+    mold_recv_config_t cfg;
+    int mcast_fd;
+    int retrans_fd;
+    struct sockaddr_in retrans_addr;
+
+    char session[MOLD_SESSION_LEN];
+    int started;                // the first packet fixed the session and sequence
+    uint64_t expected;          // next sequence number to deliver
+    uint64_t highest;           // one past the highest sequence announced
+    int eos;
+
+    // Sorted out-of-order packets in [pstart, pend)
+    pending_pkt_t *pending;
+    size_t pstart;
+    size_t pend;
+
+    int gap_open;
+    uint64_t gap_seq;           // expected sequence when the gap was last requested
+    uint64_t gap_end;           // end of the hole when the gap opened
+    uint64_t gap_start_ns;
+    uint64_t gap_request_ns;
+    int gap_retries;
+
+    uint8_t *slots;
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    mold_recv_stats_t stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline size_t pending_count(const mold_recv_t *r) {
+    return r->pend - r->pstart;
+}
+
+/* First sequence number after the current hole */
+static uint64_t hole_end(const mold_recv_t *r) {
+    return pending_count(r) ? r->pending[r->pstart].seq : r->highest;
+}
+
+/* Deliver the messages of one packet at or past the expected sequence */
+static int deliver_packet(mold_recv_t *r, const uint8_t *data, size_t len,
+                          mold_msg_fn fn, void *ctx) {
+    uint64_t seq = mold_header_seq(data);
+    uint16_t count = mold_header_count(data);
+    uint64_t skip = r->expected > seq ? r->expected - seq : 0;
+    size_t pos = MOLDUDP64_HEADER_SIZE;
+    int delivered = 0;
+    uint16_t i;
+    for (i = 0; i < count; i++) {
+        if (pos + 2 > len) break;
+        size_t msg_len = itch_read_u16(data + pos);
+        if (pos + 2 + msg_len > len) break;
+        if (i >= skip) {
+            fn(data + pos + 2, msg_len, seq + i, ctx);
+            delivered++;
+        }
+        pos += 2 + msg_len;
+    }
+    if (i < count) r->stats.malformed++;
+    // A truncated packet leaves its tail missing, to be requested as a gap
+    if (seq + i > r->expected) r->expected = seq + i;
+    r->stats.messages += (uint64_t)delivered;
+    return delivered;
+}
+
+/* Deliver buffered packets the expected sequence has reached */
+static int drain_pending(mold_recv_t *r, mold_msg_fn fn, void *ctx) {
+    int delivered = 0;
+    while (pending_count(r) && r->pending[r->pstart].seq <= r->expected) {
+        pending_pkt_t *p = &r->pending[r->pstart++];
+        if (p->seq + mold_header_count(p->data) > r->expected) {
+            delivered += deliver_packet(r, p->data, p->len, fn, ctx);
+        }
+        free(p->data);
+    }
+    if (pending_count(r) == 0) r->pstart = r->pend = 0;
+    return delivered;
+}
+
+static void send_request(mold_recv_t *r) {
+    uint64_t count = hole_end(r) - r->expected;
+    if (count > MAX_REQUEST_COUNT) count = MAX_REQUEST_COUNT;
+    uint8_t req[MOLDUDP64_HEADER_SIZE];
+    mold_write_header(req, r->session, r->expected, (uint16_t)count);
+    sendto(r->retrans_fd, req, sizeof(req), 0, (struct sockaddr *)&r->retrans_addr,
+           sizeof(r->retrans_addr));
+    r->gap_request_ns = now_ns();
+    r->stats.retrans_requests++;
+}
+
+/* Open a gap over a new hole, or close the open one once delivery passes it */
+static void update_gap(mold_recv_t *r) {
+    int missing = r->expected < hole_end(r);
+    if (r->gap_open && r->expected != r->gap_seq) {
+        if (missing && r->expected < r->gap_end) {
+            // Part of the hole came back: ask for the rest now
+            r->gap_seq = r->expected;
+            r->gap_retries = 0;
+            send_request(r);
+            return;
+        }
+        uint64_t took = now_ns() - r->gap_start_ns;
+        r->gap_open = 0;
+        r->stats.recovered++;
+        r->stats.recovery_ns_total += took;
+        if (took > r->stats.recovery_ns_max) r->stats.recovery_ns_max = took;
+    }
+    if (missing && !r->gap_open) {
+        r->gap_open = 1;
+        r->gap_seq = r->expected;
+        r->gap_end = hole_end(r);
+        r->gap_retries = 0;
+        r->gap_start_ns = now_ns();
+        r->stats.gaps++;
+        r->stats.gap_messages += r->gap_end - r->expected;
+        send_request(r);
+    }
+}
+
+/* Stop waiting for the current hole: its messages are lost */
+static int skip_hole(mold_recv_t *r, mold_msg_fn fn, void *ctx) {
+    uint64_t end = hole_end(r);
+    r->stats.lost_messages += end - r->expected;
+    r->expected = end;
+    r->gap_open = 0;
+    int delivered = drain_pending(r, fn, ctx);
+    update_gap(r);
+    return delivered;
+}
+
+/* Keep an out-of-order packet in sequence order (a duplicate is dropped) */
+static int buffer_packet(mold_recv_t *r, const uint8_t *data, size_t len, uint64_t seq,
+                         mold_msg_fn fn, void *ctx) {
+    int delivered = 0;
+    if (pending_count(r) == r->cfg.max_pending) delivered += skip_hole(r, fn, ctx);
+    if (pending_count(r) == r->cfg.max_pending) return delivered;   // still full: drop
+    if (r->pend == r->cfg.max_pending) {
+        memmove(r->pending, r->pending + r->pstart, pending_count(r) * sizeof(pending_pkt_t));
+        r->pend -= r->pstart;
+        r->pstart = 0;
+    }
+
+    size_t i = r->pend;
+    while (i > r->pstart && r->pending[i - 1].seq > seq) i--;
+    if (i > r->pstart && r->pending[i - 1].seq == seq) {
+        r->stats.duplicates++;
+        return delivered;
+    }
+    uint8_t *copy = malloc(len + 8);
+    if (!copy) return delivered;
+    memcpy(copy, data, len);
+    memmove(r->pending + i + 1, r->pending + i, (r->pend - i) * sizeof(pending_pkt_t));
+    r->pending[i] = (pending_pkt_t){ .seq = seq, .len = len, .data = copy };
+    r->pend++;
+    r->stats.out_of_order++;
+    return delivered;
+}
+
+static int process_packet(mold_recv_t *r, const uint8_t *data, size_t len, int retransmitted,
+                          mold_msg_fn fn, void *ctx) {
+    if (len < MOLDUDP64_HEADER_SIZE) {
+        r->stats.malformed++;
+        return 0;
+    }
+    if (!r->started) {
+        memcpy(r->session, data, MOLD_SESSION_LEN);
+        r->expected = r->highest = mold_header_seq(data);
+        r->started = 1;
+    } else if (memcmp(r->session, data, MOLD_SESSION_LEN) != 0) {
+        r->stats.other_sessions++;
+        return 0;
+    }
+
+    uint64_t seq = mold_header_seq(data);
+    uint16_t count = mold_header_count(data);
+    int delivered = 0;
+
+    if (count == 0 || count == MOLDUDP64_END_OF_SESSION) {
+        // Heartbeat or end of session: seq is the next message to be sent
+        if (count == 0) r->stats.heartbeats++;
+        else r->eos = 1;
+        if (seq > r->highest) r->highest = seq;
+    } else {
+        r->stats.packets++;
+        if (retransmitted) r->stats.retrans_packets++;
+        uint64_t end = seq + count;
+        if (end > r->highest) r->highest = end;
+        if (end <= r->expected) {
+            r->stats.duplicates++;
+        } else if (seq <= r->expected) {
+            delivered += deliver_packet(r, data, len, fn, ctx);
+            delivered += drain_pending(r, fn, ctx);
+        } else {
+            delivered += buffer_packet(r, data, len, seq, fn, ctx);
+        }
+    }
+    update_gap(r);
+    return delivered;
+}
+
+/* Read everything queued on one socket, a batch per recvmmsg */
+static int read_socket(mold_recv_t *r, int fd, int retransmitted, mold_msg_fn fn, void *ctx) {
+    int delivered = 0;
+    for (;;) {
+        for (int i = 0; i < r->cfg.batch; i++) r->msgs[i].msg_hdr.msg_flags = 0;
+        int n = recvmmsg(fd, r->msgs, (unsigned)r->cfg.batch, MSG_DONTWAIT, NULL);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return delivered;
+            perror("recvmmsg");
+            return -1;
+        }
+        r->stats.recvmmsg_calls++;
+        for (int i = 0; i < n; i++) {
+            delivered += process_packet(r, r->slots + (size_t)i * SLOT_SIZE, r->msgs[i].msg_len,
+                                        retransmitted, fn, ctx);
+        }
+        if (n < r->cfg.batch) return delivered;
+    }
+}
+
+mold_recv_t *mold_recv_create(const mold_recv_config_t *cfg) {
+    mold_recv_t *r = calloc(1, sizeof(mold_recv_t));
+    if (!r) return NULL;
+    r->cfg = *cfg;
+    if (r->cfg.batch <= 0) r->cfg.batch = MOLD_RECV_DEFAULT_BATCH;
+    if (r->cfg.retry_ns == 0) r->cfg.retry_ns = MOLD_RECV_DEFAULT_RETRY_NS;
+    if (r->cfg.max_retries <= 0) r->cfg.max_retries = MOLD_RECV_DEFAULT_RETRIES;
+    if (r->cfg.max_pending == 0) r->cfg.max_pending = MOLD_RECV_DEFAULT_PENDING;
+    if (r->cfg.retrans_port == 0) r->cfg.retrans_port = cfg->port + 1;
+    r->mcast_fd = -1;
+    r->retrans_fd = -1;
+
+    r->pending = malloc(r->cfg.max_pending * sizeof(pending_pkt_t));
+    r->slots = malloc((size_t)r->cfg.batch * SLOT_SIZE);
+    r->msgs = calloc((size_t)r->cfg.batch, sizeof(struct mmsghdr));
+    r->iovs = calloc((size_t)r->cfg.batch, sizeof(struct iovec));
+    if (!r->pending || !r->slots || !r->msgs || !r->iovs) {
+        fprintf(stderr, "MoldUDP64: out of memory\n");
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    for (int i = 0; i < r->cfg.batch; i++) {
+        r->iovs[i].iov_base = r->slots + (size_t)i * SLOT_SIZE;
+        r->iovs[i].iov_len = MOLD_MAX_DATAGRAM;
+        r->msgs[i].msg_hdr.msg_iov = &r->iovs[i];
+        r->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    struct ip_mreq mreq;
+    memset(&mreq, 0, sizeof(mreq));
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_port = htons((uint16_t)cfg->port) };
+    if (inet_pton(AF_INET, cfg->group, &mreq.imr_multiaddr) != 1) {
+        fprintf(stderr, "MoldUDP64: invalid group address %s\n", cfg->group);
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+    if (cfg->iface && inet_pton(AF_INET, cfg->iface, &mreq.imr_interface) != 1) {
+        fprintf(stderr, "MoldUDP64: invalid interface address %s\n", cfg->iface);
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    addr.sin_addr = mreq.imr_multiaddr;     // bind the group: other groups on the port stay out
+
+    int reuse = 1;
+    int rcvbuf = RCVBUF_BYTES;
+    r->mcast_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (r->mcast_fd < 0 ||
+        setsockopt(r->mcast_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(r->mcast_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        setsockopt(r->mcast_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+        fprintf(stderr, "MoldUDP64: cannot join %s:%d (%s)\n", cfg->group, cfg->port, strerror(errno));
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    setsockopt(r->mcast_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    const char *host = cfg->retrans_host ? cfg->retrans_host : "127.0.0.1";
+    r->retrans_addr.sin_family = AF_INET;
+    r->retrans_addr.sin_port = htons((uint16_t)r->cfg.retrans_port);
+    if (inet_pton(AF_INET, host, &r->retrans_addr.sin_addr) != 1) {
+        fprintf(stderr, "MoldUDP64: invalid retransmission server %s\n", host);
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    struct sockaddr_in any = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY) };
+    r->retrans_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (r->retrans_fd < 0 || bind(r->retrans_fd, (struct sockaddr *)&any, sizeof(any)) < 0) {
+        perror("MoldUDP64: retransmission socket");
+        mold_recv_destroy(r);
+        return NULL;
+    }
+    setsockopt(r->retrans_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return r;
+}
+
+void mold_recv_destroy(mold_recv_t *r) {
+    if (!r) return;
+    if (r->pending) {
+        for (size_t i = r->pstart; i < r->pend; i++) free(r->pending[i].data);
+    }
+    if (r->mcast_fd >= 0) close(r->mcast_fd);
+    if (r->retrans_fd >= 0) close(r->retrans_fd);
+    free(r->pending);
+    free(r->slots);
+    free(r->msgs);
+    free(r->iovs);
+    free(r);
+}
+
+int mold_recv_poll(mold_recv_t *r, int timeout_ms, mold_msg_fn fn, void *ctx) {
+    // Wake for the retry timer of an open gap
+    if (r->gap_open) {
+        uint64_t due = r->gap_request_ns + r->cfg.retry_ns;
+        uint64_t now = now_ns();
+        int wait = due > now ? (int)((due - now + 999999) / 1000000) : 0;
+        if (wait < timeout_ms) timeout_ms = wait;
+    }
+
+    struct pollfd pfd[2] = {
+        { .fd = r->mcast_fd, .events = POLLIN },
+        { .fd = r->retrans_fd, .events = POLLIN },
+    };
+    int ready = poll(pfd, 2, timeout_ms);
+    if (ready < 0 && errno != EINTR) {
+        perror("poll");
+        return -1;
+    }
+
+    int delivered = 0;
+    for (int i = 0; i < 2 && ready > 0; i++) {
+        if (!(pfd[i].revents & POLLIN)) continue;
+        int n = read_socket(r, pfd[i].fd, i == 1, fn, ctx);
+        if (n < 0) return -1;
+        delivered += n;
+    }
+
+    if (r->gap_open && now_ns() - r->gap_request_ns >= r->cfg.retry_ns) {
+        if (r->gap_retries >= r->cfg.max_retries) {
+            delivered += skip_hole(r, fn, ctx);
+        } else {
+            r->gap_retries++;
+            send_request(r);
+        }
+    }
+    return delivered;
+}
+
+int mold_recv_done(const mold_recv_t *r) {
+    return r->eos && r->expected >= r->highest && pending_count(r) == 0;
+}
+
+void mold_recv_get_stats(const mold_recv_t *r, mold_recv_stats_t *out) {
+    *out = r->stats;
+}
+
+void mold_recv_print_stats(const mold_recv_t *r, FILE *out) {
+    const mold_recv_stats_t *s = &r->stats;
+    fprintf(out, "=== MoldUDP64 ===\n");
+    fprintf(out, "Session: %.10s  Next Sequence: %lu%s\n", r->session, r->expected,
+            r->eos ? "  (end of session)" : "");
+    fprintf(out, "Packets: %lu (%.1f per recvmmsg)  Heartbeats: %lu  Duplicates: %lu  Out of Order: %lu\n",
+            s->packets, s->recvmmsg_calls ? (double)(s->packets + s->heartbeats) / s->recvmmsg_calls : 0.0,
+            s->heartbeats, s->duplicates, s->out_of_order);
+    fprintf(out, "Gaps: %lu (%lu messages)  Retransmit Requests: %lu  Retransmitted Packets: %lu\n",
+            s->gaps, s->gap_messages, s->retrans_requests, s->retrans_packets);
+    fprintf(out, "Recovered: %lu  Lost Messages: %lu", s->recovered, s->lost_messages);
+    if (s->recovered) {
+        fprintf(out, "  Recovery: avg %.1f us, max %.1f us",
+                s->recovery_ns_total / 1000.0 / s->recovered, s->recovery_ns_max / 1000.0);
+    }
+    fprintf(out, "\n");
+    if (s->other_sessions || s->malformed) {
+        fprintf(out, "Other Sessions: %lu  Malformed: %lu\n", s->other_sessions, s->malformed);
+    }
+    fprintf(out, "\n");
+}
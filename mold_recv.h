@@ -0,0 +1,94 @@
+/*
+ * MoldUDP64 Receiver - gap-free, in-sequence delivery from a multicast feed
+ *
+ * Datagrams are read in batches with recvmmsg from the multicast group and
+ * from the unicast socket that retransmissions come back on. Messages are
+ * delivered strictly in sequence-number order:
+ *
+ * - a packet that continues the sequence is delivered straight from the
+ *   receive slot (no copy); overlap with what was already delivered is
+ *   skipped, so retransmitted and duplicate packets are harmless
+ * - a packet past a gap is copied into a sorted out-of-order buffer, and
+ *   the missing range is requested from the retransmission server
+ * - a gap still open after retry_ns is requested again; after max_retries
+ *   it is given up on (counted as lost) and delivery resumes at the next
+ *   buffered packet, as it does when the buffer fills
+ *
+ * Nothing blocks on a gap: mold_recv_poll keeps reading (and buffering)
+ * while it waits for the retransmission.
+ *
+ * Usage:
+ *   mold_recv_config_t cfg = { .group = "239.1.1.1", .port = 30001,
+ *                              .retrans_host = "10.0.0.1" };
+ *   mold_recv_t *r = mold_recv_create(&cfg);
+ *   while (!mold_recv_done(r)) {
+ *       if (mold_recv_poll(r, 1000, on_message, ctx) < 0) break;
+ *   }
+ *   mold_recv_print_stats(r, stdout);
+ *   mold_recv_destroy(r);
+ */
+
+#ifndef MOLD_RECV_H
+#define MOLD_RECV_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#define MOLD_RECV_DEFAULT_BATCH 64
+#define MOLD_RECV_DEFAULT_RETRY_NS 20000000ULL     // 20 ms
+#define MOLD_RECV_DEFAULT_RETRIES 5
+#define MOLD_RECV_DEFAULT_PENDING 4096              // out-of-order packets
+
+/* Called once per message, in sequence order. The message has 8 readable
+ * bytes of slack past its end for the header loads. */
+typedef void (*mold_msg_fn)(const uint8_t *msg, size_t len, uint64_t seq, void *ctx);
+
+typedef struct {
+    const char *group;          // multicast group address
+    int port;
+    const char *iface;          // local interface address, NULL = any
+    const char *retrans_host;   // retransmission server, default 127.0.0.1
+    int retrans_port;           // default port + 1
+    int batch;                  // datagrams per recvmmsg
+    uint64_t retry_ns;
+    int max_retries;
+    size_t max_pending;
+} mold_recv_config_t;
+
+typedef struct {
+    uint64_t recvmmsg_calls;
+    uint64_t packets;
+    uint64_t messages;          // delivered
+    uint64_t heartbeats;
+    uint64_t duplicates;        // packets with nothing new
+    uint64_t out_of_order;      // packets buffered past a gap
+    uint64_t other_sessions;    // packets ignored for a different session
+    uint64_t malformed;
+    uint64_t gaps;
+    uint64_t gap_messages;      // messages missing when gaps were detected
+    uint64_t retrans_requests;
+    uint64_t retrans_packets;   // packets received on the retransmission socket
+    uint64_t recovered;         // gaps closed
+    uint64_t lost_messages;     // given up on
+    uint64_t recovery_ns_total; // gap detected -> closed
+    uint64_t recovery_ns_max;
+} mold_recv_stats_t;
+
+typedef struct mold_recv mold_recv_t;
+
+/* Join the group and open the retransmission socket. NULL on failure. */
+mold_recv_t *mold_recv_create(const mold_recv_config_t *cfg);
+void mold_recv_destroy(mold_recv_t *r);
+
+/* Wait up to timeout_ms for data, deliver everything now in sequence and
+ * service gap timers. Returns the number of messages delivered, or -1. */
+int mold_recv_poll(mold_recv_t *r, int timeout_ms, mold_msg_fn fn, void *ctx);
+
+/* End of session seen and every message before it delivered or lost */
+int mold_recv_done(const mold_recv_t *r);
+
+void mold_recv_get_stats(const mold_recv_t *r, mold_recv_stats_t *out);
+void mold_recv_print_stats(const mold_recv_t *r, FILE *out);
+
+#endif /* MOLD_RECV_H */
@@ -0,0 +1,489 @@
+/*
+ * Order Book Engine - see order_book.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "order_book.h"
+#include "order_map.h"
+#include "itch_parser.h"
+
+#define DEFAULT_MAX_ORDERS (1u << 22)
+#define DEFAULT_MAX_LEVELS (1u << 20)
+#define POOL_NIL SLAB_POOL_NIL
+
+enum { SIDE_BID = 0, SIDE_ASK = 1 };
+
+typedef struct {
+    uint64_t ref;
+    uint32_t shares;
+    uint32_t price;
+    uint32_t level;         // level pool index
+    uint16_t stockLocate;
+    uint8_t side;
+    uint8_t pad;
+} ob_order_t;
+
+typedef struct {
+    uint64_t shares;
+    uint32_t price;
+    uint32_t orders;        // live orders at this level
+} ob_level_t;
+
+/* Level indices sorted worst -> best, so the top of book is levels[count - 1] */
+typedef struct {
+    uint32_t *levels;
+    uint32_t count;
+    uint32_t cap;
+} ob_side_t;
+
+typedef struct {
+    ob_side_t side[2];
+    uint32_t topBidPrice;   // last published top of book
+    uint32_t topAskPrice;
+    uint64_t topBidShares;
+    uint64_t topAskShares;
+} ob_book_t;
+
+struct order_book {
+    slab_pool_t order_pool;
+    ob_order_t *orders;     // order_pool's slots
+    slab_pool_t level_pool;
+    ob_level_t *levels;
+
+    order_map_t map;
+    ob_book_t *books;
+
+    order_book_top_cb on_top;
+    void *ctx;
+    order_book_stats_t stats;
+};
+
+/* Sort key that is ascending towards the best price on either side */
+static inline uint32_t level_key(int side, uint32_t price) {
+    return side == SIDE_BID ? price : ~price;
+}
+
+/* Pool management */
+
+static inline uint32_t alloc_order(order_book_t *ob) {
+    return slab_pool_alloc(&ob->order_pool);
+}
+
+static inline void free_order(order_book_t *ob, uint32_t idx) {
+    slab_pool_free(&ob->order_pool, idx);
+}
+
+static inline uint32_t alloc_level(order_book_t *ob) {
+    return slab_pool_alloc(&ob->level_pool);
+}
+
+static inline void free_level(order_book_t *ob, uint32_t idx) {
+    slab_pool_free(&ob->level_pool, idx);
+}
+
+/* Price level arrays */
+
+/* First position whose key is >= key (binary search over the sorted side) */
+static uint32_t side_lower_bound(const order_book_t *ob, const ob_side_t *s, int side, uint32_t key) {
+    uint32_t lo = 0, hi = s->count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (level_key(side, ob->levels[s->levels[mid]].price) < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+/* Find the level for price, creating it if needed. Returns POOL_NIL on exhaustion. */
+static uint32_t side_get_level(order_book_t *ob, ob_side_t *s, int side, uint32_t price) {
+    uint32_t key = level_key(side, price);
+
+    // Fast path: top of book
+    if (s->count > 0) {
+        uint32_t top = s->levels[s->count - 1];
+        if (ob->levels[top].price == price) return top;
+    }
+
+    uint32_t pos = side_lower_bound(ob, s, side, key);
+    if (pos < s->count && ob->levels[s->levels[pos]].price == price) {
+        return s->levels[pos];
+    }
+
+    if (s->count == s->cap) {
+        uint32_t cap = s->cap ? s->cap * 2 : 16;
+        uint32_t *grown = realloc(s->levels, cap * sizeof(uint32_t));
+        if (!grown) return POOL_NIL;
+        s->levels = grown;
+        s->cap = cap;
+    }
+
+    uint32_t lvl = alloc_level(ob);
+    if (lvl == POOL_NIL) return POOL_NIL;
+    ob->levels[lvl].price = price;
+    ob->levels[lvl].shares = 0;
+    ob->levels[lvl].orders = 0;
+
+    // Shift the better levels (the short tail) up by one
+    memmove(&s->levels[pos + 1], &s->levels[pos], (s->count - pos) * sizeof(uint32_t));
+    s->levels[pos] = lvl;
+    s->count++;
+    ob->stats.live_levels++;
+    return lvl;
+}
+
+static void side_remove_level(order_book_t *ob, ob_side_t *s, int side, uint32_t lvl) {
+    uint32_t pos;
+    if (s->levels[s->count - 1] == lvl) {
+        pos = s->count - 1;
+    } else {
+        pos = side_lower_bound(ob, s, side, level_key(side, ob->levels[lvl].price));
+    }
+    memmove(&s->levels[pos], &s->levels[pos + 1], (s->count - pos - 1) * sizeof(uint32_t));
+    s->count--;
+    free_level(ob, lvl);
+    ob->stats.live_levels--;
+}
+
+/* Top of book publication */
+
+static void fill_top(const order_book_t *ob, const ob_book_t *b, order_book_top_t *t) {
+    const ob_side_t *bid = &b->side[SIDE_BID];
+    const ob_side_t *ask = &b->side[SIDE_ASK];
+    t->bidPrice = 0;
+    t->bidShares = 0;
+    t->askPrice = 0;
+    t->askShares = 0;
+    if (bid->count) {
+        const ob_level_t *l = &ob->levels[bid->levels[bid->count - 1]];
+        t->bidPrice = l->price;
+        t->bidShares = l->shares;
+    }
+    if (ask->count) {
+        const ob_level_t *l = &ob->levels[ask->levels[ask->count - 1]];
+        t->askPrice = l->price;
+        t->askShares = l->shares;
+    }
+}
+
+static void check_top(order_book_t *ob, uint16_t stockLocate, uint64_t timestamp) {
+    ob_book_t *b = &ob->books[stockLocate];
+    order_book_top_t t;
+    fill_top(ob, b, &t);
+
+    if (t.bidPrice == b->topBidPrice && t.bidShares == b->topBidShares &&
+        t.askPrice == b->topAskPrice && t.askShares == b->topAskShares) {
+        return;
+    }
+
+    b->topBidPrice = t.bidPrice;
+    b->topBidShares = t.bidShares;
+    b->topAskPrice = t.askPrice;
+    b->topAskShares = t.askShares;
+    ob->stats.top_updates++;
+
+    if (ob->on_top) {
+        t.stockLocate = stockLocate;
+        t.timestamp = timestamp;
+        ob->on_top(&t, ob->ctx);
+    }
+}
+
+/* Order operations */
+
+/* Take shares off an order; removes it (and possibly its level) when it reaches zero */
+static void reduce_order(order_book_t *ob, uint32_t idx, uint32_t shares) {
+    ob_order_t *o = &ob->orders[idx];
+    ob_level_t *l = &ob->levels[o->level];
+
+    if (shares > o->shares) shares = o->shares;
+    o->shares -= shares;
+    l->shares -= shares;
+
+    if (o->shares == 0) {
+        ob_side_t *s = &ob->books[o->stockLocate].side[o->side];
+        if (--l->orders == 0) side_remove_level(ob, s, o->side, o->level);
+        order_map_erase(&ob->map, o->ref);
+        free_order(ob, idx);
+        ob->stats.live_orders--;
+    }
+}
+
+static int insert_order(order_book_t *ob, uint16_t stockLocate, uint64_t ref,
+                        int side, uint32_t shares, uint32_t price) {
+    // A live ref is never overwritten: its order would leak with its shares on the level
+    if (order_map_find(&ob->map, ref) != ORDER_MAP_EMPTY) {
+        ob->stats.duplicate_refs++;
+        return -1;
+    }
+    uint32_t idx = alloc_order(ob);
+    if (idx == POOL_NIL) {
+        ob->stats.pool_exhausted++;
+        return -1;
+    }
+
+    ob_side_t *s = &ob->books[stockLocate].side[side];
+    uint32_t lvl = side_get_level(ob, s, side, price);
+    if (lvl == POOL_NIL) {
+        free_order(ob, idx);
+        ob->stats.pool_exhausted++;
+        return -1;
+    }
+
+    ob_order_t *o = &ob->orders[idx];
+    o->ref = ref;
+    o->shares = shares;
+    o->price = price;
+    o->level = lvl;
+    o->stockLocate = stockLocate;
+    o->side = (uint8_t)side;
+
+    ob->levels[lvl].shares += shares;
+    ob->levels[lvl].orders++;
+    order_map_insert(&ob->map, ref, idx);
+    ob->stats.live_orders++;
+    return 0;
+}
+
+int order_book_add(order_book_t *ob, uint16_t stockLocate, uint64_t timestamp,
+                   uint64_t orderRefNum, char side, uint32_t shares, uint32_t price) {
+    ob->stats.adds++;
+    if (insert_order(ob, stockLocate, orderRefNum, side == 'S' ? SIDE_ASK : SIDE_BID, shares, price) < 0) {
+        return -1;
+    }
+    check_top(ob, stockLocate, timestamp);
+    return 0;
+}
+
+int order_book_order(const order_book_t *ob, uint64_t orderRefNum, uint16_t *stockLocate, uint32_t *price) {
+    uint32_t idx = order_map_find(&ob->map, orderRefNum);
+    if (idx == ORDER_MAP_EMPTY) return -1;
+    *stockLocate = ob->orders[idx].stockLocate;
+    *price = ob->orders[idx].price;
+    return 0;
+}
+
+int order_book_execute(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum, uint32_t shares) {
+    ob->stats.executes++;
+    uint32_t idx = order_map_find(&ob->map, orderRefNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint16_t stockLocate = ob->orders[idx].stockLocate;
+    reduce_order(ob, idx, shares);
+    check_top(ob, stockLocate, timestamp);
+    return 0;
+}
+
+int order_book_cancel(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum, uint32_t shares) {
+    ob->stats.cancels++;
+    uint32_t idx = order_map_find(&ob->map, orderRefNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint16_t stockLocate = ob->orders[idx].stockLocate;
+    reduce_order(ob, idx, shares);
+    check_top(ob, stockLocate, timestamp);
+    return 0;
+}
+
+int order_book_delete(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum) {
+    ob->stats.deletes++;
+    uint32_t idx = order_map_find(&ob->map, orderRefNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+    uint16_t stockLocate = ob->orders[idx].stockLocate;
+    reduce_order(ob, idx, ob->orders[idx].shares);
+    check_top(ob, stockLocate, timestamp);
+    return 0;
+}
+
+int order_book_replace(order_book_t *ob, uint64_t timestamp, uint64_t origOrderRefNum,
+                       uint64_t newOrderRefNum, uint32_t shares, uint32_t price) {
+    ob->stats.replaces++;
+    uint32_t idx = order_map_find(&ob->map, origOrderRefNum);
+    if (idx == ORDER_MAP_EMPTY) {
+        ob->stats.unknown_refs++;
+        return -1;
+    }
+
+    ob_order_t *o = &ob->orders[idx];
+    uint16_t stockLocate = o->stockLocate;
+    int side = o->side;
+
+    // The new ref is live already: the original still goes, the replacement is dropped
+    if (newOrderRefNum != origOrderRefNum && order_map_find(&ob->map, newOrderRefNum) != ORDER_MAP_EMPTY) {
+        ob->stats.duplicate_refs++;
+        reduce_order(ob, idx, o->shares);
+        check_top(ob, stockLocate, timestamp);
+        return -1;
+    }
+
+    // Same price: rewrite the order in place and keep its level
+    if (o->price == price) {
+        ob_level_t *l = &ob->levels[o->level];
+        l->shares = l->shares - o->shares + shares;
+        o->shares = shares;
+        o->ref = newOrderRefNum;
+        order_map_erase(&ob->map, origOrderRefNum);
+        order_map_insert(&ob->map, newOrderRefNum, idx);
+        if (shares == 0) reduce_order(ob, idx, 0);
+        check_top(ob, stockLocate, timestamp);
+        return 0;
+    }
+
+    reduce_order(ob, idx, o->shares);
+    int rc = insert_order(ob, stockLocate, newOrderRefNum, side, shares, price);
+    check_top(ob, stockLocate, timestamp);
+    return rc;
+}
+
+size_t order_book_save(const order_book_t *ob, order_book_order_t *out) {
+    size_t n = 0;
+    for (uint64_t i = 0; i <= ob->map.mask; i++) {
+        uint32_t idx = ob->map.slots[i].idx;
+        if (idx == ORDER_MAP_EMPTY) continue;
+        const ob_order_t *o = &ob->orders[idx];
+        order_book_order_t *r = &out[n++];
+        memset(r, 0, sizeof(*r));
+        r->orderRefNum = o->ref;
+        r->shares = o->shares;
+        r->price = o->price;
+        r->stockLocate = o->stockLocate;
+        r->side = o->side == SIDE_BID ? 'B' : 'S';
+    }
+    return n;
+}
+
+int order_book_load(order_book_t *ob, const order_book_order_t *orders, size_t n, uint64_t timestamp) {
+    uint8_t *touched = calloc(ORDER_BOOK_MAX_LOCATES, 1);
+    if (!touched) return -1;
+    int rc = 0;
+    for (size_t i = 0; i < n && rc == 0; i++) {
+        const order_book_order_t *r = &orders[i];
+        rc = insert_order(ob, r->stockLocate, r->orderRefNum, r->side == 'S' ? SIDE_ASK : SIDE_BID,
+                          r->shares, r->price);
+        touched[r->stockLocate] = 1;
+    }
+    for (uint32_t l = 0; l < ORDER_BOOK_MAX_LOCATES; l++) {
+        if (touched[l]) check_top(ob, (uint16_t)l, timestamp);
+    }
+    free(touched);
+    return rc;
+}
+
+int order_book_process(order_book_t *ob, const uint8_t *msg, size_t len) {
+    if (len == 0) return 0;
+
+    switch (msg[0]) {
+        case 'A': {
+            if (len < 36) return -1;
+            ITCHAddOrder m;
+            itch_decode_A(msg, &m);
+            return order_book_add(ob, m.header.stockLocate, m.header.timestamp, m.orderRefNum,
+                                  m.buySellIndicator, m.shares, m.price);
+        }
+        case 'F': {
+            if (len < 40) return -1;
+            ITCHAddOrderMPID m;
+            itch_decode_F(msg, &m);
+            return order_book_add(ob, m.header.stockLocate, m.header.timestamp, m.orderRefNum,
+                                  m.buySellIndicator, m.shares, m.price);
+        }
+        case 'E': {
+            if (len < 31) return -1;
+            ITCHOrderExecuted m;
+            itch_decode_E(msg, &m);
+            return order_book_execute(ob, m.header.timestamp, m.orderRefNum, m.executedShares);
+        }
+        case 'C': {
+            if (len < 36) return -1;
+            ITCHOrderExecutedWithPrice m;
+            itch_decode_C(msg, &m);
+            return order_book_execute(ob, m.header.timestamp, m.orderRefNum, m.executedShares);
+        }
+        case 'X': {
+            if (len < 23) return -1;
+            ITCHOrderCancel m;
+            itch_decode_X(msg, &m);
+            return order_book_cancel(ob, m.header.timestamp, m.orderRefNum, m.cancelledShares);
+        }
+        case 'D': {
+            if (len < 19) return -1;
+            ITCHOrderDelete m;
+            itch_decode_D(msg, &m);
+            return order_book_delete(ob, m.header.timestamp, m.orderRefNum);
+        }
+        case 'U': {
+            if (len < 35) return -1;
+            ITCHOrderReplace m;
+            itch_decode_U(msg, &m);
+            return order_book_replace(ob, m.header.timestamp, m.origOrderRefNum, m.newOrderRefNum,
+                                      m.shares, m.price);
+        }
+        default:
+            return 0;
+    }
+}
+
+int order_book_top(const order_book_t *ob, uint16_t stockLocate, order_book_top_t *out) {
+    const ob_book_t *b = &ob->books[stockLocate];
+    fill_top(ob, b, out);
+    out->stockLocate = stockLocate;
+    out->timestamp = 0;
+    return (b->side[SIDE_BID].count || b->side[SIDE_ASK].count) ? 0 : -1;
+}
+
+void order_book_get_stats(const order_book_t *ob, order_book_stats_t *out) {
+    *out = ob->stats;
+}
+
+void order_book_get_pool_stats(const order_book_t *ob, slab_pool_stats_t *orders, slab_pool_stats_t *levels) {
+    if (orders) slab_pool_get_stats(&ob->order_pool, orders);
+    if (levels) slab_pool_get_stats(&ob->level_pool, levels);
+}
+
+order_book_t *order_book_create(const order_book_config_t *cfg) {
+    order_book_t *ob = calloc(1, sizeof(order_book_t));
+    if (!ob) return NULL;
+
+    uint32_t max_orders = (cfg && cfg->max_orders) ? cfg->max_orders : DEFAULT_MAX_ORDERS;
+    uint32_t max_levels = (cfg && cfg->max_levels) ? cfg->max_levels : DEFAULT_MAX_LEVELS;
+    int pages = cfg ? cfg->pages : 0;
+    ob->on_top = cfg ? cfg->on_top : NULL;
+    ob->ctx = cfg ? cfg->ctx : NULL;
+
+    // Pools are reserved up front; without SLAB_PAGES_PREFAULT pages are only
+    // touched as the bump pointers advance
+    int rc = slab_pool_init(&ob->order_pool, sizeof(ob_order_t), max_orders, pages);
+    if (rc == 0) rc = slab_pool_init(&ob->level_pool, sizeof(ob_level_t), max_levels, pages);
+    if (rc == 0) rc = order_map_init(&ob->map, max_orders, pages);
+    ob->orders = (ob_order_t *)ob->order_pool.base;
+    ob->levels = (ob_level_t *)ob->level_pool.base;
+    ob->books = calloc(ORDER_BOOK_MAX_LOCATES, sizeof(ob_book_t));
+
+    if (rc < 0 || !ob->books) {
+        order_book_destroy(ob);
+        return NULL;
+    }
+    return ob;
+}
+
+void order_book_destroy(order_book_t *ob) {
+    if (!ob) return;
+    if (ob->books) {
+        for (size_t i = 0; i < ORDER_BOOK_MAX_LOCATES; i++) {
+            free(ob->books[i].side[SIDE_BID].levels);
+            free(ob->books[i].side[SIDE_ASK].levels);
+        }
+    }
+    free(ob->books);
+    slab_pool_destroy(&ob->order_pool);
+    slab_pool_destroy(&ob->level_pool);
+    order_map_free(&ob->map);
+    free(ob);
+}
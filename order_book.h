@@ -0,0 +1,114 @@
+/*
+ * Order Book Engine - per-stockLocate limit order book reconstruction for ITCH 5.0
+ *
+ * Maintains full depth for every stock from A/F/E/C/X/D/U messages:
+ * - Orders and price levels live in fixed-size pools (slab_pool.h) mapped
+ *   at create time, on huge pages where available, and are found through
+ *   an open-addressing order-ref map (order_map.h); nothing is allocated
+ *   per message
+ * - Each side of each book is an array of price levels sorted so the best
+ *   price is the last element; activity clusters near the top, so inserts
+ *   and removals touch the tail of the array
+ * - Execute/cancel/delete are O(1): the order points straight at its level
+ * - Top-of-book changes are published through a callback
+ * - The live orders can be saved and loaded back (snapshots, itch_snap.h)
+ *
+ * Usage:
+ *   order_book_config_t cfg = { .max_orders = 1 << 22, .on_top = my_cb };
+ *   order_book_t *ob = order_book_create(&cfg);
+ *   order_book_process(ob, msg, len);   // for every framed ITCH message
+ *   order_book_destroy(ob);
+ */
+
+#ifndef ORDER_BOOK_H
+#define ORDER_BOOK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "slab_pool.h"
+
+#define ORDER_BOOK_MAX_LOCATES 65536
+
+typedef struct order_book order_book_t;
+
+/* Top-of-book snapshot, published whenever best price or size changes */
+typedef struct {
+    uint16_t stockLocate;
+    uint64_t timestamp;
+    uint32_t bidPrice;       // 0 if no bids
+    uint64_t bidShares;
+    uint32_t askPrice;       // 0 if no asks
+    uint64_t askShares;
+} order_book_top_t;
+
+typedef void (*order_book_top_cb)(const order_book_top_t *top, void *ctx);
+
+typedef struct {
+    uint32_t max_orders;     // live order capacity (default 4M)
+    uint32_t max_levels;     // live price level capacity (default 1M)
+    int pages;               // SLAB_PAGES_* for the pools and the order map
+    order_book_top_cb on_top;
+    void *ctx;
+} order_book_config_t;
+
+typedef struct {
+    uint64_t adds;
+    uint64_t executes;
+    uint64_t cancels;
+    uint64_t deletes;
+    uint64_t replaces;
+    uint64_t top_updates;
+    uint64_t unknown_refs;   // E/C/X/D/U referencing an order we never saw
+    uint64_t pool_exhausted; // adds dropped because max_orders/max_levels was hit
+    uint64_t duplicate_refs; // A/F/U reusing a live order's ref, dropped
+    uint64_t live_orders;
+    uint64_t live_levels;
+} order_book_stats_t;
+
+/* One live order, as saved in a snapshot */
+typedef struct {
+    uint64_t orderRefNum;
+    uint32_t shares;
+    uint32_t price;
+    uint16_t stockLocate;
+    char side;               // 'B' or 'S'
+    uint8_t reserved[5];
+} order_book_order_t;
+
+order_book_t *order_book_create(const order_book_config_t *cfg);
+void order_book_destroy(order_book_t *ob);
+
+/* Apply one framed ITCH message (type byte first). Non-book types are ignored.
+ * Returns 0 on success, -1 if the message could not be applied. */
+int order_book_process(order_book_t *ob, const uint8_t *msg, size_t len);
+
+/* Direct entry points, for callers that already decoded the message */
+int order_book_add(order_book_t *ob, uint16_t stockLocate, uint64_t timestamp,
+                   uint64_t orderRefNum, char side, uint32_t shares, uint32_t price);
+int order_book_execute(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum, uint32_t shares);
+int order_book_cancel(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum, uint32_t shares);
+int order_book_delete(order_book_t *ob, uint64_t timestamp, uint64_t orderRefNum);
+int order_book_replace(order_book_t *ob, uint64_t timestamp, uint64_t origOrderRefNum,
+                       uint64_t newOrderRefNum, uint32_t shares, uint32_t price);
+
+/* Price and stock of a live order, e.g. to price an E before applying it.
+ * Returns 0, or -1 if the order is unknown. */
+int order_book_order(const order_book_t *ob, uint64_t orderRefNum, uint16_t *stockLocate, uint32_t *price);
+
+/* Current top of book for a stock. Returns 0 if the book has any orders, -1 if empty. */
+int order_book_top(const order_book_t *ob, uint16_t stockLocate, order_book_top_t *out);
+
+/* Copy every live order into out (room for stats.live_orders). Returns the count. */
+size_t order_book_save(const order_book_t *ob, order_book_order_t *out);
+
+/* Add saved orders to the book, for timestamp. Each stock's top of book is
+ * published once at the end, not per order, and nothing counts as an add.
+ * Returns 0, or -1 if the pools ran out. */
+int order_book_load(order_book_t *ob, const order_book_order_t *orders, size_t n, uint64_t timestamp);
+
+void order_book_get_stats(const order_book_t *ob, order_book_stats_t *out);
+
+/* Occupancy of the order and price level pools (either may be NULL) */
+void order_book_get_pool_stats(const order_book_t *ob, slab_pool_stats_t *orders, slab_pool_stats_t *levels);
+
+#endif /* ORDER_BOOK_H */
@@ -0,0 +1,120 @@
+/*
+ * Order Map - open-addressing order reference -> pool index map
+ *
+ * Linear probing over a power-of-two slot array sized once at startup.
+ * Keys are stored inline next to the pool index so a lookup touches a single
+ * cache line in the common case. Deletes use backward-shift (no tombstones),
+ * so a full trading day of add/delete churn never degrades probe lengths.
+ * The slot array is mapped like the order pools (slab_pool.h), on huge
+ * pages where available: probes land anywhere in it.
+ */
+
+#ifndef ORDER_MAP_H
+#define ORDER_MAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "slab_pool.h"
+
+#define ORDER_MAP_EMPTY UINT32_MAX
+
+typedef struct {
+    uint64_t ref;   // order reference number
+    uint32_t idx;   // pool index, ORDER_MAP_EMPTY if slot unused
+    uint32_t pad;
+} order_map_slot_t;
+
+typedef struct {
+    order_map_slot_t *slots;
+    uint64_t mask;
+    uint32_t shift;
+    uint64_t count;
+    size_t mapped;
+} order_map_t;
+
+/* Fibonacci hashing: order refs are mostly sequential, so spread the high bits */
+static inline uint64_t order_map_hash(const order_map_t *m, uint64_t ref) {
+    return (ref * 0x9E3779B97F4A7C15ULL) >> m->shift;
+}
+
+/* Allocate a map able to hold `capacity` keys at <= 50% load; flags are
+ * SLAB_PAGES_* */
+static inline int order_map_init(order_map_t *m, uint64_t capacity, int flags) {
+    uint32_t bits = 4;
+    while ((1ULL << bits) < capacity * 2) bits++;
+
+    slab_backing_t backing;
+    m->slots = slab_pages_alloc(sizeof(order_map_slot_t) << bits, flags, &m->mapped, &backing);
+    if (!m->slots) return -1;
+    m->mask = (1ULL << bits) - 1;
+    m->shift = 64 - bits;
+    m->count = 0;
+    for (uint64_t i = 0; i <= m->mask; i++) m->slots[i].idx = ORDER_MAP_EMPTY;
+    return 0;
+}
+
+static inline void order_map_free(order_map_t *m) {
+    slab_pages_free(m->slots, m->mapped);
+    m->slots = NULL;
+}
+
+/* Returns pool index for ref, or ORDER_MAP_EMPTY */
+static inline uint32_t order_map_find(const order_map_t *m, uint64_t ref) {
+    uint64_t i = order_map_hash(m, ref);
+    for (;;) {
+        const order_map_slot_t *s = &m->slots[i];
+        if (s->idx == ORDER_MAP_EMPTY) return ORDER_MAP_EMPTY;
+        if (s->ref == ref) return s->idx;
+        i = (i + 1) & m->mask;
+    }
+}
+
+/* Insert or overwrite. Caller guarantees count stays below capacity. */
+static inline void order_map_insert(order_map_t *m, uint64_t ref, uint32_t idx) {
+    uint64_t i = order_map_hash(m, ref);
+    for (;;) {
+        order_map_slot_t *s = &m->slots[i];
+        if (s->idx == ORDER_MAP_EMPTY) {
+            s->ref = ref;
+            s->idx = idx;
+            m->count++;
+            return;
+        }
+        if (s->ref == ref) {
+            s->idx = idx;
+            return;
+        }
+        i = (i + 1) & m->mask;
+    }
+}
+
+/* Remove ref and backward-shift the following cluster. Returns old index. */
+static inline uint32_t order_map_erase(order_map_t *m, uint64_t ref) {
+    uint64_t i = order_map_hash(m, ref);
+    for (;;) {
+        order_map_slot_t *s = &m->slots[i];
+        if (s->idx == ORDER_MAP_EMPTY) return ORDER_MAP_EMPTY;
+        if (s->ref == ref) break;
+        i = (i + 1) & m->mask;
+    }
+
+    uint32_t old = m->slots[i].idx;
+    uint64_t hole = i;
+    uint64_t j = i;
+    for (;;) {
+        j = (j + 1) & m->mask;
+        order_map_slot_t *s = &m->slots[j];
+        if (s->idx == ORDER_MAP_EMPTY) break;
+        // Move s into the hole only if its home slot is not in (hole, j]
+        uint64_t home = order_map_hash(m, s->ref);
+        if (((j - home) & m->mask) >= ((j - hole) & m->mask)) {
+            m->slots[hole] = *s;
+            hole = j;
+        }
+    }
+    m->slots[hole].idx = ORDER_MAP_EMPTY;
+    m->count--;
+    return old;
+}
+
+#endif /* ORDER_MAP_H */
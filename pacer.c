@@ -0,0 +1,129 @@
+/*
+ * Pacer - see pacer.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "pacer.h"
+
+/* Upper edges of the skew histogram buckets (the last bucket is open) */
+static const uint64_t SKEW_EDGES[PACER_HIST_BUCKETS - 1] = {
+    1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 10000000,
+};
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+void pacer_init(pacer_t *p, double speed, uint64_t spin_ns) {
+    memset(p, 0, sizeof(*p));
+    p->ns_per_feed_ns = 1.0 / speed;
+    p->spin_ns = spin_ns;
+    p->max_gap_ns = PACER_DEFAULT_MAX_GAP_NS;
+}
+
+uint64_t pacer_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void anchor(pacer_t *p, uint64_t wall, uint64_t ts) {
+    p->anchor_wall = wall;
+    p->anchor_feed = ts;
+    p->anchored = 1;
+}
+
+uint64_t pacer_deadline(pacer_t *p, uint64_t ts) {
+    if (!p->anchored) {
+        anchor(p, pacer_now(), ts);
+        p->last_feed = ts;
+        p->last_deadline = p->anchor_wall;
+        return p->anchor_wall;
+    }
+    if (ts < p->last_feed) {
+        anchor(p, p->last_deadline, ts);
+        p->reanchors++;
+    }
+    p->last_feed = ts;
+
+    uint64_t deadline = p->anchor_wall + (uint64_t)((ts - p->anchor_feed) * p->ns_per_feed_ns);
+    if (deadline > p->last_deadline + p->max_gap_ns) {
+        deadline = p->last_deadline + p->max_gap_ns;
+        anchor(p, deadline, ts);
+        p->reanchors++;
+    }
+    p->last_deadline = deadline;
+    return deadline;
+}
+
+uint64_t pacer_wait(pacer_t *p, uint64_t deadline) {
+    uint64_t now = pacer_now();
+    if (now + p->spin_ns < deadline) {
+        // clock_nanosleep cannot sleep on CLOCK_MONOTONIC_RAW: sleep relative
+        uint64_t ns = deadline - p->spin_ns - now;
+        struct timespec ts = { .tv_sec = ns / 1000000000ULL, .tv_nsec = ns % 1000000000ULL };
+        nanosleep(&ts, NULL);
+        p->sleeps++;
+        now = pacer_now();
+    }
+    while (now < deadline) {
+        cpu_relax();
+        now = pacer_now();
+    }
+    return now;
+}
+
+void pacer_record(pacer_t *p, uint64_t deadline, uint64_t now) {
+    uint64_t skew = now > deadline ? now - deadline : 0;
+    int b = 0;
+    while (b < PACER_HIST_BUCKETS - 1 && skew >= SKEW_EDGES[b]) b++;
+    p->hist[b]++;
+    p->samples++;
+    p->total_skew += skew;
+    if (skew > p->max_skew) p->max_skew = skew;
+}
+
+static void format_ns(char *buf, size_t len, uint64_t ns) {
+    if (ns >= 1000000) snprintf(buf, len, "%lu ms", ns / 1000000);
+    else snprintf(buf, len, "%lu us", ns / 1000);
+}
+
+void pacer_print_stats(const pacer_t *p, FILE *out) {
+    if (p->samples == 0) return;
+    fprintf(out, "Send skew (actual - target): mean %.2f us, max %.2f us, %lu sleeps, %lu gaps re-anchored\n",
+            p->total_skew / 1000.0 / p->samples, p->max_skew / 1000.0, p->sleeps, p->reanchors);
+
+    uint64_t cumulative = 0;
+    for (int b = 0; b < PACER_HIST_BUCKETS; b++) {
+        if (p->hist[b] == 0) continue;
+        cumulative += p->hist[b];
+        char label[40];
+        if (b < PACER_HIST_BUCKETS - 1) {
+            char edge[24];
+            format_ns(edge, sizeof(edge), SKEW_EDGES[b]);
+            snprintf(label, sizeof(label), "< %s", edge);
+        } else {
+            char edge[24];
+            format_ns(edge, sizeof(edge), SKEW_EDGES[b - 1]);
+            snprintf(label, sizeof(label), ">= %s", edge);
+        }
+        fprintf(out, "  %-10s: %12lu (%5.1f%%, cumulative %5.1f%%)\n", label, p->hist[b],
+                100.0 * p->hist[b] / p->samples, 100.0 * cumulative / p->samples);
+    }
+}
+
+int pacer_pin_thread(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+}
@@ -0,0 +1,79 @@
+/*
+ * Pacer - replay messages at their feed times against absolute deadlines
+ *
+ * The first message anchors feed time to CLOCK_MONOTONIC_RAW; every later
+ * message's send deadline is anchor + (feed time - anchor feed time) / speed.
+ * Errors therefore never accumulate: a late message is followed by messages
+ * sent early enough to catch up, instead of every delay pushing back the
+ * rest of the day.
+ *
+ * Waiting is hybrid: nanosleep until spin_ns before the deadline (scheduler
+ * wake-up jitter is tens of microseconds), then spin on the clock for the
+ * rest. A feed gap longer than max_gap_ns of wall time (the open, a halt) is
+ * shortened to max_gap_ns by moving the anchor, as is a timestamp going
+ * backwards.
+ *
+ * Every paced message records its skew (actual send time - deadline) in a
+ * histogram printed by pacer_print_stats.
+ *
+ * Usage:
+ *   pacer_t p;
+ *   pacer_init(&p, 1.0, PACER_DEFAULT_SPIN_NS);
+ *   for each message:
+ *       uint64_t deadline = pacer_deadline(&p, timestamp);
+ *       uint64_t now = pacer_now();
+ *       if (now < deadline) now = pacer_wait(&p, deadline);
+ *       pacer_record(&p, deadline, now);
+ *       send(...);
+ *   pacer_print_stats(&p, stdout);
+ */
+
+#ifndef PACER_H
+#define PACER_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define PACER_DEFAULT_SPIN_NS 50000ULL          // 50 us
+#define PACER_DEFAULT_MAX_GAP_NS 1000000000ULL  // 1 s
+#define PACER_HIST_BUCKETS 12
+
+typedef struct {
+    double ns_per_feed_ns;      // 1 / speed
+    uint64_t spin_ns;
+    uint64_t max_gap_ns;
+    int anchored;
+    uint64_t anchor_wall;
+    uint64_t anchor_feed;
+    uint64_t last_feed;
+    uint64_t last_deadline;
+
+    uint64_t samples;
+    uint64_t sleeps;
+    uint64_t reanchors;         // gaps shortened or timestamps going backwards
+    uint64_t total_skew;
+    uint64_t max_skew;
+    uint64_t hist[PACER_HIST_BUCKETS];
+} pacer_t;
+
+/* speed > 0 (1.0 = real time); spin_ns 0 = never spin, sleep to the deadline */
+void pacer_init(pacer_t *p, double speed, uint64_t spin_ns);
+
+/* CLOCK_MONOTONIC_RAW in nanoseconds */
+uint64_t pacer_now(void);
+
+/* Send deadline for a message with feed timestamp ts (ns since midnight) */
+uint64_t pacer_deadline(pacer_t *p, uint64_t ts);
+
+/* Sleep, then spin, until deadline. Returns the time reached. */
+uint64_t pacer_wait(pacer_t *p, uint64_t deadline);
+
+/* Record the skew of a message sent at now for the given deadline */
+void pacer_record(pacer_t *p, uint64_t deadline, uint64_t now);
+
+void pacer_print_stats(const pacer_t *p, FILE *out);
+
+/* Pin the calling thread to one CPU. Returns 0, or -1 on error. */
+int pacer_pin_thread(int cpu);
+
+#endif /* PACER_H */
@@ -0,0 +1,301 @@
+/*
+ * SHM Ring - see shm_ring.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm_ring.h"
+
+#define MIN_SIZE (1u << 20)
+#define OPEN_POLL_MS 50
+#define ALIVE_CHECK_NS 1000000000ULL
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* "itch" and "/itch" both name /dev/shm/itch */
+static int shm_path(const char *name, char *out, size_t len) {
+    int n = snprintf(out, len, "%s%s", name[0] == '/' ? "" : "/", name);
+    if (n <= 1 || (size_t)n >= len || strchr(out + 1, '/')) {
+        fprintf(stderr, "Invalid shared memory name: %s\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+static size_t header_size(void) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    return (sizeof(shm_ring_header_t) + page - 1) / page * page;
+}
+
+/* Map the data area of fd (at offset hdr) twice, back to back */
+static uint8_t *map_data(int fd, size_t hdr, size_t size, int prot) {
+    uint8_t *base = mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return NULL;
+    if (mmap(base, size, prot, MAP_SHARED | MAP_FIXED, fd, (off_t)hdr) == MAP_FAILED ||
+        mmap(base + size, size, prot, MAP_SHARED | MAP_FIXED, fd, (off_t)hdr) == MAP_FAILED) {
+        munmap(base, 2 * size);
+        return NULL;
+    }
+    return base;
+}
+
+shm_ring_pub_t *shm_ring_pub_create(const char *name, size_t size) {
+    shm_ring_pub_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    if (shm_path(name, p->name, sizeof(p->name)) < 0) {
+        free(p);
+        return NULL;
+    }
+
+    uint64_t n = MIN_SIZE;
+    while (n < size) n <<= 1;
+    size_t hdr = header_size();
+
+    // A ring left behind by a crashed publisher is replaced, not reused:
+    // readers still mapping it see its publisher gone
+    shm_unlink(p->name);
+    int fd = shm_open(p->name, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd < 0) {
+        perror(p->name);
+        free(p);
+        return NULL;
+    }
+    if (ftruncate(fd, (off_t)(hdr + n)) < 0) {
+        perror("ftruncate");
+        goto fail;
+    }
+    p->hdr = mmap(NULL, hdr, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p->hdr == MAP_FAILED) {
+        p->hdr = NULL;
+        perror("mmap");
+        goto fail;
+    }
+    p->data = map_data(fd, hdr, n, PROT_READ | PROT_WRITE);
+    if (!p->data) {
+        perror("mmap");
+        goto fail;
+    }
+    close(fd);
+
+    // The file is zero-filled; set the geometry, then publish the magic
+    p->hdr->version = SHM_RING_VERSION;
+    p->hdr->header_size = (uint32_t)hdr;
+    p->hdr->size = n;
+    p->hdr->pid = (int32_t)getpid();
+    atomic_store_explicit(&p->hdr->magic, SHM_RING_MAGIC, memory_order_release);
+    p->size = n;
+    p->mask = n - 1;
+    p->safe_end = n;
+    return p;
+
+fail:
+    if (p->hdr) munmap(p->hdr, hdr);
+    close(fd);
+    shm_unlink(p->name);
+    free(p);
+    return NULL;
+}
+
+void shm_ring_pub_advance(shm_ring_pub_t *p, uint64_t end) {
+    // Claim another eighth of the ring past end before writing into it
+    uint64_t valid_from = end + p->size / 8 - p->size;
+    atomic_store_explicit(&p->hdr->valid_from, valid_from, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    p->safe_end = valid_from + p->size;
+}
+
+void shm_ring_pub_close(shm_ring_pub_t *p) {
+    shm_ring_commit(p);
+    atomic_store_explicit(&p->hdr->closed, 1, memory_order_release);
+}
+
+void shm_ring_pub_destroy(shm_ring_pub_t *p) {
+    if (!p) return;
+    if (p->data) munmap(p->data, 2 * p->size);
+    if (p->hdr) munmap(p->hdr, p->hdr->header_size);
+    shm_unlink(p->name);
+    free(p);
+}
+
+void shm_ring_pub_print_stats(const shm_ring_pub_t *p, FILE *out) {
+    const shm_ring_header_t *h = p->hdr;
+    uint64_t head = atomic_load_explicit(&h->head, memory_order_relaxed);
+    fprintf(out, "Shared memory: /dev/shm%s, %.1f MB ring, %lu messages, %.2f MB, %lu commits, %lu laps\n",
+            p->name, p->size / 1048576.0, p->pub_messages, head / 1048576.0, p->commits, head / p->size);
+
+    // Readers still attached, from their slots
+    unsigned active = 0;
+    uint64_t max_lag = 0, overruns = 0;
+    for (int i = 0; i < SHM_RING_MAX_READERS; i++) {
+        const shm_ring_slot_t *s = &h->readers[i];
+        if (atomic_load_explicit(&s->pid, memory_order_relaxed) == 0) continue;
+        uint64_t lag = head - atomic_load_explicit(&s->cursor, memory_order_relaxed);
+        if (lag > max_lag) max_lag = lag;
+        overruns += atomic_load_explicit(&s->overruns, memory_order_relaxed);
+        active++;
+    }
+    fprintf(out, "Readers: %u attached (%u ever), slowest %.1f KB behind, %lu overruns\n",
+            active, atomic_load_explicit(&h->attaches, memory_order_relaxed), max_lag / 1024.0, overruns);
+}
+
+/* A slot is free, or held by a process that no longer exists */
+static int claim_slot(shm_ring_header_t *h, int32_t pid) {
+    for (int i = 0; i < SHM_RING_MAX_READERS; i++) {
+        _Atomic int32_t *slot_pid = &h->readers[i].pid;
+        int32_t cur = atomic_load_explicit(slot_pid, memory_order_relaxed);
+        if (cur != 0 && (kill(cur, 0) == 0 || errno != ESRCH)) continue;
+        if (atomic_compare_exchange_strong(slot_pid, &cur, pid)) return i;
+    }
+    return -1;
+}
+
+/* head and the message count it goes with, from one commit */
+static void read_position(const shm_ring_header_t *h, uint64_t *head, uint64_t *messages) {
+    for (;;) {
+        uint64_t seq = atomic_load_explicit(&h->seq, memory_order_acquire);
+        if (seq & 1) continue;
+        *head = atomic_load_explicit(&h->head, memory_order_relaxed);
+        *messages = atomic_load_explicit(&h->messages, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&h->seq, memory_order_relaxed) == seq) return;
+    }
+}
+
+shm_ring_reader_t *shm_ring_reader_open(const char *name, int timeout_ms) {
+    char path[256];
+    if (shm_path(name, path, sizeof(path)) < 0) return NULL;
+
+    // Wait for the publisher to create the ring and finish its header
+    int fd = -1;
+    int waited = 0;
+    shm_ring_header_t *h = NULL;
+    size_t hdr = header_size();
+    for (;;) {
+        if (fd < 0) fd = shm_open(path, O_RDWR, 0);
+        if (fd >= 0 && !h) {
+            struct stat st;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size > hdr) {
+                h = mmap(NULL, hdr, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if (h == MAP_FAILED) {
+                    perror("mmap");
+                    close(fd);
+                    return NULL;
+                }
+            }
+        }
+        if (h && atomic_load_explicit(&h->magic, memory_order_acquire) == SHM_RING_MAGIC) break;
+        if (fd < 0 && errno != ENOENT) {
+            perror(path);
+            return NULL;
+        }
+        if (waited >= timeout_ms) {
+            fprintf(stderr, "No shared memory ring /dev/shm%s\n", path);
+            if (h) munmap(h, hdr);
+            if (fd >= 0) close(fd);
+            return NULL;
+        }
+        struct timespec ts = { 0, OPEN_POLL_MS * 1000000L };
+        nanosleep(&ts, NULL);
+        waited += OPEN_POLL_MS;
+    }
+
+    if (h->version != SHM_RING_VERSION || h->header_size != hdr) {
+        fprintf(stderr, "%s: unsupported ring version %u\n", path, h->version);
+        goto fail;
+    }
+
+    shm_ring_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) goto fail;
+    r->hdr = h;
+    r->header_size = hdr;
+    r->size = h->size;
+    r->mask = h->size - 1;
+    r->data = map_data(fd, hdr, h->size, PROT_READ);
+    if (!r->data) {
+        perror("mmap");
+        free(r);
+        goto fail;
+    }
+    close(fd);
+
+    int slot = claim_slot(h, (int32_t)getpid());
+    if (slot < 0) {
+        fprintf(stderr, "%s: all %d reader slots in use\n", path, SHM_RING_MAX_READERS);
+        munmap((void *)r->data, 2 * r->size);
+        free(r);
+        munmap(h, hdr);
+        return NULL;
+    }
+    r->slot = &h->readers[slot];
+    atomic_fetch_add_explicit(&h->attaches, 1, memory_order_relaxed);
+
+    // Join live, at the last commit
+    read_position(h, &r->rd, &r->rd_seq);
+    r->cached_head = r->rd;
+    r->batch_start = r->rd;
+    r->last_alive_check = now_ns();
+    atomic_store_explicit(&r->slot->cursor, r->rd, memory_order_relaxed);
+    atomic_store_explicit(&r->slot->messages, 0, memory_order_relaxed);
+    atomic_store_explicit(&r->slot->overruns, 0, memory_order_relaxed);
+    return r;
+
+fail:
+    munmap(h, hdr);
+    close(fd);
+    return NULL;
+}
+
+void shm_ring_reader_close(shm_ring_reader_t *r) {
+    if (!r) return;
+    atomic_store_explicit(&r->slot->pid, 0, memory_order_release);
+    munmap((void *)r->data, 2 * r->size);
+    munmap(r->hdr, r->header_size);
+    free(r);
+}
+
+void shm_ring_resync(shm_ring_reader_t *r) {
+    uint64_t head, messages;
+    read_position(r->hdr, &head, &messages);
+    r->overruns++;
+    r->lost_messages += messages - r->rd_seq;
+    r->rd = head;
+    r->rd_seq = messages;
+    r->cached_head = head;
+    r->batch_start = head;
+    atomic_store_explicit(&r->slot->overruns, r->overruns + r->torn_batches, memory_order_relaxed);
+}
+
+int shm_ring_drained(shm_ring_reader_t *r) {
+    // closed is read first: once it is set, head is final
+    int closed = atomic_load_explicit(&r->hdr->closed, memory_order_acquire) != 0;
+    if (!closed) {
+        uint64_t now = now_ns();
+        if (now - r->last_alive_check < ALIVE_CHECK_NS) return 0;
+        r->last_alive_check = now;
+        if (kill(r->hdr->pid, 0) == 0 || errno != ESRCH) return 0;
+        fprintf(stderr, "Shared memory publisher (pid %d) is gone\n", r->hdr->pid);
+    }
+    size_t len;
+    return shm_ring_peek(r, &len) == NULL;
+}
+
+void shm_ring_reader_print_stats(const shm_ring_reader_t *r, FILE *out) {
+    fprintf(out, "=== Shared Memory Ring ===\n");
+    fprintf(out, "Size: %.1f MB  Messages: %lu  Reader Waits (ring empty): %lu\n", r->size / 1048576.0,
+            r->messages, r->waits);
+    fprintf(out, "Overruns: %lu (%lu messages lost)  Batches overwritten while read: %lu\n\n",
+            r->overruns, r->lost_messages, r->torn_batches);
+}
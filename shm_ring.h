@@ -0,0 +1,252 @@
+/*
+ * SHM Ring - single-producer / multi-consumer broadcast ring in /dev/shm
+ *
+ * For consumers on the same host as the replay server: the publisher writes
+ * each message once into a shared-memory ring and any number of reader
+ * processes decode it in place, with no socket, no syscall and no copy on
+ * either side once the ring is mapped.
+ *
+ * Layout of /dev/shm/<name>:
+ *   [header][data: size bytes]
+ * The header holds the ring geometry, the publisher's control line and one
+ * cache line per reader (its cursor and counters, so the publisher and
+ * monitoring can see who lags without anyone taking a lock). The data area
+ * is mapped twice, back to back, like itch_stream.h: a record that runs
+ * past the end of the ring is still contiguous, and there are always at
+ * least 8 readable bytes past any message for the timestamp load.
+ *
+ * Records are [len:4][message], 8-byte aligned, at monotonically increasing
+ * byte positions. The publisher never waits for readers: a reader that falls
+ * a ring behind is overrun, not a source of backpressure. Overruns are
+ * detected the seqlock way:
+ * - valid_from is the lowest position the publisher may still overwrite
+ *   past. It is raised, ahead of the writes, in steps of 1/8 of the ring
+ *   (so a reader has 7/8 of a ring of slack), behind a release fence.
+ * - Readers decode straight from the mapping, then on shm_ring_release
+ *   re-check valid_from behind an acquire fence. If it passed the start of
+ *   the batch, the batch may have been overwritten while it was read.
+ * - A reader found lapped when it next looks at head skips forward to head
+ *   and counts the messages it lost (head and the published message count
+ *   are read together under a sequence counter).
+ *
+ * The publisher makes records visible in batches (shm_ring_commit), like
+ * fanout_flush. It marks the ring closed at end of session and unlinks the
+ * file on destroy; readers that still have it mapped finish normally, and a
+ * reader whose publisher died (pid gone) treats the ring as closed.
+ *
+ * Usage:
+ *   // publisher
+ *   shm_ring_pub_t *p = shm_ring_pub_create("itch", 64 << 20);
+ *   memcpy(shm_ring_reserve(p, len), msg, len);  // per message
+ *   shm_ring_commit(p);                           // per batch
+ *   shm_ring_pub_close(p);
+ *   shm_ring_pub_destroy(p);
+ *   // reader
+ *   shm_ring_reader_t *r = shm_ring_reader_open("itch", 10000);
+ *   while ((m = shm_ring_peek(r, &len))) { ...; shm_ring_next(r); }
+ *   shm_ring_release(r);                          // per batch
+ *   shm_ring_reader_close(r);
+ */
+
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define SHM_RING_CACHE_LINE 64
+#define SHM_RING_RECORD_HEADER 4
+#define SHM_RING_MAX_MESSAGE 65535
+#define SHM_RING_MAX_READERS 256
+#define SHM_RING_MAGIC 0x474e495248435449ULL    // "ITCHRING"
+#define SHM_RING_VERSION 1
+
+/* One reader's line in the shared header, written only by that reader */
+typedef struct {
+    _Alignas(SHM_RING_CACHE_LINE) _Atomic int32_t pid;  // 0 = free
+    _Atomic uint64_t cursor;        // next byte it will read
+    _Atomic uint64_t messages;      // messages consumed
+    _Atomic uint64_t overruns;      // times it was lapped or read a batch being overwritten
+} shm_ring_slot_t;
+
+/* The shared header at the start of the file */
+typedef struct {
+    // Set once by the publisher; magic is stored last
+    _Atomic uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;           // data starts here (page multiple)
+    uint64_t size;                  // data bytes (power of two, page multiple)
+    int32_t pid;                    // publisher
+    _Atomic uint32_t attaches;      // readers ever attached
+
+    // Publisher control line
+    _Alignas(SHM_RING_CACHE_LINE) _Atomic uint64_t head;    // committed bytes
+    _Atomic uint64_t valid_from;    // bytes before this may be overwritten
+    _Atomic uint64_t messages;      // committed messages, paired with head by seq
+    _Atomic uint64_t seq;           // odd while head/messages are being updated
+    _Atomic uint32_t closed;
+
+    shm_ring_slot_t readers[SHM_RING_MAX_READERS];
+} shm_ring_header_t;
+
+typedef struct {
+    shm_ring_header_t *hdr;
+    uint8_t *data;                  // first of the two data mappings
+    uint64_t size;
+    uint64_t mask;
+    uint64_t pub_head;              // reserved, not yet committed
+    uint64_t pub_messages;
+    uint64_t safe_end;              // bytes below this can be written without raising valid_from
+    uint64_t commits;
+    char name[256];
+} shm_ring_pub_t;
+
+typedef struct {
+    shm_ring_header_t *hdr;
+    const uint8_t *data;
+    uint64_t size;
+    uint64_t mask;
+    uint64_t rd;                    // next record
+    uint64_t rd_seq;                // feed sequence number of the message at rd
+    uint64_t batch_start;           // first byte read since the last release
+    uint64_t cached_head;
+    shm_ring_slot_t *slot;
+    int idle;
+    uint64_t last_alive_check;
+    uint64_t messages;
+    uint64_t overruns;              // lapped: skipped forward to head
+    uint64_t torn_batches;          // batches overwritten while being read
+    uint64_t lost_messages;
+    uint64_t waits;                 // times the reader found the ring empty
+    size_t header_size;
+} shm_ring_reader_t;
+
+/* Create (replacing any stale ring of that name) /dev/shm/<name> with at
+ * least size data bytes, rounded up to a power of two (at least 1 MB).
+ * NULL on failure. */
+shm_ring_pub_t *shm_ring_pub_create(const char *name, size_t size);
+
+/* Mark end of session after a final commit */
+void shm_ring_pub_close(shm_ring_pub_t *p);
+
+/* Unmap and unlink the ring */
+void shm_ring_pub_destroy(shm_ring_pub_t *p);
+
+/* Out of line part of shm_ring_reserve: raise valid_from ahead of end */
+void shm_ring_pub_advance(shm_ring_pub_t *p, uint64_t end);
+
+void shm_ring_pub_print_stats(const shm_ring_pub_t *p, FILE *out);
+
+/* Attach to /dev/shm/<name>, waiting up to timeout_ms for the publisher to
+ * create it, and start at the live head. NULL on failure. */
+shm_ring_reader_t *shm_ring_reader_open(const char *name, int timeout_ms);
+void shm_ring_reader_close(shm_ring_reader_t *r);
+
+/* Reader: skip to the live head, counting what was lost (out of line) */
+void shm_ring_resync(shm_ring_reader_t *r);
+
+/* Reader: closed (or the publisher is gone) and everything committed has
+ * been consumed */
+int shm_ring_drained(shm_ring_reader_t *r);
+
+void shm_ring_reader_print_stats(const shm_ring_reader_t *r, FILE *out);
+
+static inline uint64_t shm_record_size(size_t len) {
+    return (SHM_RING_RECORD_HEADER + len + 7) & ~(uint64_t)7;
+}
+
+/* Publisher: room for a len-byte message (len <= SHM_RING_MAX_MESSAGE).
+ * Never fails and never waits: it may overwrite what slow readers have not
+ * read yet. */
+static inline uint8_t *shm_ring_reserve(shm_ring_pub_t *p, size_t len) {
+    uint64_t end = p->pub_head + shm_record_size(len);
+    if (end > p->safe_end) shm_ring_pub_advance(p, end);
+    uint8_t *rec = p->data + (p->pub_head & p->mask);
+    uint32_t l = (uint32_t)len;
+    memcpy(rec, &l, sizeof(l));
+    p->pub_head = end;
+    p->pub_messages++;
+    return rec + SHM_RING_RECORD_HEADER;
+}
+
+/* Publisher: make every reserved record visible to the readers */
+static inline void shm_ring_commit(shm_ring_pub_t *p) {
+    shm_ring_header_t *h = p->hdr;
+    if (p->pub_head == atomic_load_explicit(&h->head, memory_order_relaxed)) return;
+    uint64_t seq = atomic_load_explicit(&h->seq, memory_order_relaxed);
+    atomic_store_explicit(&h->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&h->messages, p->pub_messages, memory_order_relaxed);
+    atomic_store_explicit(&h->head, p->pub_head, memory_order_release);
+    atomic_store_explicit(&h->seq, seq + 2, memory_order_release);
+    p->commits++;
+}
+
+/* Publisher: bytes reserved but not yet committed */
+static inline size_t shm_ring_pending(const shm_ring_pub_t *p) {
+    return (size_t)(p->pub_head - atomic_load_explicit(&p->hdr->head, memory_order_relaxed));
+}
+
+/* Reader: the next message, or NULL if none is committed. The pointer is
+ * into the shared mapping; it is only known to have been intact once
+ * shm_ring_release says so. */
+static inline const uint8_t *shm_ring_peek(shm_ring_reader_t *r, size_t *len) {
+    for (;;) {
+        if (r->rd == r->cached_head) {
+            r->cached_head = atomic_load_explicit(&r->hdr->head, memory_order_acquire);
+            if (r->rd == r->cached_head) {
+                if (!r->idle) r->waits++;
+                r->idle = 1;
+                return NULL;
+            }
+            r->idle = 0;
+            // Lapped while idle or between batches: the bytes at rd are gone
+            if (atomic_load_explicit(&r->hdr->valid_from, memory_order_relaxed) > r->rd) {
+                shm_ring_resync(r);
+                continue;
+            }
+        }
+        const uint8_t *rec = r->data + (r->rd & r->mask);
+        uint32_t l;
+        memcpy(&l, rec, sizeof(l));
+        // A length overwritten mid-read: never follow it past head
+        if (l > SHM_RING_MAX_MESSAGE || r->rd + shm_record_size(l) > r->cached_head) {
+            shm_ring_resync(r);
+            continue;
+        }
+        *len = l;
+        return rec + SHM_RING_RECORD_HEADER;
+    }
+}
+
+/* Reader: step past the message shm_ring_peek returned */
+static inline void shm_ring_next(shm_ring_reader_t *r) {
+    uint32_t l;
+    memcpy(&l, r->data + (r->rd & r->mask), sizeof(l));
+    r->rd += shm_record_size(l);
+    r->rd_seq++;
+    r->messages++;
+}
+
+/* Reader: end a batch. Returns 0, or -1 if the publisher overwrote part of
+ * the batch while it was being read (the messages decoded since the last
+ * release may be corrupt). Publishes the reader's cursor either way. */
+static inline int shm_ring_release(shm_ring_reader_t *r) {
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t valid_from = atomic_load_explicit(&r->hdr->valid_from, memory_order_relaxed);
+    int torn = valid_from > r->batch_start;
+    if (torn) {
+        r->torn_batches++;
+        if (valid_from > r->rd) shm_ring_resync(r);
+        atomic_store_explicit(&r->slot->overruns, r->overruns + r->torn_batches, memory_order_relaxed);
+    }
+    r->batch_start = r->rd;
+    atomic_store_explicit(&r->slot->cursor, r->rd, memory_order_relaxed);
+    atomic_store_explicit(&r->slot->messages, r->messages, memory_order_relaxed);
+    return torn ? -1 : 0;
+}
+
+#endif /* SHM_RING_H */
@@ -0,0 +1,101 @@
+/*
+ * Slab Pool - see slab_pool.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "slab_pool.h"
+
+#define HUGE_PAGE (2u << 20)
+
+static size_t round_up(size_t n, size_t to) {
+    return (n + to - 1) / to * to;
+}
+
+void *slab_pages_alloc(size_t bytes, int flags, size_t *mapped, slab_backing_t *backing) {
+    int populate = (flags & SLAB_PAGES_PREFAULT) ? MAP_POPULATE : 0;
+    size_t len = round_up(bytes ? bytes : 1, HUGE_PAGE);
+    void *p;
+
+    // Explicit hugepages fail at mmap time when too few are reserved
+    if (flags & SLAB_PAGES_HUGETLB) {
+        p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+        if (p != MAP_FAILED) {
+            *mapped = len;
+            *backing = SLAB_BACKING_HUGETLB;
+            return p;
+        }
+    }
+
+    // Ask for transparent huge pages before the first touch, so faults take 2 MB at a time
+    p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    *backing = madvise(p, len, MADV_HUGEPAGE) == 0 ? SLAB_BACKING_THP : SLAB_BACKING_NORMAL;
+    if (populate) {
+        for (size_t off = 0; off < len; off += 4096) ((volatile uint8_t *)p)[off] = 0;
+    }
+    *mapped = len;
+    return p;
+}
+
+void slab_pages_free(void *p, size_t mapped) {
+    if (p) munmap(p, mapped);
+}
+
+int slab_pool_init(slab_pool_t *p, size_t obj_size, uint32_t capacity, int flags) {
+    memset(p, 0, sizeof(*p));
+    p->obj_size = (uint32_t)round_up(obj_size < 4 ? 4 : obj_size, 4);
+    p->capacity = capacity;
+    p->free_head = SLAB_POOL_NIL;
+    p->base = slab_pages_alloc((size_t)p->obj_size * capacity, flags, &p->mapped, &p->backing);
+    return p->base ? 0 : -1;
+}
+
+void slab_pool_destroy(slab_pool_t *p) {
+    slab_pages_free(p->base, p->mapped);
+    p->base = NULL;
+}
+
+void slab_pool_get_stats(const slab_pool_t *p, slab_pool_stats_t *out) {
+    out->capacity = p->capacity;
+    out->live = p->live;
+    out->peak = p->peak;
+    out->touched = p->next;
+    out->free_listed = p->next - p->live;
+    out->allocs = p->allocs;
+    out->exhausted = p->exhausted;
+    out->obj_size = p->obj_size;
+    out->mapped = p->mapped;
+    out->backing = p->backing;
+}
+
+void slab_pool_stats_add(slab_pool_stats_t *dst, const slab_pool_stats_t *src) {
+    if (dst->capacity == 0) dst->backing = src->backing;
+    dst->capacity += src->capacity;
+    dst->live += src->live;
+    dst->peak += src->peak;
+    dst->touched += src->touched;
+    dst->free_listed += src->free_listed;
+    dst->allocs += src->allocs;
+    dst->exhausted += src->exhausted;
+    dst->obj_size = src->obj_size;
+    dst->mapped += src->mapped;
+}
+
+const char *slab_backing_name(slab_backing_t b) {
+    switch (b) {
+        case SLAB_BACKING_HUGETLB: return "hugetlb pages";
+        case SLAB_BACKING_THP: return "transparent huge pages";
+        default: return "4 KB pages";
+    }
+}
+
+void slab_pool_print_stats(const char *name, const slab_pool_stats_t *s, FILE *out) {
+    fprintf(out, "%s: %lu / %lu live (peak %lu), %lu touched, %lu free-listed (%.1f%% fragmented), "
+            "%lu exhausted, %.1f MB on %s\n",
+            name, s->live, s->capacity, s->peak, s->touched, s->free_listed,
+            s->touched ? 100.0 * s->free_listed / s->touched : 0.0, s->exhausted,
+            s->mapped / 1048576.0, slab_backing_name(s->backing));
+}
@@ -0,0 +1,131 @@
+/*
+ * Slab Pool - fixed-size object pools on preallocated (huge) pages
+ *
+ * The order books churn hundreds of millions of orders a day (add, then
+ * execute, cancel or delete) and a few million price levels. Each pool is
+ * one mapping reserved at create time and carved into fixed-size slots
+ * addressed by 32-bit index:
+ * - Never-used slots come from a bump pointer, so pages are only touched as
+ *   the day's peak grows
+ * - Freed slots go on an intrusive free list threaded through their first
+ *   4 bytes and are reused first (LIFO, so the next alloc is cache-hot)
+ * - alloc and free are a few inline loads and stores; malloc is never
+ *   called after create
+ *
+ * The mapping is backed by huge pages where the system allows it: explicit
+ * hugetlbfs pages (MAP_HUGETLB) with SLAB_PAGES_HUGETLB, falling back to
+ * transparent huge pages (madvise), falling back to normal pages. A pool of
+ * 4M orders then costs ~50 TLB entries instead of ~25K.
+ *
+ * SLAB_PAGES_PREFAULT touches every page at create time. Besides keeping
+ * page faults off the decode path, Linux places a page on the NUMA node of
+ * the thread that first touches it, so a pool created and prefaulted on a
+ * pinned worker thread is local to that worker's node.
+ *
+ * Occupancy counters: live and peak slots, slots touched (the bump
+ * pointer), slots waiting on the free list and allocations that failed.
+ * Fragmentation is the share of touched slots that sit on the free list:
+ * memory the pool has faulted in but is not using right now.
+ *
+ * Usage:
+ *   slab_pool_t p;
+ *   slab_pool_init(&p, sizeof(my_obj_t), 1 << 22, SLAB_PAGES_HUGETLB);
+ *   uint32_t i = slab_pool_alloc(&p);              // SLAB_POOL_NIL when full
+ *   my_obj_t *o = slab_pool_get(&p, i);
+ *   slab_pool_free(&p, i);
+ *   slab_pool_destroy(&p);
+ */
+
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+#define SLAB_POOL_NIL UINT32_MAX
+
+/* Mapping flags */
+#define SLAB_PAGES_HUGETLB  1       // try MAP_HUGETLB first (needs reserved hugepages)
+#define SLAB_PAGES_PREFAULT 2       // touch every page now, from the calling thread
+
+typedef enum {
+    SLAB_BACKING_NORMAL = 0,        // 4 KB pages
+    SLAB_BACKING_THP,               // transparent huge pages requested (madvise)
+    SLAB_BACKING_HUGETLB,           // explicit 2 MB hugetlbfs pages
+} slab_backing_t;
+
+typedef struct {
+    uint8_t *base;
+    uint32_t obj_size;
+    uint32_t capacity;
+    uint32_t next;                  // bump pointer into never-used slots
+    uint32_t free_head;             // head of the freed slot list
+    uint32_t live;
+    uint32_t peak;
+    uint64_t allocs;
+    uint64_t exhausted;             // allocs that found the pool full
+    size_t mapped;                  // bytes mapped, rounded to the page size
+    slab_backing_t backing;
+} slab_pool_t;
+
+typedef struct {
+    uint64_t capacity;
+    uint64_t live;
+    uint64_t peak;
+    uint64_t touched;               // slots ever handed out (bump pointer)
+    uint64_t free_listed;           // touched slots waiting on the free list
+    uint64_t allocs;
+    uint64_t exhausted;
+    uint64_t obj_size;
+    uint64_t mapped;
+    slab_backing_t backing;
+} slab_pool_stats_t;
+
+/* Map pages for bytes, huge pages first (see SLAB_PAGES_*). Returns NULL on
+ * failure; *mapped receives the length to pass to slab_pages_free. */
+void *slab_pages_alloc(size_t bytes, int flags, size_t *mapped, slab_backing_t *backing);
+void slab_pages_free(void *p, size_t mapped);
+
+/* Returns 0, or -1 if the mapping failed (obj_size is rounded up to 4) */
+int slab_pool_init(slab_pool_t *p, size_t obj_size, uint32_t capacity, int flags);
+void slab_pool_destroy(slab_pool_t *p);
+
+void slab_pool_get_stats(const slab_pool_t *p, slab_pool_stats_t *out);
+
+/* Sum pools of the same kind (per-worker arenas); backing is kept from dst
+ * unless dst is empty */
+void slab_pool_stats_add(slab_pool_stats_t *dst, const slab_pool_stats_t *src);
+
+/* "name: live / capacity (peak p), t touched, f free-listed (x% fragmented), M MB on <backing>" */
+void slab_pool_print_stats(const char *name, const slab_pool_stats_t *s, FILE *out);
+
+const char *slab_backing_name(slab_backing_t b);
+
+static inline void *slab_pool_get(const slab_pool_t *p, uint32_t idx) {
+    return p->base + (size_t)idx * p->obj_size;
+}
+
+static inline uint32_t slab_pool_alloc(slab_pool_t *p) {
+    uint32_t idx = p->free_head;
+    if (idx != SLAB_POOL_NIL) {
+        memcpy(&p->free_head, slab_pool_get(p, idx), sizeof(uint32_t));
+    } else if (p->next < p->capacity) {
+        idx = p->next++;
+    } else {
+        p->exhausted++;
+        return SLAB_POOL_NIL;
+    }
+    if (++p->live > p->peak) p->peak = p->live;
+    p->allocs++;
+    return idx;
+}
+
+static inline void slab_pool_free(slab_pool_t *p, uint32_t idx) {
+    memcpy(slab_pool_get(p, idx), &p->free_head, sizeof(uint32_t));
+    p->free_head = idx;
+    p->live--;
+}
+
+#endif /* SLAB_POOL_H */
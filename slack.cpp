@@ -1,7 +1,6 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <string.h>
-#include <mach/mach_time.h>
 #include <arpa/inet.h> // for ntohl
 
 typedef struct {
@@ -40,11 +39,11 @@ Message parseMessage(const unsigned char *msg) {
     memcpy(&tmp2, msg + 17, sizeof(tmp2));
     ee.executedContracts = ntohl(tmp2);
 
-    uint64_t tmp3;
+    uint32_t tmp3;
     memcpy(&tmp3, msg + 21, sizeof(tmp3));
     ee.crossNumber = ntohl(tmp3);
 
-    uint64_t tmp4;
+    uint32_t tmp4;
     memcpy(&tmp4, msg + 25, sizeof(tmp4));
     ee.matchNumber = ntohl(tmp4);
 
@@ -59,34 +58,15 @@ int main() {
         0x4E, 0x00, 0x00, 0x44, 0xC0, 0x00, 0x00, 0x00, 0x01
     };
 
-    mach_timebase_info_data_t timebase;
-    mach_timebase_info(&timebase);
-
-    const int iterations = 10000000;
-    volatile uint64_t dummy = 0;
-
-    uint64_t start = mach_absolute_time();
-    Message ee; // declare once for printing later
-    for (int i = 0; i < iterations; i++) {
-        ee = parseMessage(message);
-        dummy += ee.trackingNumber;
-    }
-    uint64_t end = mach_absolute_time();
-
-    double elapsed_ns = (double)(end - start) * (double)timebase.numer / (double)timebase.denom;
-    double elapsed_per_iter = elapsed_ns / iterations;
-
-    printf("Total elapsed time: %.4f ns\n", elapsed_ns);
-    printf("Average per iteration: %.4f ns\n", elapsed_per_iter);
-
-    if (dummy == 0) printf(""); // avoid unused variable warning
+    // timing lives in itch_bench (make bench), over real message mixes
+    Message ee = parseMessage(message);
 
     // print the last parsed message
     printf("\n--- Last Parsed Message ---\n");
     printf("Message Type: %c\n", ee.messageType);
     printf("Tracking Number: %d\n", ee.trackingNumber);
-    printf("Timestamp: %llu\n", ee.timestamp);
-    printf("Reference Number: %llu\n", ee.referenceNumber);
+    printf("Timestamp: %llu\n", (unsigned long long)ee.timestamp);
+    printf("Reference Number: %llu\n", (unsigned long long)ee.referenceNumber);
     printf("Executed Contracts: %d\n", ee.executedContracts);
     printf("Cross Number: %d\n", ee.crossNumber);
     printf("Match Number: %d:\n", ee.matchNumber);
@@ -0,0 +1,83 @@
+/*
+ * SPSC Ring - see spsc_ring.h
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include "spsc_ring.h"
+
+#define MIN_SIZE (1u << 20)
+#define SPIN_LIMIT 256
+#define YIELD_LIMIT 1024
+#define SLEEP_NS 50000
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ volatile("yield");
+#endif
+}
+
+spsc_ring_t *spsc_ring_create(size_t size) {
+    uint64_t n = MIN_SIZE;
+    while (n < size) n <<= 1;
+
+    spsc_ring_t *q = aligned_alloc(SPSC_CACHE_LINE, sizeof(spsc_ring_t));
+    if (!q) return NULL;
+    memset(q, 0, sizeof(*q));
+    q->buf = aligned_alloc(SPSC_CACHE_LINE, n + SPSC_SLACK);
+    if (!q->buf) {
+        free(q);
+        return NULL;
+    }
+    memset(q->buf + n, 0, SPSC_SLACK);
+    q->size = n;
+    q->mask = n - 1;
+    atomic_init(&q->head, 0);
+    atomic_init(&q->tail, 0);
+    atomic_init(&q->closed, 0);
+    return q;
+}
+
+void spsc_ring_destroy(spsc_ring_t *q) {
+    if (!q) return;
+    free(q->buf);
+    free(q);
+}
+
+void spsc_ring_close(spsc_ring_t *q) {
+    spsc_ring_commit(q);
+    atomic_store_explicit(&q->closed, 1, memory_order_release);
+}
+
+int spsc_ring_drained(spsc_ring_t *q) {
+    // closed is read first: once it is set, head is final
+    if (!atomic_load_explicit(&q->closed, memory_order_acquire)) return 0;
+    size_t len;
+    return spsc_ring_peek(q, &len) == NULL;
+}
+
+void spsc_ring_backoff(unsigned *spins) {
+    unsigned n = (*spins)++;
+    if (n < SPIN_LIMIT) {
+        cpu_relax();
+    } else if (n < YIELD_LIMIT) {
+        sched_yield();
+    } else {
+        struct timespec ts = { 0, SLEEP_NS };
+        nanosleep(&ts, NULL);
+    }
+}
+
+void spsc_ring_print_stats(const spsc_ring_t *q, FILE *out) {
+    fprintf(out, "=== Receive Ring ===\n");
+    fprintf(out, "Size: %.1f MB  High Water: %.1f KB (%.1f%%)\n", q->size / 1048576.0,
+            q->high_water / 1024.0, 100.0 * q->high_water / q->size);
+    fprintf(out, "Receiver Waits (ring full): %lu  Decoder Waits (ring empty): %lu\n\n",
+            q->producer_waits, q->consumer_waits);
+}
@@ -0,0 +1,152 @@
+/*
+ * SPSC Ring - lock-free single-producer / single-consumer message ring
+ *
+ * Variable-length messages are stored back to back in a power-of-two byte
+ * ring as [len:4][message] records, 8-byte aligned. A record never wraps:
+ * when one would not fit before the end of the buffer, the producer writes
+ * a skip marker and starts at offset 0. The buffer has slack past its end,
+ * so a message can always be read 8 bytes beyond its last byte.
+ *
+ * head (producer) and tail (consumer) sit on their own cache lines, and each
+ * side keeps a cached copy of the other's index so the shared line is only
+ * read when the cached view says the ring is full (or empty). Both sides
+ * work in batches: reservations become visible on spsc_ring_commit and
+ * consumed records are returned on spsc_ring_release, one store each.
+ *
+ * Usage:
+ *   spsc_ring_t *q = spsc_ring_create(16 << 20);
+ *   // producer
+ *   uint8_t *p = spsc_ring_reserve(q, len);     // NULL when full
+ *   memcpy(p, msg, len);
+ *   spsc_ring_commit(q);                        // per batch
+ *   // consumer
+ *   while ((m = spsc_ring_peek(q, &len))) { ...; spsc_ring_next(q); }
+ *   spsc_ring_release(q);                       // per batch
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define SPSC_CACHE_LINE 64
+#define SPSC_RECORD_HEADER 4
+#define SPSC_SLACK 64                       // readable bytes past the buffer end
+#define SPSC_SKIP 0xFFFFFFFFu               // rest of the buffer is unused
+
+typedef struct {
+    // Producer line
+    _Alignas(SPSC_CACHE_LINE) _Atomic uint64_t head;
+    uint64_t pub_head;          // reserved, not yet committed
+    uint64_t cached_tail;
+    uint64_t high_water;        // most bytes in use at a commit
+    uint64_t producer_waits;    // times the producer found the ring full
+    int producer_blocked;
+
+    // Consumer line
+    _Alignas(SPSC_CACHE_LINE) _Atomic uint64_t tail;
+    uint64_t read_tail;         // consumed, not yet released
+    uint64_t cached_head;
+    uint64_t consumer_waits;    // times the consumer found the ring empty
+    int consumer_idle;
+
+    // Shared, read-only after create
+    _Alignas(SPSC_CACHE_LINE) uint8_t *buf;
+    uint64_t size;
+    uint64_t mask;
+    _Atomic int closed;
+} spsc_ring_t;
+
+/* size is rounded up to a power of two (at least 1 MB). NULL on failure. */
+spsc_ring_t *spsc_ring_create(size_t size);
+void spsc_ring_destroy(spsc_ring_t *q);
+
+/* Producer: no more records will follow the last commit */
+void spsc_ring_close(spsc_ring_t *q);
+
+/* Consumer: closed and everything committed has been consumed */
+int spsc_ring_drained(spsc_ring_t *q);
+
+/* Spin, then yield, then sleep as *spins grows; reset it after progress */
+void spsc_ring_backoff(unsigned *spins);
+
+void spsc_ring_print_stats(const spsc_ring_t *q, FILE *out);
+
+static inline uint64_t spsc_record_size(size_t len) {
+    return (SPSC_RECORD_HEADER + len + 7) & ~(uint64_t)7;
+}
+
+/* Producer: room for a len-byte message, or NULL if the ring is full */
+static inline uint8_t *spsc_ring_reserve(spsc_ring_t *q, size_t len) {
+    uint64_t need = spsc_record_size(len);
+    uint64_t off = q->pub_head & q->mask;
+    uint64_t skip = off + need > q->size ? q->size - off : 0;
+    if (q->pub_head + skip + need - q->cached_tail > q->size) {
+        q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+        if (q->pub_head + skip + need - q->cached_tail > q->size) {
+            if (!q->producer_blocked) q->producer_waits++;
+            q->producer_blocked = 1;
+            return NULL;
+        }
+    }
+    q->producer_blocked = 0;
+    if (skip) {
+        uint32_t marker = SPSC_SKIP;
+        memcpy(q->buf + off, &marker, sizeof(marker));
+        q->pub_head += skip;
+        off = 0;
+    }
+    uint32_t l = (uint32_t)len;
+    memcpy(q->buf + off, &l, sizeof(l));
+    q->pub_head += need;
+    return q->buf + off + SPSC_RECORD_HEADER;
+}
+
+/* Producer: make every reserved record visible to the consumer */
+static inline void spsc_ring_commit(spsc_ring_t *q) {
+    uint64_t used = q->pub_head - atomic_load_explicit(&q->tail, memory_order_relaxed);
+    if (used > q->high_water) q->high_water = used;
+    atomic_store_explicit(&q->head, q->pub_head, memory_order_release);
+}
+
+/* Consumer: the next message, or NULL if none is committed */
+static inline const uint8_t *spsc_ring_peek(spsc_ring_t *q, size_t *len) {
+    for (;;) {
+        if (q->read_tail == q->cached_head) {
+            q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+            if (q->read_tail == q->cached_head) {
+                if (!q->consumer_idle) q->consumer_waits++;
+                q->consumer_idle = 1;
+                return NULL;
+            }
+            q->consumer_idle = 0;
+        }
+        uint64_t off = q->read_tail & q->mask;
+        uint32_t l;
+        memcpy(&l, q->buf + off, sizeof(l));
+        if (l == SPSC_SKIP) {
+            q->read_tail += q->size - off;
+            continue;
+        }
+        *len = l;
+        return q->buf + off + SPSC_RECORD_HEADER;
+    }
+}
+
+/* Consumer: step past the message spsc_ring_peek returned */
+static inline void spsc_ring_next(spsc_ring_t *q) {
+    uint32_t l;
+    memcpy(&l, q->buf + (q->read_tail & q->mask), sizeof(l));
+    q->read_tail += spsc_record_size(l);
+}
+
+/* Consumer: hand consumed records back to the producer */
+static inline void spsc_ring_release(spsc_ring_t *q) {
+    atomic_store_explicit(&q->tail, q->read_tail, memory_order_release);
+}
+
+#endif /* SPSC_RING_H */